@@ -1,5 +1,8 @@
 #pragma once
 #include <pybind11/pybind11.h>
+#include "engine/cancellation.hpp"
+#include <memory>
+#include <optional>
 
 namespace qe::pybind {
 
@@ -11,4 +14,14 @@ void bind_surface(pybind11::module_& m);
 void bind_options(pybind11::module_& m);
 void bind_pricer(pybind11::module_& m);
 
+// runs f without holding the GIL, under token if one is given. f must not
+// touch Python objects
+template <class F>
+auto run_released(const std::shared_ptr<CancellationToken>& token, F&& f) {
+    pybind11::gil_scoped_release release;
+    std::optional<CancellationToken::Scope> scope;
+    if (token) scope.emplace(*token);
+    return f();
+}
+
 } // namespace qe::pybind
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <stdexcept>
+
+
+// thrown by a run whose cancellation token was cancelled
+struct Cancelled : std::runtime_error {
+    Cancelled() : std::runtime_error("the computation was cancelled") {}
+};
+
+
+/**
+ * @brief Flag that stops the runs of the engine started under it
+ *
+ * A token is installed on the calling thread with a Scope. The engine reads
+ * the token of the calling thread when a run starts, its workers then skip
+ * the remaining paths once the token is cancelled, and the run throws
+ * Cancelled.
+ *
+ * A token may be linked to a parent token, it is then also cancelled when
+ * the parent is.
+ *
+ * @note cancel may be called from any thread.
+ */
+class CancellationToken {
+
+public:
+    CancellationToken() = default;
+    // the parent, if any, must outlive the token
+    explicit CancellationToken(const CancellationToken* parent) : parent_(parent) {}
+
+    void cancel() {cancelled_.store(true, std::memory_order_relaxed);}
+    bool cancelled() const {
+        return cancelled_.load(std::memory_order_relaxed) || (parent_ && parent_->cancelled());
+    }
+
+    // token installed on the calling thread, nullptr if none
+    static const CancellationToken* current() {return current_;}
+
+    // whether token is set and cancelled
+    static bool is_cancelled(const CancellationToken* token) {return token && token->cancelled();}
+
+    // throws Cancelled if token is set and cancelled
+    static void throw_if_cancelled(const CancellationToken* token) {
+        if (is_cancelled(token)) throw Cancelled();
+    }
+
+    // installs a token on the calling thread for the lifetime of the scope
+    class Scope {
+    public:
+        explicit Scope(const CancellationToken& token) : previous_(current_) {current_ = &token;}
+        ~Scope() {current_ = previous_;}
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        const CancellationToken* previous_;
+    };
+
+private:
+    std::atomic<bool> cancelled_ {false};
+    const CancellationToken* parent_ = nullptr;
+    static inline thread_local const CancellationToken* current_ = nullptr;
+
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "engine/cancellation.hpp"
+#include "engine/montecarlo.hpp"
+#include "engine/randomstore.hpp"
+#include <memory>
+#include "types/simulationresult.hpp"
+#include "types/timegrid.hpp"
+#include <future>
+#include <optional>
+#include <vector>
+
+
+/**
+ * @brief Generates a large simulation as successive blocks of paths. The
+ * next block is simulated in the background while the current one is read.
+ *
+ * @param engine the engine to copy. The blocks are drawn from the state of
+ * its generator at construction, which does not advance
+ * @param S0 the initial spot
+ * @param grid the simulation times
+ * @param n_paths the total number of paths
+ * @param chunk_paths the number of paths of each block, the last block holds
+ * the remaining paths
+ * @param v0 the initial volatility
+ * @param observe optional : the step indices to store. The terminal step is
+ * always stored
+ *
+ * @note the blocks are simulated under the cancellation token of the thread
+ * that builds the generator : once it is cancelled, the block in progress
+ * stops and next throws Cancelled. The token must outlive the generator.
+ *
+ * @note the blocks put end to end are the paths of generate_spot with the
+ * same seed, whatever chunk_paths. Unless the engine has a Workspace, the
+ * blocks are taken from a small pool of its own : memory stays at a few
+ * blocks as long as the previous blocks are released.
+ */
+class ChunkedGenerator {
+
+public:
+    ChunkedGenerator(const MonteCarlo& engine, double S0, const TimeGrid& grid, size_t n_paths, size_t chunk_paths,
+                     std::optional<double> v0 = std::nullopt,
+                     std::optional<std::vector<size_t>> observe = std::nullopt);
+
+    // stops the block in progress and waits for it
+    ~ChunkedGenerator();
+
+    ChunkedGenerator(const ChunkedGenerator&) = delete;
+    ChunkedGenerator& operator=(const ChunkedGenerator&) = delete;
+
+    /**
+     * @brief Returns the next block of paths, waiting for it if needed, and
+     * starts the simulation of the following one
+     *
+     * @return std::optional<SimulationResult> : the block, nullopt once every
+     * path was returned
+     *
+     * @throws Cancelled if the token of the generator was cancelled
+     */
+    std::optional<SimulationResult> next();
+
+    // number of paths not returned yet
+    size_t remaining() const {return n_paths_ - returned_;}
+    size_t chunk_paths() const {return chunk_paths_;}
+
+private:
+    // starts the simulation of the next block in the background
+    void launch();
+
+    MonteCarlo engine_;
+    // random store of the engine, read by blocks
+    const std::shared_ptr<const RandomStore> randoms_;
+    const double S0_;
+    const TimeGrid grid_;
+    const std::optional<double> v0_;
+    const std::optional<std::vector<size_t>> observe_;
+    const size_t n_paths_;
+    const size_t chunk_paths_;
+    size_t launched_ = 0;
+    size_t returned_ = 0;
+    std::optional<std::future<SimulationResult>> pending_;
+    // stops the blocks, linked to the token of the caller
+    CancellationToken token_;
+
+};
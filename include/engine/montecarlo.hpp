@@ -8,13 +8,22 @@
 */
 #pragma once
 #include "engine.hpp"
+#include "engine/randomstore.hpp"
+#include "engine/simulationcache.hpp"
+#include "engine/workspace.hpp"
+#include "payoff/accumulator.hpp"
 #include "schemes/schemes.hpp"
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <random>
+#include <span>
+#include <string>
 #include <vector>
 #include "types/path.hpp"
+#include "types/pathfeatures.hpp"
 #include "types/simulationresult.hpp"
+#include "types/timegrid.hpp"
 
 
 /**
@@ -22,6 +31,9 @@
  *
  * @param scheme : a scheme instanciated with a model to simulate 
  * 
+ * @note runs may be started concurrently on one engine, for instance from
+ * several Python threads, as long as it is not reconfigured meanwhile. A
+ * run started under a CancellationToken stops once the token is cancelled.
  */
 class MonteCarlo : Engine 
 {
@@ -72,6 +84,19 @@ public:
      * @param v0 optionnal initial volatility
      */
     void generate_path_inplace(double* s_path, double* v_path, double S0, size_t n, double T, std::mt19937& rng, std::optional<double> v0);
+
+    /**
+     * @brief Generates a path on a time grid and insert it directly in 
+     * the main path vector
+     * 
+     * @param s_path a pointer to the nth path position in the main spot path vector
+     * @param v_path a pointer to the nth path position in the main vol path vector
+     * @param S0 initial spot
+     * @param grid the simulation times, the path holds grid.size() values
+     * @param rng random number generator 
+     * @param v0 optionnal initial volatility
+     */
+    void generate_path_inplace(double* s_path, double* v_path, double S0, const TimeGrid& grid, std::mt19937& rng, std::optional<double> v0);
     
     /**
      * @brief Simulates n_paths paths that follow the spot process.  
@@ -81,24 +106,243 @@ public:
      * @param T the time horizon
      * @param n_path the number of paths to simulate
      * @param v0 the initial volatility 
+     * @param observe optional : the step indices to store. All the steps are
+     * simulated but only these columns are written. The terminal step is
+     * always stored
      * @return SimulationResult
      */
-    SimulationResult generate_spot(float S0, size_t n, float T, size_t n_path, std::optional<double> v0 = std::nullopt);
+    SimulationResult generate_spot(float S0, size_t n, float T, size_t n_path, std::optional<double> v0 = std::nullopt,
+                                   std::optional<std::vector<size_t>> observe = std::nullopt);
+
+    /**
+     * @brief Simulates n_paths paths on an explicit time grid. Each step
+     * uses its own dt, so a grid restricted to the event dates of a product
+     * only simulates those dates.
+     * 
+     * @param S0 the initial spot
+     * @param grid the simulation times
+     * @param n_paths the number of paths to simulate
+     * @param v0 the initial volatility 
+     * @param observe optional : the step indices to store, see TimeGrid::indices
+     * to select them by time. The terminal step is always stored
+     * @return SimulationResult : one value per path and per stored time, in
+     * the layout set with configure
+     */
+    SimulationResult generate_spot(double S0, const TimeGrid& grid, size_t n_paths, std::optional<double> v0 = std::nullopt,
+                                   std::optional<std::vector<size_t>> observe = std::nullopt);
     
+    /**
+     * @brief Draws the seeds of n_paths paths but does not simulate them.
+     * The result stores the seeds and regenerates the paths by blocks each
+     * time they are read.
+     * 
+     * @param S0 the initial spot
+     * @param grid the simulation times
+     * @param n_paths the number of paths to simulate
+     * @param v0 the initial volatility 
+     * @param observe optional : the step indices to store. The terminal step
+     * is always stored
+     * @param cache_blocks the number of regenerated blocks of 1024 paths
+     * kept in memory, least recently used first out. 0 keeps none
+     * @return SimulationResult : a lazy result, see SimulationResult::is_lazy
+     * 
+     * @note the paths are the ones of generate_spot with the same seed. The
+     * result uses the scheme and the number of threads of the engine at the
+     * time of the call. Memory only depends on the number of paths through
+     * the seeds, at the cost of one simulation per read of a block that is
+     * not cached.
+     */
+    SimulationResult generate_lazy(double S0, const TimeGrid& grid, size_t n_paths, std::optional<double> v0 = std::nullopt,
+                                   std::optional<std::vector<size_t>> observe = std::nullopt, size_t cache_blocks = 0);
+
+    /**
+     * @brief Simulates n_paths paths on an explicit time grid and writes
+     * them to an archive on the disk instead of the memory, see
+     * SimulationArchive. The number of paths is only limited by the disk.
+     * 
+     * @param path the archive directory, created if needed
+     * @param S0 the initial spot
+     * @param grid the simulation times
+     * @param n_paths the number of paths to simulate
+     * @param v0 the initial volatility 
+     * @param observe optional : the step indices to store. The terminal step
+     * is always stored
+     * @return SimulationResult : the archive, memory mapped read-only
+     * @note the paths are the ones of generate_spot with the same seed, in
+     * the layout set with configure. The header describes the scheme.
+     */
+    SimulationResult generate_to_file(const std::string& path, double S0, const TimeGrid& grid, size_t n_paths, 
+                                      std::optional<double> v0 = std::nullopt,
+                                      std::optional<std::vector<size_t>> observe = std::nullopt);
+
+    /**
+     * @brief Simulates n_paths paths and monitors a knock-out condition on
+     * each step. A path stops as soon as it breaches the barrier.
+     * 
+     * @param S0 the initial spot
+     * @param grid the simulation times
+     * @param n_paths the number of paths to simulate
+     * @param knock the knock-out condition, checked on S0 and after each step
+     * @param v0 the initial volatility 
+     * @return SimulationResult : the terminal value of each path (the value
+     * at knock-out for knocked paths) and the knock-out flags
+     * 
+     * @note the paths and the random numbers they use are the ones of
+     * generate_spot with the same seed. Paths are dynamically scheduled
+     * across threads since knocked paths finish early.
+     */
+    SimulationResult generate_monitored(double S0, const TimeGrid& grid, size_t n_paths, KnockCondition knock, 
+                                        std::optional<double> v0 = std::nullopt);
+
+    /**
+     * @brief Simulates n_paths paths and feeds every state to payoff
+     * accumulators. The paths are never stored, memory does not depend on
+     * the number of steps.
+     * 
+     * @param S0 the initial spot
+     * @param grid the simulation times
+     * @param n_paths the number of paths to simulate
+     * @param accumulators one accumulator per payoff, copied for each thread
+     * @param v0 the initial volatility 
+     * @return std::vector<double> : the average payoff of each accumulator
+     * 
+     * @note the paths are the ones of generate_spot with the same seed. A
+     * path stops as soon as every accumulator is finished. Payoffs are summed
+     * by fixed blocks of paths, so the averages do not depend on n_jobs.
+     */
+    std::vector<double> accumulate(double S0, const TimeGrid& grid, size_t n_paths, 
+                                   const std::vector<std::unique_ptr<PayoffAccumulator>>& accumulators,
+                                   std::optional<double> v0 = std::nullopt);
+
+    /**
+     * @brief Simulates n_paths paths and only keeps their features : the
+     * terminal, maximum, minimum and average spot
+     * 
+     * @param S0 the initial spot
+     * @param grid the simulation times
+     * @param n_paths the number of paths to simulate
+     * @param v0 the initial volatility 
+     * @return PathFeatures : the features of each path
+     * @note the paths are the ones of generate_spot with the same seed
+     */
+    PathFeatures generate_features(double S0, const TimeGrid& grid, size_t n_paths, std::optional<double> v0 = std::nullopt);
+
+    /**
+     * @brief Simulates n_paths paths with each scheme of a batch, such as
+     * one model under many parameter sets, on shared random numbers
+     * 
+     * @param schemes the schemes to simulate, in place of the engine scheme
+     * @param S0 the initial spot
+     * @param grid the simulation times
+     * @param n_paths the number of paths of each scheme
+     * @param v0 the initial volatility 
+     * @return std::vector<SimulationResult> : the paths of each scheme, in
+     * the layout of the engine
+     * 
+     * @note the normals of a path are drawn once, as many per step as the
+     * scheme with the most random dimensions reads, and every scheme steps
+     * on them (see Scheme::step_from) : the paths of a scheme are the ones
+     * of an engine reading a RandomStore generated with the same seed. The
+     * states of the schemes are kept side by side and advanced step by step,
+     * so a path is only drawn once for the whole batch. Consecutive schemes
+     * of one type are stepped by their batch kernel, which holds their
+     * parameters as arrays (see Scheme::batch), the others by step_from. The
+     * generator advances as for a single run of n_paths paths.
+     */
+    std::vector<SimulationResult> generate_batch(const std::vector<std::shared_ptr<Scheme>>& schemes, double S0, const TimeGrid& grid,
+                                                 size_t n_paths, std::optional<double> v0 = std::nullopt);
+
+    /**
+     * @brief Same as accumulate for each scheme of a batch, on the paths of
+     * generate_batch. The paths are never stored
+     * 
+     * @param schemes the schemes to simulate, in place of the engine scheme
+     * @param S0 the initial spot
+     * @param grid the simulation times
+     * @param n_paths the number of paths of each scheme
+     * @param accumulators one accumulator per payoff, copied for each scheme
+     * and each thread
+     * @param v0 the initial volatility 
+     * @return std::vector<std::vector<double>> : the average payoff of each
+     * accumulator, one row per scheme
+     */
+    std::vector<std::vector<double>> accumulate_batch(const std::vector<std::shared_ptr<Scheme>>& schemes, double S0,
+                                                      const TimeGrid& grid, size_t n_paths,
+                                                      const std::vector<std::unique_ptr<PayoffAccumulator>>& accumulators,
+                                                      std::optional<double> v0 = std::nullopt);
+
     /**
      * @brief Method allowing to configure the engine 
      * 
      * @param seed : the seed to be used for the generation
+     * @param n_jobs : the number of threads, -1 for all the cores
+     * @param return_volatility : whether the volatility paths are stored
+     * @param layout : the order in which generate_spot stores the paths.
+     * TimeMajor makes the values of all the paths at a step contiguous
      */
     void configure(std::optional<int> seed = std::nullopt, 
                    std::optional<int> n_jobs = std::nullopt, 
-                   std::optional<bool> return_volatility = std::nullopt);
+                   std::optional<bool> return_volatility = std::nullopt,
+                   std::optional<Layout> layout = std::nullopt);
     
     //returns the current seed
     int get_seed() {return seed_;}
 
+    // number of threads of the runs, see configure
+    int get_n_jobs() const {return n_jobs_;}
+
+    /**
+     * @brief Sets the pool from which the paths and seeds of the following
+     * runs are taken, see Workspace
+     * 
+     * @param workspace the pool, shared by the copies of the engine. nullptr
+     * allocates the buffers of each run
+     */
+    void set_workspace(std::shared_ptr<Workspace> workspace) {workspace_ = std::move(workspace);}
+    const std::shared_ptr<Workspace>& get_workspace() const {return workspace_;}
+
+    /**
+     * @brief Sets the cache of the runs of generate_spot and
+     * generate_features, see SimulationCache
+     * 
+     * @param cache the cache, shared by the copies of the engine. nullptr
+     * disables caching
+     * @note only seeded, reset runs are cached : a run is stored when it
+     * starts right after configure with a seed or reset_rng, and identified
+     * by the seed, the spot, the grid, the settings and the parameters of the
+     * scheme at full precision. Any later identical run then returns the
+     * stored paths, wherever the generator is, so that repeated pricings
+     * reuse their paths without reset_rng. The generator still advances as
+     * if the paths were simulated. Without a seed nothing is cached.
+     */
+    void set_cache(std::shared_ptr<SimulationCache> cache) {cache_ = std::move(cache);}
+    const std::shared_ptr<SimulationCache>& get_cache() const {return cache_;}
+
+    /**
+     * @brief Sets the random numbers read by the runs of the engine
+     * 
+     * @param store the normals of the paths, shared by the copies of the
+     * engine. nullptr draws them from the generator again
+     * @note every run reads the first n_paths paths of the store, whose
+     * number of steps must match the grid of the run. The generator does not
+     * advance and the runs are not cached.
+     */
+    void set_random_store(std::shared_ptr<const RandomStore> store) {randoms_ = std::move(store);}
+    const std::shared_ptr<const RandomStore>& get_random_store() const {return randoms_;}
+
+    //returns the scheme used for the generation
+    const Scheme& get_scheme() const {return *scheme_;}
+
+    // advances the generator past the seeds of n_paths paths, as a run of
+    // n_paths paths does
+    void skip_paths(size_t n_paths);
+
     // Reset the state of the random number generator to its initial state
-    void reset_rng() {rng_.seed(seed_);};
+    void reset_rng() {
+        rng_.seed(seed_);
+        drawn_ = 0;
+        from_seed_ = true;
+    };
     
     // Forgets the previously set seed and set a new random seed
     void reset_seed() {
@@ -106,16 +350,75 @@ public:
         std::mt19937 rng(rd());
         seed_ = rng();
         user_set_seed_ = false; 
+        // the generator keeps its state until reset_rng
+        from_seed_ = false;
     }
 
     private:
     const std::shared_ptr<Scheme> scheme_; 
 
+    // random numbers of one path, from a generator or from a RandomStore
+    class PathDraws;
+
+    // generate_path_inplace with an explicit scheme, used with the scheme
+    // prepared for the current run. Only the observed steps are written,
+    // all of them if observed is empty
+    static void generate_path_inplace(const Scheme& scheme, double* s_path, double* v_path, double S0, const TimeGrid& grid, 
+                                      PathDraws& draws, std::optional<double> v0, bool with_vol,
+                                      std::span<const size_t> observed);
+
+    // path source of generate_lazy
+    class Regenerator;
+
+    // schemes of a batch prepared for the grid, and the scheme reading the
+    // most normals per step
+    struct BatchSchemes;
+    static BatchSchemes prepare_batch(const std::vector<std::shared_ptr<Scheme>>& schemes, const TimeGrid& grid, const char* where);
+
+    // simulates n_paths paths into the given buffers, in the layout of the
+    // engine. Only the observed steps are written, all of them if observed
+    // is empty. v_all_paths is only written if the volatility is returned
+    void simulate_into(double* s_all_paths, double* v_all_paths, double S0, const TimeGrid& grid, size_t n_paths,
+                       std::optional<double> v0, std::span<const size_t> observed, size_t n_cols,
+                       size_t* first_seed = nullptr);
+
+    // sorted step indices of the stored columns, ending with the terminal
+    // step. Every step if observe is not set
+    static std::vector<size_t> observed_columns(size_t n, const std::optional<std::vector<size_t>>& observe, const char* where);
+
+    // draws one seed per path from the engine generator. first_seed receives
+    // the number of seeds drawn before them
+    std::shared_ptr<std::vector<size_t>> draw_seeds(size_t n_paths, size_t* first_seed = nullptr);
+
+    // seeds of a run, nullptr when the paths read the random store, which
+    // is checked against the run
+    std::shared_ptr<std::vector<size_t>> run_seeds(const Scheme& scheme, const TimeGrid& grid, size_t n_paths,
+                                                   size_t* first_seed = nullptr);
+
+    // key of a run in the cache, nullopt without cache, with a random store
+    // or when the generator was not seeded from seed_
+    std::optional<SimulationKey> cache_key(SimulationKey::Kind kind, double S0, const TimeGrid& grid, size_t n_paths,
+                                           std::optional<double> v0, std::vector<size_t> observed) const;
+
+    // cached run of key, the generator skips the paths of the run on a hit
+    std::shared_ptr<const SimulationCache::Run> cached_run(const SimulationKey& key);
+
+    // a buffer of n values, from the workspace if the engine has one
+    std::shared_ptr<std::vector<double>> buffer(size_t n);
+
     size_t seed_;
     std::mt19937 rng_;
+    std::shared_ptr<std::mutex> rng_mutex_ = std::make_shared<std::mutex>();
     int n_jobs_ = 1;
     bool user_set_seed_ = false;
     bool return_volatility_ = true; 
+    Layout layout_ = PathMajor;
+    std::shared_ptr<Workspace> workspace_;
+    std::shared_ptr<SimulationCache> cache_;
+    std::shared_ptr<const RandomStore> randoms_;
+    // seeds drawn since the generator was seeded, from seed_ if from_seed_
+    size_t drawn_ = 0;
+    bool from_seed_ = true;
 
     
 };
\ No newline at end of file
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+
+
+/**
+ * @brief Standard normals of a simulation, generated once and read by the
+ * runs of any engine, see MonteCarlo::set_random_store
+ *
+ * The normals of path p are n_steps * dims contiguous values, the dims
+ * normals of each step in turn. Runs reading the same store share their
+ * random numbers : bumped spots, bumped parameters or another scheme of
+ * the same model are compared on the same paths, and the runs draw nothing
+ * from their generator.
+ *
+ * @param n_paths the number of paths
+ * @param n_steps the number of steps of each path
+ * @param dims the number of normals of each step, at least the
+ * random_dimensions() of the schemes reading the store
+ * @param seed the seed of the generation
+ * @param n_jobs the number of threads of the generation, -1 for all
+ *
+ * @note path p is generated from the p-th seed drawn from an std::mt19937
+ * seeded with seed, each step from a new std::normal_distribution : the
+ * store holds the normals that an engine configured with the same seed
+ * draws for its first run with the Euler or EulerHeston schemes.
+ */
+class RandomStore {
+
+public:
+    RandomStore(size_t n_paths, size_t n_steps, size_t dims = 1, size_t seed = 0, int n_jobs = -1);
+
+    /**
+     * @brief Builds a store over normals held outside of it, such as a
+     * memory mapped archive
+     *
+     * @param storage the owner of the memory, kept alive by the store
+     * @param values the normals, n_paths * n_steps * dims values
+     * @param n_steps the number of steps of each path
+     * @param dims the number of normals of each step
+     */
+    RandomStore(std::shared_ptr<const void> storage, std::span<const double> values, size_t n_steps, size_t dims);
+
+    size_t n_paths() const {return n_paths_;}
+    size_t n_steps() const {return n_steps_;}
+    size_t dims() const {return dims_;}
+    size_t bytes() const {return values_.size() * sizeof(double);}
+
+    // every normal of the store, path by path
+    std::span<const double> values() const {return values_;}
+    // the n_steps * dims normals of path p
+    std::span<const double> path(size_t p) const {return values_.subspan(p * n_steps_ * dims_, n_steps_ * dims_);}
+
+    /**
+     * @brief Returns the store of count paths starting at path first,
+     * sharing the normals of this one
+     */
+    RandomStore rows(size_t first, size_t count) const;
+
+    /**
+     * @brief Writes the store to a SimulationArchive directory, whose spots
+     * are the normals of each path
+     *
+     * @param path the archive directory, created if needed
+     */
+    void save(const std::string& path) const;
+
+    /**
+     * @brief Opens a store written by save. The normals are memory mapped
+     * read-only, they are read from the disk when a run reads them
+     *
+     * @param path the archive directory
+     */
+    static RandomStore load(const std::string& path);
+
+private:
+    std::shared_ptr<const void> storage_;
+    std::span<const double> values_;
+    size_t n_paths_;
+    size_t n_steps_;
+    size_t dims_;
+
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "schemes/schemes.hpp"
+#include "types/lrucache.hpp"
+#include "types/pathfeatures.hpp"
+#include "types/simulationresult.hpp"
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+
+/**
+ * @brief Everything a run of the engine depends on
+ *
+ * @note the scheme is identified by its description and its parameters at
+ * full precision. A scheme without parameters is identified by its object,
+ * which the key then keeps alive. Only the runs started right after the
+ * generator was seeded with seed are cached, so the key holds the seed but
+ * not the position of the generator.
+ */
+struct SimulationKey {
+    enum Kind {Spot, Features};
+
+    Kind kind;
+    std::string description;
+    std::vector<double> parameters;
+    // only set for the schemes without parameters
+    std::shared_ptr<const Scheme> scheme;
+    double S0;
+    std::optional<double> v0;
+    std::vector<double> times;
+    size_t n_paths;
+    std::vector<size_t> observed;
+    Layout layout;
+    bool with_vol;
+    size_t seed;
+
+    bool operator==(const SimulationKey& other) const = default;
+};
+
+struct SimulationKeyHash {
+    size_t operator()(const SimulationKey& key) const;
+};
+
+
+/**
+ * @brief Least recently used cache of the runs of an engine, bounded by the
+ * memory of the cached paths
+ *
+ * @param max_bytes the memory the cached runs may hold
+ *
+ * @note a cached run is shared : the paths returned by a hit are the ones of
+ * the first run, they are never copied. The cache can be shared by several
+ * engines and threads.
+ */
+class SimulationCache {
+
+public:
+    using Run = std::variant<SimulationResult, PathFeatures>;
+
+    explicit SimulationCache(size_t max_bytes) : runs_(max_bytes) {}
+
+    // the cached run of key, nullptr if none
+    std::shared_ptr<const Run> get(const SimulationKey& key) {return runs_.get(key);}
+
+    // caches a run, whose memory is counted against max_bytes
+    void put(const SimulationKey& key, Run run);
+
+    void clear() {runs_.clear();}
+
+    size_t size() const {return runs_.size();}
+    size_t bytes() const {return runs_.cost();}
+    size_t max_bytes() const {return runs_.capacity();}
+    size_t hits() const {return runs_.hits();}
+    size_t misses() const {return runs_.misses();}
+
+private:
+    LruCache<SimulationKey, Run, SimulationKeyHash> runs_;
+
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+/**
+ * @brief Pool of buffers kept alive across the runs of an engine, so that
+ * repeated simulations of the same size do not allocate, page fault and
+ * zero their paths and seeds again
+ *
+ * @param max_buffers the maximum number of buffers of each type kept by the
+ * pool. Buffers acquired beyond are not recycled
+ *
+ * @note a buffer is handed out again only once every SimulationResult (or
+ * NumPy view) using it has been destroyed : results built on a workspace
+ * stay valid for as long as they live. A buffer only grows, when a larger
+ * run needs it. The pool can be shared by several engines and threads.
+ */
+class Workspace {
+
+public:
+    explicit Workspace(size_t max_buffers = 4) : max_buffers_(max_buffers) {}
+
+    /**
+     * @brief Returns a buffer of n values, recycled from a previous run if
+     * one is free
+     *
+     * @param n the number of values
+     * @return std::shared_ptr<std::vector<double>> : a buffer of size n. Its
+     * values are the ones left by the previous user
+     */
+    std::shared_ptr<std::vector<double>> values(size_t n);
+
+    // same as values, for the seeds of the paths
+    std::shared_ptr<std::vector<size_t>> seeds(size_t n);
+
+    // drops the buffers that are not in use
+    void release();
+
+    // memory held by the pool, in use or not
+    size_t reserved_bytes() const;
+    // number of buffers handed out by allocating, or by recycling
+    size_t allocations() const;
+    size_t reuses() const;
+
+private:
+    template <class T>
+    using Pool = std::vector<std::shared_ptr<std::vector<T>>>;
+
+    const size_t max_buffers_;
+    Pool<double> values_;
+    Pool<size_t> seeds_;
+    size_t allocations_ = 0;
+    size_t reuses_ = 0;
+    mutable std::mutex mutex_;
+
+    template <class T>
+    std::shared_ptr<std::vector<T>> acquire(Pool<T>& pool, size_t n);
+
+};
@@ -6,6 +6,8 @@
 #include "types/path.hpp"
 #include "types/simulationresult.hpp"
 #include <memory>
+#include <optional>
+#include <span>
 
 
 struct Instrument {
@@ -35,12 +37,35 @@ struct Instrument {
      * @param simulation A SimulationResult instance
      * @return double 
      * @note This method returns the average of the payoffs of 
-     * all the Path of the Simulation 
+     * all the Path of the Simulation. If the simulation monitored a
+     * knock-out condition, it must be the one of the payoff and knocked
+     * out paths pay zero.
      */
     double compute_payoff(const SimulationResult& simulation) const;
 
     double get_maturity() const {return contract_.T;};
 
+    // true if the payoff of the instrument reads the path before maturity
+    bool path_dependent() const {return payoff_->path_dependent();};
+
+    // knock-out condition of the payoff, if any
+    std::optional<KnockCondition> knock_out() const {return payoff_->knock_out();};
+
+    // true if the payoff can be computed from the path features
+    bool uses_features() const {return payoff_->uses_features();};
+
+    // payoff of each path computed from its features, see Payoff::compute_features
+    void compute_features(const PathFeatures& features, std::span<double> out) const {
+        payoff_->compute_features(features, contract_.K, out);
+    };
+
+    // paths per call of the payoff, see Payoff::chunk_paths
+    size_t chunk_paths() const {return payoff_->chunk_paths();};
+
+    // single pass accumulator of the payoff at the strike of the contract,
+    // nullptr if the payoff needs the stored path
+    std::unique_ptr<PayoffAccumulator> accumulator() const {return payoff_->accumulator(contract_.K);};
+
     private:
         OptionContract contract_;
         std::shared_ptr<Payoff> payoff_; 
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "payoff/payoff.h"
+#include "types/barrier.hpp"
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+
+// payoff of a row of an InstrumentTable
+enum PayoffCode : int32_t {CallCode = 0, PutCode = 1, DigitalCallCode = 2, DigitalPutCode = 3};
+
+
+/**
+ * @brief Columnar description of a set of options, one row per option
+ *
+ * The columns are read in place, so that options defined by arrays (NumPy
+ * for instance) are priced without building an Instrument for each of them.
+ *
+ * @param K the strikes
+ * @param T the maturities
+ * @param payoff the PayoffCode of each row
+ * @param barrier the discretely monitored barrier of each row, NaN for a
+ * row without barrier. Empty if no row has a barrier
+ * @param direction the Direction of the barrier of each row, empty if
+ * barrier is empty
+ * @param nature the Nature of the barrier of each row, empty if barrier is
+ * empty
+ * @note the columns are views : the arrays must outlive the table.
+ */
+struct InstrumentTable {
+    std::span<const double> K;
+    std::span<const double> T;
+    std::span<const int32_t> payoff;
+    std::span<const double> barrier;
+    std::span<const int32_t> direction;
+    std::span<const int32_t> nature;
+
+    size_t size() const {return K.size();}
+
+    // whether row i has a barrier
+    bool has_barrier(size_t i) const {return !barrier.empty() && barrier[i] == barrier[i];}
+
+    // throws std::invalid_argument if the columns are inconsistent
+    void validate() const;
+
+    /**
+     * @brief Builds the payoff of a row
+     *
+     * @param i the row
+     * @return std::shared_ptr<Payoff> : the vanilla payoff of the row, wrapped
+     * in a BarrierPayoff if the row has a barrier. Rows without barrier
+     * share the same payoff objects
+     */
+    std::shared_ptr<Payoff> make_payoff(size_t i) const;
+};
+
+
+/**
+ * @brief Prices of the rows of an InstrumentTable
+ *
+ * @note std_error is the standard error of the Monte Carlo estimate of each
+ * price, discounted.
+ */
+struct TablePrices {
+    std::vector<double> price;
+    std::vector<double> std_error;
+};
@@ -2,6 +2,7 @@
 
 #include "models/model.hpp"
 #include "types/state.hpp"
+#include <span>
 #include <stdexcept>
 
 
@@ -28,6 +29,12 @@ struct BlackScholes : Model {
     double drift(double t, const double S) const override;
     double diffusion(double t, const double S) const override;
     double volatility(double t, const double S) const override; 
+    Coefficients coefficients(double t, const double S) const override;
+    void coefficients_batch(double t, std::span<const double> S, std::span<double> drift,
+                            std::span<double> diffusion, std::span<double> vol) const override;
+    std::string describe() const override;
+    std::optional<std::vector<double>> parameters() const override {return std::vector<double>{mu, sigma};}
+    bool spot_homogeneous() const override {return true;}
 
 
     float mu; 
@@ -7,6 +7,8 @@
 #include "types/state.hpp"
 
 #include <memory>
+#include <span>
+#include <vector>
 
 struct Dupire : public Model {
 
@@ -22,15 +24,34 @@ public:
            std::shared_ptr<LocalVolatilitySurface> loc_vol_surface);
     
     virtual ~Dupire() override = default;
-    double sigma(float t, float S) const {return lv_surface_->sigma(t, S);}
+    double sigma(double t, double S) const;
     double drift(double t, const double S) const override; 
     double diffusion(double t, const double S) const override;
     double volatility(double t, const double S) const override;
+    Coefficients coefficients(double t, const double S) const override;
+    void coefficients_batch(double t, std::span<const double> S, std::span<double> drift,
+                            std::span<double> diffusion, std::span<double> vol) const override;
+
+    /**
+     * @brief Returns a copy of the model holding one slice of the local
+     * volatility surface per simulation time
+     *
+     * @param times the increasing times at which the engine evaluates the model
+     * @return std::shared_ptr<Model> : the prepared Dupire model
+     *
+     * @note the slices are cut in parallel. At a slicing time the local
+     * volatility is a 1D interpolation in the slice; other times fall back
+     * to the full surface.
+     */
+    std::shared_ptr<Model> prepare(const std::vector<double>& times) const override;
+
+    std::string describe() const override;
 
 private:
     float r_; 
     float q_;
     std::shared_ptr<LocalVolatilitySurface> lv_surface_;
+    std::shared_ptr<const LocalVolatilityTimeSlices> slices_;
 
     
 };
@@ -2,6 +2,8 @@
 
 #include "models/model.hpp"
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 
 
@@ -33,6 +35,12 @@ struct Heston : VectorModel {
     double drift(double t, const double S) const;
     double diffusion(double t, const double S) const;
 
+    // human readable name and parameters of the model
+    std::string describe() const;
+
+    // the parameters of the model at full precision
+    std::vector<double> parameters() const {return {mu, kappa, theta, epsilon, rho};}
+
 
 private:
     bool feller;
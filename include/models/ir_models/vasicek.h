@@ -9,6 +9,7 @@ __     __        _          _
 #pragma once 
 #include "models/model.hpp"
 #include "types/state.hpp"
+#include <span>
 #include <stdexcept>
 
 class Vasicek : public Model {
@@ -35,6 +36,16 @@ class Vasicek : public Model {
     double drift(double t, const double S) const override;
     double diffusion(double t, const double S) const override;
     double volatility(double t, const double S) const override;
+    Coefficients coefficients(double t, const double S) const override;
+    void coefficients_batch(double t, std::span<const double> S, std::span<double> drift,
+                            std::span<double> diffusion, std::span<double> vol) const override;
+
+    std::string describe() const override;
+    std::optional<std::vector<double>> parameters() const override {return std::vector<double>{a_, b_, sigma_};}
+
+    double a() const {return a_;}
+    double b() const {return b_;}
+    double sigma() const {return sigma_;}
 
     private :
 
@@ -1,5 +1,21 @@
 #pragma once
 #include "types/state.hpp"
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <vector>
+#include <string>
+
+/**
+ * @brief Coefficients of a one factor model evaluated at (t, S)
+ *
+ */
+struct Coefficients {
+    double drift;
+    double diffusion;
+    double volatility;
+};
 
 /**
  * @brief Base structure for models
@@ -16,6 +32,73 @@ struct Model{
     // Virtual function to compute the instantaneous volatility at t, S
     virtual double volatility(double t, const double S) const = 0;
 
+    /**
+     * @brief Evaluates the drift, the diffusion and the volatility at once
+     *
+     * @param t the time
+     * @param S the value of the process
+     * @return Coefficients : the three coefficients at (t, S)
+     *
+     * @note models whose coefficients share an expensive input (a surface
+     * lookup for instance) override this to compute it only once.
+     */
+    virtual Coefficients coefficients(double t, const double S) const {
+        return Coefficients{drift(t, S), diffusion(t, S), volatility(t, S)};
+    }
+
+    /**
+     * @brief Evaluates the coefficients for a block of values at time t
+     *
+     * @param t the time
+     * @param S the values of the process
+     * @param drift receives the drift at S[i]
+     * @param diffusion receives the diffusion at S[i]
+     * @param vol receives the volatility at S[i]
+     */
+    virtual void coefficients_batch(double t, std::span<const double> S, std::span<double> drift,
+                                    std::span<double> diffusion, std::span<double> vol) const {
+        check_batch(S, drift, diffusion, vol);
+        for (size_t i = 0; i < S.size(); i++){
+            const Coefficients c = coefficients(t, S[i]);
+            drift[i] = c.drift;
+            diffusion[i] = c.diffusion;
+            vol[i] = c.volatility;
+        }
+    }
+
+    /**
+     * @brief Returns a copy of the model specialised for a simulation
+     * that evaluates it at the given times
+     *
+     * @param times the increasing times at which the engine evaluates the model
+     * @return std::shared_ptr<Model> : the prepared model, or nullptr if the
+     * model has nothing to precompute
+     */
+    virtual std::shared_ptr<Model> prepare(const std::vector<double>& times) const {
+        (void)times;
+        return nullptr;
+    }
+
+    // human readable name and parameters of the model
+    virtual std::string describe() const {return "Model";}
+
+    // the parameters of the model at full precision, nullopt if they are not
+    // a list of numbers
+    virtual std::optional<std::vector<double>> parameters() const {return std::nullopt;}
+
+    // whether the drift and the diffusion are proportional to S, see
+    // Scheme::spot_homogeneous
+    virtual bool spot_homogeneous() const {return false;}
+
+protected:
+
+    // checks that the output buffers of coefficients_batch match the input size
+    static void check_batch(std::span<const double> S, std::span<double> drift,
+                            std::span<double> diffusion, std::span<double> vol) {
+        if (drift.size() != S.size() || diffusion.size() != S.size() || vol.size() != S.size())
+            throw std::invalid_argument("Model::coefficients_batch : output buffers must have the same size as S");
+    }
+
 };
 
 struct VectorModel{
@@ -0,0 +1,57 @@
+#pragma once
+#include <memory>
+
+
+/**
+ * @brief Running state of a payoff along one simulated path
+ *
+ * The engine feeds the accumulator with every state of a path as it is
+ * simulated, the payoff is then read with finalize. The path itself is never
+ * stored, an accumulator only keeps the statistics its payoff needs (the
+ * last spot, a hit flag, a running product...).
+ *
+ * @note an accumulator holds the state of a single path at a time. The
+ * engine copies it with clone for each thread and restarts it with start
+ * for each path.
+ */
+class PayoffAccumulator {
+
+public:
+    virtual ~PayoffAccumulator() = default;
+
+    /**
+     * @brief Starts a new path
+     *
+     * @param S the initial spot
+     * @param v the initial volatility
+     * @param t the initial time
+     */
+    virtual void start(double S, double v, double t) = 0;
+
+    /**
+     * @brief Adds the state reached after a step
+     *
+     * @param S the spot at the end of the step
+     * @param v the volatility at the end of the step
+     * @param t the time at the end of the step
+     */
+    virtual void update(double S, double v, double t) = 0;
+
+    /**
+     * @brief Tells whether the payoff of the path is already known
+     *
+     * @return bool : true if the remaining steps can not change the payoff,
+     * the engine stops the path once every accumulator is finished
+     */
+    virtual bool finished() const {return false;}
+
+    /**
+     * @brief Returns the payoff of the current path
+     *
+     * @return double
+     */
+    virtual double finalize() const = 0;
+
+    virtual std::unique_ptr<PayoffAccumulator> clone() const = 0;
+
+};
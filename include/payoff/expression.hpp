@@ -0,0 +1,61 @@
+#pragma once
+
+#include "payoff/payoff.h"
+#include "types/pathfeatures.hpp"
+#include <memory>
+#include <span>
+#include <string>
+
+
+/**
+ * @brief Payoff written as an expression of the path, compiled once into a
+ * bytecode evaluated on blocks of paths
+ *
+ * The expression reads :
+ * - `S[T]` the terminal spot, `S[t]` the fixing at time t in years, which is
+ *   the last simulated spot at or before t
+ * - `max(e)`, `min(e)`, `mean(e)`, `sum(e)` reductions over the states of the
+ *   path, initial spot included, of an expression e of the spot `S`
+ * - `K` the strike, numbers, `+ - * /`, comparisons `< <= > >=` which are 1
+ *   when true and 0 otherwise, `max(a, b, ...)`, `min(a, b, ...)`, `abs`,
+ *   `exp`, `log`, `sqrt`
+ *
+ * For instance `min(max(S[T] - K, 0), 20)` is a capped call,
+ * `max(mean(S) - K, 0)` an arithmetic Asian call and
+ * `mean((S > 90) * (S < 110))` a range accrual.
+ *
+ * @param expression the text of the expression
+ * @note each instruction of the bytecode runs over a whole block of paths.
+ * Expressions of S[T] only are not path dependent, expressions without
+ * fixings that only reduce the spot itself with max, min or mean are
+ * computed from the path features. Every expression has an accumulator.
+ * Throws std::invalid_argument if the expression does not parse.
+ */
+class ExpressionPayoff : public Payoff {
+
+public:
+    explicit ExpressionPayoff(const std::string& expression);
+
+    const std::string& expression() const {return expression_;}
+
+    double compute(std::span<const double> path, double K) const override;
+    double compute_path(const PathView& path, double K) const override;
+    void compute_batch(const PathsView& paths, double K, std::span<double> out) const override;
+
+    bool path_dependent() const override;
+    bool uses_features() const override;
+    void compute_features(const PathFeatures& features, double K, std::span<double> out) const override;
+    std::unique_ptr<PayoffAccumulator> accumulator(double K) const override;
+
+    std::shared_ptr<Payoff> clone() const override {
+        return std::make_shared<ExpressionPayoff>(*this);
+    }
+
+    // compiled form of the expression, shared by the copies of the payoff
+    struct Compiled;
+
+private:
+    std::string expression_;
+    std::shared_ptr<const Compiled> compiled_;
+
+};
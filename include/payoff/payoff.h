@@ -1,10 +1,57 @@
 #pragma once
+#include "payoff/accumulator.hpp"
+#include "types/barrier.hpp"
 #include "types/path.hpp"
 #include <algorithm>
+#include <cmath>
+#include <functional>
 #include <memory>
+#include <optional>
 #include <stdexcept>
 #include <span>
 
+struct PathFeatures;
+
+/**
+ * @brief Read-only view of one simulated path
+ * 
+ * @note vol and times are empty when the simulation did not record them.
+ * vol[k] is the volatility of the state stored at column k.
+ */
+struct PathView {
+    std::span<const double> spot;
+    std::span<const double> vol;
+    std::span<const double> times;
+};
+
+/**
+ * @brief Read-only view of a block of simulated paths, stored row-major
+ * 
+ * @note spot holds n_paths rows of path_size values. vol has the same shape
+ * or is empty, times holds path_size values or is empty.
+ */
+struct PathsView {
+    std::span<const double> spot;
+    std::span<const double> vol;
+    std::span<const double> times;
+    size_t n_paths = 0;
+    size_t path_size = 0;
+
+    // view of the path in row p
+    PathView path(size_t p) const {
+        return PathView{spot.subspan(p * path_size, path_size),
+                        vol.empty() ? std::span<const double>() : vol.subspan(p * path_size, path_size),
+                        times};
+    }
+
+    // view of count rows starting at row first
+    PathsView rows(size_t first, size_t count) const {
+        return PathsView{spot.subspan(first * path_size, count * path_size),
+                         vol.empty() ? std::span<const double>() : vol.subspan(first * path_size, count * path_size),
+                         times, count, path_size};
+    }
+};
+
 /**
  * @brief Base class for payoffs
  * 
@@ -22,12 +69,147 @@ public:
      */
     virtual double compute(std::span<const double> path, double K) const = 0;
 
+    /**
+     * @brief Computes the payoff value from a path with its volatility and
+     * simulation times
+     * 
+     * @param path the view of the path of the underlying asset
+     * @param K the strike price 
+     * @return double 
+     * @note defaults to compute(path.spot, K). Payoffs that need the
+     * volatility or the step lengths override it.
+     */
+    virtual double compute_path(const PathView& path, double K) const {
+        return compute(path.spot, K);
+    }
+
+    /**
+     * @brief Computes the payoff of a block of paths
+     * 
+     * @param paths the view of the paths
+     * @param K the strike price 
+     * @param out the output buffer, receives the payoff of path p at position p
+     * @note defaults to compute_path on each path. Built-in payoffs override
+     * it with vectorized kernels.
+     */
+    virtual void compute_batch(const PathsView& paths, double K, std::span<double> out) const;
+
+    /**
+     * @brief Tells whether the payoff can be computed from the path features
+     * 
+     * @return bool : defaults to false. Payoffs whose compute_features is
+     * exact override it, see TerminalPayoff
+     */
+    virtual bool uses_features() const {return false;}
+
+    /**
+     * @brief Computes the payoffs of a batch of paths from their features
+     * 
+     * @param features the features of the paths
+     * @param K the strike price 
+     * @param out the output buffer, receives the payoff of path p at position p
+     * @note defaults to compute on the terminal spot. Throws if
+     * uses_features is false.
+     */
+    virtual void compute_features(const PathFeatures& features, double K, std::span<double> out) const;
+
     virtual std::shared_ptr<Payoff> clone () const = 0;
+
+    /**
+     * @brief Tells whether the payoff depends on the path before maturity
+     * 
+     * @return bool : false if the payoff only reads the terminal value
+     * @note defaults to true : a payoff is only priced on the terminal spot
+     * when it says so, see TerminalPayoff
+     */
+    virtual bool path_dependent() const {return true;}
+
+    /**
+     * @brief Returns the condition under which the payoff is worth zero for
+     * the rest of the path
+     * 
+     * @return std::optional<KnockCondition> : the knock-out barrier, or
+     * nullopt if the payoff can not be knocked out
+     * @note the engine uses it to stop simulating knocked out paths
+     */
+    virtual std::optional<KnockCondition> knock_out() const {return std::nullopt;}
+
+    /**
+     * @brief Makes an accumulator computing the payoff in a single pass
+     * over the path, without storing it
+     * 
+     * @param K the strike price 
+     * @return std::unique_ptr<PayoffAccumulator> : the accumulator, or
+     * nullptr if the payoff can only be computed on a stored path
+     * @note defaults to nullptr. Payoffs known to be computed exactly in a
+     * single pass override it, see TerminalPayoff.
+     */
+    virtual std::unique_ptr<PayoffAccumulator> accumulator(double K) const {
+        (void)K;
+        return nullptr;
+    }
+
+    /**
+     * @brief Returns the number of paths the payoff wants to receive per
+     * call of compute_batch
+     * 
+     * @return size_t : 0 for the default blocks. Otherwise the pricer
+     * simulates the paths by chunks of this size in the background while the
+     * previous chunk is evaluated, and never stores the whole simulation
+     * @note for payoffs with a high cost per call, such as callbacks
+     */
+    virtual size_t chunk_paths() const {return 0;}
     
 };
 
 
-class CallPayoff : public Payoff {
+/**
+ * @brief Accumulator of a payoff that only reads the terminal spot
+ * 
+ */
+class TerminalAccumulator : public PayoffAccumulator {
+
+public:
+    TerminalAccumulator(std::shared_ptr<const Payoff> payoff, double K) :
+        payoff_(std::move(payoff)),
+        K_(K) {};
+
+    void start(double S, double, double) override {S_ = S;}
+    void update(double S, double, double) override {S_ = S;}
+    double finalize() const override {
+        return payoff_->compute(std::span<const double>(&S_, 1), K_);
+    }
+    std::unique_ptr<PayoffAccumulator> clone() const override {
+        return std::make_unique<TerminalAccumulator>(*this);
+    }
+
+private:
+    std::shared_ptr<const Payoff> payoff_;
+    double K_;
+    double S_ = 0.0;
+};
+
+
+
+/**
+ * @brief Base class for payoffs that only read the terminal spot
+ * 
+ */
+class TerminalPayoff : public Payoff {
+
+public:
+    bool path_dependent() const override {return false;}
+    bool uses_features() const override {return true;}
+
+    // keeps the last spot of the path
+    std::unique_ptr<PayoffAccumulator> accumulator(double K) const override {
+        return std::make_unique<TerminalAccumulator>(clone(), K);
+    }
+
+};
+
+
+class CallPayoff : public TerminalPayoff {
 
 public:
 
@@ -49,13 +231,17 @@ public:
         double S = path.back();
         return std::max((S - K), 0.0);
     } ;
+    // reads the terminal column only
+    void compute_batch(const PathsView& paths, double K, std::span<double> out) const override;
+    void compute_features(const PathFeatures& features, double K, std::span<double> out) const override;
+
     std::shared_ptr<Payoff> clone() const override {
         return std::make_shared<CallPayoff>(*this);
     }
 
 };
 
-class PutPayoff : public Payoff {
+class PutPayoff : public TerminalPayoff {
     public:
 
     PutPayoff() {};
@@ -74,6 +260,10 @@ class PutPayoff : public Payoff {
         return std::max((K - S), 0.0);
     } ;
 
+    // reads the terminal column only
+    void compute_batch(const PathsView& paths, double K, std::span<double> out) const override;
+    void compute_features(const PathFeatures& features, double K, std::span<double> out) const override;
+
     std::shared_ptr<Payoff> clone() const override {
         return std::make_shared<PutPayoff>(*this);
     }
@@ -81,7 +271,7 @@ class PutPayoff : public Payoff {
 
 };
 
-class DigitalCallPayoff : public Payoff{
+class DigitalCallPayoff : public TerminalPayoff {
     
     public:
 
@@ -101,6 +291,10 @@ class DigitalCallPayoff : public Payoff{
         return (S > K) ? 1.0 : 0.0; 
     } ;
 
+    // reads the terminal column only
+    void compute_batch(const PathsView& paths, double K, std::span<double> out) const override;
+    void compute_features(const PathFeatures& features, double K, std::span<double> out) const override;
+
     std::shared_ptr<Payoff> clone() const override {
         return std::make_shared<DigitalCallPayoff>(*this);
     }
@@ -108,7 +302,7 @@ class DigitalCallPayoff : public Payoff{
 
 };
 
-class DigitalPutPayoff : public Payoff{
+class DigitalPutPayoff : public TerminalPayoff {
     
     public:
 
@@ -127,6 +321,10 @@ class DigitalPutPayoff : public Payoff{
         return (S < K) ? 1.0 : 0.0; 
     } ;
 
+    // reads the terminal column only
+    void compute_batch(const PathsView& paths, double K, std::span<double> out) const override;
+    void compute_features(const PathFeatures& features, double K, std::span<double> out) const override;
+
     std::shared_ptr<Payoff> clone() const override {
         return std::make_shared<DigitalPutPayoff>(*this);
     }
@@ -134,15 +332,70 @@ class DigitalPutPayoff : public Payoff{
 
 };
 
-enum Direction {Up, Down};
+/**
+ * @brief Payoff defined by a function computing a block of paths at once
+ * 
+ * @param function called with the view of a block of paths, the strike and
+ * the output buffer, which receives the payoff of each path
+ * @param chunk_paths the number of paths per call, see Payoff::chunk_paths
+ * 
+ * @note the function may read the whole path, the payoff is path dependent.
+ * It is called from the pricing thread, one block at a time.
+ */
+class FunctionPayoff : public Payoff {
+
+public:
+    using Function = std::function<void(const PathsView&, double, std::span<double>)>;
+
+    FunctionPayoff(Function function, size_t chunk_paths) :
+        function_(std::move(function)),
+        chunk_paths_(chunk_paths) {
+        if (!function_) throw std::invalid_argument("FunctionPayoff : the function is empty");
+        if (chunk_paths_ == 0) throw std::invalid_argument("FunctionPayoff : chunk_paths must be positive");
+    };
+
+    double compute(std::span<const double> path, double K) const override {
+        double out = 0.0;
+        function_(PathsView{path, {}, {}, 1, path.size()}, K, std::span<double>(&out, 1));
+        return out;
+    }
+
+    double compute_path(const PathView& path, double K) const override {
+        double out = 0.0;
+        function_(PathsView{path.spot, path.vol, path.times, 1, path.spot.size()}, K, std::span<double>(&out, 1));
+        return out;
+    }
+
+    void compute_batch(const PathsView& paths, double K, std::span<double> out) const override {
+        function_(paths, K, out);
+    }
+
+    bool path_dependent() const override {return true;}
+    size_t chunk_paths() const override {return chunk_paths_;}
+
+    std::shared_ptr<Payoff> clone() const override {
+        return std::make_shared<FunctionPayoff>(*this);
+    }
+
+private:
+    Function function_;
+    size_t chunk_paths_;
+
+};
+
 enum Nature {In, Out};
+// Discrete : the barrier is only checked on the simulated spots
+// Continuous : crossings between two simulated spots are accounted for with
+// the Brownian bridge crossing probability
+enum Monitoring {Discrete, Continuous};
 
 class BarrierPayoff : public Payoff {
     public:
-        BarrierPayoff(double H, Direction direction, Nature nature , Payoff& payoff) : 
+        BarrierPayoff(double H, Direction direction, Nature nature , Payoff& payoff, Monitoring monitoring = Discrete) : 
         barr_(H),
         dir_(direction),
         nat_(nature), 
+        mon_(monitoring),
         payoff_(payoff.clone()){};
             
         double compute(std::span<const double> path, double K) const override{
@@ -151,15 +404,143 @@ class BarrierPayoff : public Payoff {
             else if (nat_ == Out && !touched) {return payoff_->compute(path, K);}
             else return 0.0;          
                 };
+
+        /**
+         * @brief Computes the barrier payoff. With continuous monitoring, the
+         * payoff is weighted by the probability that the barrier was not
+         * crossed between the simulated spots (Out) or was crossed (In).
+         * 
+         * @param path the view of the path, with its volatility and times
+         * @param K the strike
+         * @return double 
+         * @note over each step the log-spot is bridged with the volatility
+         * stored at the start of the step, the crossing probability is
+         * exp(-2 ln(S_k/H) ln(S_k+1/H) / (sigma_k^2 dt_k)).
+         */
+        double compute_path(const PathView& path, double K) const override {
+            if (mon_ == Discrete) return compute(path.spot, K);
+
+            const double survival = survival_(path);
+            const double weight = (nat_ == Out) ? survival : 1.0 - survival;
+            if (weight == 0.0) return 0.0;
+            return weight * payoff_->compute_path(path, K);
+        }
+
+        /**
+         * @brief Computes the barrier payoff of a block of paths. With
+         * discrete monitoring, the underlying payoff is computed in batch and
+         * masked by a scan of the extreme spot of each path.
+         * 
+         * @param paths the view of the paths
+         * @param K the strike
+         * @param out the output buffer
+         * @note continuous monitoring uses compute_path on each path
+         */
+        void compute_batch(const PathsView& paths, double K, std::span<double> out) const override;
+
+        // discrete barriers only need the extreme spots of the path
+        bool uses_features() const override {return mon_ == Discrete && payoff_->uses_features();}
+        void compute_features(const PathFeatures& features, double K, std::span<double> out) const override;
+
+        bool path_dependent() const override {return true;}
+        Monitoring monitoring() const {return mon_;}
+
+        /**
+         * @brief Makes a single pass accumulator for the barrier payoff. It
+         * keeps the hit flag, the bridge survival probability and the
+         * accumulator of the underlying payoff
+         * 
+         * @param K the strike
+         * @return std::unique_ptr<PayoffAccumulator> : nullptr if the
+         * underlying payoff has no accumulator
+         * @note knock-out accumulators are finished once the barrier is hit
+         */
+        std::unique_ptr<PayoffAccumulator> accumulator(double K) const override {
+            std::unique_ptr<PayoffAccumulator> inner = payoff_->accumulator(K);
+            if (!inner) return nullptr;
+            return std::make_unique<Accumulator>(*this, std::move(inner));
+        }
+
+        // discretely monitored knock-out barriers pay zero once breached.
+        // Continuous monitoring needs the whole path for the bridge weights
+        std::optional<KnockCondition> knock_out() const override {
+            if (nat_ == Out && mon_ == Discrete) return KnockCondition{barr_, dir_};
+            return std::nullopt;
+        }
         bool activated = false;
     private:
         double barr_;
         Direction dir_; 
         Nature nat_;
+        Monitoring mon_;
         std::shared_ptr<Payoff> payoff_;
         std::shared_ptr<Payoff> clone() const override {
             return std::make_shared<BarrierPayoff>(*this);
             }
+
+        class Accumulator : public PayoffAccumulator {
+            public:
+                Accumulator(const BarrierPayoff& barrier, std::unique_ptr<PayoffAccumulator> inner) :
+                    knock_{barrier.barr_, barrier.dir_},
+                    nat_(barrier.nat_),
+                    mon_(barrier.mon_),
+                    inner_(std::move(inner)) {};
+
+                Accumulator(const Accumulator& other) :
+                    knock_(other.knock_),
+                    nat_(other.nat_),
+                    mon_(other.mon_),
+                    inner_(other.inner_->clone()) {};
+
+                void start(double S, double v, double t) override {
+                    inner_->start(S, v, t);
+                    touched_ = knock_.breached(S);
+                    survival_ = 1.0;
+                    S_ = S; v_ = v; t_ = t;
+                }
+
+                // same bridge weights as BarrierPayoff::survival_, computed
+                // with the previous state only
+                void update(double S, double v, double t) override {
+                    inner_->update(S, v, t);
+                    if (!touched_) {
+                        touched_ = knock_.breached(S);
+                        if (mon_ == Continuous && !touched_) {
+                            const double var = v_ * v_ * (t - t_);
+                            if (var > 0) survival_ *= 1.0 - std::exp(-2.0 * std::log(S_ / knock_.barrier) * std::log(S / knock_.barrier) / var);
+                        }
+                    }
+                    S_ = S; v_ = v; t_ = t;
+                }
+
+                bool finished() const override {return nat_ == Out && touched_;}
+
+                double finalize() const override {
+                    if (mon_ == Discrete) {
+                        if (touched_ == (nat_ == In)) return inner_->finalize();
+                        return 0.0;
+                    }
+                    const double survival = touched_ ? 0.0 : survival_;
+                    const double weight = (nat_ == Out) ? survival : 1.0 - survival;
+                    if (weight == 0.0) return 0.0;
+                    return weight * inner_->finalize();
+                }
+
+                std::unique_ptr<PayoffAccumulator> clone() const override {
+                    return std::make_unique<Accumulator>(*this);
+                }
+
+            private:
+                KnockCondition knock_;
+                Nature nat_;
+                Monitoring mon_;
+                std::unique_ptr<PayoffAccumulator> inner_;
+                bool touched_ = false;
+                double survival_ = 1.0;
+                double S_ = 0.0;
+                double v_ = 0.0;
+                double t_ = 0.0;
+        };
         
         bool touched_(std::span<const double> path) const {
             
@@ -175,5 +556,27 @@ class BarrierPayoff : public Payoff {
             }
             return false;
         };
+
+        // probability that the continuous path stays on its side of the barrier
+        double survival_(const PathView& path) const {
+
+            if (touched_(path.spot)) return 0.0;
+
+            const size_t n = path.spot.size();
+            if (path.vol.size() != n || path.times.size() != n)
+                throw std::invalid_argument("BarrierPayoff : continuous monitoring requires the volatility and the times of the path");
+
+            double survival = 1.0;
+            for (size_t k = 1; k < n; k++) {
+                const double sigma = path.vol[k-1];
+                const double var = sigma * sigma * (path.times[k] - path.times[k-1]);
+                if (!(var > 0)) continue;
+
+                const double a = std::log(path.spot[k-1] / barr_);
+                const double b = std::log(path.spot[k] / barr_);
+                survival *= 1.0 - std::exp(-2.0 * a * b / var);
+            }
+            return survival;
+        }
 };
 
@@ -7,6 +7,7 @@
 */
 #pragma once
 #include "instruments/instrument.h"
+#include "instruments/instrumenttable.hpp"
 #include "types/marketstate.h"
 #include "engine/montecarlo.hpp"
 #include "engine/engine.hpp"
@@ -30,7 +31,9 @@ class Pricer {
      * @brief Creates a pricing engine
      * 
      * @param marketstate the market state at the time of pricing
-     * @param n_steps the number of steps of the pricing
+     * @param n_steps the number of steps of the pricing. With an exact
+     * scheme, instruments that only depend on the terminal value are priced
+     * with a single step
      * @param n_paths the number of paths required for pricing
      * @param generator a Monte Carlo simulator
      */
@@ -97,9 +100,123 @@ class Pricer {
      * @return std::vector<double> 
      */
     std::vector<double> batch_price(std::vector<std::shared_ptr<Instrument>> instruments) const;
+
+    /**
+     * @brief Prices a ladder of discretely monitored barrier options that
+     * only differ by their barrier level, from a single simulation
+     * 
+     * @param barriers the barrier levels
+     * @param direction the direction of the barriers
+     * @param nature the nature of the barriers
+     * @param payoff the payoff activated or deactivated by the barriers
+     * @param contract the strike and maturity shared by the options
+     * @return std::vector<double> : the price for each barrier level
+     * @note the paths are sorted by their extreme spot once, each level is
+     * then priced with a binary search : O(N log N + K log N) for N paths
+     * and K levels, instead of a scan of every path for each level.
+     */
+    std::vector<double> ladder_price(const std::vector<double>& barriers, Direction direction, Nature nature,
+                                     const Payoff& payoff, const OptionContract& contract) const;
+
+    /**
+     * @brief Prices the rows of an instrument table, with one simulation
+     * per distinct maturity
+     * 
+     * @param table the columns of the options to price
+     * @return TablePrices : the price and the standard error of each row
+     * @note each simulation only keeps the features of its paths, from which
+     * the rows of its maturity are evaluated in parallel. No Instrument is
+     * built, which makes pricing thousands of options from arrays cheap.
+     */
+    TablePrices price_table(const InstrumentTable& table) const;
+
+    /**
+     * @brief Prices a book of instruments in a list of market scenarios, in
+     * one sweep over shared random numbers
+     * 
+     * @param scenarios the market states to price in, for instance a grid
+     * of spot, initial volatility and rate shocks
+     * @param instruments the instruments to price, of any maturities
+     * @return std::vector<std::vector<double>> : the price of each
+     * instrument in each scenario, one row per scenario
+     * @note the instruments of each maturity get the prices batch_price
+     * gives after reconfigure with the scenario and reset_rng. Those of
+     * a maturity are simulated once per initial volatility : with a spot
+     * homogeneous scheme the paths are rescaled to every spot of the grid,
+     * otherwise each spot is simulated from the same random numbers. Books
+     * holding a payoff evaluated by chunks (see Payoff::chunk_paths) are
+     * always simulated spot by spot, through the chunks of the payoff. Rates
+     * only discount the payoffs, the drift being a parameter of the model.
+     */
+    std::vector<std::vector<double>> scenario_prices(const std::vector<MarketState>& scenarios,
+                                                     const std::vector<std::shared_ptr<Instrument>>& instruments) const;
+
+    /**
+     * @brief Prices a book of instruments under each scheme of a batch, for
+     * instance a model calibrated to many parameter sets, in one simulation
+     * 
+     * @param schemes the schemes to price with, in place of the scheme of
+     * the engine
+     * @param instruments the instruments to price, of any maturities
+     * @return std::vector<std::vector<double>> : the price of each
+     * instrument under each scheme, one row per scheme
+     * @note the schemes step on the same random numbers, see
+     * MonteCarlo::generate_batch : the differences between the rows of
+     * bumped parameter sets are sensitivities to the parameters. Each
+     * maturity is one run of the engine.
+     */
+    std::vector<std::vector<double>> parameter_prices(const std::vector<std::shared_ptr<Scheme>>& schemes,
+                                                      const std::vector<std::shared_ptr<Instrument>>& instruments) const;
     
 
     private:
+
+    /**
+     * @brief Returns the number of steps used to price instruments
+     * 
+     * @param path_dependent whether one of the priced payoffs reads the path
+     * @return size_t : 1 when the scheme is exact and no payoff is path
+     * dependent, the configured number of steps otherwise
+     */
+    size_t pricing_steps(bool path_dependent) const;
+
+    /**
+     * @brief Runs the simulation used to price instruments and returns their
+     * average payoffs
+     * 
+     * @param generator the Monte Carlo engine to use
+     * @param S0 the initial spot
+     * @param v0 the initial volatility
+     * @param T the maturity
+     * @param n_steps the number of steps
+     * @param instruments the instruments to price on the same paths
+     * @return std::vector<double> : the undiscounted average payoff of each
+     * instrument
+     * @note when every payoff has an accumulator, the payoffs are computed
+     * during the generation without storing the paths. Otherwise the paths
+     * are stored, and knocked out paths are stopped early if all the
+     * instruments share the same knock-out condition.
+     */
+    std::vector<double> expected_payoffs(MonteCarlo& generator, double S0, std::optional<double> v0, double T, size_t n_steps, 
+                                         const std::vector<std::shared_ptr<Instrument>>& instruments) const;
+
+    /**
+     * @brief Returns the average payoffs of instruments of the same maturity
+     * at several spots, from a single simulation rescaled to each spot
+     * 
+     * @param generator the Monte Carlo engine, whose scheme is spot homogeneous
+     * @param spots the initial spots
+     * @param v0 the initial volatility
+     * @param T the maturity
+     * @param n_steps the number of steps
+     * @param instruments the instruments to price
+     * @return std::vector<std::vector<double>> : the undiscounted average
+     * payoff of each instrument, one row per spot
+     */
+    std::vector<std::vector<double>> rescaled_payoffs(MonteCarlo& generator, const std::vector<double>& spots,
+                                                      std::optional<double> v0, double T, size_t n_steps,
+                                                      const std::vector<std::shared_ptr<Instrument>>& instruments) const;
+
     double S0_;
     double r_;
     size_t n_steps_;
@@ -6,6 +6,7 @@
 #include <memory>
 #include <optional>
 #include <random>
+#include <span>
 
 
 
@@ -34,14 +35,35 @@ class Euler : public Scheme {
         * corresponding model
         *
         * @param state current state
-        * @param i the current step of the generation process
+        * @param t the time at the start of the step
         * @param dt the time step
         * @param rng the random number generator
         ° @param v the volatility
         * @return double : the next spot value
         */
-        std::pair<double, double> step(const double S, const double v, int i, float dt, std::mt19937& rng) const override;
+        std::pair<double, double> step(const double S, const double v, double t, double dt, std::mt19937& rng) const override;
 
+        // same as step, with the normal of the step given in z[0]
+        std::pair<double, double> step_from(const double S, const double v, double t, double dt, std::span<const double> z) const override;
+
+        // evaluates the coefficients of the block with Model::coefficients_batch
+        void step_block(std::span<double> S, std::span<double> v, double t, double dt, std::span<const double> z) const override;
+        bool block_steps() const override {return true;}
+
+        /**
+        * @brief Prepares the underlying model for the simulation grid
+        *
+        * @param times the increasing times of the simulation grid
+        * @return std::shared_ptr<Scheme> : an Euler scheme on the prepared
+        * model, or nullptr if the model has nothing to precompute
+        */
+        std::shared_ptr<Scheme> prepare(const std::vector<double>& times) const override;
+
+
+    std::string describe() const override {return "Euler[" + model_->describe() + "]";}
+    std::optional<std::vector<double>> parameters() const override {return model_->parameters();}
+
+    bool spot_homogeneous() const override {return model_->spot_homogeneous();}
 
     private:
 
@@ -1,9 +1,13 @@
+#pragma once
+
 #include "schemes.hpp"
 #include "models/black_scholes/black_scholes.hpp"
 #include "types/state.hpp"
 
+#include <memory>
 #include <optional>
 #include <random>
+#include <span>
 
 
 
@@ -18,6 +22,8 @@ class EulerBlackScholes : public Scheme
     *
     * @param model : a BlackScholes model 
     *
+    * @note the coefficients of the log-spot are constant, so the log-Euler
+    * step samples the exact log-normal transition for any dt.
     */
     EulerBlackScholes(BlackScholes model):
     model(model)
@@ -25,6 +31,9 @@ class EulerBlackScholes : public Scheme
 
     BlackScholes model;
 
+    std::string describe() const override {return "EulerBlackScholes[" + model.describe() + "]";}
+    std::optional<std::vector<double>> parameters() const override {return model.parameters();}
+
     /**
     * @brief Creates the initial state at time 0
     * 
@@ -32,9 +41,9 @@ class EulerBlackScholes : public Scheme
     * @param S0 the spot at time 0
     * @param v0 optional : the volatility at time 0 - not required for Black Scholes
     * 
-    * @return State : a State object representing the initial state
+    * @return std::pair with first value the spot and second the volatility
     */
-    State init_state(double S0, std::optional<double> v0) const override;
+    std::pair<double, double> init_state(double S0, std::optional<double> v0) const override;
 
     /**
     * @brief Generates a new Black-Scholes spot using a log-Euler discretization
@@ -42,12 +51,23 @@ class EulerBlackScholes : public Scheme
     * Simulates log(S_{t+dt}) = log(S_t) + (mu - 0.5*sigma^2)*dt + sigma*sqrt(dt)*Z,
     * with Z ~ N(0,1).
     *
-    * @param state current state
-    * @param i the current step of the generation process
+    * @param S the current spot
+    * @param v the current volatility
+    * @param t the time at the start of the step
     * @param dt the time step
     * @param rng the random number generator
-    * @return State : a State object containing the new spot price
+    * @return std::pair with first value the spot and second the volatility
     */
-    State step(const State& state, int i, float dt, std::mt19937& rng) const override;
+    std::pair<double, double> step(const double S, const double v, double t, double dt, std::mt19937& rng) const override;
+
+    // same as step, with Z given in z[0]
+    std::pair<double, double> step_from(const double S, const double v, double t, double dt, std::span<const double> z) const override;
+
+    // steps the parameters of a batch of EulerBlackScholes schemes as arrays
+    std::unique_ptr<SchemeBatch> batch(std::span<const Scheme* const> schemes) const override;
+
+    bool exact() const override {return true;}
+
+    bool spot_homogeneous() const override {return true;}
 
-};
\ No newline at end of file
+};
@@ -2,8 +2,10 @@
 #include "models/heston/heston.hpp"
 #include "types/state.hpp"
 
+#include <memory>
 #include <optional>
 #include <random>
+#include <span>
 
 
 
@@ -25,6 +27,9 @@ class EulerHeston : public Scheme
 
     Heston model;
 
+    std::string describe() const override {return "EulerHeston[" + model.describe() + "]";}
+    std::optional<std::vector<double>> parameters() const override {return model.parameters();}
+
     /**
     * @brief Creates the initial state at time 0
     * 
@@ -42,11 +47,23 @@ class EulerHeston : public Scheme
     * 
     *
     * @param state current state
-    * @param i the current step of the generation process
+    * @param t the time at the start of the step
     * @param dt the time step
     * @param rng the random number generator
     * @return double : the next step in the spot process
     */
-    std::pair<double, double> step(const double S, const double v, int i, float dt, std::mt19937& rng) const override;
+    std::pair<double, double> step(const double S, const double v, double t, double dt, std::mt19937& rng) const override;
+
+    // same as step, with the independent spot normal in z[0] and the
+    // variance normal in z[1]
+    std::pair<double, double> step_from(const double S, const double v, double t, double dt, std::span<const double> z) const override;
+
+    // steps the parameters of a batch of EulerHeston schemes as arrays
+    std::unique_ptr<SchemeBatch> batch(std::span<const Scheme* const> schemes) const override;
+
+    size_t random_dimensions() const override {return 2;}
+
+    // the log-spot increments do not depend on the spot
+    bool spot_homogeneous() const override {return true;}
 
 };
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "schemes.hpp"
+#include "models/ir_models/vasicek.h"
+#include "types/state.hpp"
+
+#include <optional>
+#include <random>
+#include <span>
+
+
+
+/**
+ * @brief Exact simulation of the Vasicek short rate
+ *
+ * The rate is an Ornstein-Uhlenbeck process whose transition over dt is
+ * Gaussian with known mean and variance, so steps of any length are unbiased.
+ *
+ * @param model : a Vasicek model
+ */
+class ExactVasicek : public Scheme 
+{
+
+    public:
+    ExactVasicek(Vasicek model):
+    model(model)
+    {};
+
+    Vasicek model;
+
+    std::string describe() const override {return "ExactVasicek[" + model.describe() + "]";}
+    std::optional<std::vector<double>> parameters() const override {return model.parameters();}
+
+    /**
+    * @brief Creates the initial state at time 0
+    *
+    * @param r0 the short rate at time 0
+    * @param v0 optional : the volatility at time 0 - not required for Vasicek
+    *
+    * @return std::pair with first value the rate and second the volatility
+    */
+    std::pair<double, double> init_state(double r0, std::optional<double> v0) const override;
+
+    /**
+    * @brief Samples the short rate after dt from its exact transition
+    *
+    * Simulates r_{t+dt} = r_t*e^{-a*dt} + b*(1 - e^{-a*dt}) + sigma*sqrt((1 - e^{-2a*dt})/(2a))*Z,
+    * with Z ~ N(0,1).
+    *
+    * @param r the current rate
+    * @param v the current volatility
+    * @param t the time at the start of the step
+    * @param dt the time step
+    * @param rng the random number generator
+    * @return std::pair with first value the rate and second the volatility
+    */
+    std::pair<double, double> step(const double r, const double v, double t, double dt, std::mt19937& rng) const override;
+
+    // same as step, with Z given in z[0]
+    std::pair<double, double> step_from(const double r, const double v, double t, double dt, std::span<const double> z) const override;
+
+    bool exact() const override {return true;}
+
+};
@@ -2,8 +2,10 @@
 #include "models/heston/heston.hpp"
 #include "types/state.hpp"
 
+#include <memory>
 #include <optional>
 #include <random>
+#include <span>
 
 
 /**
@@ -24,20 +26,39 @@ public:
      * using a Quadratic Exponential discretization
      * 
      * @param state current state
-     * @param i the current step of the generation process
+     * @param t the time at the start of the step
      * @param dt the time step
      * @param rng the random number generator
      * @return std::pair with first value the spot and second the volatility
      */
-    std::pair<double, double> step(const double S, const double v, int i, float dt, std::mt19937& rng) const override;
+    std::pair<double, double> step(const double S, const double v, double t, double dt, std::mt19937& rng) const override;
+
+    /**
+     * @brief Same as step, from the independent spot normal z[0] and the
+     * variance normal z[1]
+     *
+     * @note in the exponential regime the variance normal is mapped to the
+     * uniform of the step through the normal distribution function, so the
+     * variance is increasing in z[1] in both regimes
+     */
+    std::pair<double, double> step_from(const double S, const double v, double t, double dt, std::span<const double> z) const override;
+
+    size_t random_dimensions() const override {return 2;}
+
+    // steps the parameters of a batch of QE schemes as arrays
+    std::unique_ptr<SchemeBatch> batch(std::span<const Scheme* const> schemes) const override;
+
+    // the log-spot increments do not depend on the spot
+    bool spot_homogeneous() const override {return true;}
 
     float psi_c() const {return psi_threshold_;}
+
+    std::string describe() const override;
+    std::optional<std::vector<double>> parameters() const override;
     void set_psi_c(float p);
 
 private:
     Heston model_;
     float psi_threshold_;
 
-    float inv_psi(float u, float p, float beta) const;
-
 };
\ No newline at end of file
@@ -2,10 +2,48 @@
 
 
 
+#include <memory>
 #include <optional>
 #include <random>
+#include <span>
+#include <stdexcept>
+#include <vector>
 
 #include "types/state.hpp"
+#include <string>
+#include <tuple>
+
+/**
+ * @brief Advances the states of a batch of schemes of one type, such as one
+ * model under many parameter sets, on the same normals
+ *
+ * The parameters of the schemes are stored as arrays, one entry per scheme,
+ * and a step is a single loop over them, without a virtual call per scheme.
+ *
+ * @note see Scheme::batch
+ */
+class SchemeBatch {
+
+public:
+    virtual ~SchemeBatch() = default;
+
+    /**
+     * @brief Advances the state of each scheme of the batch by one step
+     *
+     * @param S the spot of each scheme, updated in place
+     * @param v the volatility of each scheme, updated in place
+     * @param t the time at the start of the step
+     * @param dt the time interval
+     * @param z the normals of the step, read by every scheme as by step_from
+     *
+     * @note the states are the ones step_from gives, bit for bit
+     */
+    virtual void step(std::span<double> S, std::span<double> v, double t, double dt, std::span<const double> z) const = 0;
+
+    // number of schemes of the batch
+    virtual size_t size() const = 0;
+
+};
 
 class Scheme{
 
@@ -18,11 +56,124 @@ public:
      * 
      * @param S the current spot value
      * @param v the current volatility value
-     * @param i the number of step
+     * @param t the time at the start of the step
      * @param dt the time interval
      * @param rng the random number generator
      * @return std::pair<double, double> First value as spot, second as volatility
      */
-    virtual std::pair<double, double> step(const double S, const double v, int i, float dt, std::mt19937& rng) const = 0;
+    virtual std::pair<double, double> step(const double S, const double v, double t, double dt, std::mt19937& rng) const = 0;
+
+    /**
+     * @brief Generates the next step from given standard normals instead of
+     * a generator, see RandomStore
+     * 
+     * @param S the current spot value
+     * @param v the current volatility value
+     * @param t the time at the start of the step
+     * @param dt the time interval
+     * @param z at least random_dimensions() independent standard normals
+     * @return std::pair<double, double> First value as spot, second as volatility
+     *
+     * @note the first normal drives the spot, the second the volatility :
+     * schemes of the same model fed with the same normals are comparable
+     */
+    virtual std::pair<double, double> step_from(const double S, const double v, double t, double dt, std::span<const double> z) const {
+        (void)S; (void)v; (void)t; (void)dt; (void)z;
+        throw std::invalid_argument("Scheme::step_from : " + describe() + " can not use stored random numbers");
+    }
+
+    // number of standard normals read by step_from
+    virtual size_t random_dimensions() const {return 1;}
+
+    /**
+     * @brief Advances a block of paths by one step, from given standard
+     * normals
+     * 
+     * @param S the spots of the paths, updated in place
+     * @param v the volatilities of the paths, updated in place
+     * @param t the time at the start of the step
+     * @param dt the time interval
+     * @param z random_dimensions() normals per path, path after path
+     *
+     * @note defaults to step_from on each path. Schemes that evaluate their
+     * model on the whole block at once override it, see block_steps
+     */
+    virtual void step_block(std::span<double> S, std::span<double> v, double t, double dt, std::span<const double> z) const {
+        const size_t dims = random_dimensions();
+        if (v.size() != S.size() || z.size() != S.size() * dims)
+            throw std::invalid_argument("Scheme::step_block : the states and the normals do not match");
+        for (size_t i = 0; i < S.size(); i++) std::tie(S[i], v[i]) = step_from(S[i], v[i], t, dt, z.subspan(i * dims, dims));
+    }
+
+    /**
+     * @brief Tells whether the engine should step blocks of paths together
+     *
+     * @return bool : true if step_block is faster than stepping the paths
+     * one by one, and step draws random_dimensions() normals from a new
+     * std::normal_distribution before calling step_from, so that the paths
+     * do not depend on how they are stepped
+     */
+    virtual bool block_steps() const {return false;}
+
+    /**
+     * @brief Returns a kernel advancing a batch of schemes side by side
+     *
+     * @param schemes the schemes of the batch, of the type of this one
+     * @return std::unique_ptr<SchemeBatch> : the kernel, or nullptr if the
+     * scheme has none or a scheme of the batch is of another type, in which
+     * case the engine calls step_from on each scheme
+     */
+    virtual std::unique_ptr<SchemeBatch> batch(std::span<const Scheme* const> schemes) const {
+        (void)schemes;
+        return nullptr;
+    }
+
+    /**
+     * @brief Tells whether the scheme samples the exact transition law of
+     * its model
+     *
+     * @return bool : true if a step of any length is free of discretization
+     * bias, in which case a single step is enough to simulate the terminal value
+     */
+    virtual bool exact() const {return false;}
+
+    /**
+     * @brief Tells whether the paths of the scheme are proportional to their
+     * initial spot
+     *
+     * @return bool : true if the paths started from c * S0 are c times the
+     * paths started from S0 with the same random numbers, in which case a
+     * spot shock can be applied by rescaling simulated paths
+     */
+    virtual bool spot_homogeneous() const {return false;}
+
+    // human readable name and parameters of the scheme and of its model
+    virtual std::string describe() const {return "Scheme";}
+
+    /**
+     * @brief Returns the parameters of the scheme and of its model at full
+     * precision
+     *
+     * @return std::optional<std::vector<double>> : the parameters, which
+     * together with describe identify the paths of the scheme, nullopt if
+     * they are not a list of numbers
+     */
+    virtual std::optional<std::vector<double>> parameters() const {return std::nullopt;}
+
+    /**
+     * @brief Returns a copy of the scheme specialised for a simulation run
+     * on the given time grid
+     *
+     * @param times the increasing times of the simulation grid
+     * @return std::shared_ptr<Scheme> : the prepared scheme, or nullptr if
+     * the scheme has nothing to precompute
+     *
+     * @note the engine calls this once per run, before the parallel
+     * generation, and uses the returned scheme for all the paths of the run.
+     */
+    virtual std::shared_ptr<Scheme> prepare(const std::vector<double>& times) const {
+        (void)times;
+        return nullptr;
+    }
 
 };
\ No newline at end of file
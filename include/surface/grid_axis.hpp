@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+
+/**
+ * @brief Sorted interpolation axis with a precompiled cell lookup
+ *
+ * The spacing of the nodes is detected once at construction. On uniform
+ * and log-uniform axes the lower cell index is obtained by index arithmetic,
+ * other axes fall back to a binary search. Both paths return exactly the
+ * cell a std::lower_bound search would return.
+ */
+class GridAxis {
+
+public:
+
+    enum class Spacing {Uniform, LogUniform, Irregular};
+
+    /**
+     * @brief Builds the axis and detects its spacing
+     *
+     * @param nodes the sorted nodes of the axis (at least two)
+     */
+    explicit GridAxis(std::vector<double> nodes);
+
+    /**
+     * @brief Returns the index i of the cell [x_i, x_i+1] containing x
+     *
+     * @param x a value already clamped to [front(), back()]
+     * @return size_t : the lower index of the cell, in [0, size()-2]
+     */
+    size_t lower_index(double x) const;
+
+    struct Cell {
+        size_t idx;
+        double w;
+    };
+
+    /**
+     * @brief Clamps x to the axis and returns its cell with the linear
+     * interpolation weight of the upper node
+     *
+     * @param x any value
+     * @return Cell : the lower index of the cell and a weight in [0, 1]
+     */
+    Cell locate(double x) const;
+
+    const std::vector<double>& nodes() const {return nodes_;}
+    double operator[](size_t i) const {return nodes_[i];}
+    double front() const {return nodes_.front();}
+    double back() const {return nodes_.back();}
+    size_t size() const {return nodes_.size();}
+    Spacing spacing() const {return spacing_;}
+
+private:
+
+    std::vector<double> nodes_;
+    Spacing spacing_ = Spacing::Irregular;
+    double origin_ = 0.0;
+    double inv_step_ = 0.0;
+
+};
@@ -1,17 +1,107 @@
 #pragma once
 
+#include "surface/grid_axis.hpp"
+#include <memory>
+#include <span>
 #include <vector>
 
+
+/**
+ * @brief Local volatility of a surface interpolated at a fixed time
+ *
+ * A slice only interpolates along the spot axis, which it shares with the
+ * surface it was cut from.
+ */
+class LocalVolatilitySlice {
+
+public:
+
+    /**
+     * @brief Makes a local volatility slice
+     *
+     * @param spots the spot axis of the slice
+     * @param values the local volatility at each spot node
+     */
+    LocalVolatilitySlice(std::shared_ptr<const GridAxis> spots, std::vector<double> values);
+
+    /**
+     * @brief Returns the local volatility at spot S, linearly interpolated
+     * and clamped to the spot grid
+     */
+    double sigma(double S) const;
+
+    /**
+     * @brief Interpolates the local volatility for a block of spots
+     *
+     * @param S the spot prices
+     * @param out the output buffer, receives sigma(S[i]) at position i
+     */
+    void sigma_batch(std::span<const double> S, std::span<double> out) const;
+
+    const std::vector<double>& values() const {return values_;}
+
+private:
+
+    std::shared_ptr<const GridAxis> spots_;
+    std::vector<double> values_;
+
+};
+
+
+/**
+ * @brief Set of local volatility slices cut at the times of a simulation grid
+ *
+ */
+class LocalVolatilityTimeSlices {
+
+public:
+
+    /**
+     * @brief Makes a set of time slices
+     *
+     * @param times the increasing times at which the slices were cut
+     * @param slices one slice per time
+     */
+    LocalVolatilityTimeSlices(std::vector<double> times, std::vector<LocalVolatilitySlice> slices);
+
+    /**
+     * @brief Returns the slice cut at time t
+     *
+     * @param t the time (in years)
+     * @return const LocalVolatilitySlice* : the slice, or nullptr if t is not
+     * one of the slicing times
+     *
+     * @note t is matched up to 1e-3 times the gap to the neighbouring
+     * slicing times, which absorbs rounding on grids of any length and
+     * never matches another time of the grid.
+     */
+    const LocalVolatilitySlice* find(double t) const;
+
+    size_t size() const {return slices_.size();}
+
+private:
+
+    GridAxis times_;
+    std::vector<LocalVolatilitySlice> slices_;
+    // matching tolerance of each slicing time
+    std::vector<double> tolerance_;
+
+};
+
+
 class LocalVolatilitySurface {
 
 public:
 
     /**
      * @brief Makes a local volatility surface
-     * 
+     *
      * @param times a vector of maturities
      * @param spots a vector of spot values
      * @param sigma a vector of local volatilities
+     *
+     * @note uniform and log-uniform time and spot grids are detected at
+     * construction and use an O(1) cell lookup. Other grids use a binary search.
      */
     LocalVolatilitySurface(std::vector<double> times,
                            std::vector<double> spots,
@@ -19,24 +109,61 @@ public:
 
 
     /**
-     * @brief Returns the local volatility 
+     * @brief Returns the local volatility
      * sigma(t, S) interpolated from the grid.
-     * 
+     *
      * @param t the time (in years)
-     * @param S the spot price 
+     * @param S the spot price
      * @return double : the interpolated local volatility at (S, t)
      *
      * @note the local volatility is obtained by bilinear interpolation.
      * If S or t fall outside the grid, value is clamped to the nearest
-     * boundary 
+     * boundary
      */
     double sigma(double t, double S) const;
 
+    /**
+     * @brief Interpolates the local volatility at time t for a block of spots
+     *
+     * @param t the time (in years)
+     * @param S the spot prices
+     * @param out the output buffer, receives sigma(t, S[i]) at position i
+     *
+     * @note the time cell is located once for the whole block. Values are
+     * identical to the ones returned by sigma(t, S[i]).
+     */
+    void sigma_batch(double t, std::span<const double> S, std::span<double> out) const;
+
+    /**
+     * @brief Interpolates the surface in time only
+     *
+     * @param t the time (in years), clamped to the time grid
+     * @return LocalVolatilitySlice : the 1D spot slice of the surface at t
+     *
+     * @note the bilinear interpolation is separable : slice(t).sigma(S)
+     * equals sigma(t, S) up to rounding.
+     */
+    LocalVolatilitySlice slice(double t) const;
+
+    /**
+     * @brief Cuts one slice per time, in parallel
+     *
+     * @param times the increasing times of a simulation grid
+     * @return LocalVolatilityTimeSlices
+     */
+    LocalVolatilityTimeSlices slices(const std::vector<double>& times) const;
+
+    const GridAxis& times() const {return times_;}
+    const GridAxis& spots() const {return *spots_;}
+
 
 private:
 
-    std::vector<double> times_;
-    std::vector<double> spots_;
-    std::vector<double> loc_vol_; 
+    GridAxis times_;
+    std::shared_ptr<const GridAxis> spots_;
+    std::vector<double> loc_vol_;
+
+    // bilinear blend of the four corners around (t_cell, S_cell)
+    double blend(const GridAxis::Cell& t_cell, const GridAxis::Cell& S_cell) const;
 
-};
\ No newline at end of file
+};
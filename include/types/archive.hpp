@@ -0,0 +1,120 @@
+#pragma once
+
+#include "types/barrier.hpp"
+#include "types/simulationresult.hpp"
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief On-disk archive of a SimulationResult, read back through memory
+ * mapping so that results larger than the RAM can be priced
+ *
+ * An archive is a directory holding :
+ * - header.txt : one key=value per line (format version, seed, number of
+ *   steps and paths, layout, description of the scheme, knock-out condition)
+ * - spot.npy and, if generated, vol.npy : the values as a float64 NumPy
+ *   array of shape (n_paths, stored columns). A time-major result is saved
+ *   in Fortran order, so both layouts are written without reordering
+ * - times.npy, observed.npy and, for monitored results, knocked.npy
+ *
+ * @note every array is a plain .npy file, numpy.load(..., mmap_mode="r")
+ * reads it without this library. The data of each file starts on a 64 bytes
+ * boundary.
+ */
+struct SimulationArchive {
+
+    /**
+     * @brief Writes a simulation result to a new archive directory
+     *
+     * @param simulation the result to save
+     * @param path the archive directory, created if needed. Existing arrays
+     * are overwritten
+     * @param description optional : free text stored in the header, such as
+     * the scheme used for the generation
+     */
+    static void save(const SimulationResult& simulation, const std::string& path, const std::string& description = "");
+
+    /**
+     * @brief Opens an archive. The spot and volatility values are memory
+     * mapped read-only, they are read from the disk when accessed
+     *
+     * @param path the archive directory
+     * @return SimulationResult : a result that keeps the mapping alive
+     */
+    static SimulationResult load(const std::string& path);
+
+    /**
+     * @brief Reads the header of an archive
+     *
+     * @param path the archive directory
+     * @return std::map<std::string, std::string> : the key=value pairs
+     */
+    static std::map<std::string, std::string> header(const std::string& path);
+
+};
+
+
+/**
+ * @brief Creates the arrays of an archive before the values are known and
+ * maps them read-write, so that an engine can write the paths in place
+ *
+ * @param path the archive directory, created if needed
+ * @param n_paths the number of paths
+ * @param n_cols the number of stored columns per path
+ * @param layout the order of the values, see SimulationResult
+ * @param with_vol whether vol.npy is created
+ *
+ * @note the archive is complete once finish is called. Distinct paths may
+ * be written concurrently.
+ */
+class ArchiveWriter {
+
+public:
+    ArchiveWriter(const std::string& path, size_t n_paths, size_t n_cols, Layout layout, bool with_vol);
+    ~ArchiveWriter();
+
+    ArchiveWriter(const ArchiveWriter&) = delete;
+    ArchiveWriter& operator=(const ArchiveWriter&) = delete;
+
+    // n_paths * n_cols values, in the order of the layout
+    double* spot();
+    // same as spot, nullptr without volatility
+    double* vol();
+
+    /**
+     * @brief Writes the header and the small arrays, then flushes the
+     * mapped values to the disk
+     *
+     * @param seed the seed of the generation
+     * @param n_steps the number of simulated steps
+     * @param times the simulation time of each stored column
+     * @param observed the step index of each stored column
+     * @param description free text stored in the header
+     * @param knock optional : the knock-out condition monitored during the
+     * simulation, with one flag per path
+     */
+    void finish(size_t seed, size_t n_steps, const std::vector<double>& times, const std::vector<size_t>& observed,
+                const std::string& description,
+                const std::optional<KnockCondition>& knock = std::nullopt,
+                const std::vector<unsigned char>* knocked = nullptr);
+
+private:
+    struct Mapping;
+
+    std::string path_;
+    size_t n_paths_;
+    size_t n_cols_;
+    Layout layout_;
+    std::unique_ptr<Mapping> spot_;
+    std::unique_ptr<Mapping> vol_;
+    bool finished_ = false;
+
+    // creates a (n_paths, n_cols) float64 array and maps it
+    static std::unique_ptr<Mapping> create_values(const std::string& file, size_t n_paths, size_t n_cols, Layout layout);
+
+};
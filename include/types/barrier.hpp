@@ -0,0 +1,23 @@
+#pragma once
+
+
+enum Direction {Up, Down};
+
+
+/**
+ * @brief Barrier level beyond which a path is knocked out
+ * 
+ * @param barrier the barrier level
+ * @param direction Up if the path is knocked out at or above the barrier,
+ * Down if at or below
+ */
+struct KnockCondition {
+    double barrier;
+    Direction direction;
+
+    bool breached(double S) const {
+        return (direction == Up) ? (S >= barrier) : (S <= barrier);
+    }
+
+    bool operator==(const KnockCondition& other) const = default;
+};
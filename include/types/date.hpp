@@ -35,3 +35,15 @@ public:
     int second() {return s;}
     int minute() {return m;}
 };
+
+
+/**
+ * @brief Returns the year fraction between two dates with the ACT/365
+ * convention, the time of day included
+ * 
+ * @param start the start date
+ * @param end the end date
+ * @return double : the number of years from start to end, negative if end
+ * is before start
+ */
+double year_fraction(const Date& start, const Date& end);
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+
+/**
+ * @brief Thread safe least recently used cache of immutable values
+ *
+ * @param capacity the maximum total cost of the values kept, their number
+ * when each value costs 1. A cache of capacity 0 keeps nothing
+ *
+ * @note values are held by shared pointers : a value evicted while in use
+ * stays valid for its users. A value costlier than the capacity is not
+ * kept.
+ */
+template <class Key, class Value, class Hash = std::hash<Key>>
+class LruCache {
+
+public:
+    explicit LruCache(size_t capacity) : capacity_(capacity) {}
+
+    // the value of key, nullptr if it is not cached. A hit makes it the
+    // most recently used value
+    std::shared_ptr<const Value> get(const Key& key){
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            misses_++;
+            return nullptr;
+        }
+        hits_++;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return it->second->value;
+    }
+
+    // caches value under key, evicting the least recently used values
+    // beyond the capacity
+    void put(const Key& key, std::shared_ptr<const Value> value, size_t cost = 1){
+        if (cost > capacity_) return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            cost_ -= it->second->cost;
+            entries_.erase(it->second);
+            index_.erase(it);
+        }
+        entries_.push_front(Entry{key, std::move(value), cost});
+        index_[key] = entries_.begin();
+        cost_ += cost;
+        while (cost_ > capacity_) {
+            cost_ -= entries_.back().cost;
+            index_.erase(entries_.back().key);
+            entries_.pop_back();
+        }
+    }
+
+    void clear(){
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.clear();
+        index_.clear();
+        cost_ = 0;
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entries_.size();
+    }
+    size_t capacity() const {return capacity_;}
+    // total cost of the values kept
+    size_t cost() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return cost_;
+    }
+    // number of get calls that found, or did not find, their key
+    size_t hits() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return hits_;
+    }
+    size_t misses() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return misses_;
+    }
+
+private:
+    struct Entry {
+        Key key;
+        std::shared_ptr<const Value> value;
+        size_t cost;
+    };
+
+    const size_t capacity_;
+    std::list<Entry> entries_;
+    std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> index_;
+    size_t hits_ = 0;
+    size_t misses_ = 0;
+    size_t cost_ = 0;
+    mutable std::mutex mutex_;
+
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "types/simulationresult.hpp"
+#include <vector>
+
+
+/**
+ * @brief Per-path statistics shared by the payoffs of a batch
+ * 
+ * Vanilla payoffs only need the terminal spot and discretely monitored
+ * barriers only need the extreme spots, so a batch of instruments is
+ * evaluated from these columns instead of rescanning every path.
+ * 
+ * @note the statistics cover every state of the path, the initial spot
+ * included. average is the arithmetic average of these states.
+ */
+struct PathFeatures {
+    std::vector<double> terminal;
+    std::vector<double> max;
+    std::vector<double> min;
+    std::vector<double> average;
+
+    PathFeatures() = default;
+
+    // allocates the features of n_paths paths
+    explicit PathFeatures(size_t n_paths) :
+        terminal(n_paths), max(n_paths), min(n_paths), average(n_paths) {};
+
+    size_t size() const {return terminal.size();}
+
+    /**
+     * @brief Extracts the features of stored paths, in parallel
+     * 
+     * @param simulation a SimulationResult instance
+     * @return PathFeatures : the statistics of the stored columns of each path
+     * @note with an observation schedule, only the stored steps are seen
+     */
+    static PathFeatures extract(const SimulationResult& simulation);
+};
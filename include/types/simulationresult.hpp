@@ -4,16 +4,49 @@
 #include "path.hpp"
 #include "models/model.hpp"
 #include "schemes/schemes.hpp"
+#include "types/barrier.hpp"
 #include <optional>
+#include <span>
 #include <stdexcept>
 #include <vector>
 #include <memory>
+#include <mutex>
 
 
+// PathMajor : path p is stored contiguously, at offset p * path_size
+// TimeMajor : the values of all the paths at a stored step are contiguous,
+// value (p, j) is at offset j * n_paths + p
+enum Layout {PathMajor, TimeMajor};
+
+/**
+ * @brief Source of paths computed when they are read instead of being
+ * stored, see MonteCarlo::generate_lazy
+ */
+struct PathSource {
+
+    virtual ~PathSource() = default;
+
+    /**
+     * @brief Writes a block of paths in path-major order
+     * 
+     * @param first the first path of the block
+     * @param count the number of paths of the block
+     * @param spot the output buffer for the spots, count * stored columns values
+     * @param vol the output buffer for the volatilities, same size as spot.
+     * Left untouched if empty
+     */
+    virtual void fill(size_t first, size_t count, std::span<double> spot, std::span<double> vol) const = 0;
+
+    virtual bool has_vol() const = 0;
+
+};
+
 /**
- * @brief Structure containing the paths as row-major vectors and representing 
+ * @brief Structure containing the paths as flat vectors and representing 
  * the evolution of the spot and of the variance of the process
  * 
+ * @note the order of the values depends on the layout, use index, 
+ * path_stride and step_stride to read them.
  */
 struct SimulationResult {
 
@@ -25,13 +58,88 @@ struct SimulationResult {
      * @param seed The seed used to generate the path 
      * @param n_steps The number of steps of the generation 
      * @param n_paths the nuùber of paths of the generation
+     * @param v_paths optional : a shared pointer to the volatility paths
+     * @param times optional : the simulation times of the stored columns
+     * @param observed optional : the increasing step indices of the stored
+     * columns. If not set, every step from 0 to n_steps is stored
+     * @param layout the order of the values in paths and v_paths
      */
     SimulationResult(std::shared_ptr<std::vector<double>> paths, size_t seed,
-                    size_t n_steps, size_t n_paths, std::optional<std::shared_ptr<std::vector<double>>> v_paths = std::nullopt);
+                    size_t n_steps, size_t n_paths, std::optional<std::shared_ptr<std::vector<double>>> v_paths = std::nullopt,
+                    std::shared_ptr<const std::vector<double>> times = nullptr,
+                    std::optional<std::vector<size_t>> observed = std::nullopt,
+                    Layout layout = PathMajor);
+
+    /**
+     * @brief Construct a SimulationResult over values stored outside of it,
+     * such as a memory mapped file
+     * 
+     * @param storage the owner of the memory, kept alive by the result
+     * @param paths the spot values, n_paths * number of stored columns
+     * @param v_paths the volatility values, same size as paths or empty
+     * @param seed The seed used to generate the path 
+     * @param n_steps The number of steps of the generation 
+     * @param n_paths the number of paths of the generation
+     * @param times optional : the simulation times of the stored columns
+     * @param observed optional : the increasing step indices of the stored
+     * columns
+     * @param layout the order of the values in paths and v_paths
+     */
+    SimulationResult(std::shared_ptr<const void> storage, std::span<const double> paths, std::span<const double> v_paths,
+                    size_t seed, size_t n_steps, size_t n_paths,
+                    std::shared_ptr<const std::vector<double>> times = nullptr,
+                    std::optional<std::vector<size_t>> observed = std::nullopt,
+                    Layout layout = PathMajor);
+
+    /**
+     * @brief Construct a lazy SimulationResult : the paths are not stored but
+     * computed by a source each time they are read
+     * 
+     * @param source the source of the paths
+     * @param seed The seed used to generate the path 
+     * @param n_steps The number of steps of the generation 
+     * @param n_paths the number of paths of the generation
+     * @param times optional : the simulation times of the stored columns
+     * @param observed optional : the increasing step indices of the stored
+     * columns
+     * @param layout the order of the values of spots() and vols()
+     * 
+     * @note copy_paths reads blocks from the source. spots() and vols()
+     * compute every path once and keep them, which gives up the memory
+     * saving of the lazy result.
+     */
+    SimulationResult(std::shared_ptr<const PathSource> source, size_t seed, size_t n_steps, size_t n_paths,
+                    std::shared_ptr<const std::vector<double>> times = nullptr,
+                    std::optional<std::vector<size_t>> observed = std::nullopt,
+                    Layout layout = PathMajor);
+
     size_t get_npaths() const {return n_paths_;}
     size_t get_seed() const {return origin_seed_;}
+    // number of simulated steps, stored or not
     size_t get_nsteps() const {return n_steps_;}
-    size_t get_path_size() const {return n_steps_+1;}
+    // number of stored values per path
+    size_t get_path_size() const {return observed_.size();}
+    // step index of each stored column
+    const std::vector<size_t>& get_observed_steps() const {return observed_;}
+
+    Layout get_layout() const {return layout_;}
+    // distance between the values of two consecutive paths at the same step
+    size_t path_stride() const {return layout_ == PathMajor ? observed_.size() : 1;}
+    // distance between two consecutive stored values of a path
+    size_t step_stride() const {return layout_ == PathMajor ? 1 : n_paths_;}
+    // offset of the value of path p at stored column j
+    size_t index(size_t p, size_t j) const {return p * path_stride() + j * step_stride();}
+
+    /**
+     * @brief Copies a block of paths in path-major order, whatever the layout
+     * 
+     * @param first the first path of the block
+     * @param count the number of paths of the block
+     * @param spot the output buffer for the spots, count * get_path_size() values
+     * @param vol optional output buffer for the volatilities, same size as
+     * spot. Left untouched if empty
+     */
+    void copy_paths(size_t first, size_t count, std::span<double> spot, std::span<double> vol = {}) const;
 
     /**
      * @brief Returns the average final value of
@@ -41,27 +149,94 @@ struct SimulationResult {
      */
     double avg_terminal_value();
 
+    // spot values, whatever the storage of the result
+    std::span<const double> spots() const {return source_ ? std::span<const double>(materialize().spot) : spots_;}
+    // volatility values, whatever the storage of the result
+    std::span<const double> vols() const {
+        if (!has_vol()) throw std::invalid_argument(
+            "SimulationResult : no path for volatility was generated. "
+            "Use MonteCarlo.configure to change generation settings.");
+        return source_ ? std::span<const double>(materialize().vol) : vols_;
+    }
+
+    // whether the paths are computed when read, see PathSource
+    bool is_lazy() const {return static_cast<bool>(source_);}
+
+    // spot values of a result held in memory
     const std::vector<double>& get_paths() const {
+        if (!paths_) throw std::invalid_argument("SimulationResult : the paths are not held in memory, use spots()");
         return *paths_;
     }
+    // volatility values of a result held in memory
     const std::vector<double>& get_vol() const {
-    if (!vols_ || vols_->empty()) {
+    if (vols_.empty()) {
         throw std::invalid_argument(
             "SimulationResult : no path for volatility was generated. "
             "Use MonteCarlo.configure to change generation settings."
         );
     }
-    return *vols_;
+    if (!v_paths_) throw std::invalid_argument("SimulationResult : the paths are not held in memory, use vols()");
+    return *v_paths_;
+    }
+
+    /**
+     * @brief Marks the paths that were knocked out during the simulation
+     * 
+     * @param knock the knock-out condition monitored by the engine
+     * @param knocked one flag per path, non zero if the path was knocked out.
+     * The stored values of a knocked path stop at the knock-out step
+     */
+    void attach_knock_out(KnockCondition knock, std::vector<unsigned char> knocked);
+
+    // knock-out condition monitored during the simulation, if any
+    const std::optional<KnockCondition>& get_knock_out() const {return knock_;}
+    const std::vector<unsigned char>& get_knocked() const {
+        if (!knock_) throw std::invalid_argument("SimulationResult : the simulation did not monitor a knock-out condition");
+        return *knocked_;
+    }
+
+    bool has_vol() const {return source_ ? source_->has_vol() : !vols_.empty();}
+    bool has_times() const {return static_cast<bool>(times_);}
+
+    // returns the simulation times of the path columns
+    const std::vector<double>& get_times() const {
+        if (!times_) throw std::invalid_argument("SimulationResult : the simulation times were not recorded");
+        return *times_;
     }
 
 
     private :
+        // all the paths of a lazy result, computed on the first call to
+        // spots() or vols() and shared by the copies of the result
+        struct Materialized {
+            std::once_flag once;
+            std::vector<double> spot;
+            std::vector<double> vol;
+        };
+
+        // in memory results own vectors, other results an opaque storage.
+        // spots_ and vols_ view the values in both cases. Lazy results only
+        // hold their source
         std::shared_ptr<std::vector<double>> paths_;
-        std::shared_ptr<std::vector<double>> vols_;
+        std::shared_ptr<std::vector<double>> v_paths_;
+        std::shared_ptr<const void> storage_;
+        std::span<const double> spots_;
+        std::span<const double> vols_;
+        std::shared_ptr<const PathSource> source_;
+        std::shared_ptr<Materialized> materialized_;
+        std::shared_ptr<const std::vector<double>> times_;
+        std::vector<size_t> observed_;
+        std::optional<KnockCondition> knock_;
+        std::shared_ptr<const std::vector<unsigned char>> knocked_;
+        Layout layout_;
         const size_t origin_seed_;
         const size_t n_paths_;
         const size_t n_steps_;
 
+        // checks the dimensions and fills observed_
+        void init(std::optional<std::vector<size_t>> observed);
+
+        const Materialized& materialize() const;
 
 };
 
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "types/simulationresult.hpp"
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <vector>
+
+
+/**
+ * @brief Cross-sectional mean and variance of each stored column
+ *
+ * @note variance is the unbiased sample variance, 0 with a single path
+ */
+struct StepMoments {
+    std::vector<double> mean;
+    std::vector<double> variance;
+};
+
+/**
+ * @brief Fixed-bin histogram
+ *
+ * @note edges holds n_bins + 1 increasing values. Bin i counts the values in
+ * [edges[i], edges[i+1]), the last bin also counts its upper edge.
+ */
+struct Histogram {
+    std::vector<double> edges;
+    std::vector<size_t> counts;
+};
+
+
+/**
+ * @brief Parallel statistics across the paths of a simulation, computed in
+ * C++ without copying the paths out
+ *
+ * Every function reads the spot values, or the volatility values if vol is
+ * set, and works with both layouts of SimulationResult.
+ */
+struct Statistics {
+
+    /**
+     * @brief Computes the mean and variance of every stored column in one
+     * parallel pass
+     *
+     * @param simulation a SimulationResult instance
+     * @param vol whether to read the volatility instead of the spot
+     * @return StepMoments : one mean and one variance per stored column
+     * @note each thread accumulates a contiguous range of paths with
+     * Welford's update, the partial moments are then merged in order.
+     */
+    static StepMoments moments(const SimulationResult& simulation, bool vol = false);
+
+    /**
+     * @brief Computes quantiles of a stored column
+     *
+     * @param simulation a SimulationResult instance
+     * @param column the stored column
+     * @param probs the probabilities, in [0, 1]
+     * @param vol whether to read the volatility instead of the spot
+     * @return std::vector<double> : one quantile per probability, in the
+     * order of probs
+     * @note quantiles are linearly interpolated between order statistics,
+     * like numpy.quantile. The order statistics are found by recursive
+     * selection, the two sides of each selected rank in parallel : no full
+     * sort is performed.
+     */
+    static std::vector<double> quantiles(const SimulationResult& simulation, size_t column,
+                                         const std::vector<double>& probs, bool vol = false);
+
+    /**
+     * @brief Counts the values of a stored column in fixed-width bins
+     *
+     * @param simulation a SimulationResult instance
+     * @param column the stored column
+     * @param n_bins the number of bins
+     * @param range optional : the lower and upper edges. Values outside are
+     * not counted. Defaults to the minimum and maximum of the column
+     * @param vol whether to read the volatility instead of the spot
+     * @return Histogram
+     */
+    static Histogram histogram(const SimulationResult& simulation, size_t column, size_t n_bins,
+                               std::optional<std::pair<double, double>> range = std::nullopt, bool vol = false);
+
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "types/date.hpp"
+#include <cstddef>
+#include <vector>
+
+
+/**
+ * @brief Increasing simulation times, starting at 0
+ *
+ * A grid can be uniform, built from an explicit list of times or from a
+ * schedule of dates. Steps of different lengths are allowed, so a product
+ * observed on a few dates only needs to simulate those dates.
+ */
+class TimeGrid {
+
+public:
+
+    /**
+     * @brief Makes a time grid from explicit times
+     *
+     * @param times strictly increasing times in years. The first one must be 0
+     */
+    explicit TimeGrid(std::vector<double> times);
+
+    /**
+     * @brief Makes a grid of n steps of length T/n
+     *
+     * @param T the time horizon
+     * @param n the number of steps
+     * @return TimeGrid
+     */
+    static TimeGrid uniform(double T, size_t n);
+
+    /**
+     * @brief Makes a grid from a schedule of dates
+     *
+     * @param start the valuation date, mapped to time 0
+     * @param dates the increasing event dates, all after start
+     * @return TimeGrid : the year fractions (ACT/365) of the dates from start
+     */
+    static TimeGrid from_dates(const Date& start, const std::vector<Date>& dates);
+
+    /**
+     * @brief Splits the steps longer than max_dt
+     *
+     * @param max_dt the maximum step length
+     * @return TimeGrid : a grid containing all the current times, where each
+     * step is split into the smallest number of equal sub-steps not longer
+     * than max_dt
+     */
+    TimeGrid refine(double max_dt) const;
+
+    /**
+     * @brief Returns the index of a time of the grid
+     *
+     * @param t a time of the grid
+     * @return size_t : the index k such that times()[k] == t, up to a
+     * relative tolerance of 1e-9
+     */
+    size_t index(double t) const;
+
+    /**
+     * @brief Returns the indices of several times of the grid
+     *
+     * @param times times of the grid
+     * @return std::vector<size_t> : index(t) for each time
+     */
+    std::vector<size_t> indices(const std::vector<double>& times) const;
+
+    const std::vector<double>& times() const {return times_;}
+    double operator[](size_t k) const {return times_[k];}
+    // length of the step ending at times()[k], for k >= 1
+    double dt(size_t k) const {return times_[k] - times_[k-1];}
+    size_t size() const {return times_.size();}
+    size_t n_steps() const {return times_.size() - 1;}
+    double maturity() const {return times_.back();}
+
+private:
+
+    std::vector<double> times_;
+
+};
@@ -1,32 +1,198 @@
 #include <memory>
 #include <pybind11/attr.h>
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include <pybind11/stl_bind.h>
 #include <optional>
+#include <string>
+#include <vector>
 #include "schemes/schemes.hpp"
+#include "engine/cancellation.hpp"
+#include "engine/chunks.hpp"
 #include "engine/montecarlo.hpp"
+#include "engine/randomstore.hpp"
+#include "engine/simulationcache.hpp"
+#include "engine/workspace.hpp"
+#include "types/simulationresult.hpp"
+#include "types/timegrid.hpp"
 
 namespace py = pybind11;
 
 namespace qe::pybind {
 
 void bind_engine(py::module_& m) {
+
+    py::register_exception<Cancelled>(m, "_Cancelled");
+
+    py::class_<CancellationToken, std::shared_ptr<CancellationToken>>(m, "_CancellationToken")
+        .def(py::init<>())
+        .def("cancel", &CancellationToken::cancel)
+        .def_property_readonly("cancelled", &CancellationToken::cancelled);
+    
+    py::class_<ChunkedGenerator>(m, "_ChunkedGenerator")
+        .def("__iter__", [](ChunkedGenerator& self) -> ChunkedGenerator& {return self;})
+        .def("__next__", [](ChunkedGenerator& self) {
+                std::optional<SimulationResult> block;
+                {
+                    py::gil_scoped_release release;
+                    block = self.next();
+                }
+                if (!block) throw py::stop_iteration();
+                return std::move(*block);
+            })
+        .def_property_readonly("remaining", &ChunkedGenerator::remaining)
+        .def_property_readonly("chunk_paths", &ChunkedGenerator::chunk_paths);
     
+    py::class_<RandomStore, std::shared_ptr<RandomStore>>(m, "_RandomStore")
+        .def(py::init<size_t, size_t, size_t, size_t, int>(),
+            py::arg("n_paths"),
+            py::arg("n_steps"),
+            py::arg("dims") = 1,
+            py::arg("seed") = 0,
+            py::arg("n_jobs") = -1,
+            py::call_guard<py::gil_scoped_release>())
+        .def_property_readonly("n_paths", &RandomStore::n_paths)
+        .def_property_readonly("n_steps", &RandomStore::n_steps)
+        .def_property_readonly("dims", &RandomStore::dims)
+        .def_property_readonly("nbytes", &RandomStore::bytes)
+        // read-only (n_paths, n_steps, dims) view, which keeps the store alive
+        .def_property_readonly("values", [](py::object self) {
+                const RandomStore& store = self.cast<const RandomStore&>();
+                py::array out(py::dtype::of<double>(),
+                              std::vector<ssize_t>{static_cast<ssize_t>(store.n_paths()), static_cast<ssize_t>(store.n_steps()),
+                                                   static_cast<ssize_t>(store.dims())},
+                              store.values().data(),
+                              self);
+                py::detail::array_proxy(out.ptr())->flags &= ~py::detail::npy_api::NPY_ARRAY_WRITEABLE_;
+                return out;
+            })
+        .def("_save", &RandomStore::save, py::arg("path"), py::call_guard<py::gil_scoped_release>());
+
+    m.def("_load_random_store", [](const std::string& path) {
+            return std::make_shared<RandomStore>(RandomStore::load(path));
+        },
+        py::arg("path"),
+        py::call_guard<py::gil_scoped_release>());
+
     py::class_<MonteCarlo, std::shared_ptr<MonteCarlo>>(m, "_MonteCarlo")
         .def(py::init<std::shared_ptr<Scheme> >(),
             py::arg("scheme"),
             py::keep_alive<1,2>())
-        .def("_generate", &MonteCarlo::generate_spot,
+        .def("_generate", py::overload_cast<float, size_t, float, size_t, std::optional<double>, 
+                                            std::optional<std::vector<size_t>>>(&MonteCarlo::generate_spot),
+            py::arg("S0"),
+            py::arg("n"),
+            py::arg("T"),
+            py::arg("n_paths"),
+            py::arg("v0") = py::none(),
+            py::arg("observe") = py::none(),
+            py::call_guard<py::gil_scoped_release>())
+        .def("_generate_batch", [](MonteCarlo& mc, const std::vector<std::shared_ptr<Scheme>>& schemes, double S0, size_t n, double T,
+                                   size_t n_paths, std::optional<double> v0) {
+                return mc.generate_batch(schemes, S0, TimeGrid::uniform(T, n), n_paths, v0);
+            },
+            py::arg("schemes"),
             py::arg("S0"),
             py::arg("n"),
             py::arg("T"),
             py::arg("n_paths"),
-            py::arg("v0") = py::none())
+            py::arg("v0") = py::none(),
+            py::call_guard<py::gil_scoped_release>())
+        .def("_iter_chunks", [](const MonteCarlo& mc, double S0, size_t n, double T, size_t n_paths, size_t chunk_paths,
+                                std::optional<double> v0, std::optional<std::vector<size_t>> observe) {
+                return std::make_unique<ChunkedGenerator>(mc, S0, TimeGrid::uniform(T, n), n_paths, chunk_paths, v0, std::move(observe));
+            },
+            py::arg("S0"),
+            py::arg("n"),
+            py::arg("T"),
+            py::arg("n_paths"),
+            py::arg("chunk_paths"),
+            py::arg("v0") = py::none(),
+            py::arg("observe") = py::none())
+        .def("_generate_on_grid", [](MonteCarlo& mc, double S0, std::vector<double> times, size_t n_paths,
+                                     std::optional<double> v0, std::optional<double> max_dt,
+                                     std::optional<std::vector<double>> observe_times) {
+                TimeGrid grid(std::move(times));
+                if (max_dt.has_value()) grid = grid.refine(max_dt.value());
+                std::optional<std::vector<size_t>> observe = std::nullopt;
+                if (observe_times.has_value()) observe = grid.indices(observe_times.value());
+                return mc.generate_spot(S0, grid, n_paths, v0, observe);
+            },
+            py::arg("S0"),
+            py::arg("times"),
+            py::arg("n_paths"),
+            py::arg("v0") = py::none(),
+            py::arg("max_dt") = py::none(),
+            py::arg("observe_times") = py::none(),
+            py::call_guard<py::gil_scoped_release>())
+        .def("_generate_lazy", [](MonteCarlo& mc, double S0, std::vector<double> times, size_t n_paths,
+                                  std::optional<double> v0, std::optional<double> max_dt,
+                                  std::optional<std::vector<double>> observe_times, size_t cache_blocks) {
+                TimeGrid grid(std::move(times));
+                if (max_dt.has_value()) grid = grid.refine(max_dt.value());
+                std::optional<std::vector<size_t>> observe = std::nullopt;
+                if (observe_times.has_value()) observe = grid.indices(observe_times.value());
+                return mc.generate_lazy(S0, grid, n_paths, v0, observe, cache_blocks);
+            },
+            py::arg("S0"),
+            py::arg("times"),
+            py::arg("n_paths"),
+            py::arg("v0") = py::none(),
+            py::arg("max_dt") = py::none(),
+            py::arg("observe_times") = py::none(),
+            py::arg("cache_blocks") = 0,
+            py::call_guard<py::gil_scoped_release>())
+        .def("_generate_to_file", [](MonteCarlo& mc, const std::string& path, double S0, std::vector<double> times, size_t n_paths,
+                                     std::optional<double> v0, std::optional<double> max_dt,
+                                     std::optional<std::vector<double>> observe_times) {
+                TimeGrid grid(std::move(times));
+                if (max_dt.has_value()) grid = grid.refine(max_dt.value());
+                std::optional<std::vector<size_t>> observe = std::nullopt;
+                if (observe_times.has_value()) observe = grid.indices(observe_times.value());
+                return mc.generate_to_file(path, S0, grid, n_paths, v0, observe);
+            },
+            py::arg("path"),
+            py::arg("S0"),
+            py::arg("times"),
+            py::arg("n_paths"),
+            py::arg("v0") = py::none(),
+            py::arg("max_dt") = py::none(),
+            py::arg("observe_times") = py::none(),
+            py::call_guard<py::gil_scoped_release>())
+        .def("_set_workspace", [](MonteCarlo& mc, std::optional<size_t> max_buffers) {
+                mc.set_workspace(max_buffers.has_value() ? std::make_shared<Workspace>(max_buffers.value()) : nullptr);
+            },
+            py::arg("max_buffers"))
+        .def("_workspace_bytes", [](const MonteCarlo& mc) {
+                return mc.get_workspace() ? mc.get_workspace()->reserved_bytes() : size_t(0);
+            })
+        .def("_set_cache", [](MonteCarlo& mc, std::optional<size_t> max_bytes) {
+                mc.set_cache(max_bytes.has_value() ? std::make_shared<SimulationCache>(max_bytes.value()) : nullptr);
+            },
+            py::arg("max_bytes"))
+        .def("_cache_stats", [](const MonteCarlo& mc) {
+                py::dict stats;
+                const std::shared_ptr<SimulationCache>& cache = mc.get_cache();
+                stats["entries"] = cache ? cache->size() : size_t(0);
+                stats["bytes"] = cache ? cache->bytes() : size_t(0);
+                stats["max_bytes"] = cache ? cache->max_bytes() : size_t(0);
+                stats["hits"] = cache ? cache->hits() : size_t(0);
+                stats["misses"] = cache ? cache->misses() : size_t(0);
+                return stats;
+            })
+        .def("_clear_cache", [](MonteCarlo& mc) {
+                if (mc.get_cache()) mc.get_cache()->clear();
+            })
+        .def("_set_random_store", [](MonteCarlo& mc, std::shared_ptr<RandomStore> store) {
+                mc.set_random_store(std::move(store));
+            },
+            py::arg("store"))
         .def("_configure", &MonteCarlo::configure,
             py::arg("seed"),
             py::arg("n_jobs"),
-            py::arg("return_vol")
+            py::arg("return_vol"),
+            py::arg("layout") = py::none()
         );
 }
 
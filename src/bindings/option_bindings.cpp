@@ -1,10 +1,16 @@
 #include "instruments/instrument.h"
 #include "options/options.hpp"
+#include "payoff/expression.hpp"
 #include "payoff/payoff.h"
 #include "types/simulationresult.hpp"
+#include <algorithm>
 #include <memory>
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+#include <span>
+#include <stdexcept>
+#include <string>
 
 
 
@@ -14,6 +20,36 @@ namespace py = pybind11;
 namespace qe::pybind {
 
 
+// wraps a Python function mapping a n_paths x path_size block of spots and
+// the strike to the payoffs of the paths. The pricing threads do not hold the GIL : it is
+// acquired for each call, and for the last release of the function
+static FunctionPayoff::Function python_payoff(py::function function) {
+
+    std::shared_ptr<py::function> held(new py::function(std::move(function)), [](py::function* f){
+        py::gil_scoped_acquire gil;
+        delete f;
+    });
+
+    return [held](const PathsView& paths, double K, std::span<double> out){
+        py::gil_scoped_acquire gil;
+
+        // a read-only view on the block, only valid during the call
+        const ssize_t item = static_cast<ssize_t>(sizeof(double));
+        py::array spots(py::dtype::of<double>(),
+                        {static_cast<ssize_t>(paths.n_paths), static_cast<ssize_t>(paths.path_size)},
+                        {static_cast<ssize_t>(paths.path_size) * item, item},
+                        paths.spot.data(),
+                        py::none());
+        spots.attr("setflags")(py::arg("write") = false);
+
+        auto payoffs = py::array_t<double, py::array::c_style | py::array::forcecast>::ensure((*held)(spots, K));
+        if (!payoffs || payoffs.ndim() != 1 || static_cast<size_t>(payoffs.size()) != out.size())
+            throw std::invalid_argument("FunctionPayoff : the function must return a 1-D array of "
+                                        + std::to_string(out.size()) + " payoffs, one per path");
+        std::copy(payoffs.data(), payoffs.data() + out.size(), out.begin());
+    };
+}
+
 void bind_options(py::module_& m){
 
     py::class_<OptionContract>(m, "_OptionContract")
@@ -35,6 +71,19 @@ void bind_options(py::module_& m){
     py::class_<DigitalPutPayoff, Payoff, std::shared_ptr<DigitalPutPayoff>>(m, "_DigitalPutPayoff")
         .def(py::init<>());
 
+    py::class_<FunctionPayoff, Payoff, std::shared_ptr<FunctionPayoff>>(m, "_FunctionPayoff")
+        .def(py::init([](py::function function, size_t chunk_paths){
+                return std::make_shared<FunctionPayoff>(python_payoff(std::move(function)), chunk_paths);
+            }),
+            py::arg("function"),
+            py::arg("chunk_paths"))
+        .def_property_readonly("chunk_paths", &FunctionPayoff::chunk_paths);
+
+    py::class_<ExpressionPayoff, Payoff, std::shared_ptr<ExpressionPayoff>>(m, "_ExpressionPayoff")
+        .def(py::init<const std::string&>(),
+            py::arg("expression"))
+        .def_property_readonly("expression", &ExpressionPayoff::expression);
+
     py::enum_<Direction>(m, "_Direction")
         .value("Up", Direction::Up)
         .value("Down", Direction::Down)
@@ -45,12 +94,18 @@ void bind_options(py::module_& m){
         .value("Out", Nature::Out)
         .export_values();
 
+    py::enum_<Monitoring>(m, "_Monitoring")
+        .value("Discrete", Monitoring::Discrete)
+        .value("Continuous", Monitoring::Continuous)
+        .export_values();
+
     py::class_<BarrierPayoff, Payoff, std::shared_ptr<BarrierPayoff>>(m, "_BarrierPayoff")
-        .def(py::init<double, Direction, Nature, Payoff&>(),
+        .def(py::init<double, Direction, Nature, Payoff&, Monitoring>(),
             py::arg("H"),
             py::arg("direction"),
             py::arg("nature"),
-            py::arg("payoff"));
+            py::arg("payoff"),
+            py::arg("monitoring") = Monitoring::Discrete);
 
     py::class_<Instrument, std::shared_ptr<Instrument>>(m, "_Instrument")
         .def(py::init<OptionContract, std::shared_ptr<Payoff>>())
@@ -58,7 +113,8 @@ void bind_options(py::module_& m){
             [](const Instrument& self, const SimulationResult& res){
                 return self.compute_payoff(res);
             },
-            py::arg("simulation_result"));
+            py::arg("simulation_result"),
+            py::call_guard<py::gil_scoped_release>());
 
 
 }
@@ -1,10 +1,19 @@
+#include "bindings.hpp"
+#include "engine/cancellation.hpp"
 #include "engine/engine.hpp"
 #include "engine/montecarlo.hpp"
 #include "instruments/instrument.h"
+#include "instruments/instrumenttable.hpp"
+#include "options/options.hpp"
+#include "payoff/payoff.h"
 #include "pricing/pricer.h"
+#include "schemes/schemes.hpp"
 #include "types/marketstate.h"
 #include <memory>
 #include <optional>
+#include <span>
+#include <stdexcept>
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include <vector>
@@ -14,6 +23,16 @@ namespace py = pybind11;
 namespace qe::pybind {
 
 
+using Doubles = py::array_t<double, py::array::c_style | py::array::forcecast>;
+using Codes = py::array_t<int32_t, py::array::c_style | py::array::forcecast>;
+
+template <class T>
+static std::span<const T> column(const std::optional<py::array_t<T, py::array::c_style | py::array::forcecast>>& a) {
+    if (!a) return {};
+    if (a->ndim() != 1) throw std::invalid_argument("Pricer::price_table : the columns must be one dimensional");
+    return std::span<const T>(a->data(), static_cast<size_t>(a->size()));
+}
+
 void bind_pricer(py::module_& m){
 
     py::class_<MarketState>(m, "_MarketState")
@@ -29,15 +48,23 @@ void bind_pricer(py::module_& m){
             py::arg("n_paths"),
             py::arg("engine"))
         .def("_compute_price", 
-            [](const Pricer& self, std::shared_ptr<Instrument> instrument)
-            {return self.compute_price(instrument);})
+            [](const Pricer& self, std::shared_ptr<Instrument> instrument, std::shared_ptr<CancellationToken> token)
+            {return run_released(token, [&]{return self.compute_price(instrument);});},
+            py::arg("instrument"),
+            py::arg("token") = nullptr)
         .def("_delta",
-            [] (const Pricer& self, std::shared_ptr<Instrument> instrument, double h)
-            {return self.compute_delta_bar(instrument, h);}
+            [] (const Pricer& self, std::shared_ptr<Instrument> instrument, double h, std::shared_ptr<CancellationToken> token)
+            {return run_released(token, [&]{return self.compute_delta_bar(instrument, h);});},
+            py::arg("instrument"),
+            py::arg("h"),
+            py::arg("token") = nullptr
         )
         .def("_gamma", 
-            [] (const Pricer& self, std::shared_ptr<Instrument> instrument, double h)
-            {return self.compute_gamma_bar(instrument, h);}
+            [] (const Pricer& self, std::shared_ptr<Instrument> instrument, double h, std::shared_ptr<CancellationToken> token)
+            {return run_released(token, [&]{return self.compute_gamma_bar(instrument, h);});},
+            py::arg("instrument"),
+            py::arg("h"),
+            py::arg("token") = nullptr
         )
         .def("_reconfigure", &Pricer::reconfigure,
             py::arg("n_steps"),
@@ -45,8 +72,68 @@ void bind_pricer(py::module_& m){
             py::arg("marketstate")
         )
         .def("_batch_price", 
-            [] (const Pricer& self, std::vector<std::shared_ptr<Instrument>>& instruments)
-            {return self.batch_price(instruments);}
+            [] (const Pricer& self, std::vector<std::shared_ptr<Instrument>>& instruments, std::shared_ptr<CancellationToken> token)
+            {return run_released(token, [&]{return self.batch_price(instruments);});},
+            py::arg("instruments"),
+            py::arg("token") = nullptr
+        )
+        .def("_price_table",
+            [] (const Pricer& self, Doubles K, Doubles T, Codes payoff, std::optional<Doubles> barrier,
+                std::optional<Codes> direction, std::optional<Codes> nature, std::shared_ptr<CancellationToken> token)
+            {
+                InstrumentTable table{column<double>(K), column<double>(T), column<int32_t>(payoff),
+                                      column<double>(barrier), column<int32_t>(direction), column<int32_t>(nature)};
+                TablePrices prices = run_released(token, [&]{return self.price_table(table);});
+                return py::make_tuple(py::array_t<double>(static_cast<ssize_t>(prices.price.size()), prices.price.data()),
+                                      py::array_t<double>(static_cast<ssize_t>(prices.std_error.size()), prices.std_error.data()));
+            },
+            py::arg("K"),
+            py::arg("T"),
+            py::arg("payoff"),
+            py::arg("barrier") = py::none(),
+            py::arg("direction") = py::none(),
+            py::arg("nature") = py::none(),
+            py::arg("token") = nullptr
+        )
+        .def("_scenario_prices",
+            [] (const Pricer& self, const std::vector<MarketState>& scenarios, const std::vector<std::shared_ptr<Instrument>>& instruments,
+                std::shared_ptr<CancellationToken> token)
+            {
+                std::vector<std::vector<double>> prices = run_released(token, [&]{return self.scenario_prices(scenarios, instruments);});
+                py::array_t<double> out({static_cast<ssize_t>(prices.size()), static_cast<ssize_t>(instruments.size())});
+                auto view = out.mutable_unchecked<2>();
+                for (size_t k = 0; k < prices.size(); k++) {
+                    for (size_t i = 0; i < prices[k].size(); i++) view(k, i) = prices[k][i];
+                }
+                return out;
+            },
+            py::arg("scenarios"),
+            py::arg("instruments"),
+            py::arg("token") = nullptr
+        )
+        .def("_parameter_prices",
+            [] (const Pricer& self, const std::vector<std::shared_ptr<Scheme>>& schemes,
+                const std::vector<std::shared_ptr<Instrument>>& instruments, std::shared_ptr<CancellationToken> token)
+            {
+                std::vector<std::vector<double>> prices = run_released(token, [&]{return self.parameter_prices(schemes, instruments);});
+                py::array_t<double> out({static_cast<ssize_t>(prices.size()), static_cast<ssize_t>(instruments.size())});
+                auto view = out.mutable_unchecked<2>();
+                for (size_t k = 0; k < prices.size(); k++) {
+                    for (size_t i = 0; i < prices[k].size(); i++) view(k, i) = prices[k][i];
+                }
+                return out;
+            },
+            py::arg("schemes"),
+            py::arg("instruments"),
+            py::arg("token") = nullptr
+        )
+        .def("_ladder_price", &Pricer::ladder_price,
+            py::arg("barriers"),
+            py::arg("direction"),
+            py::arg("nature"),
+            py::arg("payoff"),
+            py::arg("contract"),
+            py::call_guard<py::gil_scoped_release>()
         );
 
 
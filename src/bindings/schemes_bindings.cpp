@@ -3,8 +3,11 @@
 #include "models/black_scholes/black_scholes.hpp"
 #include "models/dupire/dupire.hpp"
 #include "models/heston/heston.hpp"
+#include "models/ir_models/vasicek.h"
 #include "models/model.hpp"
 #include "schemes/euler.h"
+#include "schemes/eulerblackscholes.hpp"
+#include "schemes/exactvasicek.hpp"
 #include "schemes/eulerheston.hpp"
 #include "schemes/qe.hpp"
 
@@ -30,6 +33,14 @@ void bind_schemes(py::module_& m) {
         .def(py::init<std::shared_ptr<Model>>(),
         py::arg("model"));
 
+    py::class_<EulerBlackScholes, Scheme, std::shared_ptr<EulerBlackScholes>>(m, "_EulerBlackScholes")
+        .def(py::init<BlackScholes>(),
+        py::arg("model"));
+
+    py::class_<ExactVasicek, Scheme, std::shared_ptr<ExactVasicek>>(m, "_ExactVasicek")
+        .def(py::init<Vasicek>(),
+        py::arg("model"));
+
 }
 
 } // namespace qe::pybind
@@ -4,6 +4,7 @@
 #include <pybind11/stl.h>
 #include <pybind11/stl_bind.h>
 #include <pybind11/numpy.h>
+#include <span>
 #include <vector>
 #include <stdexcept>
 #include <optional>
@@ -47,6 +48,21 @@ void bind_surface(py::module_& m) {
             &LocalVolatilitySurface::sigma,
             py::arg("t"),
             py::arg("s")
+        )
+        .def("_sigma_batch", [](const LocalVolatilitySurface& self, double t,
+                                py::array_t<double, py::array::c_style | py::array::forcecast> s) {
+
+                                    if (s.ndim() != 1) throw std::runtime_error("LocalVolatilitySurface : spot value array must be 1D");
+
+                                    py::array_t<double> out(s.size());
+                                    std::span<const double> spots(s.data(), static_cast<size_t>(s.size()));
+                                    std::span<double> sigma(out.mutable_data(), static_cast<size_t>(out.size()));
+
+                                    self.sigma_batch(t, spots, sigma);
+                                    return out;
+                                },
+            py::arg("t"),
+            py::arg("s")
         );
 }
 
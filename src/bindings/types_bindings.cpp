@@ -4,64 +4,55 @@
 #include <pybind11/stl.h>
 #include <pybind11/numpy.h>
 
+#include <algorithm>
 #include <optional>
 #include <span>
 #include <stdexcept>
+#include <string>
+#include "types/archive.hpp"
 #include "types/path.hpp"
 #include "types/simulationresult.hpp"
 #include "types/state.hpp"
+#include "types/statistics.hpp"
 
 namespace py = pybind11; 
 
 //-----------------SimulationResult
 
-//converts a row-major array of value (spot) from simulationresult into a np.matrix
-    static py::array spot_view(py::object self, const SimulationResult& res) {
-        
-        const std::vector<double>& paths =res.get_paths();
-        if (paths.size() == 0) throw std::runtime_error("Error : no paths were found in the the SimulationResult");
-
-        const ssize_t n_rows = static_cast<ssize_t>(res.get_npaths());
-        const ssize_t n_cols = static_cast<ssize_t>(res.get_nsteps()+1);
+// exposes a flat array of values (spot or vol) of the simulationresult as a
+// read-only n_paths x n_cols np.ndarray without copying. The strides follow
+// the layout of the result, which self keeps alive
+    static py::array matrix_view(py::object self, const SimulationResult& res, std::span<const double> values) {
 
-        py::array_t<double> out({n_rows, n_cols});
-        auto r = out.mutable_unchecked<2>();
+        if (values.size() == 0) throw std::runtime_error("Error : no paths were found in the the SimulationResult");
 
-    for (ssize_t i = 0; i < n_rows; ++i) {
-        const size_t offset = static_cast<size_t>(i) * static_cast<size_t>(n_cols);
-        std::span<const double> row(paths.data() + offset, static_cast<size_t>(n_cols));
-
-        ssize_t j = 0;
-        for (double st : row) {
-            r(i, j++) = st;
-            }
-        }
+        const ssize_t n_rows = static_cast<ssize_t>(res.get_npaths());
+        const ssize_t n_cols = static_cast<ssize_t>(res.get_path_size());
+        const ssize_t item = static_cast<ssize_t>(sizeof(double));
+
+        py::array out(py::dtype::of<double>(), 
+                      {n_rows, n_cols},
+                      {static_cast<ssize_t>(res.path_stride()) * item, static_cast<ssize_t>(res.step_stride()) * item},
+                      values.data(), 
+                      self);
+        py::detail::array_proxy(out.ptr())->flags &= ~py::detail::npy_api::NPY_ARRAY_WRITEABLE_;
         return out;
-
     }
 
-    static py::array vol_view(py::object self, const SimulationResult& res) {
-        
-        const std::vector<double>& paths =res.get_vol();
-        if (paths.size() == 0) throw std::runtime_error("Error : no paths were found in the the SimulationResult");
-
-        const ssize_t n_rows = static_cast<ssize_t>(res.get_npaths());
-        const ssize_t n_cols = static_cast<ssize_t>(res.get_nsteps()+1);
-
-        py::array_t<double> out({n_rows, n_cols});
-        auto r = out.mutable_unchecked<2>();
-
-    for (ssize_t i = 0; i < n_rows; ++i) {
-        const size_t offset = static_cast<size_t>(i) * static_cast<size_t>(n_cols);
-        std::span<const double> row(paths.data() + offset, static_cast<size_t>(n_cols));
+    // the paths of a lazy result are computed on first access, without
+    // holding the GIL
+    static std::span<const double> values_of(const SimulationResult& res, bool vol) {
+        if (!res.is_lazy()) return vol ? res.vols() : res.spots();
+        py::gil_scoped_release release;
+        return vol ? res.vols() : res.spots();
+    }
 
-        ssize_t j = 0;
-        for (double st : row) {
-            r(i, j++) = st;
-            }
-        }
-        return out;
+    static py::array spot_view(py::object self, const SimulationResult& res) {
+        return matrix_view(self, res, values_of(res, false));
+    }
 
+    static py::array vol_view(py::object self, const SimulationResult& res) {
+        return matrix_view(self, res, values_of(res, true));
     }
 
 
@@ -90,7 +81,56 @@ void bind_types(py::module_& m) {
         .def_property_readonly("vol", [](py::object self) {
             const auto& r = self.cast<const SimulationResult&>();
             return vol_view(self, r);
-        });
+        })
+        .def_property_readonly("times", [](const SimulationResult& r) {
+            const std::vector<double>& times = r.get_times();
+            py::array_t<double> out(static_cast<ssize_t>(times.size()));
+            std::copy(times.begin(), times.end(), out.mutable_data());
+            return out;
+        })
+        .def_property_readonly("observed_steps", &SimulationResult::get_observed_steps)
+        .def_property_readonly("n_paths", &SimulationResult::get_npaths)
+        .def_property_readonly("n_cols", &SimulationResult::get_path_size)
+        .def_property_readonly("lazy", &SimulationResult::is_lazy)
+        .def_property_readonly("time_major", [](const SimulationResult& r) {return r.get_layout() == TimeMajor;})
+        .def("_moments", [](const SimulationResult& r, bool vol) {
+            StepMoments moments;
+            {
+                py::gil_scoped_release release;
+                moments = Statistics::moments(r, vol);
+            }
+            return py::make_tuple(py::array_t<double>(static_cast<ssize_t>(moments.mean.size()), moments.mean.data()),
+                                  py::array_t<double>(static_cast<ssize_t>(moments.variance.size()), moments.variance.data()));
+        }, py::arg("vol"))
+        .def("_quantiles", [](const SimulationResult& r, size_t column, const std::vector<double>& probs, bool vol) {
+            std::vector<double> q;
+            {
+                py::gil_scoped_release release;
+                q = Statistics::quantiles(r, column, probs, vol);
+            }
+            return py::array_t<double>(static_cast<ssize_t>(q.size()), q.data());
+        }, py::arg("column"), py::arg("probs"), py::arg("vol"))
+        .def("_histogram", [](const SimulationResult& r, size_t column, size_t n_bins, 
+                              std::optional<std::pair<double, double>> range, bool vol) {
+            Histogram h;
+            {
+                py::gil_scoped_release release;
+                h = Statistics::histogram(r, column, n_bins, range, vol);
+            }
+            return py::make_tuple(py::array_t<size_t>(static_cast<ssize_t>(h.counts.size()), h.counts.data()),
+                                  py::array_t<double>(static_cast<ssize_t>(h.edges.size()), h.edges.data()));
+        }, py::arg("column"), py::arg("n_bins"), py::arg("range"), py::arg("vol"))
+        .def("_save", [](const SimulationResult& r, const std::string& path, const std::string& description) {
+            SimulationArchive::save(r, path, description);
+        }, py::arg("path"), py::arg("description") = "", py::call_guard<py::gil_scoped_release>());
+
+    m.def("_load_archive", &SimulationArchive::load, py::arg("path"), py::call_guard<py::gil_scoped_release>());
+    m.def("_archive_header", &SimulationArchive::header, py::arg("path"));
+
+    py::enum_<Layout>(m, "_Layout")
+        .value("PathMajor", Layout::PathMajor)
+        .value("TimeMajor", Layout::TimeMajor)
+        .export_values();
 
     }
 } // namespace qe::pybind
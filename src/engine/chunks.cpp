@@ -0,0 +1,71 @@
+#include "engine/chunks.hpp"
+#include "engine/cancellation.hpp"
+#include "engine/montecarlo.hpp"
+#include "engine/randomstore.hpp"
+#include "engine/workspace.hpp"
+#include <algorithm>
+#include <future>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+
+ChunkedGenerator::ChunkedGenerator(const MonteCarlo& engine, double S0, const TimeGrid& grid, size_t n_paths, size_t chunk_paths,
+                                   std::optional<double> v0, std::optional<std::vector<size_t>> observe) :
+    engine_(engine),
+    randoms_(engine.get_random_store()),
+    S0_(S0),
+    grid_(grid),
+    v0_(v0),
+    observe_(std::move(observe)),
+    n_paths_(n_paths),
+    chunk_paths_(chunk_paths),
+    token_(CancellationToken::current())
+{
+    if (chunk_paths == 0) throw std::invalid_argument("ChunkedGenerator : chunk_paths must be positive");
+
+    // spot and volatility of the block being read, of the block being
+    // simulated and of a spare one
+    if (!engine_.get_workspace()) engine_.set_workspace(std::make_shared<Workspace>(6));
+    // blocks are released once read, caching them would keep them alive
+    engine_.set_cache(nullptr);
+    if (randoms_ && randoms_->n_paths() < n_paths)
+        throw std::invalid_argument("ChunkedGenerator : the random store holds fewer paths than the simulation");
+
+    launch();
+}
+
+ChunkedGenerator::~ChunkedGenerator(){
+    token_.cancel();
+    if (pending_) pending_->wait();
+}
+
+void ChunkedGenerator::launch(){
+    if (launched_ == n_paths_) return;
+
+    const size_t count = std::min(chunk_paths_, n_paths_ - launched_);
+    // with stored random numbers, each block reads its own paths of the store
+    if (randoms_) engine_.set_random_store(std::make_shared<const RandomStore>(randoms_->rows(launched_, count)));
+    launched_ += count;
+
+    // the blocks are simulated one after the other, so that they draw their
+    // seeds from the engine generator in order
+    pending_ = std::async(std::launch::async, [this, count]{
+        CancellationToken::Scope scope(token_);
+        return engine_.generate_spot(S0_, grid_, count, v0_, observe_);
+    });
+}
+
+std::optional<SimulationResult> ChunkedGenerator::next(){
+    if (!pending_) return std::nullopt;
+    CancellationToken::throw_if_cancelled(&token_);
+
+    std::future<SimulationResult> block = std::move(*pending_);
+    pending_.reset();
+    SimulationResult res = block.get();
+
+    returned_ += res.get_npaths();
+    launch();
+    return res;
+}
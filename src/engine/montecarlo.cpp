@@ -1,22 +1,151 @@
 
 
 
+#include "engine/cancellation.hpp"
+#include "engine/randomstore.hpp"
+#include "engine/workspace.hpp"
+#include "types/archive.hpp"
+#include "types/lrucache.hpp"
 #include "types/path.hpp"
+#include "types/pathfeatures.hpp"
 #include "engine/montecarlo.hpp"
 #include "types/simulationresult.hpp"
 #include "types/state.hpp"
+#include "types/timegrid.hpp"
+#include <algorithm>
 #include <memory>
+#include <mutex>
+#include <numeric>
 #include <optional>
 #include <random>
+#include <span>
 #include <stdexcept>
+#include <string>
 #include <exception>
 #include <thread>
+#include <tuple>
+#include <typeinfo>
 #include <omp.h>
 #include <utility>
 #include <vector>
 
 
 
+class MonteCarlo::PathDraws {
+
+public:
+    explicit PathDraws(std::mt19937& rng) : rng_(&rng) {}
+
+    // path p of a run : its normals in the store if there is one, a
+    // generator seeded with seeds[p] otherwise
+    PathDraws(const RandomStore* store, const std::vector<size_t>* seeds, size_t p) {
+        if (store) {
+            normals_ = store->path(p).data();
+            dims_ = store->dims();
+        }
+        else {
+            own_.emplace(static_cast<unsigned int>((*seeds)[p]));
+            rng_ = &*own_;
+        }
+    }
+
+    PathDraws(const PathDraws&) = delete;
+    PathDraws& operator=(const PathDraws&) = delete;
+
+    // the next step of the path
+    std::pair<double, double> step(const Scheme& scheme, const std::pair<double, double>& state, double t, double dt) {
+        if (!normals_) return scheme.step(state.first, state.second, t, dt, *rng_);
+        std::span<const double> z(normals_, dims_);
+        normals_ += dims_;
+        return scheme.step_from(state.first, state.second, t, dt, z);
+    }
+
+    // the normals of the next step, at least dims of them, for schemes
+    // stepping on the same random numbers
+    std::span<const double> next(size_t dims) {
+        if (normals_) {
+            std::span<const double> z(normals_, dims_);
+            normals_ += dims_;
+            return z;
+        }
+        // a new distribution per step, as in the steps of the schemes
+        z_.resize(dims);
+        std::normal_distribution<double> dist;
+        for (double& z : z_) z = dist(*rng_);
+        return z_;
+    }
+
+private:
+    std::optional<std::mt19937> own_;
+    std::mt19937* rng_ = nullptr;
+    const double* normals_ = nullptr;
+    size_t dims_ = 0;
+    std::vector<double> z_;
+};
+
+// steps the schemes of a batch that have no kernel of their own one by one
+class StepFromBatch : public SchemeBatch {
+
+public:
+    explicit StepFromBatch(std::span<const Scheme* const> schemes) : schemes_(schemes.begin(), schemes.end()) {}
+
+    void step(std::span<double> S, std::span<double> v, double t, double dt, std::span<const double> z) const override {
+        for (size_t k = 0; k < schemes_.size(); k++) std::tie(S[k], v[k]) = schemes_[k]->step_from(S[k], v[k], t, dt, z);
+    }
+
+    size_t size() const override {return schemes_.size();}
+
+private:
+    std::vector<const Scheme*> schemes_;
+
+};
+
+struct MonteCarlo::BatchSchemes {
+    // prepared copies of the schemes that need one
+    std::vector<std::shared_ptr<Scheme>> prepared;
+    std::vector<const Scheme*> schemes;
+    const Scheme* widest = nullptr;
+    size_t dims = 0;
+    // one kernel per run of consecutive schemes of the same type
+    std::vector<std::unique_ptr<SchemeBatch>> kernels;
+
+    // advances the states of every scheme of the batch by one step
+    void step(std::span<double> S, std::span<double> v, double t, double dt, std::span<const double> z) const {
+        size_t first = 0;
+        for (const auto& kernel : kernels) {
+            kernel->step(S.subspan(first, kernel->size()), v.subspan(first, kernel->size()), t, dt, z);
+            first += kernel->size();
+        }
+    }
+};
+
+MonteCarlo::BatchSchemes MonteCarlo::prepare_batch(const std::vector<std::shared_ptr<Scheme>>& schemes, const TimeGrid& grid,
+                                                   const char* where){
+    if (schemes.empty()) throw std::invalid_argument(std::string(where) + " : at least one scheme is required");
+
+    BatchSchemes batch;
+    for (const auto& scheme : schemes) {
+        if (!scheme) throw std::invalid_argument(std::string(where) + " : null scheme");
+        std::shared_ptr<Scheme> run_scheme = scheme->prepare(grid.times());
+        batch.schemes.push_back(run_scheme ? run_scheme.get() : scheme.get());
+        if (run_scheme) batch.prepared.push_back(std::move(run_scheme));
+        if (scheme->random_dimensions() > batch.dims) {
+            batch.dims = scheme->random_dimensions();
+            batch.widest = batch.schemes.back();
+        }
+    }
+
+    for (size_t first = 0; first < batch.schemes.size();) {
+        size_t last = first + 1;
+        while (last < batch.schemes.size() && typeid(*batch.schemes[last]) == typeid(*batch.schemes[first])) last++;
+        const std::span<const Scheme* const> run(batch.schemes.data() + first, last - first);
+        std::unique_ptr<SchemeBatch> kernel = batch.schemes[first]->batch(run);
+        batch.kernels.push_back(kernel ? std::move(kernel) : std::make_unique<StepFromBatch>(run));
+        first = last;
+    }
+    return batch;
+}
+
 std::vector<double> MonteCarlo::simulate_path(double S0, 
                                         size_t n, 
                                         float T,
@@ -24,17 +153,13 @@ std::vector<double> MonteCarlo::simulate_path(double S0,
                                         std::optional<float> v0
                                         )
     {
-    double dt = T/static_cast<double>(n);
-    std::pair<double, double> state = scheme_->init_state(S0, v0);
+    TimeGrid grid = TimeGrid::uniform(T, n);
+    std::optional<double> v0_d = v0.has_value() ? std::optional<double>(v0.value()) : std::nullopt;
+
     std::vector<double> path(n+1);
-    path[0] = state.first;
-    
-    for (size_t step = 1; step <= n; step ++){
-        double S_t = state.first;
-        double v_t = state.second;
-        std::pair<double, double> state = scheme_->step(S_t, v_t, step, dt, rng);
-        path[step] = state.first;
-    }
+    std::vector<double> vol(n+1);
+    PathDraws draws(rng);
+    generate_path_inplace(*scheme_, path.data(), vol.data(), S0, grid, draws, v0_d, true, {});
 
     return path;
 }
@@ -42,31 +167,41 @@ std::vector<double> MonteCarlo::simulate_path(double S0,
 
 void MonteCarlo::generate_path_inplace(double* s_path, double* v_path, double S0, size_t n, double T, 
                                        std::mt19937& rng, std::optional<double> v0) {
-    double dt = T / static_cast<double>(n-1);
-    std::pair<double, double> state = scheme_->init_state(S0, v0);
-    
-    
-    
-    if (return_volatility_ == false){
-        s_path[0] = state.first;
-        for (size_t step = 1; step < n; ++step) {
-            double S_t = state.first;
-            double v_t = state.second;
-            state = scheme_->step(S_t, v_t, step, dt, rng);
-            s_path[step] = state.first;
+    generate_path_inplace(s_path, v_path, S0, TimeGrid::uniform(T, n-1), rng, v0);
+}
+
+void MonteCarlo::generate_path_inplace(double* s_path, double* v_path, double S0, const TimeGrid& grid, 
+                                       std::mt19937& rng, std::optional<double> v0) {
+    PathDraws draws(rng);
+    generate_path_inplace(*scheme_, s_path, v_path, S0, grid, draws, v0, return_volatility_, {});
+}
+
+
+void MonteCarlo::generate_path_inplace(const Scheme& scheme, double* s_path, double* v_path, double S0, const TimeGrid& grid, 
+                                       PathDraws& draws, std::optional<double> v0, bool with_vol,
+                                       std::span<const size_t> observed) {
+    const std::vector<double>& t = grid.times();
+    const size_t n = t.size();
+    std::pair<double, double> state = scheme.init_state(S0, v0);
+
+    // every step is simulated, only the observed ones are written. An empty
+    // observation list writes every step
+    const bool all = observed.empty();
+    size_t col = 0;
+    auto record = [&](size_t step) {
+        if (!all) {
+            if (col == observed.size() || observed[col] != step) return;
         }
+        s_path[col] = state.first;
+        if (with_vol) v_path[col] = state.second;
+        col++;
+    };
+
+    record(0);
+    for (size_t step = 1; step < n; ++step) {
+        state = draws.step(scheme, state, t[step-1], t[step] - t[step-1]);
+        record(step);
     }
-    else{
-        s_path[0] = state.first;
-        v_path[0] = state.second;
-        for (size_t step = 1; step < n; ++step) {
-            double S_t = state.first;
-            double v_t = state.second;
-            state = scheme_->step(S_t, v_t, step, dt, rng);
-            s_path[step] = state.first;
-            v_path[step] = state.second;
-        }
-        }
 }
 
 
@@ -74,25 +209,720 @@ void MonteCarlo::generate_path_inplace(double* s_path, double* v_path, double S0
 SimulationResult MonteCarlo::generate_spot(float S0, 
                                       size_t n, 
                                       float T, 
-                                      size_t n_paths, std::optional<double> v0){
+                                      size_t n_paths, std::optional<double> v0,
+                                      std::optional<std::vector<size_t>> observe){
+    return generate_spot(S0, TimeGrid::uniform(T, n), n_paths, v0, std::move(observe));
+}
+
+std::vector<size_t> MonteCarlo::observed_columns(size_t n, const std::optional<std::vector<size_t>>& observe, const char* where){
+    // observed steps : sorted, unique, and always ending with the terminal step
+    std::vector<size_t> observed;
+    if (observe.has_value()) {
+        observed = observe.value();
+        std::sort(observed.begin(), observed.end());
+        observed.erase(std::unique(observed.begin(), observed.end()), observed.end());
+        if (!observed.empty() && observed.back() > n)
+            throw std::invalid_argument(std::string(where) + " : observed steps must be at most the number of steps");
+        if (observed.empty() || observed.back() != n) observed.push_back(n);
+    }
+    else {
+        observed.resize(n+1);
+        std::iota(observed.begin(), observed.end(), 0);
+    }
+    return observed;
+}
+
+void MonteCarlo::simulate_into(double* s_all_paths, double* v_all_paths, double S0, const TimeGrid& grid, size_t n_paths,
+                               std::optional<double> v0, std::span<const size_t> observed, size_t n_cols,
+                               size_t* first_seed){
+
+    std::exception_ptr eptr = nullptr;
+    // cancellation token of the calling thread, read by the workers
+    const CancellationToken* token = CancellationToken::current();
+
+    // schemes with time dependent inputs precompute them once here, on the
+    // times of the grid, before the workers start
+    const std::shared_ptr<Scheme> run_scheme = scheme_->prepare(grid.times());
+    const Scheme& scheme = run_scheme ? *run_scheme : *scheme_;
+
+    const std::shared_ptr<std::vector<size_t>> seeds = run_seeds(scheme, grid, n_paths, first_seed);
+
+    if (layout_ == PathMajor) {
+        #pragma omp parallel for num_threads(n_jobs_)
+        for (size_t p = 0; p < n_paths; p++){
+            if (CancellationToken::is_cancelled(token)) continue;
+            try {
+                PathDraws draws(randoms_.get(), seeds.get(), p);
+                    double* s_path_ptr = s_all_paths + p * n_cols;
+                    double* v_path_ptr = return_volatility_ ? v_all_paths + p * n_cols : nullptr;
+                    generate_path_inplace(scheme, s_path_ptr, v_path_ptr, S0, grid, draws, v0, return_volatility_, observed);
+                }
+            catch(...) {
+                #pragma omp critical 
+                {
+                    if (!eptr) eptr = std::current_exception();
+                }
+            }
+        }
+    }
+    else if (scheme.block_steps()) {
+        // the paths of a block are stepped together, each stored step of the
+        // block is written contiguously
+        constexpr size_t block_size = 64;
+        const size_t n_blocks = (n_paths + block_size - 1) / block_size;
+        const std::vector<double>& t = grid.times();
+        const size_t dims = scheme.random_dimensions();
+        const bool all = observed.empty();
+
+        #pragma omp parallel num_threads(n_jobs_)
+        {
+            std::vector<std::optional<PathDraws>> draws(block_size);
+            std::vector<double> S(block_size);
+            std::vector<double> v(block_size);
+            std::vector<double> z(block_size * dims);
+
+            #pragma omp for
+            for (size_t b = 0; b < n_blocks; b++){
+                if (CancellationToken::is_cancelled(token)) continue;
+                try {
+                    const size_t first = b * block_size;
+                    const size_t count = std::min(block_size, n_paths - first);
+                    const std::span<double> block_S(S.data(), count);
+                    const std::span<double> block_v(v.data(), count);
+                    for (size_t i = 0; i < count; i++) {
+                        draws[i].emplace(randoms_.get(), seeds.get(), first + i);
+                        std::tie(S[i], v[i]) = scheme.init_state(S0, v0);
+                    }
+
+                    size_t col = 0;
+                    auto record = [&](size_t step) {
+                        if (!all && (col == observed.size() || observed[col] != step)) return;
+                        std::copy(S.begin(), S.begin() + count, s_all_paths + col * n_paths + first);
+                        if (return_volatility_) std::copy(v.begin(), v.begin() + count, v_all_paths + col * n_paths + first);
+                        col++;
+                    };
+
+                    record(0);
+                    for (size_t step = 1; step < t.size(); ++step) {
+                        for (size_t i = 0; i < count; i++) {
+                            const std::span<const double> zi = draws[i]->next(dims);
+                            std::copy(zi.begin(), zi.begin() + dims, z.begin() + i * dims);
+                        }
+                        scheme.step_block(block_S, block_v, t[step-1], t[step] - t[step-1], std::span<const double>(z.data(), count * dims));
+                        record(step);
+                    }
+                }
+                catch(...) {
+                    #pragma omp critical 
+                    {
+                        if (!eptr) eptr = std::current_exception();
+                    }
+                }
+            }
+        }
+    }
+    else {
+        // paths are generated by blocks in a thread local buffer, then each
+        // stored step of the block is written contiguously
+        constexpr size_t block_size = 64;
+        const size_t n_blocks = (n_paths + block_size - 1) / block_size;
+
+        #pragma omp parallel num_threads(n_jobs_)
+        {
+            std::vector<double> s_block(block_size * n_cols);
+            std::vector<double> v_block(return_volatility_ ? block_size * n_cols : 0);
+
+            #pragma omp for
+            for (size_t b = 0; b < n_blocks; b++){
+                if (CancellationToken::is_cancelled(token)) continue;
+                try {
+                    const size_t first = b * block_size;
+                    const size_t count = std::min(block_size, n_paths - first);
+                    for (size_t i = 0; i < count; i++){
+                        PathDraws draws(randoms_.get(), seeds.get(), first + i);
+                        double* v_path_ptr = return_volatility_ ? &v_block[i * n_cols] : nullptr;
+                        generate_path_inplace(scheme, &s_block[i * n_cols], v_path_ptr, S0, grid, draws, v0, return_volatility_, observed);
+                    }
+                    for (size_t j = 0; j < n_cols; j++){
+                        double* s_col = s_all_paths + j * n_paths + first;
+                        for (size_t i = 0; i < count; i++) s_col[i] = s_block[i * n_cols + j];
+                        if (return_volatility_) {
+                            double* v_col = v_all_paths + j * n_paths + first;
+                            for (size_t i = 0; i < count; i++) v_col[i] = v_block[i * n_cols + j];
+                        }
+                    }
+                }
+                catch(...) {
+                    #pragma omp critical 
+                    {
+                        if (!eptr) eptr = std::current_exception();
+                    }
+                }
+            }
+        }
+    }
+    if (eptr) std::rethrow_exception(eptr);
+    CancellationToken::throw_if_cancelled(token);
+}
+
+SimulationResult MonteCarlo::generate_spot(double S0, 
+                                      const TimeGrid& grid, 
+                                      size_t n_paths, std::optional<double> v0,
+                                      std::optional<std::vector<size_t>> observe){
     
-    std::vector<double> s_all_paths(n_paths*(n+1));
-    std::vector<double> v_all_paths(n_paths*(n+1));
+    const size_t n = grid.n_steps();
+    std::vector<size_t> observed = observed_columns(n, observe, "MonteCarlo::generate_spot");
+    const size_t n_cols = observed.size();
+
+    std::optional<SimulationKey> key = cache_key(SimulationKey::Spot, S0, grid, n_paths, v0,
+                                                 observe.has_value() ? observed : std::vector<size_t>());
+    if (key) {
+        if (auto run = cached_run(*key)) return std::get<SimulationResult>(*run);
+    }
+
+    std::shared_ptr<std::vector<double>> s_all_paths = buffer(n_paths*n_cols);
+    std::shared_ptr<std::vector<double>> v_all_paths = return_volatility_ ? buffer(n_paths*n_cols) : nullptr;
+
+    // an empty observation list writes every step without checking them
+    size_t first_seed = 0;
+    simulate_into(s_all_paths->data(), v_all_paths ? v_all_paths->data() : nullptr, S0, grid, n_paths, v0,
+                  observe.has_value() ? std::span<const size_t>(observed) : std::span<const size_t>(), n_cols, &first_seed);
+
+    std::optional<std::vector<size_t>> observed_steps = std::nullopt;
+    std::shared_ptr<const std::vector<double>> times;
+    if (observe.has_value()) {
+        std::vector<double> obs_times(n_cols);
+        for (size_t j = 0; j < n_cols; j++) obs_times[j] = grid[observed[j]];
+        times = std::make_shared<const std::vector<double>>(std::move(obs_times));
+        observed_steps = std::move(observed);
+    }
+    else times = std::make_shared<const std::vector<double>>(grid.times());
+
+    std::optional<std::shared_ptr<std::vector<double>>> vols = std::nullopt;
+    if (return_volatility_) vols = std::move(v_all_paths);
+
+    SimulationResult res(std::move(s_all_paths), seed_,  n, n_paths, vols, times, std::move(observed_steps), layout_);
+    // only the runs started from the seed are cached
+    if (key && first_seed == 0) cache_->put(*key, res);
+    return res;
+
+}
+
+// paths regenerated by a lazy result are produced by blocks of this size
+static constexpr size_t lazy_block_size = 1024;
+
+class MonteCarlo::Regenerator : public PathSource {
+
+public:
+    Regenerator(std::shared_ptr<const Scheme> scheme, TimeGrid grid, double S0, std::optional<double> v0,
+                std::shared_ptr<const std::vector<size_t>> seeds, std::shared_ptr<const RandomStore> randoms, size_t n_paths,
+                std::vector<size_t> observed, size_t n_cols, bool with_vol, int n_jobs, size_t cache_blocks):
+        scheme_(std::move(scheme)),
+        grid_(std::move(grid)),
+        S0_(S0),
+        v0_(v0),
+        seeds_(std::move(seeds)),
+        randoms_(std::move(randoms)),
+        n_paths_(n_paths),
+        observed_(std::move(observed)),
+        n_cols_(n_cols),
+        with_vol_(with_vol),
+        n_jobs_(n_jobs),
+        cache_(cache_blocks) {}
+
+    bool has_vol() const override {return with_vol_;}
+
+    void fill(size_t first, size_t count, std::span<double> spot, std::span<double> vol) const override {
+        const size_t m = n_cols_;
+        for (size_t b = first / lazy_block_size; b * lazy_block_size < first + count; b++) {
+            const size_t b_first = b * lazy_block_size;
+            const size_t from = std::max(first, b_first);
+            const size_t to = std::min(first + count, b_first + lazy_block_size);
+
+            std::shared_ptr<const Block> values = block(b);
+            std::copy(values->spot.begin() + (from - b_first) * m, values->spot.begin() + (to - b_first) * m,
+                      spot.begin() + (from - first) * m);
+            if (!vol.empty())
+                std::copy(values->vol.begin() + (from - b_first) * m, values->vol.begin() + (to - b_first) * m,
+                          vol.begin() + (from - first) * m);
+        }
+    }
+
+private:
+    struct Block {
+        std::vector<double> spot;
+        std::vector<double> vol;
+    };
+
+    const std::shared_ptr<const Scheme> scheme_;
+    const TimeGrid grid_;
+    const double S0_;
+    const std::optional<double> v0_;
+    const std::shared_ptr<const std::vector<size_t>> seeds_;
+    const std::shared_ptr<const RandomStore> randoms_;
+    const size_t n_paths_;
+    const std::vector<size_t> observed_;
+    const size_t n_cols_;
+    const bool with_vol_;
+    const int n_jobs_;
+    mutable LruCache<size_t, Block> cache_;
+
+    // block b, from the cache or simulated again
+    std::shared_ptr<const Block> block(size_t b) const {
+        if (std::shared_ptr<const Block> cached = cache_.get(b)) return cached;
+
+        const size_t first = b * lazy_block_size;
+        const size_t count = std::min(lazy_block_size, n_paths_ - first);
+        auto values = std::make_shared<Block>();
+        values->spot.resize(count * n_cols_);
+        values->vol.resize(with_vol_ ? count * n_cols_ : 0);
+        std::exception_ptr eptr = nullptr;
+        const CancellationToken* token = CancellationToken::current();
+
+        #pragma omp parallel for num_threads(n_jobs_)
+        for (size_t i = 0; i < count; i++){
+            if (CancellationToken::is_cancelled(token)) continue;
+            try {
+                PathDraws draws(randoms_.get(), seeds_.get(), first + i);
+                double* v_path_ptr = with_vol_ ? &values->vol[i * n_cols_] : nullptr;
+                generate_path_inplace(*scheme_, &values->spot[i * n_cols_], v_path_ptr, S0_, grid_, draws, v0_, with_vol_, observed_);
+            }
+            catch(...) {
+                #pragma omp critical 
+                {
+                    if (!eptr) eptr = std::current_exception();
+                }
+            }
+        }
+        if (eptr) std::rethrow_exception(eptr);
+        CancellationToken::throw_if_cancelled(token);
+
+        cache_.put(b, values);
+        return values;
+    }
+};
+
+SimulationResult MonteCarlo::generate_lazy(double S0, const TimeGrid& grid, size_t n_paths, std::optional<double> v0,
+                                           std::optional<std::vector<size_t>> observe, size_t cache_blocks){
+
+    const size_t n = grid.n_steps();
+    std::vector<size_t> observed = observed_columns(n, observe, "MonteCarlo::generate_lazy");
+    const size_t n_cols = observed.size();
+
+    std::vector<double> times(n_cols);
+    for (size_t j = 0; j < n_cols; j++) times[j] = grid[observed[j]];
+
+    // the scheme is prepared once for all the regenerations
+    const std::shared_ptr<Scheme> run_scheme = scheme_->prepare(grid.times());
+    std::shared_ptr<const Scheme> scheme = run_scheme ? run_scheme : scheme_;
+
+    std::shared_ptr<std::vector<size_t>> seeds = run_seeds(*scheme, grid, n_paths);
+    auto source = std::make_shared<const Regenerator>(std::move(scheme), grid, S0, v0, std::move(seeds), randoms_, n_paths,
+                                                      observe.has_value() ? observed : std::vector<size_t>(), n_cols,
+                                                      return_volatility_, n_jobs_, cache_blocks);
+
+    return SimulationResult(std::move(source), seed_, n, n_paths, std::make_shared<const std::vector<double>>(std::move(times)),
+                            std::move(observed), layout_);
+}
+
+SimulationResult MonteCarlo::generate_to_file(const std::string& path, double S0, const TimeGrid& grid, size_t n_paths,
+                                              std::optional<double> v0, std::optional<std::vector<size_t>> observe){
+
+    const size_t n = grid.n_steps();
+    std::vector<size_t> observed = observed_columns(n, observe, "MonteCarlo::generate_to_file");
+    const size_t n_cols = observed.size();
+
+    // the workers write the paths straight into the mapped files
+    {
+        ArchiveWriter writer(path, n_paths, n_cols, layout_, return_volatility_);
+        simulate_into(writer.spot(), writer.vol(), S0, grid, n_paths, v0,
+                      observe.has_value() ? std::span<const size_t>(observed) : std::span<const size_t>(), n_cols);
+
+        std::vector<double> times(n_cols);
+        for (size_t j = 0; j < n_cols; j++) times[j] = grid[observed[j]];
+        writer.finish(seed_, n, times, observed, scheme_->describe());
+    }
+    return SimulationArchive::load(path);
+}
+
+SimulationResult MonteCarlo::generate_monitored(double S0, 
+                                                const TimeGrid& grid, 
+                                                size_t n_paths, 
+                                                KnockCondition knock,
+                                                std::optional<double> v0){
+
+    const std::vector<double>& t = grid.times();
+    const size_t n = grid.n_steps();
+
+    // terminal value and flag only : one column per path
+    std::shared_ptr<std::vector<double>> s_terminal = buffer(n_paths);
+    std::shared_ptr<std::vector<double>> v_terminal = return_volatility_ ? buffer(n_paths) : nullptr;
+    std::vector<unsigned char> knocked(n_paths, 0);
     std::exception_ptr eptr = nullptr;
+    const CancellationToken* token = CancellationToken::current();
 
-    std::vector<size_t> seeds_vector(n_paths);
-    for (size_t i = 0; i < n_paths; i++){
-        seeds_vector[i] = rng_();
+    const std::shared_ptr<Scheme> run_scheme = scheme_->prepare(t);
+    const Scheme& scheme = run_scheme ? *run_scheme : *scheme_;
+
+    const std::shared_ptr<std::vector<size_t>> seeds = run_seeds(scheme, grid, n_paths);
+
+    // knocked paths finish early, paths are handed out in small chunks so
+    // that threads stay balanced
+    #pragma omp parallel for schedule(dynamic, 64) num_threads(n_jobs_)
+    for (size_t p = 0; p < n_paths; p++){
+        if (CancellationToken::is_cancelled(token)) continue;
+        try {
+            PathDraws draws(randoms_.get(), seeds.get(), p);
+            std::pair<double, double> state = scheme.init_state(S0, v0);
+            bool out = knock.breached(state.first);
+
+            for (size_t step = 1; step <= n && !out; ++step) {
+                state = draws.step(scheme, state, t[step-1], t[step] - t[step-1]);
+                out = knock.breached(state.first);
+            }
+
+            (*s_terminal)[p] = state.first;
+            if (return_volatility_) (*v_terminal)[p] = state.second;
+            knocked[p] = out ? 1 : 0;
+        }
+        catch(...) {
+            #pragma omp critical 
+            {
+                if (!eptr) eptr = std::current_exception();
+            }
+        }
+    }
+    if (eptr) std::rethrow_exception(eptr);
+    CancellationToken::throw_if_cancelled(token);
+
+    std::optional<std::shared_ptr<std::vector<double>>> vols = std::nullopt;
+    if (return_volatility_) vols = std::move(v_terminal);
+
+    SimulationResult res(std::move(s_terminal), seed_, n, n_paths, vols,
+                         std::make_shared<const std::vector<double>>(1, grid.maturity()), std::vector<size_t>{n});
+    res.attach_knock_out(knock, std::move(knocked));
+    return res;
+}
+
+std::vector<double> MonteCarlo::accumulate(double S0, 
+                                           const TimeGrid& grid, 
+                                           size_t n_paths, 
+                                           const std::vector<std::unique_ptr<PayoffAccumulator>>& accumulators,
+                                           std::optional<double> v0){
+
+    if (accumulators.empty()) throw std::invalid_argument("MonteCarlo::accumulate : at least one accumulator is required");
+    for (const auto& acc : accumulators){
+        if (!acc) throw std::invalid_argument("MonteCarlo::accumulate : null accumulator");
+    }
+
+    const std::vector<double>& t = grid.times();
+    const size_t n = grid.n_steps();
+    const size_t n_acc = accumulators.size();
+
+    // paths are summed by blocks of fixed size, then the blocks in order :
+    // the result does not depend on the number of threads
+    constexpr size_t block_size = 256;
+    const size_t n_blocks = (n_paths + block_size - 1) / block_size;
+    std::vector<double> block_sums(n_blocks * n_acc, 0.0);
+    std::exception_ptr eptr = nullptr;
+    const CancellationToken* token = CancellationToken::current();
+
+    const std::shared_ptr<Scheme> run_scheme = scheme_->prepare(t);
+    const Scheme& scheme = run_scheme ? *run_scheme : *scheme_;
+
+    const std::shared_ptr<std::vector<size_t>> seeds = run_seeds(scheme, grid, n_paths);
+
+    #pragma omp parallel num_threads(n_jobs_)
+    {
+        std::vector<std::unique_ptr<PayoffAccumulator>> local;
+        try {
+            local.reserve(n_acc);
+            for (const auto& acc : accumulators) local.push_back(acc->clone());
+        }
+        catch(...) {
+            #pragma omp critical 
+            {
+                if (!eptr) eptr = std::current_exception();
+            }
+        }
+
+        // paths can stop early, blocks are handed out dynamically
+        #pragma omp for schedule(dynamic)
+        for (size_t b = 0; b < n_blocks; b++){
+            if (local.size() != n_acc || CancellationToken::is_cancelled(token)) continue;
+            try {
+                double* sums = &block_sums[b * n_acc];
+                const size_t last = std::min(n_paths, (b + 1) * block_size);
+
+                for (size_t p = b * block_size; p < last; p++){
+                    PathDraws draws(randoms_.get(), seeds.get(), p);
+                    std::pair<double, double> state = scheme.init_state(S0, v0);
+                    for (auto& acc : local) acc->start(state.first, state.second, t[0]);
+
+                    auto all_finished = [&]() {
+                        return std::all_of(local.begin(), local.end(), [](const auto& acc){return acc->finished();});
+                    };
+
+                    for (size_t step = 1; step <= n && !all_finished(); ++step) {
+                        state = draws.step(scheme, state, t[step-1], t[step] - t[step-1]);
+                        for (auto& acc : local) acc->update(state.first, state.second, t[step]);
+                    }
+
+                    for (size_t i = 0; i < n_acc; i++) sums[i] += local[i]->finalize();
+                }
+            }
+            catch(...) {
+                #pragma omp critical 
+                {
+                    if (!eptr) eptr = std::current_exception();
+                }
+            }
+        }
+    }
+    if (eptr) std::rethrow_exception(eptr);
+    CancellationToken::throw_if_cancelled(token);
+
+    std::vector<double> averages(n_acc, 0.0);
+    for (size_t b = 0; b < n_blocks; b++){
+        for (size_t i = 0; i < n_acc; i++) averages[i] += block_sums[b * n_acc + i];
+    }
+    for (double& avg : averages) avg /= static_cast<double>(n_paths);
+
+    return averages;
+}
+
+std::vector<SimulationResult> MonteCarlo::generate_batch(const std::vector<std::shared_ptr<Scheme>>& schemes, 
+                                                       double S0, 
+                                                       const TimeGrid& grid, 
+                                                       size_t n_paths, 
+                                                       std::optional<double> v0){
+
+    const BatchSchemes batch = prepare_batch(schemes, grid, "MonteCarlo::generate_batch");
+    const size_t n_sets = batch.schemes.size();
+    const std::vector<double>& t = grid.times();
+    const size_t n = grid.n_steps();
+    const size_t n_cols = n + 1;
+
+    std::vector<std::shared_ptr<std::vector<double>>> s_paths(n_sets);
+    std::vector<std::shared_ptr<std::vector<double>>> v_paths(n_sets);
+    for (size_t k = 0; k < n_sets; k++) {
+        s_paths[k] = buffer(n_paths * n_cols);
+        if (return_volatility_) v_paths[k] = buffer(n_paths * n_cols);
+    }
+
+    std::exception_ptr eptr = nullptr;
+    const CancellationToken* token = CancellationToken::current();
+    const std::shared_ptr<std::vector<size_t>> seeds = run_seeds(*batch.widest, grid, n_paths);
+
+    // value (p, j) of a result, in the layout of the engine
+    const bool path_major = (layout_ == PathMajor);
+    auto at = [&](size_t p, size_t j) {return path_major ? p * n_cols + j : j * n_paths + p;};
+
+    #pragma omp parallel num_threads(n_jobs_)
+    {
+        // states of the schemes side by side
+        std::vector<double> S(n_sets);
+        std::vector<double> v(n_sets);
+
+        #pragma omp for
+        for (size_t p = 0; p < n_paths; p++){
+            if (CancellationToken::is_cancelled(token)) continue;
+            try {
+                PathDraws draws(randoms_.get(), seeds.get(), p);
+                for (size_t k = 0; k < n_sets; k++) {
+                    std::tie(S[k], v[k]) = batch.schemes[k]->init_state(S0, v0);
+                    (*s_paths[k])[at(p, 0)] = S[k];
+                    if (return_volatility_) (*v_paths[k])[at(p, 0)] = v[k];
+                }
+                for (size_t step = 1; step <= n; ++step) {
+                    const std::span<const double> z = draws.next(batch.dims);
+                    batch.step(S, v, t[step-1], t[step] - t[step-1], z);
+                    for (size_t k = 0; k < n_sets; k++) {
+                        (*s_paths[k])[at(p, step)] = S[k];
+                        if (return_volatility_) (*v_paths[k])[at(p, step)] = v[k];
+                    }
+                }
+            }
+            catch(...) {
+                #pragma omp critical 
+                {
+                    if (!eptr) eptr = std::current_exception();
+                }
+            }
+        }
+    }
+    if (eptr) std::rethrow_exception(eptr);
+    CancellationToken::throw_if_cancelled(token);
+
+    auto times = std::make_shared<const std::vector<double>>(t);
+    std::vector<SimulationResult> results;
+    results.reserve(n_sets);
+    for (size_t k = 0; k < n_sets; k++) {
+        std::optional<std::shared_ptr<std::vector<double>>> vols = std::nullopt;
+        if (return_volatility_) vols = std::move(v_paths[k]);
+        results.emplace_back(std::move(s_paths[k]), seed_, n, n_paths, vols, times, std::nullopt, layout_);
     }
+    return results;
+}
+
+std::vector<std::vector<double>> MonteCarlo::accumulate_batch(const std::vector<std::shared_ptr<Scheme>>& schemes, 
+                                                              double S0, 
+                                                              const TimeGrid& grid, 
+                                                              size_t n_paths, 
+                                                              const std::vector<std::unique_ptr<PayoffAccumulator>>& accumulators,
+                                                              std::optional<double> v0){
+
+    if (accumulators.empty()) throw std::invalid_argument("MonteCarlo::accumulate_batch : at least one accumulator is required");
+    for (const auto& acc : accumulators){
+        if (!acc) throw std::invalid_argument("MonteCarlo::accumulate_batch : null accumulator");
+    }
+
+    const BatchSchemes batch = prepare_batch(schemes, grid, "MonteCarlo::accumulate_batch");
+    const size_t n_sets = batch.schemes.size();
+    const std::vector<double>& t = grid.times();
+    const size_t n = grid.n_steps();
+    const size_t n_acc = accumulators.size();
+
+    // paths are summed by blocks of fixed size, then the blocks in order :
+    // the result does not depend on the number of threads
+    constexpr size_t block_size = 256;
+    const size_t n_blocks = (n_paths + block_size - 1) / block_size;
+    std::vector<double> block_sums(n_blocks * n_sets * n_acc, 0.0);
+    std::exception_ptr eptr = nullptr;
+    const CancellationToken* token = CancellationToken::current();
+
+    const std::shared_ptr<std::vector<size_t>> seeds = run_seeds(*batch.widest, grid, n_paths);
+
+    #pragma omp parallel num_threads(n_jobs_)
+    {
+        // accumulators of scheme k are local[k * n_acc, (k+1) * n_acc)
+        std::vector<std::unique_ptr<PayoffAccumulator>> local;
+        std::vector<double> S(n_sets);
+        std::vector<double> v(n_sets);
+        std::vector<char> running(n_sets);
+        try {
+            local.reserve(n_sets * n_acc);
+            for (size_t k = 0; k < n_sets; k++) {
+                for (const auto& acc : accumulators) local.push_back(acc->clone());
+            }
+        }
+        catch(...) {
+            #pragma omp critical 
+            {
+                if (!eptr) eptr = std::current_exception();
+            }
+        }
+
+        auto finished = [&](size_t k) {
+            return std::all_of(local.begin() + k * n_acc, local.begin() + (k + 1) * n_acc, [](const auto& acc){return acc->finished();});
+        };
+
+        #pragma omp for schedule(dynamic)
+        for (size_t b = 0; b < n_blocks; b++){
+            if (local.size() != n_sets * n_acc || CancellationToken::is_cancelled(token)) continue;
+            try {
+                double* sums = &block_sums[b * n_sets * n_acc];
+                const size_t last = std::min(n_paths, (b + 1) * block_size);
+
+                for (size_t p = b * block_size; p < last; p++){
+                    PathDraws draws(randoms_.get(), seeds.get(), p);
+                    size_t n_running = 0;
+                    for (size_t k = 0; k < n_sets; k++) {
+                        std::tie(S[k], v[k]) = batch.schemes[k]->init_state(S0, v0);
+                        for (size_t i = 0; i < n_acc; i++) local[k * n_acc + i]->start(S[k], v[k], t[0]);
+                        running[k] = !finished(k);
+                        n_running += running[k];
+                    }
+
+                    // the normals are drawn for every step so that each
+                    // scheme reads the same ones whatever the others do.
+                    // The schemes are all stepped together, the finished
+                    // ones are no longer read
+                    for (size_t step = 1; step <= n && n_running > 0; ++step) {
+                        const std::span<const double> z = draws.next(batch.dims);
+                        batch.step(S, v, t[step-1], t[step] - t[step-1], z);
+                        for (size_t k = 0; k < n_sets; k++) {
+                            if (!running[k]) continue;
+                            for (size_t i = 0; i < n_acc; i++) local[k * n_acc + i]->update(S[k], v[k], t[step]);
+                            if (finished(k)) {
+                                running[k] = false;
+                                n_running--;
+                            }
+                        }
+                    }
+
+                    for (size_t j = 0; j < n_sets * n_acc; j++) sums[j] += local[j]->finalize();
+                }
+            }
+            catch(...) {
+                #pragma omp critical 
+                {
+                    if (!eptr) eptr = std::current_exception();
+                }
+            }
+        }
+    }
+    if (eptr) std::rethrow_exception(eptr);
+    CancellationToken::throw_if_cancelled(token);
+
+    std::vector<std::vector<double>> averages(n_sets, std::vector<double>(n_acc, 0.0));
+    for (size_t b = 0; b < n_blocks; b++){
+        for (size_t k = 0; k < n_sets; k++) {
+            for (size_t i = 0; i < n_acc; i++) averages[k][i] += block_sums[(b * n_sets + k) * n_acc + i];
+        }
+    }
+    for (auto& row : averages) {
+        for (double& avg : row) avg /= static_cast<double>(n_paths);
+    }
+
+    return averages;
+}
+
+PathFeatures MonteCarlo::generate_features(double S0, 
+                                           const TimeGrid& grid, 
+                                           size_t n_paths, 
+                                           std::optional<double> v0){
+
+    const std::vector<double>& t = grid.times();
+    const size_t n = grid.n_steps();
+
+    std::optional<SimulationKey> key = cache_key(SimulationKey::Features, S0, grid, n_paths, v0, {});
+    if (key) {
+        if (auto run = cached_run(*key)) return std::get<PathFeatures>(*run);
+    }
+
+    PathFeatures features(n_paths);
+    std::exception_ptr eptr = nullptr;
+    const CancellationToken* token = CancellationToken::current();
+
+    const std::shared_ptr<Scheme> run_scheme = scheme_->prepare(t);
+    const Scheme& scheme = run_scheme ? *run_scheme : *scheme_;
+
+    size_t first_seed = 0;
+    const std::shared_ptr<std::vector<size_t>> seeds = run_seeds(scheme, grid, n_paths, &first_seed);
 
     #pragma omp parallel for num_threads(n_jobs_)
     for (size_t p = 0; p < n_paths; p++){
+        if (CancellationToken::is_cancelled(token)) continue;
         try {
-            std::mt19937 rng(static_cast<unsigned int>(seeds_vector[p]));
-                double* s_path_ptr = &s_all_paths[p * (n + 1)];
-                double* v_path_ptr = &v_all_paths[p * (n + 1)];
-                generate_path_inplace( s_path_ptr, v_path_ptr, S0, n+1, T, rng, v0);
+            PathDraws draws(randoms_.get(), seeds.get(), p);
+            std::pair<double, double> state = scheme.init_state(S0, v0);
+            double hi = state.first;
+            double lo = state.first;
+            double sum = state.first;
+
+            for (size_t step = 1; step <= n; ++step) {
+                state = draws.step(scheme, state, t[step-1], t[step] - t[step-1]);
+                hi = std::max(hi, state.first);
+                lo = std::min(lo, state.first);
+                sum += state.first;
             }
+
+            features.terminal[p] = state.first;
+            features.max[p] = hi;
+            features.min[p] = lo;
+            features.average[p] = sum / static_cast<double>(n + 1);
+        }
         catch(...) {
             #pragma omp critical 
             {
@@ -101,18 +931,78 @@ SimulationResult MonteCarlo::generate_spot(float S0,
         }
     }
     if (eptr) std::rethrow_exception(eptr);
+    CancellationToken::throw_if_cancelled(token);
 
-    if (return_volatility_) return SimulationResult(std::make_shared<std::vector<double>>(s_all_paths), seed_,  n, n_paths, std::make_shared<std::vector<double>>(v_all_paths)); 
-    else return SimulationResult(std::make_shared<std::vector<double>>(s_all_paths), seed_,  n, n_paths); 
+    if (key && first_seed == 0) cache_->put(*key, features);
+    return features;
+}
 
+std::shared_ptr<std::vector<size_t>> MonteCarlo::draw_seeds(size_t n_paths, size_t* first_seed){
+    std::shared_ptr<std::vector<size_t>> seeds = workspace_ ? workspace_->seeds(n_paths) : std::make_shared<std::vector<size_t>>(n_paths);
+    std::vector<size_t>& seeds_vector = *seeds;
+    // runs started concurrently on the same engine draw their seeds in turn
+    std::lock_guard<std::mutex> lock(*rng_mutex_);
+    if (first_seed) *first_seed = drawn_;
+    for (size_t i = 0; i < n_paths; i++){
+        seeds_vector[i] = rng_();
+    }
+    drawn_ += n_paths;
+    return seeds;
+}
+
+std::shared_ptr<std::vector<size_t>> MonteCarlo::run_seeds(const Scheme& scheme, const TimeGrid& grid, size_t n_paths,
+                                                        size_t* first_seed){
+    if (!randoms_) return draw_seeds(n_paths, first_seed);
+    if (n_paths > randoms_->n_paths())
+        throw std::invalid_argument("MonteCarlo : the random store holds fewer paths than the run");
+    if (grid.n_steps() != randoms_->n_steps())
+        throw std::invalid_argument("MonteCarlo : the random store and the time grid have different numbers of steps");
+    if (scheme.random_dimensions() > randoms_->dims())
+        throw std::invalid_argument("MonteCarlo : the random store holds fewer normals per step than the scheme reads");
+    return nullptr;
 }
 
-void MonteCarlo::configure(std::optional<int> seed, std::optional<int> n_jobs, std::optional<bool> return_volatility){
+void MonteCarlo::skip_paths(size_t n_paths){
+    std::lock_guard<std::mutex> lock(*rng_mutex_);
+    rng_.discard(n_paths);
+    drawn_ += n_paths;
+}
+
+std::optional<SimulationKey> MonteCarlo::cache_key(SimulationKey::Kind kind, double S0, const TimeGrid& grid, size_t n_paths,
+                                                   std::optional<double> v0, std::vector<size_t> observed) const {
+    if (!cache_ || !from_seed_ || randoms_) return std::nullopt;
+    // features do not depend on the storage settings
+    const bool features = (kind == SimulationKey::Features);
+    std::optional<std::vector<double>> parameters = scheme_->parameters();
+    std::shared_ptr<const Scheme> scheme = parameters ? nullptr : scheme_;
+    return SimulationKey{kind, scheme_->describe(), parameters.value_or(std::vector<double>()), std::move(scheme),
+                         S0, v0, grid.times(), n_paths, std::move(observed),
+                         features ? PathMajor : layout_, !features && return_volatility_, seed_};
+}
+
+std::shared_ptr<const SimulationCache::Run> MonteCarlo::cached_run(const SimulationKey& key){
+    std::lock_guard<std::mutex> lock(*rng_mutex_);
+    std::shared_ptr<const SimulationCache::Run> run = cache_->get(key);
+    if (run) {
+        rng_.discard(key.n_paths);
+        drawn_ += key.n_paths;
+    }
+    return run;
+}
+
+std::shared_ptr<std::vector<double>> MonteCarlo::buffer(size_t n){
+    return workspace_ ? workspace_->values(n) : std::make_shared<std::vector<double>>(n);
+}
+
+void MonteCarlo::configure(std::optional<int> seed, std::optional<int> n_jobs, std::optional<bool> return_volatility,
+                           std::optional<Layout> layout){
 
     if (seed.has_value()) {
         if (seed.value()<0) throw std::invalid_argument("MonteCarlo::configure : seed value must be positive");
         seed_ = static_cast<size_t>(seed.value());
         rng_.seed(seed_);
+        drawn_ = 0;
+        from_seed_ = true;
         user_set_seed_ = true; 
     }
 
@@ -127,4 +1017,8 @@ void MonteCarlo::configure(std::optional<int> seed, std::optional<int> n_jobs, s
     if (return_volatility.has_value()) {
         return_volatility_ = return_volatility.value();
     }
+
+    if (layout.has_value()) {
+        layout_ = layout.value();
+    }
 }
\ No newline at end of file
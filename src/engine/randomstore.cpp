@@ -0,0 +1,87 @@
+#include "engine/randomstore.hpp"
+#include "types/archive.hpp"
+#include "types/simulationresult.hpp"
+#include <map>
+#include <memory>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <omp.h>
+
+
+RandomStore::RandomStore(size_t n_paths, size_t n_steps, size_t dims, size_t seed, int n_jobs):
+    n_paths_(n_paths),
+    n_steps_(n_steps),
+    dims_(dims)
+{
+    if (n_paths == 0 || n_steps == 0 || dims == 0)
+        throw std::invalid_argument("RandomStore : n_paths, n_steps and dims must be positive");
+    if (n_jobs < -1 || n_jobs == 0) throw std::invalid_argument("RandomStore : n_jobs value must be strictly positive or equal to -1");
+    if (n_jobs == -1) {
+        const int hw = static_cast<int>(std::thread::hardware_concurrency());
+        n_jobs = hw == 0 ? 1 : hw;
+    }
+
+    std::vector<size_t> seeds(n_paths);
+    std::mt19937 rng(seed);
+    for (size_t& s : seeds) s = rng();
+
+    const size_t per_path = n_steps * dims;
+    auto values = std::make_shared<std::vector<double>>(n_paths * per_path);
+    double* data = values->data();
+
+    #pragma omp parallel for num_threads(n_jobs)
+    for (size_t p = 0; p < n_paths; p++){
+        std::mt19937 path_rng(static_cast<unsigned int>(seeds[p]));
+        double* z = data + p * per_path;
+        for (size_t k = 0; k < n_steps; k++){
+            // a new distribution per step, as in the steps of the schemes
+            std::normal_distribution<double> dist;
+            for (size_t d = 0; d < dims; d++) *z++ = dist(path_rng);
+        }
+    }
+
+    values_ = std::span<const double>(*values);
+    storage_ = std::move(values);
+}
+
+RandomStore::RandomStore(std::shared_ptr<const void> storage, std::span<const double> values, size_t n_steps, size_t dims):
+    storage_(std::move(storage)),
+    values_(values),
+    n_steps_(n_steps),
+    dims_(dims)
+{
+    if (n_steps == 0 || dims == 0) throw std::invalid_argument("RandomStore : n_steps and dims must be positive");
+    if (values.empty() || values.size() % (n_steps * dims) != 0)
+        throw std::invalid_argument("RandomStore : the number of values must be a positive multiple of n_steps * dims");
+    n_paths_ = values.size() / (n_steps * dims);
+}
+
+RandomStore RandomStore::rows(size_t first, size_t count) const {
+    if (count == 0 || first + count > n_paths_) throw std::invalid_argument("RandomStore::rows : the paths are out of the store");
+    const size_t per_path = n_steps_ * dims_;
+    return RandomStore(storage_, values_.subspan(first * per_path, count * per_path), n_steps_, dims_);
+}
+
+void RandomStore::save(const std::string& path) const {
+    // one row of n_steps * dims values per path
+    SimulationResult normals(storage_, values_, std::span<const double>(), 0, n_steps_ * dims_ - 1, n_paths_);
+    SimulationArchive::save(normals, path, "RandomStore dims=" + std::to_string(dims_));
+}
+
+RandomStore RandomStore::load(const std::string& path){
+    std::map<std::string, std::string> head = SimulationArchive::header(path);
+    const std::string& description = head["description"];
+    const std::string prefix = "RandomStore dims=";
+    if (description.rfind(prefix, 0) != 0) throw std::invalid_argument("RandomStore::load : " + path + " does not hold a random store");
+    const size_t dims = std::stoull(description.substr(prefix.size()));
+
+    auto normals = std::make_shared<const SimulationResult>(SimulationArchive::load(path));
+    if (normals->get_layout() != PathMajor) throw std::invalid_argument("RandomStore::load : the normals must be stored path by path");
+    const size_t n_cols = normals->get_path_size();
+    if (n_cols % dims != 0) throw std::invalid_argument("RandomStore::load : the number of columns is not a multiple of dims");
+    return RandomStore(normals, normals->spots(), n_cols / dims, dims);
+}
@@ -0,0 +1,42 @@
+#include "engine/simulationcache.hpp"
+#include "types/pathfeatures.hpp"
+#include "types/simulationresult.hpp"
+#include <functional>
+#include <memory>
+#include <string>
+#include <variant>
+
+
+template <class T>
+static void combine(size_t& h, const T& value){
+    h ^= std::hash<T>{}(value) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+}
+
+size_t SimulationKeyHash::operator()(const SimulationKey& key) const {
+    size_t h = 0;
+    combine(h, static_cast<int>(key.kind));
+    combine(h, key.description);
+    for (double p : key.parameters) combine(h, p);
+    combine(h, key.scheme.get());
+    combine(h, key.S0);
+    combine(h, key.v0.value_or(-1.0));
+    for (double t : key.times) combine(h, t);
+    combine(h, key.n_paths);
+    for (size_t j : key.observed) combine(h, j);
+    combine(h, static_cast<int>(key.layout));
+    combine(h, key.with_vol);
+    combine(h, key.seed);
+    return h;
+}
+
+void SimulationCache::put(const SimulationKey& key, Run run){
+
+    size_t bytes = 0;
+    if (const SimulationResult* res = std::get_if<SimulationResult>(&run)) {
+        const size_t values = res->get_npaths() * res->get_path_size();
+        bytes = values * sizeof(double) * (res->has_vol() ? 2 : 1);
+    }
+    else bytes = std::get<PathFeatures>(run).size() * 4 * sizeof(double);
+
+    runs_.put(key, std::make_shared<const Run>(std::move(run)), bytes);
+}
@@ -0,0 +1,74 @@
+#include "engine/workspace.hpp"
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+template <class T>
+std::shared_ptr<std::vector<T>> Workspace::acquire(Pool<T>& pool, size_t n){
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // a buffer is free when the pool holds its only reference. The smallest
+    // free buffer large enough is preferred, then the largest free one,
+    // which grows
+    std::shared_ptr<std::vector<T>>* best = nullptr;
+    for (auto& buffer : pool) {
+        if (buffer.use_count() != 1) continue;
+        if (!best) {
+            best = &buffer;
+            continue;
+        }
+        const size_t cap = buffer->capacity();
+        const size_t best_cap = (*best)->capacity();
+        const bool fits = cap >= n;
+        const bool best_fits = best_cap >= n;
+        if ((fits && (!best_fits || cap < best_cap)) || (!fits && !best_fits && cap > best_cap)) best = &buffer;
+    }
+
+    if (best) {
+        if ((*best)->capacity() >= n) reuses_++;
+        else allocations_++;
+        (*best)->resize(n);
+        return *best;
+    }
+
+    allocations_++;
+    auto buffer = std::make_shared<std::vector<T>>(n);
+    if (pool.size() < max_buffers_) pool.push_back(buffer);
+    return buffer;
+}
+
+std::shared_ptr<std::vector<double>> Workspace::values(size_t n){
+    return acquire(values_, n);
+}
+
+std::shared_ptr<std::vector<size_t>> Workspace::seeds(size_t n){
+    return acquire(seeds_, n);
+}
+
+void Workspace::release(){
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto unused = [](const auto& buffer){return buffer.use_count() == 1;};
+    values_.erase(std::remove_if(values_.begin(), values_.end(), unused), values_.end());
+    seeds_.erase(std::remove_if(seeds_.begin(), seeds_.end(), unused), seeds_.end());
+}
+
+size_t Workspace::reserved_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t bytes = 0;
+    for (const auto& buffer : values_) bytes += buffer->capacity() * sizeof(double);
+    for (const auto& buffer : seeds_) bytes += buffer->capacity() * sizeof(size_t);
+    return bytes;
+}
+
+size_t Workspace::allocations() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return allocations_;
+}
+
+size_t Workspace::reuses() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return reuses_;
+}
@@ -5,23 +5,77 @@
 #include "types/path.hpp"
 #include "types/simulationresult.hpp"
 #include "types/state.hpp"
+#include <algorithm>
 #include <span>
+#include <stdexcept>
+#include <vector>
 
 
 
 double Instrument::compute_payoff(const SimulationResult& simulation) const {
 
-    const std::vector<double>& paths = simulation.get_paths();
     const size_t n_paths = simulation.get_npaths();
     const size_t p_size = simulation.get_path_size();
 
+    // lazy results are read block by block and never materialized
+    const bool lazy = simulation.is_lazy();
+    std::span<const double> paths = lazy ? std::span<const double>() : simulation.spots();
+    const bool with_vol = simulation.has_vol();
+    const double* vols = (with_vol && !lazy) ? simulation.vols().data() : nullptr;
+    std::span<const double> times;
+    if (simulation.has_times()) times = simulation.get_times();
+
+    const std::vector<unsigned char>* knocked = nullptr;
+    if (simulation.get_knock_out().has_value()) {
+        if (payoff_->knock_out() != simulation.get_knock_out())
+            throw std::invalid_argument("Instrument::compute_payoff : the simulation monitored a knock-out condition that is not the one of the payoff");
+        knocked = &simulation.get_knocked();
+    }
+
+    // payoffs are computed by blocks of paths with the batch kernels, or
+    // by the blocks the payoff asks for
+    const size_t block_size = payoff_->chunk_paths() ? payoff_->chunk_paths() : 1024;
+    std::vector<double> payoffs(std::min(block_size, n_paths));
+
+    // path-major paths are read in place. With a time-major layout, payoffs
+    // that only read the terminal value get the contiguous terminal column,
+    // the others a path-major copy of each block
+    const bool time_major = simulation.get_layout() == TimeMajor && p_size > 1;
+    const bool terminal_only = !lazy && time_major && !payoff_->path_dependent();
+    const bool copied = lazy || (time_major && !terminal_only);
+    const size_t view_size = terminal_only ? 1 : p_size;
+
+    const size_t offset = terminal_only ? (p_size - 1) * n_paths : 0;
+    const PathsView all{lazy ? paths : std::span<const double>(paths.data() + offset, n_paths * view_size),
+                        vols ? std::span<const double>(vols + offset, n_paths * view_size) : std::span<const double>(),
+                        (terminal_only && !times.empty()) ? times.last(1) : times, 
+                        n_paths, view_size};
+
+    std::vector<double> s_block, v_block;
+    if (copied) {
+        s_block.resize(payoffs.size() * p_size);
+        if (with_vol) v_block.resize(payoffs.size() * p_size);
+    }
+
     double payoff_avg = 0;
     double K = contract_.K;
 
-    for (size_t p = 0; p < n_paths; p++) {
-        std::span<const double> path_view(paths.data() + (p * p_size), p_size);
-        payoff_avg += payoff_->compute(path_view, K);
+    for (size_t first = 0; first < n_paths; first += block_size) {
+        const size_t count = std::min(block_size, n_paths - first);
+        std::span<double> out(payoffs.data(), count);
+
+        if (copied) {
+            std::span<double> s(s_block.data(), count * p_size);
+            std::span<double> v = with_vol ? std::span<double>(v_block.data(), count * p_size) : std::span<double>();
+            simulation.copy_paths(first, count, s, v);
+            payoff_->compute_batch(PathsView{s, v, times, count, p_size}, K, out);
+        }
+        else payoff_->compute_batch(all.rows(first, count), K, out);
+
+        for (size_t p = 0; p < count; p++) {
+            if (knocked && (*knocked)[first + p]) continue;
+            payoff_avg += out[p];
+        }
     };
     return payoff_avg/static_cast<double>(n_paths);
-};
-
+};
\ No newline at end of file
@@ -0,0 +1,45 @@
+#include "instruments/instrumenttable.hpp"
+#include "payoff/payoff.h"
+#include "types/barrier.hpp"
+#include <memory>
+#include <stdexcept>
+
+
+void InstrumentTable::validate() const {
+
+    const size_t n = size();
+    if (n == 0) throw std::invalid_argument("InstrumentTable::validate : the table is empty");
+    if (T.size() != n || payoff.size() != n)
+        throw std::invalid_argument("InstrumentTable::validate : K, T and payoff must have the same size");
+    if (!barrier.empty() && (barrier.size() != n || direction.size() != n || nature.size() != n))
+        throw std::invalid_argument("InstrumentTable::validate : barrier, direction and nature must have one value per row");
+    if (barrier.empty() && (!direction.empty() || !nature.empty()))
+        throw std::invalid_argument("InstrumentTable::validate : direction and nature require barrier");
+
+    for (size_t i = 0; i < n; i++) {
+        if (!(K[i] >= 0)) throw std::invalid_argument("InstrumentTable::validate : strikes must be non negative");
+        if (!(T[i] > 0)) throw std::invalid_argument("InstrumentTable::validate : maturities must be positive");
+        if (payoff[i] < CallCode || payoff[i] > DigitalPutCode)
+            throw std::invalid_argument("InstrumentTable::validate : unknown payoff code");
+        if (!has_barrier(i)) continue;
+        if (direction[i] != Up && direction[i] != Down)
+            throw std::invalid_argument("InstrumentTable::validate : unknown barrier direction");
+        if (nature[i] != In && nature[i] != Out)
+            throw std::invalid_argument("InstrumentTable::validate : unknown barrier nature");
+    }
+}
+
+std::shared_ptr<Payoff> InstrumentTable::make_payoff(size_t i) const {
+
+    static const std::shared_ptr<Payoff> vanillas[] = {
+        std::make_shared<CallPayoff>(),
+        std::make_shared<PutPayoff>(),
+        std::make_shared<DigitalCallPayoff>(),
+        std::make_shared<DigitalPutPayoff>()
+    };
+
+    const std::shared_ptr<Payoff>& vanilla = vanillas[payoff[i]];
+    if (!has_barrier(i)) return vanilla;
+    return std::make_shared<BarrierPayoff>(barrier[i], static_cast<Direction>(direction[i]),
+                                           static_cast<Nature>(nature[i]), *vanilla);
+}
@@ -1,4 +1,6 @@
 #include "models/black_scholes/black_scholes.hpp"
+#include <sstream>
+#include <string>
 
 
 
@@ -13,4 +15,26 @@ double BlackScholes::diffusion(double t, const double S) const {
 
 double BlackScholes::volatility(double t, const double S) const {
     return sigma;
-}
\ No newline at end of file
+}
+
+Coefficients BlackScholes::coefficients(double t, const double S) const {
+    (void)t;
+    return Coefficients{S*mu, sigma*S, sigma};
+}
+
+void BlackScholes::coefficients_batch(double t, std::span<const double> S, std::span<double> drift,
+                                      std::span<double> diffusion, std::span<double> vol) const {
+    (void)t;
+    check_batch(S, drift, diffusion, vol);
+    for (size_t i = 0; i < S.size(); i++){
+        drift[i] = S[i]*mu;
+        diffusion[i] = sigma*S[i];
+        vol[i] = sigma;
+    }
+}
+
+std::string BlackScholes::describe() const {
+    std::ostringstream out;
+    out << "BlackScholes(mu=" << mu << ", sigma=" << sigma << ")";
+    return out.str();
+}
@@ -2,6 +2,8 @@
 
 #include "surface/local_vol.hpp"
 #include "types/state.hpp"
+#include <sstream>
+#include <string>
 
 Dupire::Dupire(float r, float q, 
            std::shared_ptr<LocalVolatilitySurface> loc_vol_surface):
@@ -10,15 +12,59 @@ Dupire::Dupire(float r, float q,
 
 {}
 
+std::shared_ptr<Model> Dupire::prepare(const std::vector<double>& times) const {
+    if (times.size() < 2) return nullptr;
+
+    auto prepared = std::make_shared<Dupire>(*this);
+    prepared->slices_ = std::make_shared<const LocalVolatilityTimeSlices>(lv_surface_->slices(times));
+    return prepared;
+}
+
+double Dupire::sigma(double t, double S) const {
+    if (slices_) {
+        const LocalVolatilitySlice* slice = slices_->find(t);
+        if (slice) return slice->sigma(S);
+    }
+    return lv_surface_->sigma(t, S);
+}
+
 double Dupire::drift(double t, const double S) const {
     return (r_ - q_)*S;
 }
 
 double Dupire::diffusion(double t, const double S) const {
-    return lv_surface_->sigma(t, S)*S;
+    return sigma(t, S)*S;
 }
 
 double Dupire::volatility(double t, const double S) const {
-    return lv_surface_->sigma(t, S);
+    return sigma(t, S);
 }
 
+Coefficients Dupire::coefficients(double t, const double S) const {
+    // the local volatility is interpolated once and shared by the
+    // diffusion and the volatility
+    const double vol = sigma(t, S);
+    return Coefficients{(r_ - q_)*S, vol*S, vol};
+}
+
+void Dupire::coefficients_batch(double t, std::span<const double> S, std::span<double> drift,
+                                std::span<double> diffusion, std::span<double> vol) const {
+    check_batch(S, drift, diffusion, vol);
+
+    const LocalVolatilitySlice* slice = slices_ ? slices_->find(t) : nullptr;
+    if (slice) slice->sigma_batch(S, vol);
+    else lv_surface_->sigma_batch(t, S, vol);
+
+    for (size_t i = 0; i < S.size(); i++){
+        drift[i] = (r_ - q_)*S[i];
+        diffusion[i] = vol[i]*S[i];
+    }
+}
+
+
+std::string Dupire::describe() const {
+    std::ostringstream out;
+    out << "Dupire(r=" << r_ << ", q=" << q_ << ", local volatility surface of " 
+        << lv_surface_->times().size() << " times x " << lv_surface_->spots().size() << " spots)";
+    return out.str();
+}
@@ -1,4 +1,6 @@
 #include "models/heston/heston.hpp"
+#include <sstream>
+#include <string>
 
 
 double Heston::drift(double t, const double S) const {
@@ -11,3 +13,10 @@ double Heston::diffusion(double t, const double S) const {
 }
 
 
+
+std::string Heston::describe() const {
+    std::ostringstream out;
+    out << "Heston(mu=" << mu << ", kappa=" << kappa << ", theta=" << theta 
+        << ", epsilon=" << epsilon << ", rho=" << rho << ")";
+    return out.str();
+}
@@ -1,5 +1,7 @@
 
 #include "models/ir_models/vasicek.h"
+#include <sstream>
+#include <string>
 
 
 
@@ -15,4 +17,26 @@ double Vasicek::diffusion(double t, const double S) const {
 
 double Vasicek::volatility(double t, const double S) const {
     return sigma_;
-}
\ No newline at end of file
+}
+
+Coefficients Vasicek::coefficients(double t, const double S) const {
+    (void)t;
+    return Coefficients{a_ *(b_ - S), sigma_, sigma_};
+}
+
+void Vasicek::coefficients_batch(double t, std::span<const double> S, std::span<double> drift,
+                                 std::span<double> diffusion, std::span<double> vol) const {
+    (void)t;
+    check_batch(S, drift, diffusion, vol);
+    for (size_t i = 0; i < S.size(); i++){
+        drift[i] = a_ *(b_ - S[i]);
+        diffusion[i] = sigma_;
+        vol[i] = sigma_;
+    }
+}
+
+std::string Vasicek::describe() const {
+    std::ostringstream out;
+    out << "Vasicek(a=" << a_ << ", b=" << b_ << ", sigma=" << sigma_ << ")";
+    return out.str();
+}
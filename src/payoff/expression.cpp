@@ -0,0 +1,543 @@
+#include "payoff/expression.hpp"
+#include "payoff/accumulator.hpp"
+#include "payoff/payoff.h"
+#include "types/pathfeatures.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+enum class Op {Const, Strike, Spot, Terminal, Fixing, Reduce,
+               Add, Sub, Mul, Div, Max, Min, Lt, Le, Gt, Ge,
+               Neg, Abs, Exp, Log, Sqrt};
+
+enum class Reduction {Max, Min, Mean, Sum};
+
+// index is the fixing or the reduction read by the leaf
+struct Instruction {
+    Op op;
+    double value = 0.0;
+    size_t index = 0;
+};
+
+struct Program {
+    std::vector<Instruction> code;
+    size_t depth = 0;
+};
+
+// what an expression reads, checked against the context it is used in
+struct Usage {
+    bool spot = false;
+    bool terminal = false;
+    bool fixing = false;
+    bool reduce = false;
+};
+
+bool is_leaf(Op op) {return op <= Op::Reduce;}
+bool is_unary(Op op) {return op >= Op::Neg;}
+
+// fixings are matched to the simulation times up to rounding
+constexpr double time_tolerance = 1e-9;
+
+}
+
+
+struct ExpressionPayoff::Compiled {
+    struct Reducer {
+        Reduction kind;
+        Program body;
+        // body is the spot itself
+        bool spot_only() const {return body.code.size() == 1 && body.code[0].op == Op::Spot;}
+    };
+
+    Program main;
+    std::vector<Reducer> reducers;
+    std::vector<double> fixings;
+};
+
+
+namespace {
+
+using Compiled = ExpressionPayoff::Compiled;
+
+void set_depth(Program& program) {
+    size_t depth = 0;
+    for (const Instruction& in : program.code) {
+        if (is_leaf(in.op)) depth++;
+        else if (!is_unary(in.op)) depth--;
+        program.depth = std::max(program.depth, depth);
+    }
+}
+
+class Parser {
+
+public:
+    Parser(const std::string& text, Compiled& out) : text_(text), out_(out) {}
+
+    void parse() {
+        Usage use;
+        expression(out_.main, use);
+        skip();
+        if (pos_ != text_.size()) fail("unexpected '" + std::string(1, text_[pos_]) + "'");
+        if (use.spot) fail("the spot S must be read at a time, as in S[T] or S[0.5], or reduced, as in max(S)");
+        set_depth(out_.main);
+    }
+
+private:
+    const std::string& text_;
+    Compiled& out_;
+    size_t pos_ = 0;
+
+    [[noreturn]] void fail(const std::string& message) const {
+        throw std::invalid_argument("ExpressionPayoff : " + message + " at position " + std::to_string(pos_) + " of '" + text_ + "'");
+    }
+
+    void skip() {
+        while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) pos_++;
+    }
+
+    bool accept(const char* token) {
+        skip();
+        const std::string t(token);
+        if (text_.compare(pos_, t.size(), t) != 0) return false;
+        pos_ += t.size();
+        return true;
+    }
+
+    void expect(const char* token) {
+        if (!accept(token)) fail(std::string("expected '") + token + "'");
+    }
+
+    std::string identifier() {
+        skip();
+        const size_t start = pos_;
+        while (pos_ < text_.size() && (std::isalnum(static_cast<unsigned char>(text_[pos_])) || text_[pos_] == '_')) pos_++;
+        return text_.substr(start, pos_ - start);
+    }
+
+    bool number(double& value) {
+        skip();
+        if (pos_ >= text_.size() || !(std::isdigit(static_cast<unsigned char>(text_[pos_])) || text_[pos_] == '.')) return false;
+        const char* begin = text_.c_str() + pos_;
+        char* end = nullptr;
+        value = std::strtod(begin, &end);
+        if (end == begin) fail("invalid number");
+        pos_ += static_cast<size_t>(end - begin);
+        return true;
+    }
+
+    // comparison := additive [(< | <= | > | >=) additive]
+    void expression(Program& p, Usage& use) {
+        additive(p, use);
+        Op op;
+        if (accept("<=")) op = Op::Le;
+        else if (accept(">=")) op = Op::Ge;
+        else if (accept("<")) op = Op::Lt;
+        else if (accept(">")) op = Op::Gt;
+        else return;
+        additive(p, use);
+        p.code.push_back({op});
+    }
+
+    void additive(Program& p, Usage& use) {
+        term(p, use);
+        while (true) {
+            if (accept("+")) {term(p, use); p.code.push_back({Op::Add});}
+            else if (accept("-")) {term(p, use); p.code.push_back({Op::Sub});}
+            else return;
+        }
+    }
+
+    void term(Program& p, Usage& use) {
+        unary(p, use);
+        while (true) {
+            if (accept("*")) {unary(p, use); p.code.push_back({Op::Mul});}
+            else if (accept("/")) {unary(p, use); p.code.push_back({Op::Div});}
+            else return;
+        }
+    }
+
+    void unary(Program& p, Usage& use) {
+        if (accept("-")) {
+            unary(p, use);
+            p.code.push_back({Op::Neg});
+        }
+        else if (accept("+")) unary(p, use);
+        else primary(p, use);
+    }
+
+    void primary(Program& p, Usage& use) {
+        double value;
+        if (number(value)) {
+            p.code.push_back({Op::Const, value});
+            return;
+        }
+        if (accept("(")) {
+            expression(p, use);
+            expect(")");
+            return;
+        }
+
+        const size_t start = pos_;
+        const std::string name = identifier();
+        if (name.empty()) fail("expected a number, K, S or a function");
+
+        if (name == "K") p.code.push_back({Op::Strike});
+        else if (name == "S") spot(p, use);
+        else if (name == "max" || name == "min") extremum(p, use, name == "max");
+        else if (name == "mean" || name == "sum") {
+            expect("(");
+            reduction(p, use, name == "mean" ? Reduction::Mean : Reduction::Sum);
+        }
+        else if (name == "abs" || name == "exp" || name == "log" || name == "sqrt") {
+            expect("(");
+            expression(p, use);
+            expect(")");
+            p.code.push_back({name == "abs" ? Op::Abs : name == "exp" ? Op::Exp : name == "log" ? Op::Log : Op::Sqrt});
+        }
+        else {
+            pos_ = start;
+            fail("unknown name '" + name + "'");
+        }
+    }
+
+    // S, S[T] or S[t]
+    void spot(Program& p, Usage& use) {
+        if (!accept("[")) {
+            p.code.push_back({Op::Spot});
+            use.spot = true;
+            return;
+        }
+        double t;
+        if (number(t)) {
+            if (!(t >= 0)) fail("fixing times must be non negative");
+            auto it = std::find(out_.fixings.begin(), out_.fixings.end(), t);
+            const size_t index = static_cast<size_t>(it - out_.fixings.begin());
+            if (it == out_.fixings.end()) out_.fixings.push_back(t);
+            p.code.push_back({Op::Fixing, t, index});
+            use.fixing = true;
+        }
+        else if (identifier() == "T") {
+            p.code.push_back({Op::Terminal});
+            use.terminal = true;
+        }
+        else fail("expected T or a time in S[...]");
+        expect("]");
+    }
+
+    // max(e) and min(e) reduce the path, max(a, b, ...) and min(a, b, ...)
+    // compare values
+    void extremum(Program& p, Usage& use, bool is_max) {
+        expect("(");
+        Program first;
+        Usage first_use;
+        const size_t start = pos_;
+        expression(first, first_use);
+
+        if (!accept(",")) {
+            pos_ = start;
+            reduction(p, use, is_max ? Reduction::Max : Reduction::Min);
+            return;
+        }
+
+        p.code.insert(p.code.end(), first.code.begin(), first.code.end());
+        merge(use, first_use);
+        do {
+            expression(p, use);
+            p.code.push_back({is_max ? Op::Max : Op::Min});
+        } while (accept(","));
+        expect(")");
+    }
+
+    // reduction over the states of the path, the opening parenthesis is read
+    void reduction(Program& p, Usage& use, Reduction kind) {
+        Compiled::Reducer reducer{kind, {}};
+        Usage body;
+        expression(reducer.body, body);
+        expect(")");
+        if (body.terminal || body.fixing || body.reduce)
+            fail("a reduction over the path can only read the spot S, K and numbers");
+        set_depth(reducer.body);
+
+        out_.reducers.push_back(std::move(reducer));
+        p.code.push_back({Op::Reduce, 0.0, out_.reducers.size() - 1});
+        use.reduce = true;
+    }
+
+    static void merge(Usage& to, const Usage& from) {
+        to.spot = to.spot || from.spot;
+        to.terminal = to.terminal || from.terminal;
+        to.fixing = to.fixing || from.fixing;
+        to.reduce = to.reduce || from.reduce;
+    }
+};
+
+
+template <class F>
+void binary(double* a, const double* b, size_t n, F f) {
+    #pragma omp simd
+    for (size_t p = 0; p < n; p++) a[p] = f(a[p], b[p]);
+}
+
+template <class F>
+void unary(double* a, size_t n, F f) {
+    #pragma omp simd
+    for (size_t p = 0; p < n; p++) a[p] = f(a[p]);
+}
+
+/**
+ * Runs a program on n paths. Each instruction processes the n values of its
+ * operands, stack holds program.depth rows of n values. leaf(in, dst) writes
+ * the n values of the Spot, Terminal, Fixing and Reduce leaves.
+ */
+template <class Leaf>
+void run(const Program& program, size_t n, double K, std::vector<double>& stack, Leaf&& leaf, double* out) {
+
+    if (stack.size() < program.depth * n) stack.resize(program.depth * n);
+    size_t top = 0;
+
+    for (const Instruction& in : program.code) {
+        if (is_leaf(in.op)) {
+            double* dst = stack.data() + top * n;
+            if (in.op == Op::Const) std::fill(dst, dst + n, in.value);
+            else if (in.op == Op::Strike) std::fill(dst, dst + n, K);
+            else leaf(in, dst);
+            top++;
+            continue;
+        }
+
+        double* a = stack.data() + (top - 1) * n;
+        if (is_unary(in.op)) {
+            switch (in.op) {
+                case Op::Neg: unary(a, n, [](double x){return -x;}); break;
+                case Op::Abs: unary(a, n, [](double x){return std::abs(x);}); break;
+                case Op::Exp: unary(a, n, [](double x){return std::exp(x);}); break;
+                case Op::Log: unary(a, n, [](double x){return std::log(x);}); break;
+                default: unary(a, n, [](double x){return std::sqrt(x);}); break;
+            }
+            continue;
+        }
+
+        a = stack.data() + (top - 2) * n;
+        const double* b = stack.data() + (top - 1) * n;
+        switch (in.op) {
+            case Op::Add: binary(a, b, n, [](double x, double y){return x + y;}); break;
+            case Op::Sub: binary(a, b, n, [](double x, double y){return x - y;}); break;
+            case Op::Mul: binary(a, b, n, [](double x, double y){return x * y;}); break;
+            case Op::Div: binary(a, b, n, [](double x, double y){return x / y;}); break;
+            case Op::Max: binary(a, b, n, [](double x, double y){return std::max(x, y);}); break;
+            case Op::Min: binary(a, b, n, [](double x, double y){return std::min(x, y);}); break;
+            case Op::Lt: binary(a, b, n, [](double x, double y){return x < y ? 1.0 : 0.0;}); break;
+            case Op::Le: binary(a, b, n, [](double x, double y){return x <= y ? 1.0 : 0.0;}); break;
+            case Op::Gt: binary(a, b, n, [](double x, double y){return x > y ? 1.0 : 0.0;}); break;
+            default: binary(a, b, n, [](double x, double y){return x >= y ? 1.0 : 0.0;}); break;
+        }
+        top--;
+    }
+
+    std::copy(stack.data(), stack.data() + n, out);
+}
+
+double initial(Reduction kind) {
+    if (kind == Reduction::Max) return -std::numeric_limits<double>::infinity();
+    if (kind == Reduction::Min) return std::numeric_limits<double>::infinity();
+    return 0.0;
+}
+
+void combine(Reduction kind, double* acc, const double* x, size_t n) {
+    if (kind == Reduction::Max) binary(acc, x, n, [](double a, double b){return std::max(a, b);});
+    else if (kind == Reduction::Min) binary(acc, x, n, [](double a, double b){return std::min(a, b);});
+    else binary(acc, x, n, [](double a, double b){return a + b;});
+}
+
+// last column at or before t, the first one if t precedes the simulation
+size_t fixing_column(std::span<const double> times, double t) {
+    const auto it = std::upper_bound(times.begin(), times.end(), t + time_tolerance * std::max(1.0, t));
+    return (it == times.begin()) ? 0 : static_cast<size_t>(it - times.begin()) - 1;
+}
+
+}
+
+
+ExpressionPayoff::ExpressionPayoff(const std::string& expression) : expression_(expression) {
+    auto compiled = std::make_shared<Compiled>();
+    Parser(expression_, *compiled).parse();
+    compiled_ = std::move(compiled);
+}
+
+bool ExpressionPayoff::path_dependent() const {
+    for (const Instruction& in : compiled_->main.code) {
+        if (in.op == Op::Fixing || in.op == Op::Reduce) return true;
+    }
+    return false;
+}
+
+bool ExpressionPayoff::uses_features() const {
+    if (!compiled_->fixings.empty()) return false;
+    return std::all_of(compiled_->reducers.begin(), compiled_->reducers.end(), [](const Compiled::Reducer& r){
+        return r.spot_only() && r.kind != Reduction::Sum;
+    });
+}
+
+double ExpressionPayoff::compute(std::span<const double> path, double K) const {
+    double out = 0.0;
+    compute_batch(PathsView{path, {}, {}, 1, path.size()}, K, std::span<double>(&out, 1));
+    return out;
+}
+
+double ExpressionPayoff::compute_path(const PathView& path, double K) const {
+    double out = 0.0;
+    compute_batch(PathsView{path.spot, path.vol, path.times, 1, path.spot.size()}, K, std::span<double>(&out, 1));
+    return out;
+}
+
+void ExpressionPayoff::compute_batch(const PathsView& paths, double K, std::span<double> out) const {
+
+    const size_t n = paths.n_paths;
+    const size_t m = paths.path_size;
+    if (out.size() != n) throw std::invalid_argument("ExpressionPayoff::compute_batch : output buffer size does not match the number of paths");
+    if (m == 0 || paths.spot.size() != n * m) throw std::invalid_argument("ExpressionPayoff::compute_batch : the spot buffer does not match the shape of the paths");
+
+    const Compiled& c = *compiled_;
+    if (!c.fixings.empty() && paths.times.size() != m)
+        throw std::invalid_argument("ExpressionPayoff::compute_batch : fixings require the simulation times");
+
+    const double* spot = paths.spot.data();
+    auto column = [&](size_t j, double* dst){
+        for (size_t p = 0; p < n; p++) dst[p] = spot[p * m + j];
+    };
+
+    std::vector<double> stack;
+
+    // each reduction walks the steps, over the whole block at once
+    std::vector<double> reduced(c.reducers.size() * n);
+    std::vector<double> state(n), value(n);
+    for (size_t r = 0; r < c.reducers.size(); r++) {
+        const Compiled::Reducer& reducer = c.reducers[r];
+        double* acc = reduced.data() + r * n;
+        std::fill(acc, acc + n, initial(reducer.kind));
+
+        for (size_t k = 0; k < m; k++) {
+            column(k, state.data());
+            if (reducer.spot_only()) combine(reducer.kind, acc, state.data(), n);
+            else {
+                run(reducer.body, n, K, stack, [&](const Instruction&, double* dst){std::copy(state.begin(), state.end(), dst);}, value.data());
+                combine(reducer.kind, acc, value.data(), n);
+            }
+        }
+        if (reducer.kind == Reduction::Mean) unary(acc, n, [m](double x){return x / static_cast<double>(m);});
+    }
+
+    run(c.main, n, K, stack, [&](const Instruction& in, double* dst){
+        switch (in.op) {
+            case Op::Terminal: column(m - 1, dst); break;
+            case Op::Fixing: column(fixing_column(paths.times, in.value), dst); break;
+            default: std::copy(reduced.data() + in.index * n, reduced.data() + (in.index + 1) * n, dst); break;
+        }
+    }, out.data());
+}
+
+void ExpressionPayoff::compute_features(const PathFeatures& features, double K, std::span<double> out) const {
+    if (!uses_features())
+        throw std::invalid_argument("ExpressionPayoff::compute_features : the expression can not be computed from the path features");
+    if (out.size() != features.size())
+        throw std::invalid_argument("ExpressionPayoff::compute_features : output buffer size does not match the number of paths");
+
+    const Compiled& c = *compiled_;
+    constexpr size_t block_size = 1024;
+    std::vector<double> stack;
+
+    for (size_t first = 0; first < features.size(); first += block_size) {
+        const size_t n = std::min(block_size, features.size() - first);
+        run(c.main, n, K, stack, [&](const Instruction& in, double* dst){
+            const std::vector<double>* source = &features.terminal;
+            if (in.op == Op::Reduce) {
+                const Reduction kind = c.reducers[in.index].kind;
+                source = (kind == Reduction::Max) ? &features.max : (kind == Reduction::Min) ? &features.min : &features.average;
+            }
+            std::copy(source->begin() + first, source->begin() + first + n, dst);
+        }, out.data() + first);
+    }
+}
+
+
+namespace {
+
+/**
+ * Running state of an expression along one path : the last spot, the
+ * fixings and the reductions. The programs run on a single value.
+ */
+class ExpressionAccumulator : public PayoffAccumulator {
+
+public:
+    ExpressionAccumulator(std::shared_ptr<const Compiled> compiled, double K) :
+        compiled_(std::move(compiled)),
+        K_(K),
+        fixings_(compiled_->fixings.size()),
+        reduced_(compiled_->reducers.size()) {};
+
+    void start(double S, double, double t) override {
+        count_ = 0;
+        for (size_t r = 0; r < reduced_.size(); r++) reduced_[r] = initial(compiled_->reducers[r].kind);
+        std::fill(fixings_.begin(), fixings_.end(), S);
+        observe(S, t);
+    }
+
+    void update(double S, double, double t) override {observe(S, t);}
+
+    double finalize() const override {
+        double out = 0.0;
+        run(compiled_->main, 1, K_, stack_, [&](const Instruction& in, double* dst){
+            if (in.op == Op::Terminal) *dst = S_;
+            else if (in.op == Op::Fixing) *dst = fixings_[in.index];
+            else {
+                const bool mean = compiled_->reducers[in.index].kind == Reduction::Mean;
+                *dst = mean ? reduced_[in.index] / static_cast<double>(count_) : reduced_[in.index];
+            }
+        }, &out);
+        return out;
+    }
+
+    std::unique_ptr<PayoffAccumulator> clone() const override {
+        return std::make_unique<ExpressionAccumulator>(*this);
+    }
+
+private:
+    std::shared_ptr<const Compiled> compiled_;
+    double K_;
+    double S_ = 0.0;
+    size_t count_ = 0;
+    std::vector<double> fixings_;
+    std::vector<double> reduced_;
+    mutable std::vector<double> stack_;
+
+    void observe(double S, double t) {
+        S_ = S;
+        count_++;
+        for (size_t i = 0; i < fixings_.size(); i++) {
+            const double f = compiled_->fixings[i];
+            if (t <= f + time_tolerance * std::max(1.0, f)) fixings_[i] = S;
+        }
+        for (size_t r = 0; r < reduced_.size(); r++) {
+            const Compiled::Reducer& reducer = compiled_->reducers[r];
+            double x = S;
+            if (!reducer.spot_only()) run(reducer.body, 1, K_, stack_, [S](const Instruction&, double* dst){*dst = S;}, &x);
+            combine(reducer.kind, &reduced_[r], &x, 1);
+        }
+    }
+};
+
+}
+
+std::unique_ptr<PayoffAccumulator> ExpressionPayoff::accumulator(double K) const {
+    return std::make_unique<ExpressionAccumulator>(compiled_, K);
+}
@@ -0,0 +1,151 @@
+#include "payoff/payoff.h"
+#include "types/pathfeatures.hpp"
+#include <algorithm>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+static void check_batch(const PathsView& paths, std::span<double> out, const char* where){
+    if (out.size() != paths.n_paths)
+        throw std::invalid_argument(std::string(where) + " : output buffer size does not match the number of paths");
+    if (paths.path_size == 0 || paths.spot.size() != paths.n_paths * paths.path_size)
+        throw std::invalid_argument(std::string(where) + " : the spot buffer does not match the shape of the paths");
+}
+
+static void check_strike(double K){
+    if (K<0) throw std::invalid_argument("Strike value cannot be negative");
+}
+
+static void check_features(const PathFeatures& features, std::span<double> out, const char* where){
+    if (out.size() != features.size())
+        throw std::invalid_argument(std::string(where) + " : output buffer size does not match the number of paths");
+}
+
+// applies f to the n values s[0], s[stride], ... The values are gathered
+// first so that the payoff loop itself is vectorized
+template <class F>
+static void terminal_kernel(const double* s, size_t stride, size_t n, std::span<double> out, F f){
+    double* o = out.data();
+
+    if (stride == 1) std::copy(s, s + n, o);
+    else for (size_t p = 0; p < n; p++) o[p] = s[p * stride];
+
+    #pragma omp simd
+    for (size_t p = 0; p < n; p++) o[p] = f(o[p]);
+}
+
+// terminal column of a block of paths
+static const double* terminal_column(const PathsView& paths){
+    return paths.spot.data() + (paths.path_size - 1);
+}
+
+
+void Payoff::compute_batch(const PathsView& paths, double K, std::span<double> out) const {
+    check_batch(paths, out, "Payoff::compute_batch");
+    for (size_t p = 0; p < paths.n_paths; p++) out[p] = compute_path(paths.path(p), K);
+}
+
+void Payoff::compute_features(const PathFeatures& features, double K, std::span<double> out) const {
+    if (!uses_features())
+        throw std::invalid_argument("Payoff::compute_features : the payoff can not be computed from the path features");
+    check_features(features, out, "Payoff::compute_features");
+    for (size_t p = 0; p < features.size(); p++) out[p] = compute(std::span<const double>(&features.terminal[p], 1), K);
+}
+
+void CallPayoff::compute_batch(const PathsView& paths, double K, std::span<double> out) const {
+    check_batch(paths, out, "CallPayoff::compute_batch");
+    check_strike(K);
+    terminal_kernel(terminal_column(paths), paths.path_size, paths.n_paths, out, [K](double S){return std::max(S - K, 0.0);});
+}
+
+void CallPayoff::compute_features(const PathFeatures& features, double K, std::span<double> out) const {
+    check_features(features, out, "CallPayoff::compute_features");
+    check_strike(K);
+    terminal_kernel(features.terminal.data(), 1, features.size(), out, [K](double S){return std::max(S - K, 0.0);});
+}
+
+void PutPayoff::compute_batch(const PathsView& paths, double K, std::span<double> out) const {
+    check_batch(paths, out, "PutPayoff::compute_batch");
+    check_strike(K);
+    terminal_kernel(terminal_column(paths), paths.path_size, paths.n_paths, out, [K](double S){return std::max(K - S, 0.0);});
+}
+
+void PutPayoff::compute_features(const PathFeatures& features, double K, std::span<double> out) const {
+    check_features(features, out, "PutPayoff::compute_features");
+    check_strike(K);
+    terminal_kernel(features.terminal.data(), 1, features.size(), out, [K](double S){return std::max(K - S, 0.0);});
+}
+
+void DigitalCallPayoff::compute_batch(const PathsView& paths, double K, std::span<double> out) const {
+    check_batch(paths, out, "DigitalCallPayoff::compute_batch");
+    check_strike(K);
+    terminal_kernel(terminal_column(paths), paths.path_size, paths.n_paths, out, [K](double S){return (S > K) ? 1.0 : 0.0;});
+}
+
+void DigitalCallPayoff::compute_features(const PathFeatures& features, double K, std::span<double> out) const {
+    check_features(features, out, "DigitalCallPayoff::compute_features");
+    check_strike(K);
+    terminal_kernel(features.terminal.data(), 1, features.size(), out, [K](double S){return (S > K) ? 1.0 : 0.0;});
+}
+
+void DigitalPutPayoff::compute_batch(const PathsView& paths, double K, std::span<double> out) const {
+    check_batch(paths, out, "DigitalPutPayoff::compute_batch");
+    check_strike(K);
+    terminal_kernel(terminal_column(paths), paths.path_size, paths.n_paths, out, [K](double S){return (S < K) ? 1.0 : 0.0;});
+}
+
+void DigitalPutPayoff::compute_features(const PathFeatures& features, double K, std::span<double> out) const {
+    check_features(features, out, "DigitalPutPayoff::compute_features");
+    check_strike(K);
+    terminal_kernel(features.terminal.data(), 1, features.size(), out, [K](double S){return (S < K) ? 1.0 : 0.0;});
+}
+
+void BarrierPayoff::compute_batch(const PathsView& paths, double K, std::span<double> out) const {
+    if (mon_ == Continuous) {
+        Payoff::compute_batch(paths, K, out);
+        return;
+    }
+    check_batch(paths, out, "BarrierPayoff::compute_batch");
+
+    payoff_->compute_batch(paths, K, out);
+
+    // the extreme spot of each row is reduced without early exit, which
+    // vectorizes, then compared once to the barrier
+    const size_t m = paths.path_size;
+    const bool pay_if_touched = (nat_ == In);
+
+    for (size_t p = 0; p < paths.n_paths; p++) {
+        const double* row = paths.spot.data() + p * m;
+        bool touched;
+        if (dir_ == Up) {
+            double hi = row[0];
+            #pragma omp simd reduction(max:hi)
+            for (size_t k = 1; k < m; k++) hi = std::max(hi, row[k]);
+            touched = hi >= barr_;
+        }
+        else {
+            double lo = row[0];
+            #pragma omp simd reduction(min:lo)
+            for (size_t k = 1; k < m; k++) lo = std::min(lo, row[k]);
+            touched = lo <= barr_;
+        }
+        if (touched != pay_if_touched) out[p] = 0.0;
+    }
+}
+
+void BarrierPayoff::compute_features(const PathFeatures& features, double K, std::span<double> out) const {
+    if (!uses_features())
+        throw std::invalid_argument("BarrierPayoff::compute_features : continuously monitored barriers need the whole path");
+    check_features(features, out, "BarrierPayoff::compute_features");
+
+    payoff_->compute_features(features, K, out);
+
+    const bool pay_if_touched = (nat_ == In);
+    const std::vector<double>& extreme = (dir_ == Up) ? features.max : features.min;
+    for (size_t p = 0; p < features.size(); p++) {
+        const bool touched = (dir_ == Up) ? (extreme[p] >= barr_) : (extreme[p] <= barr_);
+        if (touched != pay_if_touched) out[p] = 0.0;
+    }
+}
@@ -1,12 +1,22 @@
 
 #include "pricing/pricer.h"
+#include "engine/chunks.hpp"
 #include "engine/montecarlo.hpp"
 #include "instruments/instrument.h"
+#include "instruments/instrumenttable.hpp"
 #include "types/marketstate.h"
+#include "types/pathfeatures.hpp"
 #include "types/simulationresult.hpp"
+#include "types/timegrid.hpp"
+#include <algorithm>
 #include <cmath>
+#include <exception>
+#include <map>
 #include <memory>
+#include <numeric>
+#include <optional>
 #include <random>
+#include <span>
 #include <stdexcept>
 #include <unordered_map>
 
@@ -24,23 +34,81 @@ Pricer::Pricer(const MarketState& marketstate,
 {
 }
 
-double Pricer::compute_price(std::shared_ptr<Instrument> instrument) const {
-
-    double T = instrument->get_maturity();
-
+size_t Pricer::pricing_steps(bool path_dependent) const {
+    if (!path_dependent && generator_->get_scheme().exact()) return 1;
+    return n_steps_;
+}
 
-    double payoff;
+std::vector<double> Pricer::expected_payoffs(MonteCarlo& generator, double S0, std::optional<double> v0, double T, size_t n_steps, 
+                                             const std::vector<std::shared_ptr<Instrument>>& instruments) const {
+
+    const TimeGrid grid = TimeGrid::uniform(T, n_steps);
+
+    // with a cache, runs are stored so that a repeated pricing reuses them :
+    // accumulators and knocked out paths are not kept, so they are skipped
+    const bool cached = generator.get_cache() != nullptr;
+
+    // a batch of payoffs that only read the terminal and extreme spots is
+    // evaluated from features extracted once per path
+    const bool features = (instruments.size() > 1 || cached) &&
+        std::all_of(instruments.begin(), instruments.end(), [](const auto& in){return in->uses_features();});
+    if (features) {
+        PathFeatures f = generator.generate_features(S0, grid, n_paths_, v0);
+        std::vector<double> values(f.size());
+        std::vector<double> payoffs(instruments.size());
+        for (size_t i = 0; i < instruments.size(); i++) {
+            instruments[i]->compute_features(f, values);
+            payoffs[i] = std::accumulate(values.begin(), values.end(), 0.0) / static_cast<double>(n_paths_);
+        }
+        return payoffs;
+    }
 
-    if (!v0_.has_value()) {
-        SimulationResult res = generator_->generate_spot(S0_,  n_steps_, T, n_paths_);
-        payoff = instrument->compute_payoff(res);
+    std::vector<std::unique_ptr<PayoffAccumulator>> accumulators;
+    accumulators.reserve(instruments.size());
+    for (const auto& in : instruments) {
+        std::unique_ptr<PayoffAccumulator> acc = in->accumulator();
+        if (!acc) break;
+        accumulators.push_back(std::move(acc));
+    }
+    if (!cached && accumulators.size() == instruments.size()) 
+        return generator.accumulate(S0, grid, n_paths_, accumulators, v0);
+
+    // payoffs evaluated by chunks never see the whole simulation : each chunk
+    // is simulated in the background while the previous one is evaluated
+    size_t chunk_paths = 0;
+    for (const auto& in : instruments) chunk_paths = std::max(chunk_paths, in->chunk_paths());
+    if (chunk_paths > 0) {
+        ChunkedGenerator chunks(generator, S0, grid, n_paths_, chunk_paths, v0);
+        std::vector<double> payoffs(instruments.size(), 0.0);
+        while (std::optional<SimulationResult> block = chunks.next()) {
+            const double weight = static_cast<double>(block->get_npaths()) / static_cast<double>(n_paths_);
+            for (size_t i = 0; i < instruments.size(); i++) payoffs[i] += instruments[i]->compute_payoff(*block) * weight;
+        }
+        generator.skip_paths(n_paths_);
+        return payoffs;
     }
 
-    if (v0_.has_value()) {
-        SimulationResult res = generator_->generate_spot(S0_,  n_steps_, T, n_paths_, v0_.value());
-        payoff = instrument->compute_payoff(res);
+    // paths can only be stopped early if all the instruments share the knock-out
+    std::optional<KnockCondition> knock = instruments[0]->knock_out();
+    for (const auto& in : instruments){
+        if (in->knock_out() != knock) knock = std::nullopt;
     }
 
+    SimulationResult res = knock.has_value() && !cached
+        ? generator.generate_monitored(S0, grid, n_paths_, knock.value(), v0)
+        : generator.generate_spot(S0, grid, n_paths_, v0);
+
+    std::vector<double> payoffs(instruments.size());
+    for (size_t i = 0; i < instruments.size(); i++) payoffs[i] = instruments[i]->compute_payoff(res);
+    return payoffs;
+}
+
+double Pricer::compute_price(std::shared_ptr<Instrument> instrument) const {
+
+    double T = instrument->get_maturity();
+    size_t n_steps = pricing_steps(instrument->path_dependent());
+
+    double payoff = expected_payoffs(*generator_, S0_, v0_, T, n_steps, {instrument})[0];
 
     return payoff * std::exp(-r_*T);
 
@@ -68,22 +136,142 @@ std::vector<double> Pricer::batch_price(std::vector<std::shared_ptr<Instrument>>
     std::vector<double> prices(n_instruments);
     double T = instruments[0]->get_maturity();
 
+    bool path_dependent = false;
     for (auto in : instruments){
         if (in->get_maturity() != T) throw std::invalid_argument("Error : can only batch price instruments with the same maturity");
+        path_dependent = path_dependent || in->path_dependent();
+    }
+    size_t n_steps = pricing_steps(path_dependent);
+
+    std::vector<double> payoffs = expected_payoffs(*generator_, S0_, v0_, T, n_steps, instruments);
+
+    for (size_t i = 0; i < n_instruments; i ++) {
+        prices[i] = payoffs[i] *std::exp(-r_ * T);
+
     }
 
-    SimulationResult res = v0_.has_value() ? generator_->generate_spot(S0_,  n_steps_, T, n_paths_, v0_.value())
-        : generator_->generate_spot(S0_,  n_steps_, T, n_paths_);
+    return prices;
+
+}
 
+std::vector<double> Pricer::ladder_price(const std::vector<double>& barriers, Direction direction, Nature nature,
+                                         const Payoff& payoff, const OptionContract& contract) const {
 
+    if (barriers.empty()) throw std::invalid_argument("Pricer::ladder_price : barrier list is empty");
+    if (!payoff.uses_features()) 
+        throw std::invalid_argument("Pricer::ladder_price : the payoff can not be computed from the path features");
 
-    for (size_t i = 0; i < n_instruments; i ++) {
-        prices[i] = instruments[i]->compute_payoff(res) *std::exp(-r_ * T);
+    const double T = contract.T;
+    const PathFeatures f = generator_->generate_features(S0_, TimeGrid::uniform(T, n_steps_), n_paths_, v0_);
+    const size_t n = f.size();
 
+    std::vector<double> values(n);
+    payoff.compute_features(f, contract.K, values);
+
+    // paths sorted by their extreme spot : the paths that touch a barrier
+    // form a prefix (down) or a suffix (up) of the order
+    const std::vector<double>& extreme = (direction == Up) ? f.max : f.min;
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b){return extreme[a] < extreme[b];});
+
+    std::vector<double> sorted_extreme(n);
+    std::vector<double> prefix(n + 1, 0.0);
+    for (size_t i = 0; i < n; i++) {
+        sorted_extreme[i] = extreme[order[i]];
+        prefix[i+1] = prefix[i] + values[order[i]];
+    }
+
+    const double discount = std::exp(-r_ * T);
+    std::vector<double> prices(barriers.size());
+
+    for (size_t j = 0; j < barriers.size(); j++) {
+        const double H = barriers[j];
+        double touched;
+        if (direction == Up) {
+            // max >= H
+            const size_t first = std::lower_bound(sorted_extreme.begin(), sorted_extreme.end(), H) - sorted_extreme.begin();
+            touched = prefix[n] - prefix[first];
+        }
+        else {
+            // min <= H
+            const size_t last = std::upper_bound(sorted_extreme.begin(), sorted_extreme.end(), H) - sorted_extreme.begin();
+            touched = prefix[last];
+        }
+        const double paid = (nature == In) ? touched : prefix[n] - touched;
+        prices[j] = paid / static_cast<double>(n) * discount;
     }
 
     return prices;
+}
+
+TablePrices Pricer::price_table(const InstrumentTable& table) const {
+
+    table.validate();
+
+    const size_t n_rows = table.size();
+    std::map<double, std::vector<size_t>> maturities;
+    for (size_t i = 0; i < n_rows; i++) maturities[table.T[i]].push_back(i);
+
+    std::vector<std::shared_ptr<Payoff>> payoffs(n_rows);
+    for (size_t i = 0; i < n_rows; i++) payoffs[i] = table.make_payoff(i);
+
+    TablePrices prices{std::vector<double>(n_rows), std::vector<double>(n_rows)};
+
+    for (const auto& [T, rows] : maturities) {
+
+        bool path_dependent = false;
+        for (size_t i : rows) path_dependent = path_dependent || table.has_barrier(i);
+
+        const PathFeatures f = generator_->generate_features(S0_, TimeGrid::uniform(T, pricing_steps(path_dependent)), n_paths_, v0_);
+        const size_t n = f.size();
+        const double discount = std::exp(-r_ * T);
+        std::exception_ptr eptr = nullptr;
+
+        #pragma omp parallel num_threads(generator_->get_n_jobs())
+        {
+            std::vector<double> values;
+            try {
+                values.resize(n);
+            }
+            catch(...) {
+                #pragma omp critical 
+                {
+                    if (!eptr) eptr = std::current_exception();
+                }
+            }
+
+            #pragma omp for schedule(dynamic)
+            for (size_t j = 0; j < rows.size(); j++) {
+                if (values.size() != n) continue;
+                try {
+                    const size_t i = rows[j];
+                    payoffs[i]->compute_features(f, table.K[i], values);
+
+                    double sum = 0.0, sum_sq = 0.0;
+                    #pragma omp simd reduction(+:sum, sum_sq)
+                    for (size_t p = 0; p < n; p++) {
+                        sum += values[p];
+                        sum_sq += values[p] * values[p];
+                    }
+                    const double mean = sum / static_cast<double>(n);
+                    const double variance = (n > 1) ? std::max(sum_sq - sum * mean, 0.0) / static_cast<double>(n - 1) : 0.0;
+
+                    prices.price[i] = mean * discount;
+                    prices.std_error[i] = std::sqrt(variance / static_cast<double>(n)) * discount;
+                }
+                catch(...) {
+                    #pragma omp critical 
+                    {
+                        if (!eptr) eptr = std::current_exception();
+                    }
+                }
+            }
+        }
+        if (eptr) std::rethrow_exception(eptr);
+    }
 
+    return prices;
 }
 
 double Pricer::compute_delta_bar(std::shared_ptr<Instrument> instrument, double h) const {
@@ -94,15 +282,14 @@ double Pricer::compute_delta_bar(std::shared_ptr<Instrument> instrument, double
     double S0_p = S0_ + h;
     double S0_m = S0_ - h;
     double T = instrument->get_maturity();
+    size_t n_steps = pricing_steps(instrument->path_dependent());
 
     MonteCarlo local_generator = *generator_; //to avoid changing the user's rng state
 
     local_generator.reset_rng();
-    SimulationResult res_p = local_generator.generate_spot(S0_p,  n_steps_, T, n_paths_);
+    double payoff_p = expected_payoffs(local_generator, S0_p, v0_, T, n_steps, {instrument})[0];
     local_generator.reset_rng();
-    SimulationResult res_m = local_generator.generate_spot(S0_m,  n_steps_, T, n_paths_);
-    double payoff_p = instrument->compute_payoff(res_p);
-    double payoff_m = instrument->compute_payoff(res_m);
+    double payoff_m = expected_payoffs(local_generator, S0_m, v0_, T, n_steps, {instrument})[0];
     double price_p = payoff_p * std::exp(-r_*T);
     double price_m = payoff_m * std::exp(-r_*T);
 
@@ -119,22 +306,238 @@ double Pricer::compute_gamma_bar(std::shared_ptr<Instrument> instrument, double
     double S0_m = S0_ - h;
     double r = r_;
     double T = instrument->get_maturity();
+    size_t n_steps = pricing_steps(instrument->path_dependent());
 
     MonteCarlo local_generator = *generator_; //to avoid changing the user's rng state
 
     local_generator.reset_rng();
-    SimulationResult res_p = local_generator.generate_spot(S0_p,  n_steps_, T, n_paths_);
+    double payoff_p = expected_payoffs(local_generator, S0_p, v0_, T, n_steps, {instrument})[0];
     local_generator.reset_rng();
-    SimulationResult res_m = local_generator.generate_spot(S0_m,  n_steps_, T, n_paths_);
+    double payoff_m = expected_payoffs(local_generator, S0_m, v0_, T, n_steps, {instrument})[0];
     local_generator.reset_rng();
-    SimulationResult res = local_generator.generate_spot(S0,  n_steps_, T, n_paths_);
-    double payoff_p = instrument->compute_payoff(res_p);
-    double payoff_m = instrument->compute_payoff(res_m);
-    double payoff = instrument->compute_payoff(res);
+    double payoff = expected_payoffs(local_generator, S0, v0_, T, n_steps, {instrument})[0];
     double price_p = payoff_p * std::exp(-r*T);
     double price_m = payoff_m * std::exp(-r*T);
     double price = payoff *std::exp(-r*T);
 
     return (price_p - 2*price + price_m)/(h*h);
 
-};
\ No newline at end of file
+};
+std::vector<std::vector<double>> Pricer::scenario_prices(const std::vector<MarketState>& scenarios,
+                                                         const std::vector<std::shared_ptr<Instrument>>& instruments) const {
+
+    if (scenarios.empty()) throw std::invalid_argument("Pricer::scenario_prices : scenario list is empty");
+    if (instruments.empty()) throw std::invalid_argument("Pricer::scenario_prices : instrument list is empty");
+    for (const MarketState& scenario : scenarios) {
+        if (!(scenario.spot() > 0)) throw std::invalid_argument("Pricer::scenario_prices : the spots must be positive");
+    }
+
+    std::map<double, std::vector<size_t>> maturities;
+    for (size_t i = 0; i < instruments.size(); i++) maturities[instruments[i]->get_maturity()].push_back(i);
+
+    // scenarios that only differ by their rate share their payoffs
+    std::map<std::optional<double>, std::map<double, std::vector<size_t>>> states;
+    for (size_t k = 0; k < scenarios.size(); k++) states[scenarios[k].vol()][scenarios[k].spot()].push_back(k);
+
+    // payoffs evaluated by chunks, such as Python functions, are not called
+    // from the threads of the rescaled paths
+    const bool chunked = std::any_of(instruments.begin(), instruments.end(), [](const auto& in){return in->chunk_paths() > 0;});
+    const bool homogeneous = generator_->get_scheme().spot_homogeneous() && !chunked;
+    MonteCarlo local_generator = *generator_; //to avoid changing the user's rng state
+
+    std::vector<std::vector<double>> prices(scenarios.size(), std::vector<double>(instruments.size()));
+
+    for (const auto& [T, members] : maturities) {
+
+        std::vector<std::shared_ptr<Instrument>> book;
+        bool path_dependent = false;
+        for (size_t i : members) {
+            book.push_back(instruments[i]);
+            path_dependent = path_dependent || instruments[i]->path_dependent();
+        }
+        const size_t n_steps = pricing_steps(path_dependent);
+
+        for (const auto& [v0, by_spot] : states) {
+
+            std::vector<double> spots;
+            for (const auto& entry : by_spot) spots.push_back(entry.first);
+
+            std::vector<std::vector<double>> payoffs;
+            if (homogeneous) payoffs = rescaled_payoffs(local_generator, spots, v0, T, n_steps, book);
+            else {
+                for (double S0 : spots) {
+                    local_generator.reset_rng();
+                    payoffs.push_back(expected_payoffs(local_generator, S0, v0, T, n_steps, book));
+                }
+            }
+
+            size_t j = 0;
+            for (const auto& entry : by_spot) {
+                for (size_t k : entry.second) {
+                    const double discount = std::exp(-scenarios[k].rf_rate() * T);
+                    for (size_t m = 0; m < members.size(); m++) prices[k][members[m]] = payoffs[j][m] * discount;
+                }
+                j++;
+            }
+        }
+    }
+
+    return prices;
+}
+
+std::vector<std::vector<double>> Pricer::rescaled_payoffs(MonteCarlo& generator, const std::vector<double>& spots,
+                                                          std::optional<double> v0, double T, size_t n_steps,
+                                                          const std::vector<std::shared_ptr<Instrument>>& instruments) const {
+
+    const TimeGrid grid = TimeGrid::uniform(T, n_steps);
+    const size_t n_spots = spots.size();
+    const size_t n_inst = instruments.size();
+    const double reference = spots[0];
+    std::vector<std::vector<double>> payoffs(n_spots, std::vector<double>(n_inst, 0.0));
+    std::exception_ptr eptr = nullptr;
+
+    generator.reset_rng();
+
+    // the features of a path scale with its spot
+    const bool features = std::all_of(instruments.begin(), instruments.end(), [](const auto& in){return in->uses_features();});
+    if (features) {
+        const PathFeatures f = generator.generate_features(reference, grid, n_paths_, v0);
+        const size_t n = f.size();
+
+        #pragma omp parallel num_threads(generator.get_n_jobs())
+        {
+            PathFeatures scaled(n);
+            std::vector<double> values(n);
+
+            #pragma omp for schedule(dynamic)
+            for (size_t j = 0; j < n_spots; j++) {
+                try {
+                    const double c = spots[j] / reference;
+                    for (size_t p = 0; p < n; p++) {
+                        scaled.terminal[p] = c * f.terminal[p];
+                        scaled.max[p] = c * f.max[p];
+                        scaled.min[p] = c * f.min[p];
+                        scaled.average[p] = c * f.average[p];
+                    }
+                    for (size_t i = 0; i < n_inst; i++) {
+                        instruments[i]->compute_features(scaled, values);
+                        payoffs[j][i] = std::accumulate(values.begin(), values.end(), 0.0) / static_cast<double>(n_paths_);
+                    }
+                }
+                catch(...) {
+                    #pragma omp critical 
+                    {
+                        if (!eptr) eptr = std::current_exception();
+                    }
+                }
+            }
+        }
+        if (eptr) std::rethrow_exception(eptr);
+        return payoffs;
+    }
+
+    // stored paths are rescaled by blocks, so that each thread only holds
+    // one block per spot. Blocks are summed in order : the result does not
+    // depend on the number of threads
+    const SimulationResult res = generator.generate_spot(reference, grid, n_paths_, v0);
+    const size_t n_cols = res.get_path_size();
+    const bool with_vol = res.has_vol();
+    const std::shared_ptr<const std::vector<double>> times =
+        res.has_times() ? std::make_shared<const std::vector<double>>(res.get_times()) : nullptr;
+
+    constexpr size_t block_size = 1024;
+    const size_t n_blocks = (n_paths_ + block_size - 1) / block_size;
+    std::vector<double> block_sums(n_blocks * n_spots * n_inst, 0.0);
+
+    #pragma omp parallel num_threads(generator.get_n_jobs())
+    {
+        std::vector<double> spot(block_size * n_cols);
+        std::vector<double> vol(with_vol ? block_size * n_cols : 0);
+        auto scaled = std::make_shared<std::vector<double>>(block_size * n_cols);
+
+        #pragma omp for schedule(dynamic)
+        for (size_t b = 0; b < n_blocks; b++) {
+            try {
+                const size_t first = b * block_size;
+                const size_t count = std::min(block_size, n_paths_ - first);
+                const std::span<double> block_spot(spot.data(), count * n_cols);
+                const std::span<double> block_vol(vol.data(), with_vol ? count * n_cols : 0);
+                res.copy_paths(first, count, block_spot, block_vol);
+
+                for (size_t j = 0; j < n_spots; j++) {
+                    const double c = spots[j] / reference;
+                    for (size_t k = 0; k < count * n_cols; k++) (*scaled)[k] = c * block_spot[k];
+
+                    // the volatility does not depend on the spot
+                    const SimulationResult block(scaled, std::span<const double>(scaled->data(), count * n_cols), block_vol,
+                                                 res.get_seed(), res.get_nsteps(), count, times, res.get_observed_steps());
+                    double* sums = &block_sums[(b * n_spots + j) * n_inst];
+                    for (size_t i = 0; i < n_inst; i++) sums[i] = instruments[i]->compute_payoff(block) * static_cast<double>(count);
+                }
+            }
+            catch(...) {
+                #pragma omp critical 
+                {
+                    if (!eptr) eptr = std::current_exception();
+                }
+            }
+        }
+    }
+    if (eptr) std::rethrow_exception(eptr);
+
+    for (size_t b = 0; b < n_blocks; b++) {
+        for (size_t j = 0; j < n_spots; j++) {
+            for (size_t i = 0; i < n_inst; i++) payoffs[j][i] += block_sums[(b * n_spots + j) * n_inst + i];
+        }
+    }
+    for (auto& row : payoffs) {
+        for (double& payoff : row) payoff /= static_cast<double>(n_paths_);
+    }
+    return payoffs;
+}
+
+std::vector<std::vector<double>> Pricer::parameter_prices(const std::vector<std::shared_ptr<Scheme>>& schemes,
+                                                          const std::vector<std::shared_ptr<Instrument>>& instruments) const {
+
+    if (schemes.empty()) throw std::invalid_argument("Pricer::parameter_prices : scheme list is empty");
+    if (instruments.empty()) throw std::invalid_argument("Pricer::parameter_prices : instrument list is empty");
+    for (const auto& scheme : schemes) {
+        if (!scheme) throw std::invalid_argument("Pricer::parameter_prices : null scheme");
+    }
+
+    std::map<double, std::vector<size_t>> maturities;
+    for (size_t i = 0; i < instruments.size(); i++) maturities[instruments[i]->get_maturity()].push_back(i);
+
+    const bool exact = std::all_of(schemes.begin(), schemes.end(), [](const auto& s){return s->exact();});
+    std::vector<std::vector<double>> prices(schemes.size(), std::vector<double>(instruments.size()));
+
+    for (const auto& [T, members] : maturities) {
+
+        bool path_dependent = false;
+        std::vector<std::unique_ptr<PayoffAccumulator>> accumulators;
+        for (size_t i : members) {
+            path_dependent = path_dependent || instruments[i]->path_dependent();
+            if (std::unique_ptr<PayoffAccumulator> acc = instruments[i]->accumulator()) accumulators.push_back(std::move(acc));
+        }
+        const TimeGrid grid = TimeGrid::uniform(T, exact && !path_dependent ? 1 : n_steps_);
+        const double discount = std::exp(-r_ * T);
+
+        // payoffs without accumulator are computed on the stored paths
+        std::vector<std::vector<double>> payoffs;
+        if (accumulators.size() == members.size())
+            payoffs = generator_->accumulate_batch(schemes, S0_, grid, n_paths_, accumulators, v0_);
+        else {
+            std::vector<SimulationResult> results = generator_->generate_batch(schemes, S0_, grid, n_paths_, v0_);
+            for (const SimulationResult& res : results) {
+                std::vector<double>& row = payoffs.emplace_back();
+                for (size_t i : members) row.push_back(instruments[i]->compute_payoff(res));
+            }
+        }
+
+        for (size_t k = 0; k < schemes.size(); k++) {
+            for (size_t m = 0; m < members.size(); m++) prices[k][members[m]] = payoffs[k][m] * discount;
+        }
+    }
+
+    return prices;
+}
@@ -1,7 +1,12 @@
 #include "schemes/euler.h"
 #include "models/model.hpp"
 #include "types/state.hpp"
+#include <cmath>
+#include <random>
+#include <span>
+#include <stdexcept>
 #include <utility>
+#include <vector>
 
 
 
@@ -11,16 +16,49 @@ std::pair<double, double> Euler::init_state(double S0, std::optional<double> v0)
     else return std::pair<double, double>(S0, model_->volatility(0, S0)); 
 }
 
-std::pair<double, double> Euler::step(const double S, const double v,int i, float dt, std::mt19937& rng) const {
+std::shared_ptr<Scheme> Euler::prepare(const std::vector<double>& times) const {
+    std::shared_ptr<Model> prepared = model_->prepare(times);
+    if (!prepared) return nullptr;
+    return std::make_shared<Euler>(prepared);
+}
+
+std::pair<double, double> Euler::step(const double S, const double v, double t, double dt, std::mt19937& rng) const {
     if (dt <= 0) throw std::invalid_argument("Euler::step : dt must be stricltly positive");
 
     std::normal_distribution<double> dist;
     double Z = dist(rng);
-    double t = i * dt;
-    double vt = model_->volatility(t,S);
-    double St = S + model_->drift(t, S) * dt + model_->diffusion(t,S) *Z * std::sqrt(dt);
+    return step_from(S, v, t, dt, std::span<const double>(&Z, 1));
+}
+
+std::pair<double, double> Euler::step_from(const double S, const double v, double t, double dt, std::span<const double> z) const {
+    (void)v;
+    if (dt <= 0) throw std::invalid_argument("Euler::step_from : dt must be stricltly positive");
+
+    const double Z = z[0];
+    const Coefficients c = model_->coefficients(t, S);
+    double vt = c.volatility;
+    double St = S + c.drift * dt + c.diffusion *Z * std::sqrt(dt);
 
     return std::pair<double, double>(St, vt);
 
 
-}
\ No newline at end of file
+}
+
+void Euler::step_block(std::span<double> S, std::span<double> v, double t, double dt, std::span<const double> z) const {
+    if (dt <= 0) throw std::invalid_argument("Euler::step_block : dt must be stricltly positive");
+    if (v.size() != S.size() || z.size() != S.size())
+        throw std::invalid_argument("Euler::step_block : the states and the normals do not match");
+
+    // coefficients of the block, reused by the steps of the thread
+    thread_local std::vector<double> drift, diffusion, vol;
+    drift.resize(S.size());
+    diffusion.resize(S.size());
+    vol.resize(S.size());
+    model_->coefficients_batch(t, S, drift, diffusion, vol);
+
+    const double sqrt_dt = std::sqrt(dt);
+    for (size_t i = 0; i < S.size(); i++) {
+        S[i] = S[i] + drift[i] * dt + diffusion[i] * z[i] * sqrt_dt;
+        v[i] = vol[i];
+    }
+}
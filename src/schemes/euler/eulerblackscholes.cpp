@@ -0,0 +1,99 @@
+#include "schemes/eulerblackscholes.hpp"
+#include "models/black_scholes/black_scholes.hpp"
+#include "types/state.hpp"
+
+#include <cmath>
+#include <memory>
+#include <optional>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+
+
+namespace {
+
+// drift and volatility of each scheme of a batch, one array per parameter
+class EulerBlackScholesBatch : public SchemeBatch {
+
+public:
+    explicit EulerBlackScholesBatch(size_t n) {
+        mu_.reserve(n);
+        sigma_.reserve(n);
+    }
+
+    void add(const BlackScholes& model) {
+        mu_.push_back(model.mu);
+        sigma_.push_back(model.sigma);
+    }
+
+    void step(std::span<double> S, std::span<double> v, double t, double dt, std::span<const double> z) const override {
+        (void)t;
+        if (dt <= 0) throw std::invalid_argument("EulerBlackScholes::batch : dt must be strictly positive");
+
+        const double sqrt_dt = std::sqrt(dt);
+        const double Z = z[0];
+        for (size_t k = 0; k < mu_.size(); k++) {
+            const double sigma = sigma_[k];
+            S[k] = S[k] * std::exp((mu_[k] - 0.5*sigma*sigma) * dt + sigma * sqrt_dt * Z);
+            v[k] = sigma;
+        }
+    }
+
+    size_t size() const override {return mu_.size();}
+
+private:
+    // the single precision parameters of the model, as read by step_from
+    std::vector<double> mu_;
+    std::vector<double> sigma_;
+
+};
+
+}
+
+
+std::pair<double, double> EulerBlackScholes::init_state(double S0, std::optional<double> v0) const {
+    if (v0.has_value()) return std::pair<double, double>(S0, v0.value());
+    else return std::pair<double, double>(S0, model.sigma);
+}
+
+std::pair<double, double> EulerBlackScholes::step(const double S, 
+                                                  const double v, 
+                                                  double t, 
+                                                  double dt, 
+                                                  std::mt19937& rng) const {
+
+    if (dt <= 0) throw std::invalid_argument("EulerBlackScholes::step : dt must be stricltly positive");
+
+    std::normal_distribution<double> dist;
+    double Z = dist(rng);
+    return step_from(S, v, t, dt, std::span<const double>(&Z, 1));
+}
+
+std::pair<double, double> EulerBlackScholes::step_from(const double S, 
+                                                       const double v, 
+                                                       double t, 
+                                                       double dt, 
+                                                       std::span<const double> z) const {
+
+    (void)v; (void)t;
+    if (dt <= 0) throw std::invalid_argument("EulerBlackScholes::step_from : dt must be stricltly positive");
+
+    const double Z = z[0];
+    const double sigma = model.sigma;
+    double St = S * std::exp((model.mu - 0.5*sigma*sigma) * dt + sigma * std::sqrt(dt) * Z);
+
+    return std::pair<double, double>(St, sigma);
+}
+
+std::unique_ptr<SchemeBatch> EulerBlackScholes::batch(std::span<const Scheme* const> schemes) const {
+    auto kernel = std::make_unique<EulerBlackScholesBatch>(schemes.size());
+    for (const Scheme* scheme : schemes) {
+        const EulerBlackScholes* euler = dynamic_cast<const EulerBlackScholes*>(scheme);
+        if (!euler) return nullptr;
+        kernel->add(euler->model);
+    }
+    return kernel;
+}
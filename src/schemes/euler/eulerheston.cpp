@@ -4,15 +4,72 @@
 #include "types/state.hpp"
 
 
+#include <memory>
 #include <optional>
 #include <random>
+#include <span>
 #include <cmath>
 #include <stdexcept>
 #include <algorithm> 
 #include <utility>
+#include <vector>
 
 
 
+namespace {
+
+// parameters of each scheme of a batch, one array per parameter
+class EulerHestonBatch : public SchemeBatch {
+
+public:
+    explicit EulerHestonBatch(size_t n) {
+        for (std::vector<float>* param : {&mu_, &kappa_, &theta_, &epsilon_, &rho_}) param->reserve(n);
+    }
+
+    void add(const Heston& model) {
+        mu_.push_back(model.mu);
+        kappa_.push_back(model.kappa);
+        theta_.push_back(model.theta);
+        epsilon_.push_back(model.epsilon);
+        rho_.push_back(model.rho);
+    }
+
+    // same arithmetic as EulerHeston::step_from, on each scheme
+    void step(std::span<double> S, std::span<double> v, double t, double dt, std::span<const double> z) const override {
+        (void)t;
+        if (dt <= 0) throw std::invalid_argument("EulerHeston::batch : dt must be strictly positive");
+
+        const double sqrt_dt = std::sqrt(dt);
+        const double Z = z[0];
+        const double Z_v = z[1];
+        for (size_t k = 0; k < mu_.size(); k++) {
+            const double V = v[k]*v[k];
+            const double Z_s = rho_[k] * Z_v + std::sqrt(1-rho_[k]*rho_[k])*Z;
+            const double v_plus = std::max(V, 0.0);
+            const double sqrt_v = std::sqrt(v_plus);
+
+            const double Vt = V + kappa_[k] * (theta_[k] - v_plus) * dt + epsilon_[k]*sqrt_v * Z_v * sqrt_dt;
+            const double logSt = std::log(S[k]) + (mu_[k] - 0.5*v_plus) * dt + sqrt_v * sqrt_dt * Z_s;
+
+            S[k] = std::exp(logSt);
+            v[k] = std::sqrt(std::max(Vt, 0.0));
+        }
+    }
+
+    size_t size() const override {return mu_.size();}
+
+private:
+    std::vector<float> mu_;
+    std::vector<float> kappa_;
+    std::vector<float> theta_;
+    std::vector<float> epsilon_;
+    std::vector<float> rho_;
+
+};
+
+}
+
+
 std::pair<double, double> EulerHeston::init_state(double S0, std::optional<double> v0) const {
     
     if (!v0.has_value()) throw std::invalid_argument("EulerHeston::init_state : intial state must receive a value for initial variance");
@@ -25,20 +82,33 @@ std::pair<double, double> EulerHeston::init_state(double S0, std::optional<doubl
 
 std::pair<double, double> EulerHeston::step(const double S,
                             const double v, 
-                            int i,
-                            float dt, 
+                            double t,
+                            double dt, 
                             std::mt19937& rng) const 
                         
 {
 
     if (dt <= 0) throw std::invalid_argument("EulerHeston::step : dt must be stricltly positive");
-    double logS = std::log(S);    
-    double V = (v*v);
 
     std::normal_distribution<double> dist;
 
-    double Z = dist(rng);
-    double Z_v = dist(rng);
+    const double z[2] = {dist(rng), dist(rng)};
+    return step_from(S, v, t, dt, z);
+}
+
+std::pair<double, double> EulerHeston::step_from(const double S,
+                            const double v, 
+                            double t,
+                            double dt, 
+                            std::span<const double> z) const 
+{
+    (void)t;
+    if (dt <= 0) throw std::invalid_argument("EulerHeston::step_from : dt must be stricltly positive");
+    double logS = std::log(S);    
+    double V = (v*v);
+
+    double Z = z[0];
+    double Z_v = z[1];
     double Z_s = model.rho * Z_v + std::sqrt(1-model.rho*model.rho)*Z;
 
     const double v_plus = std::max(V, 0.0);
@@ -53,4 +123,14 @@ std::pair<double, double> EulerHeston::step(const double S,
 
 
     return std::pair<double, double>(std::exp(logSt), std::sqrt(std::max(Vt, 0.0)));
-}
\ No newline at end of file
+}
+
+std::unique_ptr<SchemeBatch> EulerHeston::batch(std::span<const Scheme* const> schemes) const {
+    auto kernel = std::make_unique<EulerHestonBatch>(schemes.size());
+    for (const Scheme* scheme : schemes) {
+        const EulerHeston* euler = dynamic_cast<const EulerHeston*>(scheme);
+        if (!euler) return nullptr;
+        kernel->add(euler->model);
+    }
+    return kernel;
+}
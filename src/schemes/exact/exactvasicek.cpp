@@ -0,0 +1,49 @@
+#include "schemes/exactvasicek.hpp"
+#include "models/ir_models/vasicek.h"
+#include "types/state.hpp"
+
+#include <cmath>
+#include <optional>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+
+
+std::pair<double, double> ExactVasicek::init_state(double r0, std::optional<double> v0) const {
+    if (v0.has_value()) return std::pair<double, double>(r0, v0.value());
+    else return std::pair<double, double>(r0, model.sigma());
+}
+
+std::pair<double, double> ExactVasicek::step(const double r, 
+                                             const double v, 
+                                             double t, 
+                                             double dt, 
+                                             std::mt19937& rng) const {
+
+    if (dt <= 0) throw std::invalid_argument("ExactVasicek::step : dt must be stricltly positive");
+
+    std::normal_distribution<double> dist;
+    double Z = dist(rng);
+    return step_from(r, v, t, dt, std::span<const double>(&Z, 1));
+}
+
+std::pair<double, double> ExactVasicek::step_from(const double r, 
+                                                  const double v, 
+                                                  double t, 
+                                                  double dt, 
+                                                  std::span<const double> z) const {
+
+    (void)v; (void)t;
+    if (dt <= 0) throw std::invalid_argument("ExactVasicek::step_from : dt must be stricltly positive");
+
+    const double Z = z[0];
+    const double a = model.a();
+    const double decay = std::exp(-a * dt);
+    const double std_dev = model.sigma() * std::sqrt(-std::expm1(-2.0 * a * dt) / (2.0 * a));
+
+    double rt = r * decay + model.b() * (1.0 - decay) + std_dev * Z;
+
+    return std::pair<double, double>(rt, model.sigma());
+}
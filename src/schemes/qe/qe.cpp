@@ -2,15 +2,144 @@
 
 #include "models/heston/heston.hpp"
 #include "types/state.hpp"
+#include <algorithm>
 #include <optional>
 #include <random>
+#include <span>
 #include <cmath>
+#include <memory>
 #include <stdexcept>
 #include <utility>
+#include <vector>
+#include <sstream>
+#include <string>
 
 
 
 
+namespace {
+
+// The steps read the parameters in the single precision of Heston, the
+// helpers take them as floats so that a batch of schemes steps exactly as
+// each scheme alone
+
+// conditional mean and psi ratio of the variance at the end of a step
+std::pair<double, double> variance_moments(float kappa, float theta, float epsilon, double V, double dt) {
+
+    double exp_sp = std::exp(-kappa * dt);
+
+    double E_X = theta + (V- theta) * exp_sp;
+
+    double VAR_X1 = (V * 
+                    (epsilon*epsilon) * exp_sp) *
+                    (1-exp_sp)
+                    /kappa;
+
+    double VAR_X2 = ((theta * epsilon * epsilon) *
+                    (1-exp_sp) * 
+                    (1-exp_sp))
+                    /(2*kappa);
+
+    double VAR_X = VAR_X1 + VAR_X2;
+
+    double psi = VAR_X/(E_X*E_X);
+    return std::pair<double, double>(E_X, psi);
+}
+
+float inv_psi(float u, float p, float beta) {
+
+    if (u<=p) return 0;
+    else return (1/beta)*std::log((1-p)/(1-u));
+
+}
+
+// variance at the end of a step in each regime, from its uniform or normal
+double exponential_variance(double E_X, double psi, double u) {
+
+    double p = (psi-1)/(psi+1);
+    double beta = (1-p)/E_X;
+    return inv_psi(u, p, beta);
+}
+
+double quadratic_variance(double E_X, double psi, double zq) {
+
+    double dpsi = 2.0f/psi;
+    double b_2 = dpsi - 1 + std::sqrt(dpsi*(dpsi-1));
+    double a = E_X/(1+b_2);
+
+    double sqrt_b2 = std::sqrt(b_2);
+    return a * (zq + sqrt_b2) * (zq + sqrt_b2);
+}
+
+// variance at the end of a step from the variance normal, see QE::step_from
+double next_variance(float kappa, float theta, float epsilon, float psi_threshold, double V, double dt, double zv) {
+
+    const std::pair<double, double> moments = variance_moments(kappa, theta, epsilon, V, dt);
+
+    // the variance normal is mapped to a uniform in the exponential regime,
+    // kept below 1 in single precision
+    if (moments.second > psi_threshold) {
+        const double u = std::min(0.5 * std::erfc(-zv / std::sqrt(2.0)), 1.0 - 1e-7);
+        return exponential_variance(moments.first, moments.second, u);
+    }
+    return quadratic_variance(moments.first, moments.second, zv);
+}
+
+// log-spot at the end of a step, given the variance at both ends
+double next_log_spot(float mu, float kappa, float theta, float epsilon, float rho,
+                     double S, double V, double V_next, double dt, double Z) {
+
+    double V_int = 0.5 * (V + V_next);
+    return std::log(S) + 
+           mu * dt - 
+           0.5 * V_int * dt + 
+           (rho / epsilon) *
+           (V_next - V - kappa*(theta - V_int)*dt) +
+           std::sqrt((1-rho*rho)*V_int*dt)*Z;
+}
+
+// parameters of each scheme of a batch, one array per parameter
+class QEBatch : public SchemeBatch {
+
+public:
+    explicit QEBatch(size_t n) {
+        for (std::vector<float>* param : {&mu_, &kappa_, &theta_, &epsilon_, &rho_, &psi_threshold_}) param->reserve(n);
+    }
+
+    void add(const Heston& model, float psi_threshold) {
+        mu_.push_back(model.mu);
+        kappa_.push_back(model.kappa);
+        theta_.push_back(model.theta);
+        epsilon_.push_back(model.epsilon);
+        rho_.push_back(model.rho);
+        psi_threshold_.push_back(psi_threshold);
+    }
+
+    void step(std::span<double> S, std::span<double> v, double t, double dt, std::span<const double> z) const override {
+        (void)t;
+        for (size_t k = 0; k < mu_.size(); k++) {
+            const double V = v[k]*v[k];
+            const double V_next = next_variance(kappa_[k], theta_[k], epsilon_[k], psi_threshold_[k], V, dt, z[1]);
+            S[k] = std::exp(next_log_spot(mu_[k], kappa_[k], theta_[k], epsilon_[k], rho_[k], S[k], V, V_next, dt, z[0]));
+            v[k] = std::sqrt(V_next);
+        }
+    }
+
+    size_t size() const override {return mu_.size();}
+
+private:
+    std::vector<float> mu_;
+    std::vector<float> kappa_;
+    std::vector<float> theta_;
+    std::vector<float> epsilon_;
+    std::vector<float> rho_;
+    std::vector<float> psi_threshold_;
+
+};
+
+}
+
+
 QE::QE(const Heston& model, float psi_threshold) :
     model_(model),
     psi_threshold_(psi_threshold)
@@ -33,80 +162,60 @@ std::pair<double, double> QE::init_state(double S0, std::optional<double> v0) co
 
 
 std::pair<double, double> QE::step(const double S, double v, 
-                        int i, 
-                        float dt, 
+                        double t, 
+                        double dt, 
                         std::mt19937& rng) const 
 {
 
     std::normal_distribution<double> N;
     std::uniform_real_distribution<double> U(0.0f, 1.0f);
 
-    
     double V = v*v;
-    double exp_sp = std::exp(-model_.kappa * dt);
-
-    double E_X = model_.theta + (V- model_.theta) * exp_sp;
-
-    double VAR_X1 = (V * 
-                    (model_.epsilon*model_.epsilon) * exp_sp) *
-                    (1-exp_sp)
-                    /model_.kappa;
-
-    double VAR_X2 = ((model_.theta * model_.epsilon * model_.epsilon) *
-                    (1-exp_sp) * 
-                    (1-exp_sp))
-                    /(2*model_.kappa);
-
-    double VAR_X = VAR_X1 + VAR_X2;
-
-    double psi = VAR_X/(E_X*E_X);
+    const std::pair<double, double> moments = variance_moments(model_.kappa, model_.theta, model_.epsilon, V, dt);
     double u = U(rng);
-    double logSt;
-    double V_next;
     double Z = N(rng);
 
-    if (psi > psi_threshold_) { //exp regime
-        
-        double p = (psi-1)/(psi+1);
-        double beta = (1-p)/E_X;
-        V_next = inv_psi(u, p, beta);
-        double V_int = 0.5 * (V+V_next);
-
-        logSt = std::log(S) + 
-                model_.mu * dt - 
-                0.5 * V_int * dt + 
-                (model_.rho / model_.epsilon) *
-                (V_next - V - model_.kappa*(model_.theta - V_int)*dt) +
-                std::sqrt((1-model_.rho*model_.rho)*V_int*dt)*Z;
+    // the quadratic regime draws its normal after the one of the spot
+    double V_next = moments.second > psi_threshold_
+        ? exponential_variance(moments.first, moments.second, u)
+        : quadratic_variance(moments.first, moments.second, N(rng));
 
-    }
-
-    else { //quadratic regime 
-
-        double zq = N(rng);
-        double dpsi = 2.0f/psi;
-        double b_2 = dpsi - 1 + std::sqrt(dpsi*(dpsi-1));
-        double a = E_X/(1+b_2);
+    double logSt = next_log_spot(model_.mu, model_.kappa, model_.theta, model_.epsilon, model_.rho, S, V, V_next, dt, Z);
+    return std::pair<double, double>(std::exp(logSt), std::sqrt(V_next));
+};
 
-        double sqrt_b2 = std::sqrt(b_2);
-        V_next = a * (zq + sqrt_b2) * (zq + sqrt_b2);
-        double V_int = 0.5 * (V + V_next);
-        logSt = std::log(S) + 
-                model_.mu * dt - 
-                0.5 * V_int * dt + 
-                (model_.rho / model_.epsilon) *
-                (V_next - V - model_.kappa*(model_.theta - V_int)*dt) +
-                std::sqrt((1.0f-model_.rho*model_.rho)*V_int*dt)*Z;
+std::pair<double, double> QE::step_from(const double S, double v, 
+                                        double t, 
+                                        double dt, 
+                                        std::span<const double> z) const 
+{
 
-               
-    }
+    (void)t;
+    double V = v*v;
+    double V_next = next_variance(model_.kappa, model_.theta, model_.epsilon, psi_threshold_, V, dt, z[1]);
 
+    double logSt = next_log_spot(model_.mu, model_.kappa, model_.theta, model_.epsilon, model_.rho, S, V, V_next, dt, z[0]);
     return std::pair<double, double>(std::exp(logSt), std::sqrt(V_next));
 };
 
-float QE::inv_psi(float u, float p, float beta) const{
+std::unique_ptr<SchemeBatch> QE::batch(std::span<const Scheme* const> schemes) const {
+    auto kernel = std::make_unique<QEBatch>(schemes.size());
+    for (const Scheme* scheme : schemes) {
+        const QE* qe = dynamic_cast<const QE*>(scheme);
+        if (!qe) return nullptr;
+        kernel->add(qe->model_, qe->psi_threshold_);
+    }
+    return kernel;
+}
 
-    if (u<=p) return 0;
-    else return (1/beta)*std::log((1-p)/(1-u));
+std::string QE::describe() const {
+    std::ostringstream out;
+    out << "QE(psi_c=" << psi_threshold_ << ")[" << model_.describe() << "]";
+    return out.str();
+}
 
-};
\ No newline at end of file
+std::optional<std::vector<double>> QE::parameters() const {
+    std::vector<double> params = model_.parameters();
+    params.push_back(psi_threshold_);
+    return params;
+}
@@ -0,0 +1,76 @@
+#include "surface/grid_axis.hpp"
+#include <algorithm>
+#include <cmath>
+
+
+// relative tolerance used to decide that the node spacing is constant
+static constexpr double spacing_tol = 1e-10;
+
+static bool constant_steps(const std::vector<double>& x){
+    const double step = x[1] - x[0];
+    if (!(step > 0)) return false;
+    for (size_t i = 2; i < x.size(); i++){
+        if (std::abs((x[i] - x[i-1]) - step) > spacing_tol * step) return false;
+    }
+    return true;
+}
+
+GridAxis::GridAxis(std::vector<double> nodes) : nodes_(std::move(nodes))
+{
+    if (nodes_.size() < 2) return;
+
+    if (constant_steps(nodes_)){
+        spacing_ = Spacing::Uniform;
+        origin_ = nodes_.front();
+        inv_step_ = 1.0 / (nodes_[1] - nodes_[0]);
+        return;
+    }
+
+    if (nodes_.front() > 0){
+        std::vector<double> log_nodes(nodes_.size());
+        std::transform(nodes_.begin(), nodes_.end(), log_nodes.begin(), [](double x){return std::log(x);});
+        if (constant_steps(log_nodes)){
+            spacing_ = Spacing::LogUniform;
+            origin_ = log_nodes.front();
+            inv_step_ = 1.0 / (log_nodes[1] - log_nodes[0]);
+        }
+    }
+}
+
+size_t GridAxis::lower_index(double x) const {
+
+    const size_t n = nodes_.size();
+
+    if (x <= nodes_.front()) return 0;
+    if (x >= nodes_.back()) return n-2;
+
+    if (spacing_ == Spacing::Irregular){
+        auto it = std::lower_bound(nodes_.begin(), nodes_.end(), x);
+        return static_cast<size_t>(std::distance(nodes_.begin(), it)-1);
+    }
+
+    const double u = (spacing_ == Spacing::Uniform) ? x : std::log(x);
+    const double guess = std::floor((u - origin_) * inv_step_);
+    const double last = static_cast<double>(n-2);
+    size_t i = (guess > 0) ? static_cast<size_t>(std::min(guess, last)) : 0;
+
+    // the guess can be off by one cell because of rounding : step it to the
+    // cell satisfying x_i < x <= x_i+1, which is the lower_bound convention
+    while (i > 0 && nodes_[i] >= x) i--;
+    while (i + 2 < n && nodes_[i+1] < x) i++;
+
+    return i;
+}
+
+GridAxis::Cell GridAxis::locate(double x) const {
+
+    double x_clamped = std::clamp(x, nodes_.front(), nodes_.back());
+    size_t low_idx = lower_index(x_clamped);
+
+    double x0 = nodes_[low_idx];
+    double x1 = nodes_[low_idx+1];
+
+    double w = (x1 == x0) ? 0.0 : (x_clamped - x0) / (x1 - x0);
+
+    return Cell{low_idx, std::clamp(w, 0.0, 1.0)};
+}
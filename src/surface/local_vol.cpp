@@ -1,17 +1,24 @@
 #include "surface/local_vol.hpp"
 #include <algorithm>
+#include <cmath>
 #include <stdexcept>
 
+
+// tolerance used to match a time against a slicing time, as a fraction of
+// the gaps to the neighbouring slicing times
+static constexpr double slice_time_tol = 1e-3;
+
+
 LocalVolatilitySurface::LocalVolatilitySurface(std::vector<double> times,
                            std::vector<double> spots,
                            std::vector<double> sigma):
 
-                           times_(times),
-                           spots_(spots),
-                           loc_vol_(sigma) 
+                           times_(std::move(times)),
+                           spots_(std::make_shared<const GridAxis>(std::move(spots))),
+                           loc_vol_(std::move(sigma))
 {
     size_t nt = times_.size();
-    size_t nS = spots_.size();
+    size_t nS = spots_->size();
 
     if (nt<2 || nS < 2)
         throw std::invalid_argument("LocalVolatilitySurface constructor : at least two points are required to build a local volatility surface");
@@ -20,59 +27,136 @@ LocalVolatilitySurface::LocalVolatilitySurface(std::vector<double> times,
         throw std::invalid_argument("LocalVolatilitySurface constructor : the local volatility vector has wrong dimension for inputs S and t.");
 };
 
-size_t get_l_bound_index(const std::vector<double>& vec, double val){
 
-    if (val <= vec.front()) return 0;
-    if (val >= vec.back()) return vec.size()-2;
+double LocalVolatilitySurface::blend(const GridAxis::Cell& t_cell, const GridAxis::Cell& S_cell) const {
 
-    auto it = std::lower_bound(vec.begin(), vec.end(), val);
+    const size_t nS = spots_->size();
+    const double wt = t_cell.w;
+    const double wS = S_cell.w;
 
-    return static_cast<size_t>(std::distance(vec.begin(), it)-1);
+    auto at = [&](size_t ii, size_t jj) {
+        return loc_vol_[ii * nS + jj]; // row-major par temps
+    };
 
-};
+    const double v00 = at(t_cell.idx,  S_cell.idx);
+    const double v01 = at(t_cell.idx,   S_cell.idx+1);
+    const double v10 = at(t_cell.idx+1, S_cell.idx);
+    const double v11 = at(t_cell.idx+1, S_cell.idx+1);
+
+    const double v0 = (1.0 - wS) * v00 + wS * v01;
+    const double v1 = (1.0 - wS) * v10 + wS * v11;
+    return (1.0 - wt) * v0 + wt * v1;
+}
 
 double LocalVolatilitySurface::sigma(double t, double S) const{
 
+    return blend(times_.locate(t), spots_->locate(S));
 
-    size_t nS = spots_.size();
-    size_t nt = times_.size();
- 
-    double S_clamped = std::clamp(S, spots_.front(), spots_.back());
-    double t_clamped = std::clamp(t, times_.front(), times_.back());
+};
 
-    size_t low_S_idx = get_l_bound_index(spots_, S_clamped);
-    size_t low_t_idx = get_l_bound_index(times_, t_clamped);
+void LocalVolatilitySurface::sigma_batch(double t, std::span<const double> S, std::span<double> out) const {
 
-    low_S_idx = std::min(low_S_idx, nS -2);
-    low_t_idx = std::min(low_t_idx, nt -2);
+    if (S.size() != out.size())
+        throw std::invalid_argument("LocalVolatilitySurface::sigma_batch : output buffer size does not match the number of spots");
 
-    double S0 = spots_[low_S_idx];
-    double t0 = times_[low_t_idx];
-    
-    double S1 = spots_[low_S_idx+1];
-    double t1 = times_[low_t_idx+1];
-    
-    double wt = (t1 == t0) ? 0.0 : (t_clamped - t0) / (t1 - t0);
-    double wS = (S1 == S0) ? 0.0 : (S_clamped- S0) / (S1 - S0);
+    const GridAxis::Cell t_cell = times_.locate(t);
 
-    wt = std::clamp(wt, 0.0, 1.0);
-    wS = std::clamp(wS, 0.0, 1.0);
+    for (size_t i = 0; i < S.size(); i++){
+        out[i] = blend(t_cell, spots_->locate(S[i]));
+    }
+}
 
-    auto at = [&](size_t ii, size_t jj) {
-        return loc_vol_[ii * nS + jj]; // row-major par temps
-    };
+LocalVolatilitySlice LocalVolatilitySurface::slice(double t) const {
 
-    const double v00 = at(low_t_idx,  low_S_idx);
-    const double v01 = at(low_t_idx,   low_S_idx+1);
-    const double v10 = at(low_t_idx+1, low_S_idx);
-    const double v11 = at(low_t_idx+1, low_S_idx+1);
+    const size_t nS = spots_->size();
+    const GridAxis::Cell t_cell = times_.locate(t);
+    const double wt = t_cell.w;
 
-    const double v0 = (1.0 - wS) * v00 + wS * v01;
-    const double v1 = (1.0 - wS) * v10 + wS * v11;
-    double sigma = (1.0 - wt) * v0 + wt * v1;
+    const double* v0 = loc_vol_.data() + t_cell.idx * nS;
+    const double* v1 = v0 + nS;
 
-    return sigma;
+    std::vector<double> values(nS);
+    for (size_t j = 0; j < nS; j++){
+        values[j] = (1.0 - wt) * v0[j] + wt * v1[j];
+    }
+
+    return LocalVolatilitySlice(spots_, std::move(values));
+}
+
+LocalVolatilityTimeSlices LocalVolatilitySurface::slices(const std::vector<double>& times) const {
+
+    if (times.size() < 2)
+        throw std::invalid_argument("LocalVolatilitySurface::slices : at least two times are required");
+    if (!std::is_sorted(times.begin(), times.end()))
+        throw std::invalid_argument("LocalVolatilitySurface::slices : times must be sorted in increasing order");
+
+    const size_t n = times.size();
+    std::vector<std::vector<double>> values(n);
+
+    #pragma omp parallel for
+    for (size_t k = 0; k < n; k++){
+        values[k] = slice(times[k]).values();
+    }
+
+    std::vector<LocalVolatilitySlice> slices;
+    slices.reserve(n);
+    for (size_t k = 0; k < n; k++){
+        slices.emplace_back(spots_, std::move(values[k]));
+    }
+
+    return LocalVolatilityTimeSlices(times, std::move(slices));
+}
 
-};
 
+LocalVolatilitySlice::LocalVolatilitySlice(std::shared_ptr<const GridAxis> spots, std::vector<double> values) :
+    spots_(std::move(spots)),
+    values_(std::move(values))
+{
+    if (values_.size() != spots_->size())
+        throw std::invalid_argument("LocalVolatilitySlice constructor : the number of values does not match the spot grid");
+}
+
+double LocalVolatilitySlice::sigma(double S) const {
+
+    const GridAxis::Cell cell = spots_->locate(S);
+    return (1.0 - cell.w) * values_[cell.idx] + cell.w * values_[cell.idx+1];
+}
+
+void LocalVolatilitySlice::sigma_batch(std::span<const double> S, std::span<double> out) const {
 
+    if (S.size() != out.size())
+        throw std::invalid_argument("LocalVolatilitySlice::sigma_batch : output buffer size does not match the number of spots");
+
+    for (size_t i = 0; i < S.size(); i++){
+        const GridAxis::Cell cell = spots_->locate(S[i]);
+        out[i] = (1.0 - cell.w) * values_[cell.idx] + cell.w * values_[cell.idx+1];
+    }
+}
+
+
+LocalVolatilityTimeSlices::LocalVolatilityTimeSlices(std::vector<double> times, std::vector<LocalVolatilitySlice> slices) :
+    times_(std::move(times)),
+    slices_(std::move(slices))
+{
+    if (times_.size() != slices_.size())
+        throw std::invalid_argument("LocalVolatilityTimeSlices constructor : one slice is required per time");
+    if (times_.size() < 2)
+        throw std::invalid_argument("LocalVolatilityTimeSlices constructor : at least two times are required");
+
+    const size_t n = times_.size();
+    tolerance_.resize(n);
+    for (size_t k = 0; k < n; k++) {
+        const double before = k > 0 ? times_[k] - times_[k-1] : times_[k+1] - times_[k];
+        const double after = k + 1 < n ? times_[k+1] - times_[k] : before;
+        tolerance_[k] = slice_time_tol * std::min(before, after);
+    }
+}
+
+const LocalVolatilitySlice* LocalVolatilityTimeSlices::find(double t) const {
+
+    const GridAxis::Cell cell = times_.locate(t);
+    const size_t k = (cell.w < 0.5) ? cell.idx : cell.idx + 1;
+
+    if (!(std::abs(times_[k] - t) <= tolerance_[k])) return nullptr;
+    return &slices_[k];
+}
@@ -0,0 +1,436 @@
+#include "types/archive.hpp"
+#include "types/simulationresult.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+static constexpr const char* archive_format = "volmc-archive";
+static constexpr int archive_version = 1;
+
+// the data of every array starts at a multiple of this offset
+static constexpr size_t npy_alignment = 64;
+
+
+// whole file mapping, read-only for an existing file, read-write for a
+// created one
+class MappedFile {
+
+public:
+    explicit MappedFile(const std::string& file){
+#ifdef _WIN32
+        file_ = ::CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) throw std::invalid_argument("SimulationArchive : unable to open " + file);
+        LARGE_INTEGER size;
+        if (!::GetFileSizeEx(file_, &size) || size.QuadPart == 0) {
+            ::CloseHandle(file_);
+            throw std::invalid_argument("SimulationArchive : unable to read " + file);
+        }
+        size_ = static_cast<size_t>(size.QuadPart);
+        map(file, false);
+#else
+        fd_ = ::open(file.c_str(), O_RDONLY);
+        if (fd_ < 0) throw std::invalid_argument("SimulationArchive : unable to open " + file);
+        struct stat st;
+        if (::fstat(fd_, &st) != 0 || st.st_size == 0) {
+            ::close(fd_);
+            throw std::invalid_argument("SimulationArchive : unable to read " + file);
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        map(file, PROT_READ);
+#endif
+    }
+
+    MappedFile(const std::string& file, size_t size){
+        size_ = size;
+#ifdef _WIN32
+        file_ = ::CreateFileA(file.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) throw std::invalid_argument("ArchiveWriter : unable to create " + file);
+        // the mapping of a created file extends it to size
+        map(file, true);
+#else
+        fd_ = ::open(file.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0) throw std::invalid_argument("ArchiveWriter : unable to create " + file);
+        if (::ftruncate(fd_, static_cast<off_t>(size_)) != 0) {
+            ::close(fd_);
+            throw std::invalid_argument("ArchiveWriter : unable to allocate " + file);
+        }
+        map(file, PROT_READ | PROT_WRITE);
+#endif
+    }
+
+    ~MappedFile(){
+#ifdef _WIN32
+        ::UnmapViewOfFile(base_);
+        ::CloseHandle(mapping_);
+        ::CloseHandle(file_);
+#else
+        ::munmap(base_, size_);
+        ::close(fd_);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    char* data() const {return static_cast<char*>(base_);}
+    size_t size() const {return size_;}
+
+    void sync() const {
+#ifdef _WIN32
+        const bool synced = ::FlushViewOfFile(base_, size_) && ::FlushFileBuffers(file_);
+#else
+        const bool synced = ::msync(base_, size_, MS_SYNC) == 0;
+#endif
+        if (!synced) throw std::runtime_error("ArchiveWriter : unable to flush the mapped values to the disk");
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+    void* base_ = nullptr;
+    size_t size_ = 0;
+
+#ifdef _WIN32
+    void map(const std::string& file, bool writable){
+        const unsigned long long size = size_;
+        mapping_ = ::CreateFileMappingA(file_, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY,
+                                        static_cast<DWORD>(size >> 32), static_cast<DWORD>(size & 0xffffffffULL), nullptr);
+        if (mapping_ != nullptr) base_ = ::MapViewOfFile(mapping_, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size_);
+        if (base_ == nullptr) {
+            if (mapping_ != nullptr) ::CloseHandle(mapping_);
+            ::CloseHandle(file_);
+            throw std::runtime_error("SimulationArchive : unable to map " + file);
+        }
+    }
+#else
+    void map(const std::string& file, int protection){
+        base_ = ::mmap(nullptr, size_, protection, MAP_SHARED, fd_, 0);
+        if (base_ == MAP_FAILED) {
+            ::close(fd_);
+            throw std::runtime_error("SimulationArchive : unable to map " + file);
+        }
+    }
+#endif
+};
+
+struct ArchiveWriter::Mapping : MappedFile {
+    using MappedFile::MappedFile;
+    size_t offset = 0;
+};
+
+
+// npy v1.0 header, padded so that the data starts on the alignment
+static std::string npy_header(const std::string& descr, bool fortran_order, const std::vector<size_t>& shape){
+    std::string dict = "{'descr': '" + descr + "', 'fortran_order': " + (fortran_order ? "True" : "False") + ", 'shape': (";
+    for (size_t i = 0; i < shape.size(); i++) {
+        dict += std::to_string(shape[i]);
+        if (shape.size() == 1 || i + 1 < shape.size()) dict += ",";
+        if (i + 1 < shape.size()) dict += " ";
+    }
+    dict += "), }";
+
+    // magic, version and length take 10 bytes, the dict ends with a newline
+    const size_t total = (10 + dict.size() + 1 + npy_alignment - 1) / npy_alignment * npy_alignment;
+    dict.append(total - 10 - dict.size() - 1, ' ');
+    dict += '\n';
+
+    const uint16_t len = static_cast<uint16_t>(dict.size());
+    std::string header("\x93NUMPY\x01\x00", 8);
+    header += static_cast<char>(len & 0xff);
+    header += static_cast<char>(len >> 8);
+    return header + dict;
+}
+
+struct NpyArray {
+    std::string descr;
+    bool fortran_order;
+    std::vector<size_t> shape;
+    size_t offset;
+};
+
+// reads the description of an array from the beginning of its file
+static NpyArray parse_npy(const char* data, size_t size, const std::string& file){
+    auto fail = [&file]() -> NpyArray {throw std::invalid_argument("SimulationArchive : " + file + " is not a valid npy file");};
+    if (size < 10 || std::memcmp(data, "\x93NUMPY", 6) != 0) return fail();
+
+    const unsigned char major = static_cast<unsigned char>(data[6]);
+    size_t len, start;
+    if (major == 1) {
+        len = static_cast<unsigned char>(data[8]) | (static_cast<size_t>(static_cast<unsigned char>(data[9])) << 8);
+        start = 10;
+    }
+    else if (major == 2 || major == 3) {
+        if (size < 12) return fail();
+        len = 0;
+        for (int b = 3; b >= 0; b--) len = (len << 8) | static_cast<unsigned char>(data[8 + b]);
+        start = 12;
+    }
+    else return fail();
+    if (start + len > size) return fail();
+
+    const std::string dict(data + start, len);
+    auto value = [&](const std::string& key) -> std::string {
+        const size_t k = dict.find("'" + key + "'");
+        if (k == std::string::npos) fail();
+        size_t v = dict.find(':', k);
+        if (v == std::string::npos) fail();
+        v++;
+        while (v < dict.size() && dict[v] == ' ') v++;
+        return dict.substr(v);
+    };
+
+    NpyArray array;
+    const std::string descr = value("descr");
+    if (descr.empty() || descr[0] != '\'') return fail();
+    array.descr = descr.substr(1, descr.find('\'', 1) - 1);
+
+    array.fortran_order = value("fortran_order").rfind("True", 0) == 0;
+
+    const std::string shape = value("shape");
+    if (shape.empty() || shape[0] != '(') return fail();
+    std::istringstream dims(shape.substr(1, shape.find(')') - 1));
+    std::string dim;
+    while (std::getline(dims, dim, ',')) {
+        dim.erase(std::remove(dim.begin(), dim.end(), ' '), dim.end());
+        if (!dim.empty()) array.shape.push_back(std::stoull(dim));
+    }
+
+    array.offset = start + len;
+    return array;
+}
+
+static void check_little_endian(){
+    if constexpr (std::endian::native != std::endian::little)
+        throw std::runtime_error("SimulationArchive : archives are only supported on little endian platforms");
+}
+
+// writes a small one dimensional array
+template <class T>
+static void write_npy(const std::string& file, const std::string& descr, const std::vector<T>& values){
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::invalid_argument("ArchiveWriter : unable to create " + file);
+    const std::string header = npy_header(descr, false, {values.size()});
+    out.write(header.data(), static_cast<std::streamsize>(header.size()));
+    out.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+    if (!out) throw std::runtime_error("ArchiveWriter : unable to write " + file);
+}
+
+// reads a small one dimensional array
+template <class T>
+static std::vector<T> read_npy(const std::string& file, const std::string& descr){
+    MappedFile mapped(file);
+    const NpyArray array = parse_npy(mapped.data(), mapped.size(), file);
+    if (array.descr != descr || array.shape.size() != 1)
+        throw std::invalid_argument("SimulationArchive : " + file + " must be a one dimensional " + descr + " array");
+    if (array.offset + array.shape[0] * sizeof(T) > mapped.size())
+        throw std::invalid_argument("SimulationArchive : " + file + " is truncated");
+    std::vector<T> values(array.shape[0]);
+    std::memcpy(values.data(), mapped.data() + array.offset, values.size() * sizeof(T));
+    return values;
+}
+
+std::unique_ptr<ArchiveWriter::Mapping> ArchiveWriter::create_values(const std::string& file, size_t n_paths, size_t n_cols, Layout layout){
+    const std::string header = npy_header("<f8", layout == TimeMajor, {n_paths, n_cols});
+    auto mapping = std::make_unique<Mapping>(file, header.size() + n_paths * n_cols * sizeof(double));
+    std::memcpy(mapping->data(), header.data(), header.size());
+    mapping->offset = header.size();
+    return mapping;
+}
+
+
+ArchiveWriter::ArchiveWriter(const std::string& path, size_t n_paths, size_t n_cols, Layout layout, bool with_vol):
+    path_(path),
+    n_paths_(n_paths),
+    n_cols_(n_cols),
+    layout_(layout)
+{
+    check_little_endian();
+    if (n_cols == 0) throw std::invalid_argument("ArchiveWriter : at least one column must be stored");
+    std::filesystem::create_directories(path_);
+    // a previous header is removed first, the archive is incomplete until
+    // finish writes the new one
+    std::filesystem::remove(std::filesystem::path(path_) / "header.txt");
+
+    const std::filesystem::path dir(path_);
+    spot_ = create_values((dir / "spot.npy").string(), n_paths, n_cols, layout);
+    if (with_vol) vol_ = create_values((dir / "vol.npy").string(), n_paths, n_cols, layout);
+    else std::filesystem::remove(dir / "vol.npy");
+}
+
+ArchiveWriter::~ArchiveWriter() = default;
+
+double* ArchiveWriter::spot(){
+    return reinterpret_cast<double*>(spot_->data() + spot_->offset);
+}
+
+double* ArchiveWriter::vol(){
+    return vol_ ? reinterpret_cast<double*>(vol_->data() + vol_->offset) : nullptr;
+}
+
+void ArchiveWriter::finish(size_t seed, size_t n_steps, const std::vector<double>& times, const std::vector<size_t>& observed,
+                           const std::string& description,
+                           const std::optional<KnockCondition>& knock,
+                           const std::vector<unsigned char>* knocked){
+
+    if (finished_) throw std::logic_error("ArchiveWriter::finish : the archive is already complete");
+    if (observed.size() != n_cols_) throw std::invalid_argument("ArchiveWriter::finish : one observed step per stored column is required");
+    if (!times.empty() && times.size() != n_cols_) throw std::invalid_argument("ArchiveWriter::finish : one time per stored column is required");
+    if (knock.has_value() && (!knocked || knocked->size() != n_paths_))
+        throw std::invalid_argument("ArchiveWriter::finish : one knock-out flag per path is required");
+
+    const std::filesystem::path dir(path_);
+
+    spot_->sync();
+    if (vol_) vol_->sync();
+
+    if (!times.empty()) write_npy((dir / "times.npy").string(), "<f8", times);
+    else std::filesystem::remove(dir / "times.npy");
+
+    write_npy((dir / "observed.npy").string(), "<u8", std::vector<uint64_t>(observed.begin(), observed.end()));
+
+    if (knock.has_value()) write_npy((dir / "knocked.npy").string(), "|u1", *knocked);
+    else std::filesystem::remove(dir / "knocked.npy");
+
+    // the header is written last, its presence marks a complete archive
+    std::string text = description;
+    std::replace(text.begin(), text.end(), '\n', ' ');
+
+    std::ofstream out(dir / "header.txt", std::ios::trunc);
+    if (!out) throw std::invalid_argument("ArchiveWriter::finish : unable to create the header of " + path_);
+    out.precision(17);
+    out << "format=" << archive_format << "\n"
+        << "version=" << archive_version << "\n"
+        << "seed=" << seed << "\n"
+        << "n_steps=" << n_steps << "\n"
+        << "n_paths=" << n_paths_ << "\n"
+        << "n_cols=" << n_cols_ << "\n"
+        << "layout=" << (layout_ == PathMajor ? "path" : "time") << "\n"
+        << "precision=float64\n"
+        << "vol=" << (vol_ ? 1 : 0) << "\n"
+        << "description=" << text << "\n";
+    if (knock.has_value()) {
+        out << "knock_barrier=" << knock->barrier << "\n"
+            << "knock_direction=" << (knock->direction == Up ? "up" : "down") << "\n";
+    }
+    if (!out) throw std::runtime_error("ArchiveWriter::finish : unable to write the header of " + path_);
+    finished_ = true;
+}
+
+
+void SimulationArchive::save(const SimulationResult& simulation, const std::string& path, const std::string& description){
+
+    const size_t n_paths = simulation.get_npaths();
+    const size_t n_cols = simulation.get_path_size();
+
+    ArchiveWriter writer(path, n_paths, n_cols, simulation.get_layout(), simulation.has_vol());
+    std::span<const double> spots = simulation.spots();
+    std::copy(spots.begin(), spots.end(), writer.spot());
+    if (simulation.has_vol()) {
+        std::span<const double> vols = simulation.vols();
+        std::copy(vols.begin(), vols.end(), writer.vol());
+    }
+
+    const std::vector<double> times = simulation.has_times() ? simulation.get_times() : std::vector<double>();
+    const std::optional<KnockCondition>& knock = simulation.get_knock_out();
+    writer.finish(simulation.get_seed(), simulation.get_nsteps(), times, simulation.get_observed_steps(), description,
+                  knock, knock.has_value() ? &simulation.get_knocked() : nullptr);
+}
+
+std::map<std::string, std::string> SimulationArchive::header(const std::string& path){
+    const std::filesystem::path file = std::filesystem::path(path) / "header.txt";
+    std::ifstream in(file);
+    if (!in) throw std::invalid_argument("SimulationArchive::header : " + path + " is not a complete archive, header.txt is missing");
+
+    std::map<std::string, std::string> values;
+    std::string line;
+    while (std::getline(in, line)) {
+        const size_t eq = line.find('=');
+        if (eq == std::string::npos) continue;
+        values[line.substr(0, eq)] = line.substr(eq + 1);
+    }
+    if (values["format"] != archive_format)
+        throw std::invalid_argument("SimulationArchive::header : " + path + " is not a simulation archive");
+    return values;
+}
+
+SimulationResult SimulationArchive::load(const std::string& path){
+
+    check_little_endian();
+    std::map<std::string, std::string> head = header(path);
+    if (std::stoi(head["version"]) > archive_version)
+        throw std::invalid_argument("SimulationArchive::load : the archive was written by a newer version");
+
+    const size_t seed = std::stoull(head["seed"]);
+    const size_t n_steps = std::stoull(head["n_steps"]);
+    const size_t n_paths = std::stoull(head["n_paths"]);
+    const size_t n_cols = std::stoull(head["n_cols"]);
+    const Layout layout = head["layout"] == "time" ? TimeMajor : PathMajor;
+    const std::filesystem::path dir(path);
+
+    // the mappings are owned by the result and released with its last copy
+    struct Storage {
+        std::unique_ptr<MappedFile> spot;
+        std::unique_ptr<MappedFile> vol;
+    };
+    auto storage = std::make_shared<Storage>();
+
+    auto map_values = [&](const std::string& name, std::unique_ptr<MappedFile>& mapped) -> std::span<const double> {
+        const std::string file = (dir / name).string();
+        mapped = std::make_unique<MappedFile>(file);
+        const NpyArray array = parse_npy(mapped->data(), mapped->size(), file);
+        if (array.descr != "<f8") throw std::invalid_argument("SimulationArchive::load : " + file + " must hold float64 values");
+        if (array.shape != std::vector<size_t>{n_paths, n_cols})
+            throw std::invalid_argument("SimulationArchive::load : the shape of " + file + " does not match the header");
+        if (n_cols > 1 && n_paths > 1 && array.fortran_order != (layout == TimeMajor))
+            throw std::invalid_argument("SimulationArchive::load : the order of " + file + " does not match the layout of the header");
+        if (array.offset + n_paths * n_cols * sizeof(double) > mapped->size())
+            throw std::invalid_argument("SimulationArchive::load : " + file + " is truncated");
+        return std::span<const double>(reinterpret_cast<const double*>(mapped->data() + array.offset), n_paths * n_cols);
+    };
+
+    std::span<const double> spots = map_values("spot.npy", storage->spot);
+    std::span<const double> vols;
+    if (head["vol"] == "1") vols = map_values("vol.npy", storage->vol);
+
+    std::shared_ptr<const std::vector<double>> times;
+    if (std::filesystem::exists(dir / "times.npy"))
+        times = std::make_shared<const std::vector<double>>(read_npy<double>((dir / "times.npy").string(), "<f8"));
+
+    const std::vector<uint64_t> obs = read_npy<uint64_t>((dir / "observed.npy").string(), "<u8");
+
+    SimulationResult result(std::static_pointer_cast<const void>(storage), spots, vols, seed, n_steps, n_paths,
+                            times, std::vector<size_t>(obs.begin(), obs.end()), layout);
+
+    if (head.count("knock_barrier")) {
+        const KnockCondition knock{std::stod(head["knock_barrier"]), head["knock_direction"] == "up" ? Up : Down};
+        result.attach_knock_out(knock, read_npy<unsigned char>((dir / "knocked.npy").string(), "|u1"));
+    }
+    return result;
+}
@@ -21,4 +21,25 @@ Date::Date(int day,
             throw std::invalid_argument("Date constructor : month value is not valid");
         if (D < 1 || D > 31) 
             throw std::invalid_argument("Date constructor : day value is not valid");
-    }
\ No newline at end of file
+    }
+
+
+// number of days from 1970-01-01 to the civil date (y, m, d), proleptic
+// gregorian calendar
+static long days_from_civil(long y, long m, long d) {
+    y -= m <= 2;
+    const long era = (y >= 0 ? y : y - 399) / 400;
+    const long yoe = y - era * 400;
+    const long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+static double serial_days(const Date& date) {
+    return static_cast<double>(days_from_civil(date.Y, date.M, date.D))
+         + (date.h * 3600.0 + date.m * 60.0 + date.s) / 86400.0;
+}
+
+double year_fraction(const Date& start, const Date& end) {
+    return (serial_days(end) - serial_days(start)) / 365.0;
+}
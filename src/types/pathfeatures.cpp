@@ -0,0 +1,84 @@
+#include "types/pathfeatures.hpp"
+#include "types/simulationresult.hpp"
+#include <algorithm>
+#include <span>
+#include <vector>
+
+
+PathFeatures PathFeatures::extract(const SimulationResult& simulation){
+
+    const size_t n_paths = simulation.get_npaths();
+    const size_t m = simulation.get_path_size();
+
+    PathFeatures features(n_paths);
+
+    // features of the path-major rows [first, first + count)
+    auto reduce_rows = [&](const double* rows, size_t first, size_t count) {
+        #pragma omp parallel for
+        for (size_t i = 0; i < count; i++){
+            const double* row = rows + i * m;
+            double hi = row[0];
+            double lo = row[0];
+            double sum = 0.0;
+            #pragma omp simd reduction(max:hi) reduction(min:lo) reduction(+:sum)
+            for (size_t k = 0; k < m; k++){
+                hi = std::max(hi, row[k]);
+                lo = std::min(lo, row[k]);
+                sum += row[k];
+            }
+            features.terminal[first + i] = row[m-1];
+            features.max[first + i] = hi;
+            features.min[first + i] = lo;
+            features.average[first + i] = sum / static_cast<double>(m);
+        }
+    };
+
+    // lazy results are regenerated block by block, never materialized
+    if (simulation.is_lazy()) {
+        constexpr size_t block_size = 1024;
+        std::vector<double> block(std::min(block_size, n_paths) * m);
+        for (size_t first = 0; first < n_paths; first += block_size){
+            const size_t count = std::min(block_size, n_paths - first);
+            simulation.copy_paths(first, count, std::span<double>(block.data(), count * m));
+            reduce_rows(block.data(), first, count);
+        }
+        return features;
+    }
+
+    std::span<const double> paths = simulation.spots();
+
+    if (simulation.get_layout() == PathMajor) {
+        reduce_rows(paths.data(), 0, n_paths);
+        return features;
+    }
+
+    // time-major : the paths are swept one stored step at a time, each
+    // thread owning a contiguous range of paths
+    #pragma omp parallel
+    {
+        #pragma omp for schedule(static)
+        for (size_t p = 0; p < n_paths; p++){
+            features.max[p] = paths[p];
+            features.min[p] = paths[p];
+            features.average[p] = 0.0;
+        }
+
+        for (size_t k = 0; k < m; k++){
+            const double* col = paths.data() + k * n_paths;
+            #pragma omp for simd schedule(static)
+            for (size_t p = 0; p < n_paths; p++){
+                features.max[p] = std::max(features.max[p], col[p]);
+                features.min[p] = std::min(features.min[p], col[p]);
+                features.average[p] += col[p];
+            }
+        }
+
+        #pragma omp for schedule(static)
+        for (size_t p = 0; p < n_paths; p++){
+            features.terminal[p] = paths[(m-1) * n_paths + p];
+            features.average[p] /= static_cast<double>(m);
+        }
+    }
+
+    return features;
+}
\ No newline at end of file
@@ -1,34 +1,165 @@
 #include "types/simulationresult.hpp"
+#include <algorithm>
 #include <memory>
+#include <mutex>
+#include <numeric>
+#include <span>
 #include <stdexcept>
 
 
 
 
 SimulationResult::SimulationResult(std::shared_ptr<std::vector<double>> paths, size_t seed,
-                   size_t n_steps, size_t n_paths, std::optional<std::shared_ptr<std::vector<double>>> v_paths):
+                   size_t n_steps, size_t n_paths, std::optional<std::shared_ptr<std::vector<double>>> v_paths,
+                   std::shared_ptr<const std::vector<double>> times,
+                   std::optional<std::vector<size_t>> observed,
+                   Layout layout):
                     paths_(std::move(paths)),
+                    times_(std::move(times)),
+                    layout_(layout),
                     origin_seed_(seed),
                     n_paths_(n_paths), 
                     n_steps_(n_steps)
                     
                    
     {
-        size_t paths_size = paths_->size();
-        if (n_paths_*(n_steps_+1) != paths_size) throw std::invalid_argument("SimulationResult constructor : dimension of path vector does not match specified dimensions") ;
+        if (!paths_) throw std::invalid_argument("SimulationResult constructor : the path vector is null");
+        spots_ = std::span<const double>(*paths_);
 
-        if (v_paths.has_value()){
-            if (v_paths.value()->size() != paths_size) throw std::logic_error("SimulationResult constructor : dimension of volatility vector does not match spot vector dimension");
-            vols_ = std::move(v_paths.value());
+        if (v_paths.has_value() && v_paths.value()){
+            if (v_paths.value()->size() != paths_->size()) throw std::logic_error("SimulationResult constructor : dimension of volatility vector does not match spot vector dimension");
+            v_paths_ = std::move(v_paths.value());
+            vols_ = std::span<const double>(*v_paths_);
         }
+
+        init(std::move(observed));
+    }
+
+SimulationResult::SimulationResult(std::shared_ptr<const void> storage, std::span<const double> paths, std::span<const double> v_paths,
+                   size_t seed, size_t n_steps, size_t n_paths,
+                   std::shared_ptr<const std::vector<double>> times,
+                   std::optional<std::vector<size_t>> observed,
+                   Layout layout):
+                    storage_(std::move(storage)),
+                    spots_(paths),
+                    vols_(v_paths),
+                    times_(std::move(times)),
+                    layout_(layout),
+                    origin_seed_(seed),
+                    n_paths_(n_paths), 
+                    n_steps_(n_steps)
+    {
+        if (!vols_.empty() && vols_.size() != spots_.size()) throw std::logic_error("SimulationResult constructor : dimension of volatility vector does not match spot vector dimension");
+        init(std::move(observed));
+    }
+
+SimulationResult::SimulationResult(std::shared_ptr<const PathSource> source, size_t seed, size_t n_steps, size_t n_paths,
+                   std::shared_ptr<const std::vector<double>> times,
+                   std::optional<std::vector<size_t>> observed,
+                   Layout layout):
+                    source_(std::move(source)),
+                    materialized_(std::make_shared<Materialized>()),
+                    times_(std::move(times)),
+                    layout_(layout),
+                    origin_seed_(seed),
+                    n_paths_(n_paths), 
+                    n_steps_(n_steps)
+    {
+        if (!source_) throw std::invalid_argument("SimulationResult constructor : the path source is null");
+        init(std::move(observed));
     }
 
+void SimulationResult::init(std::optional<std::vector<size_t>> observed){
+
+        if (observed.has_value()) {
+            observed_ = std::move(observed.value());
+            if (observed_.empty()) throw std::invalid_argument("SimulationResult constructor : at least one step must be observed");
+            for (size_t j = 0; j < observed_.size(); j++){
+                if (observed_[j] > n_steps_ || (j > 0 && observed_[j] <= observed_[j-1]))
+                    throw std::invalid_argument("SimulationResult constructor : observed steps must be increasing and at most n_steps");
+            }
+        }
+        else {
+            observed_.resize(n_steps_+1);
+            std::iota(observed_.begin(), observed_.end(), 0);
+        }
+
+        if (!source_ && n_paths_*observed_.size() != spots_.size()) throw std::invalid_argument("SimulationResult constructor : dimension of path vector does not match specified dimensions") ;
+
+        if (times_ && times_->size() != observed_.size()) throw std::invalid_argument("SimulationResult constructor : the number of times does not match the number of stored columns");
+}
+
+const SimulationResult::Materialized& SimulationResult::materialize() const {
+    std::call_once(materialized_->once, [this]() {
+        const size_t m = observed_.size();
+        Materialized& all = *materialized_;
+        all.spot.resize(n_paths_ * m);
+        if (source_->has_vol()) all.vol.resize(n_paths_ * m);
+
+        if (layout_ == PathMajor) {
+            source_->fill(0, n_paths_, all.spot, all.vol);
+            return;
+        }
+        // time-major : blocks of paths are scattered one stored step at a time
+        constexpr size_t block_size = 1024;
+        std::vector<double> s_block(std::min(block_size, n_paths_) * m);
+        std::vector<double> v_block(all.vol.empty() ? 0 : s_block.size());
+        for (size_t first = 0; first < n_paths_; first += block_size) {
+            const size_t count = std::min(block_size, n_paths_ - first);
+            std::span<double> s(s_block.data(), count * m);
+            std::span<double> v = v_block.empty() ? std::span<double>() : std::span<double>(v_block.data(), count * m);
+            source_->fill(first, count, s, v);
+            for (size_t j = 0; j < m; j++) {
+                for (size_t p = 0; p < count; p++) {
+                    all.spot[j * n_paths_ + first + p] = s[p * m + j];
+                    if (!v.empty()) all.vol[j * n_paths_ + first + p] = v[p * m + j];
+                }
+            }
+        }
+    });
+    return *materialized_;
+}
+
 double SimulationResult::avg_terminal_value(){
+    std::span<const double> values = spots();
+    const size_t last = observed_.size() - 1;
     double total_count = 0;
     for (size_t p = 0; p < n_paths_; p++){
-        size_t add_idx = p*(n_steps_+1) + (n_steps_);
-        double add = (*paths_)[add_idx];
-        total_count += add;
+        total_count += values[index(p, last)];
     }
     return total_count/static_cast<double>(n_paths_);
-}
\ No newline at end of file
+}
+
+void SimulationResult::copy_paths(size_t first, size_t count, std::span<double> spot, std::span<double> vol) const {
+    const size_t m = observed_.size();
+    if (first + count > n_paths_) throw std::invalid_argument("SimulationResult::copy_paths : the block exceeds the number of paths");
+    if (spot.size() != count * m) throw std::invalid_argument("SimulationResult::copy_paths : the spot buffer does not match the block size");
+    if (!vol.empty() && vol.size() != count * m) throw std::invalid_argument("SimulationResult::copy_paths : the volatility buffer does not match the block size");
+    if (!vol.empty() && !has_vol()) throw std::invalid_argument("SimulationResult::copy_paths : no path for volatility was generated");
+
+    if (source_) {
+        source_->fill(first, count, spot, vol);
+        return;
+    }
+
+    auto copy = [&](std::span<const double> src, std::span<double> dst) {
+        if (layout_ == PathMajor) {
+            std::copy(src.begin() + first * m, src.begin() + (first + count) * m, dst.begin());
+            return;
+        }
+        // read the block one stored step at a time, each read is contiguous
+        for (size_t j = 0; j < m; j++){
+            const double* col = src.data() + j * n_paths_ + first;
+            for (size_t p = 0; p < count; p++) dst[p * m + j] = col[p];
+        }
+    };
+
+    copy(spots_, spot);
+    if (!vol.empty()) copy(vols_, vol);
+}
+
+void SimulationResult::attach_knock_out(KnockCondition knock, std::vector<unsigned char> knocked){
+    if (knocked.size() != n_paths_) throw std::invalid_argument("SimulationResult::attach_knock_out : one flag per path is required");
+    knock_ = knock;
+    knocked_ = std::make_shared<const std::vector<unsigned char>>(std::move(knocked));
+}
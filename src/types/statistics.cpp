@@ -0,0 +1,222 @@
+#include "types/statistics.hpp"
+#include "types/simulationresult.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <omp.h>
+#include <stdexcept>
+#include <string>
+#include <span>
+#include <vector>
+
+
+// ranges smaller than this are selected without spawning a task
+static constexpr size_t select_task_size = 1 << 14;
+
+static std::span<const double> field(const SimulationResult& simulation, bool vol){
+    if (simulation.get_npaths() == 0) throw std::invalid_argument("Statistics : the simulation has no path");
+    return vol ? simulation.vols() : simulation.spots();
+}
+
+static void check_column(const SimulationResult& simulation, size_t column, const char* where){
+    if (column >= simulation.get_path_size())
+        throw std::invalid_argument(std::string(where) + " : the column must be lower than the number of stored columns");
+}
+
+// places the values of the given ranks (sorted) at their sorted position in
+// x[lo, hi). The two sides of each selected rank are independent
+static void select_ranks(std::vector<double>& x, size_t lo, size_t hi,
+                         const std::vector<size_t>& ranks, size_t r_lo, size_t r_hi){
+    if (r_lo >= r_hi) return;
+
+    const size_t mid = r_lo + (r_hi - r_lo) / 2;
+    const size_t k = ranks[mid];
+    std::nth_element(x.begin() + lo, x.begin() + k, x.begin() + hi);
+
+    #pragma omp task shared(x, ranks) if (k - lo > select_task_size)
+    select_ranks(x, lo, k, ranks, r_lo, mid);
+
+    select_ranks(x, k + 1, hi, ranks, mid + 1, r_hi);
+
+    #pragma omp taskwait
+}
+
+
+StepMoments Statistics::moments(const SimulationResult& simulation, bool vol){
+
+    std::span<const double> values = field(simulation, vol);
+    const size_t n_paths = simulation.get_npaths();
+    const size_t m = simulation.get_path_size();
+    const bool path_major = simulation.get_layout() == PathMajor;
+
+    struct Partial {
+        double count = 0;
+        std::vector<double> mean;
+        std::vector<double> m2;
+    };
+    std::vector<Partial> partials;
+
+    #pragma omp parallel
+    {
+        #pragma omp single
+        partials.resize(static_cast<size_t>(omp_get_num_threads()));
+
+        const size_t t = static_cast<size_t>(omp_get_thread_num());
+        const size_t n_threads = partials.size();
+        const size_t first = n_paths * t / n_threads;
+        const size_t last = n_paths * (t + 1) / n_threads;
+
+        Partial& part = partials[t];
+        part.count = static_cast<double>(last - first);
+        part.mean.assign(m, 0.0);
+        part.m2.assign(m, 0.0);
+        double* mean = part.mean.data();
+        double* m2 = part.m2.data();
+
+        if (path_major) {
+            // one path at a time, the update is vectorized across columns
+            for (size_t p = first; p < last; p++){
+                const double k = static_cast<double>(p - first + 1);
+                const double* row = values.data() + p * m;
+                #pragma omp simd
+                for (size_t j = 0; j < m; j++){
+                    const double d = row[j] - mean[j];
+                    mean[j] += d / k;
+                    m2[j] += d * (row[j] - mean[j]);
+                }
+            }
+        }
+        else {
+            for (size_t j = 0; j < m; j++){
+                const double* col = values.data() + j * n_paths;
+                for (size_t p = first; p < last; p++){
+                    const double k = static_cast<double>(p - first + 1);
+                    const double d = col[p] - mean[j];
+                    mean[j] += d / k;
+                    m2[j] += d * (col[p] - mean[j]);
+                }
+            }
+        }
+    }
+
+    // merge of the partial moments, in thread order
+    std::vector<double> mean(m, 0.0);
+    std::vector<double> m2(m, 0.0);
+    double count = 0;
+    for (const Partial& part : partials){
+        if (part.count == 0) continue;
+        const double total = count + part.count;
+        for (size_t j = 0; j < m; j++){
+            const double delta = part.mean[j] - mean[j];
+            mean[j] += delta * part.count / total;
+            m2[j] += part.m2[j] + delta * delta * count * part.count / total;
+        }
+        count = total;
+    }
+
+    std::vector<double> variance(m, 0.0);
+    if (count > 1) {
+        for (size_t j = 0; j < m; j++) variance[j] = m2[j] / (count - 1);
+    }
+
+    return StepMoments{std::move(mean), std::move(variance)};
+}
+
+std::vector<double> Statistics::quantiles(const SimulationResult& simulation, size_t column,
+                                          const std::vector<double>& probs, bool vol){
+
+    std::span<const double> values = field(simulation, vol);
+    check_column(simulation, column, "Statistics::quantiles");
+    for (double q : probs){
+        if (!(q >= 0.0 && q <= 1.0)) throw std::invalid_argument("Statistics::quantiles : probabilities must be in [0, 1]");
+    }
+
+    const size_t n = simulation.get_npaths();
+    std::vector<double> x(n);
+
+    #pragma omp parallel for
+    for (size_t p = 0; p < n; p++) x[p] = values[simulation.index(p, column)];
+
+    // each quantile interpolates between the order statistics lo and lo+1
+    std::vector<size_t> ranks;
+    ranks.reserve(2 * probs.size());
+    for (double q : probs){
+        const size_t lo = static_cast<size_t>(std::floor(q * static_cast<double>(n - 1)));
+        ranks.push_back(lo);
+        ranks.push_back(std::min(lo + 1, n - 1));
+    }
+    std::sort(ranks.begin(), ranks.end());
+    ranks.erase(std::unique(ranks.begin(), ranks.end()), ranks.end());
+
+    #pragma omp parallel
+    {
+        #pragma omp single
+        select_ranks(x, 0, n, ranks, 0, ranks.size());
+    }
+
+    std::vector<double> out(probs.size());
+    for (size_t i = 0; i < probs.size(); i++){
+        const double h = probs[i] * static_cast<double>(n - 1);
+        const size_t lo = static_cast<size_t>(std::floor(h));
+        const size_t hi = std::min(lo + 1, n - 1);
+        out[i] = x[lo] + (h - static_cast<double>(lo)) * (x[hi] - x[lo]);
+    }
+    return out;
+}
+
+Histogram Statistics::histogram(const SimulationResult& simulation, size_t column, size_t n_bins,
+                                std::optional<std::pair<double, double>> range, bool vol){
+
+    std::span<const double> values = field(simulation, vol);
+    check_column(simulation, column, "Statistics::histogram");
+    if (n_bins == 0) throw std::invalid_argument("Statistics::histogram : at least one bin is required");
+
+    const size_t n = simulation.get_npaths();
+
+    double lo, hi;
+    if (range.has_value()) {
+        lo = range->first;
+        hi = range->second;
+        if (!(lo < hi)) throw std::invalid_argument("Statistics::histogram : the lower edge must be lower than the upper edge");
+    }
+    else {
+        lo = std::numeric_limits<double>::infinity();
+        hi = -std::numeric_limits<double>::infinity();
+        #pragma omp parallel for reduction(min:lo) reduction(max:hi)
+        for (size_t p = 0; p < n; p++){
+            const double v = values[simulation.index(p, column)];
+            lo = std::min(lo, v);
+            hi = std::max(hi, v);
+        }
+        // a constant column gets a unit wide range around its value
+        if (lo == hi) {
+            lo -= 0.5;
+            hi += 0.5;
+        }
+    }
+
+    const double width = (hi - lo) / static_cast<double>(n_bins);
+    std::vector<size_t> counts(n_bins, 0);
+
+    #pragma omp parallel
+    {
+        std::vector<size_t> local(n_bins, 0);
+
+        #pragma omp for nowait
+        for (size_t p = 0; p < n; p++){
+            const double v = values[simulation.index(p, column)];
+            if (!(v >= lo && v <= hi)) continue;
+            const size_t b = std::min(static_cast<size_t>((v - lo) / width), n_bins - 1);
+            local[b]++;
+        }
+
+        #pragma omp critical
+        for (size_t b = 0; b < n_bins; b++) counts[b] += local[b];
+    }
+
+    std::vector<double> edges(n_bins + 1);
+    for (size_t b = 0; b < n_bins; b++) edges[b] = lo + static_cast<double>(b) * width;
+    edges[n_bins] = hi;
+
+    return Histogram{std::move(edges), std::move(counts)};
+}
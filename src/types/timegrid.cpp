@@ -0,0 +1,82 @@
+#include "types/timegrid.hpp"
+#include "types/date.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+
+TimeGrid::TimeGrid(std::vector<double> times) : times_(std::move(times))
+{
+    if (times_.size() < 2)
+        throw std::invalid_argument("TimeGrid constructor : at least two times are required");
+    if (times_.front() != 0.0)
+        throw std::invalid_argument("TimeGrid constructor : the first time must be 0");
+    for (size_t k = 1; k < times_.size(); k++){
+        if (!(times_[k] > times_[k-1]))
+            throw std::invalid_argument("TimeGrid constructor : times must be strictly increasing");
+    }
+}
+
+TimeGrid TimeGrid::uniform(double T, size_t n){
+
+    if (n == 0) throw std::invalid_argument("TimeGrid::uniform : the number of steps must be strictly positive");
+    if (!(T > 0)) throw std::invalid_argument("TimeGrid::uniform : the time horizon must be strictly positive");
+
+    std::vector<double> times(n+1);
+    const double dt = T / static_cast<double>(n);
+    for (size_t k = 0; k < n; k++) times[k] = k * dt;
+    times[n] = T;
+
+    return TimeGrid(std::move(times));
+}
+
+TimeGrid TimeGrid::from_dates(const Date& start, const std::vector<Date>& dates){
+
+    if (dates.empty()) throw std::invalid_argument("TimeGrid::from_dates : the schedule is empty");
+
+    std::vector<double> times;
+    times.reserve(dates.size()+1);
+    times.push_back(0.0);
+    for (const Date& d : dates){
+        times.push_back(year_fraction(start, d));
+    }
+
+    return TimeGrid(std::move(times));
+}
+
+TimeGrid TimeGrid::refine(double max_dt) const {
+
+    if (!(max_dt > 0)) throw std::invalid_argument("TimeGrid::refine : max_dt must be strictly positive");
+
+    std::vector<double> times{times_.front()};
+    for (size_t k = 1; k < times_.size(); k++){
+        const double t0 = times_[k-1];
+        const double h = times_[k] - t0;
+        const size_t m = static_cast<size_t>(std::ceil(h / max_dt));
+        for (size_t j = 1; j < m; j++){
+            times.push_back(t0 + h * static_cast<double>(j) / static_cast<double>(m));
+        }
+        times.push_back(times_[k]);
+    }
+
+    return TimeGrid(std::move(times));
+}
+
+size_t TimeGrid::index(double t) const {
+
+    auto it = std::lower_bound(times_.begin(), times_.end(), t);
+    const double tol = 1e-9 * std::max(1.0, std::abs(t));
+
+    if (it != times_.end() && std::abs(*it - t) <= tol) return static_cast<size_t>(it - times_.begin());
+    if (it != times_.begin() && std::abs(*(it-1) - t) <= tol) return static_cast<size_t>(it - times_.begin()) - 1;
+
+    throw std::invalid_argument("TimeGrid::index : the time is not a node of the grid");
+}
+
+std::vector<size_t> TimeGrid::indices(const std::vector<double>& times) const {
+    std::vector<size_t> idx(times.size());
+    for (size_t j = 0; j < times.size(); j++) idx[j] = index(times[j]);
+    return idx;
+}
@@ -10,19 +10,37 @@
 
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/catch_approx.hpp>  
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <filesystem>
 #include <memory>
 #include <optional>
 #include <random>
 #include <stdexcept>
+#include <thread>
+#include <vector>
 #include "models/black_scholes/black_scholes.hpp"
 #include "models/heston/heston.hpp"
 #include "models/dupire/dupire.hpp"
 #include "schemes/euler.h"
+#include "schemes/eulerblackscholes.hpp"
 #include "schemes/eulerheston.hpp"
 #include "schemes/qe.hpp"
+#include "engine/cancellation.hpp"
+#include "engine/chunks.hpp"
+#include "engine/simulationcache.hpp"
 #include "engine/montecarlo.hpp"
+#include "engine/randomstore.hpp"
+#include "instruments/instrument.h"
+#include "options/options.hpp"
+#include "payoff/payoff.h"
+#include "pricing/pricer.h"
+#include "types/marketstate.h"
 #include "types/simulationresult.hpp"
 #include "surface/local_vol.hpp"
+#include "types/timegrid.hpp"
+#include "types/pathfeatures.hpp"
 
 
 
@@ -379,4 +397,692 @@ TEST_CASE("Dupire - Basic Usage") {
     REQUIRE(res.get_npaths() == 20);
     REQUIRE(res.get_nsteps() == 252);
 
-}
\ No newline at end of file
+}
+TEST_CASE("Dupire - Time sliced local volatility") {
+
+    std::vector<double> t {0.25, 0.5, 0.75, 1.0};
+    std::vector<double> s {80, 90, 100, 110, 120};
+    std::vector<double> vol{0.25, 0.22, 0.20, 0.21, 0.23,
+                            0.24, 0.21, 0.19, 0.20, 0.22,
+                            0.23, 0.20, 0.18, 0.19, 0.21,
+                            0.22, 0.19, 0.17, 0.18, 0.20};
+
+    auto surface = std::make_shared<LocalVolatilitySurface>(t, s, vol);
+    auto dupire = std::make_shared<Dupire>(0.05, 0.02, surface);
+
+    std::vector<double> times{0.0, 0.1, 0.2, 0.3, 0.4};
+    std::shared_ptr<Model> prepared = dupire->prepare(times);
+    REQUIRE(prepared != nullptr);
+    for (double ti : {0.0, 0.1, 0.2, 0.3, 0.4, 0.15}) {
+        for (double S : {75.0, 93.0, 100.0, 117.5}) {
+            REQUIRE(prepared->volatility(ti, S) == Catch::Approx(surface->sigma(ti, S)).margin(1e-12));
+        }
+    }
+
+    // a run with the prepared model reproduces the path built on the full surface
+    MonteCarlo mc(Euler(std::static_pointer_cast<Model>(dupire)));
+    mc.configure(1, 2);
+    SimulationResult res = mc.generate_spot(100, 50, 1, 4);
+
+    std::mt19937 seeder(1);
+    std::mt19937 rng(static_cast<unsigned int>(seeder()));
+    std::vector<double> s_path(51), v_path(51);
+    mc.generate_path_inplace(s_path.data(), v_path.data(), 100, 51, 1, rng, std::nullopt);
+
+    const auto& paths = res.get_paths();
+    for (size_t k = 0; k <= 50; k++) {
+        REQUIRE(paths[k] == Catch::Approx(s_path[k]).epsilon(1e-12));
+    }
+}
+
+TEST_CASE("Monte Carlo - Non uniform time grid") {
+
+    BlackScholes bs(0.05, 0.0);
+    MonteCarlo mc(Euler(std::make_shared<BlackScholes>(bs)));
+    mc.configure(1, 2);
+
+    TimeGrid grid({0.0, 0.1, 0.5, 1.0});
+    SimulationResult res = mc.generate_spot(100, grid, 3);
+
+    REQUIRE(res.get_nsteps() == 3);
+    REQUIRE(res.get_times() == grid.times());
+
+    // without volatility each step compounds its own dt
+    double expected = 100 * (1 + 0.05 * 0.1) * (1 + 0.05 * 0.4) * (1 + 0.05 * 0.5);
+    const auto& paths = res.get_paths();
+    REQUIRE(paths[1] == Catch::Approx(100 * (1 + 0.05 * 0.1)));
+    REQUIRE(paths[3] == Catch::Approx(expected));
+    REQUIRE(res.avg_terminal_value() == Catch::Approx(expected));
+
+    // the uniform overload records the uniform grid
+    SimulationResult uniform = mc.generate_spot(100, 4, 1, 2);
+    REQUIRE(uniform.get_times() == TimeGrid::uniform(1, 4).times());
+}
+
+TEST_CASE("Monte Carlo - Observation schedule") {
+
+    Heston heston(0.02, 1.5, 0.04, 0.3, -0.7);
+    MonteCarlo mc(QE{heston});
+    mc.configure(3, 2);
+
+    size_t n_steps = 24;
+    size_t n_paths = 50;
+    SimulationResult full = mc.generate_spot(100, n_steps, 2, n_paths, 0.04);
+
+    mc.reset_rng();
+    std::vector<size_t> observe{12, 2, 6, 6};
+    SimulationResult obs = mc.generate_spot(100, n_steps, 2, n_paths, 0.04, observe);
+
+    // sorted, deduplicated and completed with the terminal step
+    std::vector<size_t> expected_steps{2, 6, 12, 24};
+    REQUIRE(obs.get_observed_steps() == expected_steps);
+    REQUIRE(obs.get_nsteps() == n_steps);
+    REQUIRE(obs.get_path_size() == 4);
+    REQUIRE(obs.get_paths().size() == 4 * n_paths);
+    REQUIRE(obs.get_times()[1] == Catch::Approx(0.5));
+
+    const auto& s_full = full.get_paths();
+    const auto& v_full = full.get_vol();
+    for (size_t p = 0; p < n_paths; p++) {
+        for (size_t j = 0; j < expected_steps.size(); j++) {
+            REQUIRE(obs.get_paths()[p * 4 + j] == s_full[p * (n_steps + 1) + expected_steps[j]]);
+            REQUIRE(obs.get_vol()[p * 4 + j] == v_full[p * (n_steps + 1) + expected_steps[j]]);
+        }
+    }
+    REQUIRE(obs.avg_terminal_value() == full.avg_terminal_value());
+
+    // selection by time on a grid
+    TimeGrid grid = TimeGrid({0.0, 0.25, 0.5, 1.0}).refine(0.05);
+    SimulationResult by_time = mc.generate_spot(100, grid, 5, 0.04, grid.indices({0.25, 0.5}));
+    REQUIRE(by_time.get_times() == std::vector<double>{0.25, 0.5, 1.0});
+
+    REQUIRE_THROWS_AS(mc.generate_spot(100, n_steps, 2, n_paths, 0.04, std::vector<size_t>{25}), std::invalid_argument);
+}
+
+
+TEST_CASE("Monte Carlo - Streaming payoff accumulators") {
+
+    double S0 = 100, K = 100, T = 1;
+    OptionContract contract(K, T);
+    CallPayoff call;
+    PutPayoff put;
+
+    std::vector<std::shared_ptr<Instrument>> instruments = {
+        std::make_shared<Instrument>(contract, std::make_shared<CallPayoff>()),
+        std::make_shared<Instrument>(contract, std::make_shared<DigitalPutPayoff>()),
+        std::make_shared<Instrument>(contract, std::make_shared<BarrierPayoff>(115, Up, Out, call)),
+        std::make_shared<Instrument>(contract, std::make_shared<BarrierPayoff>(90, Down, In, put)),
+        std::make_shared<Instrument>(contract, std::make_shared<BarrierPayoff>(85, Down, Out, call, Continuous)),
+    };
+    std::vector<std::unique_ptr<PayoffAccumulator>> accumulators;
+    for (const auto& in : instruments) accumulators.push_back(in->accumulator());
+
+    MonteCarlo mc(Euler(std::make_shared<BlackScholes>(0.02, 0.3)));
+    mc.configure(7, 1);
+
+    size_t n_paths = 3000;
+    TimeGrid grid = TimeGrid::uniform(T, 50);
+    SimulationResult full = mc.generate_spot(S0, grid, n_paths);
+    mc.reset_rng();
+    std::vector<double> streamed = mc.accumulate(S0, grid, n_paths, accumulators);
+
+    SECTION("same payoffs as the stored paths") {
+        REQUIRE(streamed.size() == instruments.size());
+        for (size_t i = 0; i < instruments.size(); i++){
+            REQUIRE(streamed[i] == Catch::Approx(instruments[i]->compute_payoff(full)).epsilon(1e-12));
+        }
+    }
+
+    SECTION("independent of the number of threads") {
+        mc.configure(7, 4);
+        REQUIRE(mc.accumulate(S0, grid, n_paths, accumulators) == streamed);
+    }
+
+    SECTION("invalid accumulators") {
+        std::vector<std::unique_ptr<PayoffAccumulator>> none;
+        REQUIRE_THROWS_AS(mc.accumulate(S0, grid, n_paths, none), std::invalid_argument);
+        none.push_back(nullptr);
+        REQUIRE_THROWS_AS(mc.accumulate(S0, grid, n_paths, none), std::invalid_argument);
+    }
+}
+
+TEST_CASE("Monte Carlo - Time-major layout") {
+
+    Heston heston(0.02, 2, 0.05, 0.3, -0.6);
+    MonteCarlo mc(QE{heston});
+    mc.configure(3, 4);
+
+    // 150 paths : two full blocks and a partial one
+    size_t n_paths = 150;
+    TimeGrid grid = TimeGrid::uniform(1, 20);
+    SimulationResult rows = mc.generate_spot(100, grid, n_paths, 0.04);
+    mc.configure(3, std::nullopt, std::nullopt, TimeMajor);
+    SimulationResult cols = mc.generate_spot(100, grid, n_paths, 0.04);
+
+    REQUIRE(rows.get_layout() == PathMajor);
+    REQUIRE(cols.get_layout() == TimeMajor);
+    REQUIRE(cols.path_stride() == 1);
+    REQUIRE(cols.step_stride() == n_paths);
+
+    const size_t m = rows.get_path_size();
+    for (size_t p = 0; p < n_paths; p++) {
+        for (size_t j = 0; j < m; j++) {
+            REQUIRE(cols.get_paths()[cols.index(p, j)] == rows.get_paths()[rows.index(p, j)]);
+            REQUIRE(cols.get_vol()[cols.index(p, j)] == rows.get_vol()[rows.index(p, j)]);
+        }
+    }
+    // a stored step is contiguous
+    for (size_t p = 0; p < n_paths; p++) REQUIRE(cols.get_paths()[20 * n_paths + p] == rows.get_paths()[p * m + 20]);
+
+    REQUIRE(cols.avg_terminal_value() == Catch::Approx(rows.avg_terminal_value()).epsilon(1e-12));
+
+    std::vector<double> s(3 * m), v(3 * m);
+    cols.copy_paths(100, 3, s, v);
+    for (size_t k = 0; k < 3 * m; k++) {
+        REQUIRE(s[k] == rows.get_paths()[100 * m + k]);
+        REQUIRE(v[k] == rows.get_vol()[100 * m + k]);
+    }
+    REQUIRE_THROWS_AS(cols.copy_paths(149, 2, s, v), std::invalid_argument);
+
+    // payoffs and features do not depend on the layout
+    OptionContract contract(100, 1);
+    CallPayoff call;
+    for (auto payoff : std::vector<std::shared_ptr<Payoff>>{std::make_shared<CallPayoff>(), 
+                                                             std::make_shared<BarrierPayoff>(110, Up, Out, call),
+                                                             std::make_shared<BarrierPayoff>(90, Down, In, call, Continuous)}) {
+        Instrument instrument(contract, payoff);
+        REQUIRE(instrument.compute_payoff(cols) == Catch::Approx(instrument.compute_payoff(rows)).epsilon(1e-12));
+    }
+
+    PathFeatures f_rows = PathFeatures::extract(rows);
+    PathFeatures f_cols = PathFeatures::extract(cols);
+    for (size_t p = 0; p < n_paths; p++) {
+        REQUIRE(f_cols.terminal[p] == f_rows.terminal[p]);
+        REQUIRE(f_cols.max[p] == f_rows.max[p]);
+        REQUIRE(f_cols.min[p] == f_rows.min[p]);
+        REQUIRE(f_cols.average[p] == Catch::Approx(f_rows.average[p]).epsilon(1e-12));
+    }
+}
+
+TEST_CASE("Monte Carlo - Lazy regenerated paths") {
+
+    Heston heston(0.02, 2, 0.05, 0.3, -0.6);
+    MonteCarlo mc(QE{heston});
+    TimeGrid grid = TimeGrid::uniform(1, 20);
+    // 2500 paths : two full blocks of regeneration and a partial one
+    size_t n_paths = 2500;
+
+    for (Layout layout : {PathMajor, TimeMajor}) {
+        mc.configure(5, -1, std::nullopt, layout);
+        SimulationResult stored = mc.generate_spot(100, grid, n_paths, 0.04, std::vector<size_t>{5, 10});
+        mc.reset_rng();
+        SimulationResult lazy = mc.generate_lazy(100, grid, n_paths, 0.04, std::vector<size_t>{5, 10}, 2);
+
+        REQUIRE(lazy.is_lazy());
+        REQUIRE(!stored.is_lazy());
+        REQUIRE(lazy.get_observed_steps() == stored.get_observed_steps());
+        REQUIRE(lazy.get_times() == stored.get_times());
+        REQUIRE_THROWS_AS(lazy.get_paths(), std::invalid_argument);
+
+        // blocks across a regeneration boundary
+        const size_t m = stored.get_path_size();
+        std::vector<double> s_lazy(30 * m), v_lazy(30 * m), s(30 * m), v(30 * m);
+        lazy.copy_paths(1010, 30, s_lazy, v_lazy);
+        stored.copy_paths(1010, 30, s, v);
+        REQUIRE(s_lazy == s);
+        REQUIRE(v_lazy == v);
+
+        OptionContract contract(100, 1);
+        CallPayoff call;
+        for (auto payoff : std::vector<std::shared_ptr<Payoff>>{std::make_shared<CallPayoff>(), 
+                                                                 std::make_shared<BarrierPayoff>(110, Up, Out, call)}) {
+            Instrument instrument(contract, payoff);
+            REQUIRE(instrument.compute_payoff(lazy) == Catch::Approx(instrument.compute_payoff(stored)).epsilon(1e-12));
+        }
+
+        PathFeatures f_lazy = PathFeatures::extract(lazy);
+        PathFeatures f_stored = PathFeatures::extract(stored);
+        REQUIRE(f_lazy.terminal == f_stored.terminal);
+        REQUIRE(f_lazy.max == f_stored.max);
+
+        // the whole paths are only computed when asked for, in the layout
+        REQUIRE(std::equal(lazy.spots().begin(), lazy.spots().end(), stored.spots().begin(), stored.spots().end()));
+        REQUIRE(std::equal(lazy.vols().begin(), lazy.vols().end(), stored.vols().begin(), stored.vols().end()));
+    }
+}
+
+TEST_CASE("Monte Carlo - Workspace reuse") {
+
+    MonteCarlo mc(Euler(std::make_shared<BlackScholes>(0.02, 0.2)));
+    mc.configure(9, -1);
+    TimeGrid grid = TimeGrid::uniform(1, 30);
+    SimulationResult reference = mc.generate_spot(100, grid, 2000);
+
+    auto workspace = std::make_shared<Workspace>(2);
+    mc.set_workspace(workspace);
+
+    const double* first_data;
+    {
+        mc.reset_rng();
+        SimulationResult first = mc.generate_spot(100, grid, 2000);
+        REQUIRE(first.get_paths() == reference.get_paths());
+        first_data = first.get_paths().data();
+    }
+    // the first result is gone : its buffers are handed out again
+    mc.reset_rng();
+    SimulationResult second = mc.generate_spot(100, grid, 2000);
+    REQUIRE(second.get_paths().data() == first_data);
+    REQUIRE(second.get_paths() == reference.get_paths());
+    REQUIRE(second.get_vol() == reference.get_vol());
+    const size_t allocated = workspace->allocations();
+
+    // the second result is alive : a new buffer is used and it is unchanged
+    SimulationResult third = mc.generate_spot(100, grid, 2000);
+    REQUIRE(third.get_paths().data() != second.get_paths().data());
+    REQUIRE(second.get_paths() == reference.get_paths());
+    REQUIRE(workspace->allocations() > allocated);
+
+    // a smaller run fits in a free buffer
+    const size_t reused = workspace->reuses();
+    {
+        SimulationResult small = mc.generate_spot(100, grid, 500);
+        (void)small;
+    }
+    REQUIRE(workspace->reuses() > reused);
+    REQUIRE(workspace->reserved_bytes() > 0);
+
+    // copies of the engine, as in the greeks of the pricer, share the pool
+    MonteCarlo copy = mc;
+    REQUIRE(copy.get_workspace() == workspace);
+    mc.set_workspace(nullptr);
+    workspace->release();
+}
+
+TEST_CASE("Monte Carlo - Cancellation") {
+
+    MonteCarlo mc(Euler(std::make_shared<BlackScholes>(0.02, 0.2)));
+    mc.configure(2, -1);
+    TimeGrid grid = TimeGrid::uniform(1, 50);
+
+    CancellationToken token;
+    {
+        CancellationToken::Scope scope(token);
+        // a token that is not cancelled changes nothing
+        REQUIRE(mc.generate_spot(100, grid, 100).get_npaths() == 100);
+
+        token.cancel();
+        REQUIRE_THROWS_AS(mc.generate_spot(100, grid, 100), Cancelled);
+        REQUIRE_THROWS_AS(mc.generate_features(100, grid, 100), Cancelled);
+        REQUIRE_THROWS_AS(mc.generate_monitored(100, grid, 100, KnockCondition{120, Up}), Cancelled);
+    }
+    // the scope is closed : the next runs are not affected
+    REQUIRE(CancellationToken::current() == nullptr);
+    REQUIRE(mc.generate_spot(100, grid, 100).get_npaths() == 100);
+
+    // concurrent runs on one engine, cancelled from another thread
+    CancellationToken stop;
+    std::atomic<bool> stopped = false;
+    std::thread runner([&]() {
+        CancellationToken::Scope scope(stop);
+        try {
+            for (;;) mc.generate_spot(100, grid, 20000);
+        }
+        catch (const Cancelled&) {
+            stopped = true;
+        }
+    });
+    SimulationResult other = mc.generate_spot(100, grid, 1000);
+    stop.cancel();
+    runner.join();
+    REQUIRE(stopped);
+    REQUIRE(other.get_npaths() == 1000);
+
+    // the blocks of a chunked generation run under the token of its caller
+    CancellationToken chunked;
+    {
+        CancellationToken::Scope scope(chunked);
+        ChunkedGenerator chunks(mc, 100, grid, 3000, 1000);
+        REQUIRE(chunks.next()->get_npaths() == 1000);
+        chunked.cancel();
+        REQUIRE_THROWS_AS(chunks.next(), Cancelled);
+    }
+}
+
+TEST_CASE("Monte Carlo - Chunked generation") {
+
+    MonteCarlo mc(Euler(std::make_shared<BlackScholes>(0.02, 0.2)));
+    mc.configure(5, -1);
+    TimeGrid grid = TimeGrid::uniform(1, 20);
+    SimulationResult reference = mc.generate_spot(100, grid, 2500);
+    mc.reset_rng();
+
+    // the blocks put end to end are the paths of a single generation
+    ChunkedGenerator chunks(mc, 100, grid, 2500, 1000);
+    std::vector<double> spots;
+    std::vector<double> vols;
+    std::vector<size_t> sizes;
+    while (std::optional<SimulationResult> block = chunks.next()) {
+        sizes.push_back(block->get_npaths());
+        spots.insert(spots.end(), block->spots().begin(), block->spots().end());
+        vols.insert(vols.end(), block->vols().begin(), block->vols().end());
+    }
+    REQUIRE(sizes == std::vector<size_t>{1000, 1000, 500});
+    REQUIRE(chunks.remaining() == 0);
+    REQUIRE_FALSE(chunks.next().has_value());
+    REQUIRE(std::equal(spots.begin(), spots.end(), reference.spots().begin(), reference.spots().end()));
+    REQUIRE(std::equal(vols.begin(), vols.end(), reference.vols().begin(), reference.vols().end()));
+
+    // the engine generator does not advance
+    SimulationResult again = mc.generate_spot(100, grid, 2500);
+    REQUIRE(std::equal(again.spots().begin(), again.spots().end(), reference.spots().begin(), reference.spots().end()));
+
+    // observed steps, and released blocks recycled by the pool
+    mc.reset_rng();
+    ChunkedGenerator observed(mc, 100, grid, 2500, 500, std::nullopt, std::vector<size_t>{10});
+    const double* first_data = nullptr;
+    bool recycled = false;
+    while (std::optional<SimulationResult> block = observed.next()) {
+        REQUIRE(block->get_path_size() == 2);
+        if (!first_data) first_data = block->spots().data();
+        else recycled = recycled || block->spots().data() == first_data;
+    }
+    REQUIRE(recycled);
+
+    // a generator destroyed before the end stops its pending block
+    {
+        ChunkedGenerator abandoned(mc, 100, grid, 100000, 50000);
+        REQUIRE(abandoned.next().has_value());
+    }
+
+    REQUIRE_THROWS_AS(ChunkedGenerator(mc, 100, grid, 100, 0), std::invalid_argument);
+}
+
+TEST_CASE("Monte Carlo - Simulation cache") {
+
+    auto mc = std::make_shared<MonteCarlo>(Euler(std::make_shared<BlackScholes>(0.02, 0.2)));
+    mc->configure(4, -1);
+    TimeGrid grid = TimeGrid::uniform(1, 20);
+    SimulationResult reference = mc->generate_spot(100, grid, 1000);
+    SimulationResult reference_next = mc->generate_spot(100, grid, 1000);
+
+    auto cache = std::make_shared<SimulationCache>(size_t(1) << 24);
+    mc->set_cache(cache);
+
+    // a run repeated from the same state of the generator is shared
+    mc->reset_rng();
+    SimulationResult first = mc->generate_spot(100, grid, 1000);
+    mc->reset_rng();
+    SimulationResult second = mc->generate_spot(100, grid, 1000);
+    REQUIRE(cache->hits() == 1);
+    REQUIRE(second.get_paths().data() == first.get_paths().data());
+    REQUIRE(second.get_paths() == reference.get_paths());
+
+    // a repeated run hits without reset_rng, and the generator advances as
+    // without cache
+    SimulationResult again = mc->generate_spot(100, grid, 1000);
+    REQUIRE(cache->hits() == 2);
+    REQUIRE(again.get_paths().data() == first.get_paths().data());
+    mc->reset_rng();
+    mc->generate_spot(100, grid, 1000);
+    mc->set_cache(nullptr);
+    REQUIRE(mc->generate_spot(100, grid, 1000).get_paths() == reference_next.get_paths());
+    mc->set_cache(cache);
+
+    // runs that do not start from the seed are not stored
+    const size_t entries = cache->size();
+    mc->generate_spot(100, grid, 999);
+    REQUIRE(cache->size() == entries);
+
+    // another spot, settings or model is another run
+    const size_t hits = cache->hits();
+    mc->reset_rng();
+    mc->generate_spot(101, grid, 1000);
+    mc->reset_rng();
+    mc->generate_spot(100, grid, 1000, std::nullopt, std::vector<size_t>{10});
+    REQUIRE(cache->hits() == hits);
+
+    // models that only differ beyond the printed digits are not confused
+    auto close = std::make_shared<MonteCarlo>(Euler(std::make_shared<BlackScholes>(0.02, 0.2f + 1e-7f)));
+    close->configure(4, -1);
+    close->set_cache(cache);
+    REQUIRE(close->get_scheme().describe() == mc->get_scheme().describe());
+    close->generate_spot(100, grid, 1000);
+    REQUIRE(cache->hits() == hits);
+
+    // an identical scheme object shares the runs
+    auto same = std::make_shared<MonteCarlo>(Euler(std::make_shared<BlackScholes>(0.02, 0.2)));
+    same->configure(4, -1);
+    same->set_cache(cache);
+    REQUIRE(same->generate_spot(100, grid, 1000).get_paths().data() == first.get_paths().data());
+    REQUIRE(cache->hits() == hits + 1);
+
+    // features are cached on their own
+    mc->reset_rng();
+    PathFeatures features = mc->generate_features(100, grid, 1000);
+    mc->reset_rng();
+    PathFeatures cached = mc->generate_features(100, grid, 1000);
+    REQUIRE(cache->hits() == hits + 2);
+    REQUIRE(cached.terminal == features.terminal);
+
+    // a repeated pricing reuses its paths
+    Pricer pricer(MarketState(100, 0.02), 20, 1000, mc);
+    CallPayoff payoff;
+    auto barrier = std::make_shared<Instrument>(OptionContract(100, 1), std::make_shared<BarrierPayoff>(130, Up, Out, payoff));
+    mc->reset_rng();
+    const double price = pricer.compute_price(barrier);
+    mc->reset_rng();
+    const size_t before = cache->hits();
+    REQUIRE(pricer.compute_price(barrier) == price);
+    REQUIRE(cache->hits() == before + 1);
+    // repeated pricings give the same price without reset_rng
+    REQUIRE(pricer.compute_price(barrier) == price);
+    REQUIRE(cache->hits() == before + 2);
+    mc->set_cache(nullptr);
+    mc->reset_rng();
+    REQUIRE(pricer.compute_price(barrier) == Catch::Approx(price).epsilon(1e-12));
+    mc->set_cache(cache);
+
+    // a new random seed is not cached until reset_rng
+    mc->reset_seed();
+    const size_t misses = cache->misses();
+    mc->generate_spot(100, grid, 1000);
+    REQUIRE(cache->misses() == misses);
+
+    // the least recently used runs are dropped beyond max_bytes
+    auto small = std::make_shared<SimulationCache>(3 * 1000 * 21 * sizeof(double));
+    mc->set_cache(small);
+    for (double S0 : {100.0, 101.0, 102.0, 103.0}) {
+        mc->configure(4, -1);
+        mc->generate_spot(S0, grid, 1000);
+    }
+    REQUIRE(small->size() == 1);
+    REQUIRE(small->bytes() <= small->max_bytes());
+    mc->configure(4, -1);
+    mc->generate_spot(100, grid, 1000);
+    REQUIRE(small->hits() == 0);
+}
+
+TEST_CASE("Monte Carlo - Random store") {
+
+    TimeGrid grid = TimeGrid::uniform(1, 20);
+
+    // the store holds the normals drawn by an engine with the same seed
+    MonteCarlo mc(Euler(std::make_shared<BlackScholes>(0.02, 0.2)));
+    mc.configure(7, -1);
+    SimulationResult reference = mc.generate_spot(100, grid, 1000);
+    auto store = std::make_shared<const RandomStore>(1500, 20, 2, 7);
+    REQUIRE(store->n_paths() == 1500);
+    REQUIRE(store->bytes() == 1500 * 20 * 2 * sizeof(double));
+    mc.set_random_store(std::make_shared<const RandomStore>(1000, 20, 1, 7, 2));
+    SimulationResult stored = mc.generate_spot(100, grid, 1000);
+    REQUIRE(stored.get_paths() == reference.get_paths());
+
+    // every run reads the same paths, the generator does not advance
+    mc.set_random_store(store);
+    SimulationResult first = mc.generate_spot(100, grid, 1000);
+    SimulationResult second = mc.generate_spot(100, grid, 1000);
+    REQUIRE(first.get_paths() == second.get_paths());
+    PathFeatures features = mc.generate_features(100, grid, 1000);
+    bool same_terminal = true;
+    for (size_t p = 0; p < 1000; p++) same_terminal = same_terminal && features.terminal[p] == first.get_paths()[p * 21 + 20];
+    REQUIRE(same_terminal);
+    mc.set_random_store(nullptr);
+    SimulationResult next = mc.generate_spot(100, grid, 1000);
+    mc.configure(7);
+    mc.generate_spot(100, grid, 1000);
+    REQUIRE(mc.generate_spot(100, grid, 1000).get_paths() == next.get_paths());
+
+    // bumped runs of the pricer read the store instead of resetting the generator
+    auto engine = std::make_shared<MonteCarlo>(Euler(std::make_shared<BlackScholes>(0.02, 0.2)));
+    engine->configure(7, -1);
+    Pricer pricer(MarketState(100, 0.02), 20, 1000, engine);
+    auto call = std::make_shared<Instrument>(OptionContract(100, 1), std::make_shared<CallPayoff>());
+    const double delta = pricer.compute_delta_bar(call, 1.0);
+    engine->set_random_store(store);
+    REQUIRE(pricer.compute_delta_bar(call, 1.0) == Catch::Approx(delta).epsilon(1e-12));
+
+    // Heston schemes read two normals per step : both schemes run on the
+    // same randoms and the Euler one reproduces the engine draws
+    Heston heston{0.02, 2, 0.05, 0.4, -0.5};
+    MonteCarlo euler_heston(EulerHeston{heston});
+    euler_heston.configure(7, -1);
+    SimulationResult heston_reference = euler_heston.generate_spot(100, grid, 1500, 0.2);
+    euler_heston.set_random_store(store);
+    MonteCarlo qe(QE{heston});
+    qe.configure(1, -1);
+    qe.set_random_store(store);
+    SimulationResult heston_stored = euler_heston.generate_spot(100, grid, 1500, 0.2);
+    SimulationResult qe_stored = qe.generate_spot(100, grid, 1500, 0.2);
+    REQUIRE(heston_stored.get_paths() == heston_reference.get_paths());
+    double mean_diff = 0.0;
+    double mean_sq = 0.0;
+    for (size_t p = 0; p < 1500; p++) {
+        const double d = heston_stored.get_paths()[p * 21 + 20] - qe_stored.get_paths()[p * 21 + 20];
+        mean_diff += d / 1500.0;
+        mean_sq += d * d / 1500.0;
+    }
+    // the schemes differ by their discretization, not by their randoms
+    REQUIRE(std::sqrt(mean_sq) < 5.0);
+    REQUIRE(std::abs(mean_diff) < 1.0);
+
+    // the store must cover the run
+    REQUIRE_THROWS_AS(euler_heston.generate_spot(100, grid, 2000, 0.2), std::invalid_argument);
+    REQUIRE_THROWS_AS(euler_heston.generate_spot(100, TimeGrid::uniform(1, 10), 100, 0.2), std::invalid_argument);
+    euler_heston.set_random_store(std::make_shared<const RandomStore>(100, 20, 1, 7));
+    REQUIRE_THROWS_AS(euler_heston.generate_spot(100, grid, 100, 0.2), std::invalid_argument);
+    REQUIRE_THROWS_AS(RandomStore(0, 20), std::invalid_argument);
+
+    // blocks of a chunked generation read their own rows
+    mc.set_random_store(store);
+    ChunkedGenerator chunks(mc, 100, grid, 1000, 400);
+    std::vector<double> spots;
+    while (std::optional<SimulationResult> block = chunks.next())
+        spots.insert(spots.end(), block->spots().begin(), block->spots().end());
+    REQUIRE(std::equal(spots.begin(), spots.end(), first.spots().begin(), first.spots().end()));
+    REQUIRE(store->rows(500, 100).path(0)[3] == store->path(500)[3]);
+    REQUIRE_THROWS_AS(store->rows(1400, 200), std::invalid_argument);
+
+    // saved then memory mapped
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "volmc_test_randomstore";
+    std::filesystem::remove_all(dir);
+    store->save(dir.string());
+    mc.set_random_store(std::make_shared<const RandomStore>(RandomStore::load(dir.string())));
+    REQUIRE(mc.get_random_store()->dims() == 2);
+    REQUIRE(mc.generate_spot(100, grid, 1000).get_paths() == first.get_paths());
+    mc.set_random_store(nullptr);
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("Monte Carlo - Parameter batch") {
+
+    TimeGrid grid = TimeGrid::uniform(1, 20);
+
+    // a batch of one normal per step draws the paths of each scheme alone
+    std::vector<std::shared_ptr<Scheme>> bs;
+    for (double sigma : {0.1, 0.2, 0.3}) bs.push_back(std::make_shared<Euler>(std::make_shared<BlackScholes>(0.02, sigma)));
+    MonteCarlo mc(bs[0]);
+    mc.configure(7, -1);
+    std::vector<SimulationResult> batch = mc.generate_batch(bs, 100, grid, 1000);
+    REQUIRE(batch.size() == 3);
+    for (size_t k = 0; k < bs.size(); k++) {
+        MonteCarlo single(bs[k]);
+        single.configure(7, 2);
+        REQUIRE(batch[k].get_paths() == single.generate_spot(100, grid, 1000).get_paths());
+    }
+
+    // the generator advances as for one run
+    SimulationResult next = mc.generate_spot(100, grid, 1000);
+    mc.configure(7);
+    mc.generate_spot(100, grid, 1000);
+    REQUIRE(mc.generate_spot(100, grid, 1000).get_paths() == next.get_paths());
+
+    // Heston parameter sets : the schemes read the normals of a store
+    // generated with the seed
+    std::vector<std::shared_ptr<Scheme>> qe;
+    for (double kappa : {1.0, 2.0, 3.0}) qe.push_back(std::make_shared<QE>(Heston{0.02, static_cast<float>(kappa), 0.05, 0.4, -0.5}));
+    qe.push_back(std::make_shared<EulerHeston>(Heston{0.02, 2, 0.05, 0.4, -0.5}));
+    mc.configure(7, -1, true, TimeMajor);
+    std::vector<SimulationResult> heston = mc.generate_batch(qe, 100, grid, 1000, 0.04);
+    auto store = std::make_shared<const RandomStore>(1000, 20, 2, 7);
+    for (size_t k = 0; k < qe.size(); k++) {
+        MonteCarlo single(qe[k]);
+        single.configure(1, 2, true, TimeMajor);
+        single.set_random_store(store);
+        SimulationResult expected = single.generate_spot(100, grid, 1000, 0.04);
+        REQUIRE(heston[k].get_layout() == TimeMajor);
+        REQUIRE(heston[k].get_paths() == expected.get_paths());
+        REQUIRE(heston[k].vols()[20 * 1000] == expected.vols()[20 * 1000]);
+    }
+
+    // schemes of one type are stepped by a kernel over their parameters,
+    // with the states of step_from
+    std::vector<const Scheme*> heston_sets{qe[0].get(), qe[1].get(), qe[2].get()};
+    std::unique_ptr<SchemeBatch> kernel = qe[0]->batch(heston_sets);
+    REQUIRE(kernel != nullptr);
+    REQUIRE(kernel->size() == 3);
+    std::vector<double> S{100, 101, 99};
+    std::vector<double> v{0.2, 0.3, 0.1};
+    for (double zv : {-1.5, 0.3, 2.5}) {
+        const std::vector<double> z{0.7, zv};
+        std::vector<double> S_next = S;
+        std::vector<double> v_next = v;
+        kernel->step(S_next, v_next, 0.0, 0.05, z);
+        for (size_t k = 0; k < 3; k++) {
+            const std::pair<double, double> expected = heston_sets[k]->step_from(S[k], v[k], 0.0, 0.05, z);
+            REQUIRE(S_next[k] == expected.first);
+            REQUIRE(v_next[k] == expected.second);
+        }
+    }
+    heston_sets.push_back(qe[3].get());
+    REQUIRE(qe[0]->batch(heston_sets) == nullptr);
+    REQUIRE(bs[0]->batch(std::vector<const Scheme*>{bs[0].get()}) == nullptr);
+
+    std::vector<std::shared_ptr<Scheme>> log_euler;
+    for (double sigma : {0.1, 0.2, 0.3}) log_euler.push_back(std::make_shared<EulerBlackScholes>(BlackScholes(0.02, sigma)));
+    log_euler.push_back(bs[1]);
+    mc.configure(7, -1, true, PathMajor);
+    std::vector<SimulationResult> log_batch = mc.generate_batch(log_euler, 100, grid, 1000);
+    for (size_t k = 0; k < log_euler.size(); k++) {
+        MonteCarlo single(log_euler[k]);
+        single.configure(7, 2);
+        REQUIRE(log_batch[k].get_paths() == single.generate_spot(100, grid, 1000).get_paths());
+    }
+
+    // accumulators give the averages of the stored paths
+    auto call = std::make_shared<Instrument>(OptionContract(100, 1), std::make_shared<CallPayoff>());
+    std::vector<std::unique_ptr<PayoffAccumulator>> accumulators;
+    accumulators.push_back(call->accumulator());
+    mc.configure(7, -1, true, PathMajor);
+    std::vector<std::vector<double>> averages = mc.accumulate_batch(qe, 100, grid, 1000, accumulators, 0.04);
+    mc.configure(7);
+    heston = mc.generate_batch(qe, 100, grid, 1000, 0.04);
+    for (size_t k = 0; k < qe.size(); k++) REQUIRE(averages[k][0] == Catch::Approx(call->compute_payoff(heston[k])).epsilon(1e-12));
+    // v0 < theta : a faster mean reversion raises the variance of the paths
+    REQUIRE(averages[0][0] < averages[2][0]);
+
+    REQUIRE_THROWS_AS(mc.generate_batch({}, 100, grid, 10), std::invalid_argument);
+    REQUIRE_THROWS_AS(mc.generate_batch({nullptr}, 100, grid, 10), std::invalid_argument);
+    REQUIRE_THROWS_AS(mc.accumulate_batch(qe, 100, grid, 10, {}, 0.04), std::invalid_argument);
+    mc.set_random_store(std::make_shared<const RandomStore>(100, 20, 1, 7));
+    REQUIRE_THROWS_AS(mc.generate_batch(qe, 100, grid, 100, 0.04), std::invalid_argument);
+}
@@ -4,10 +4,17 @@
 #include "options/options.hpp"
 #include "payoff/payoff.h"
 #include "schemes/euler.h"
+#include "schemes/eulerblackscholes.hpp"
+#include "pricing/pricer.h"
+#include "types/marketstate.h"
+#include "types/pathfeatures.hpp"
 #include "types/simulationresult.hpp"
+#include "types/timegrid.hpp"
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/catch_approx.hpp>  
+#include <algorithm>
 #include <memory>
+#include <span>
 #include <optional>
 #include <stdexcept>
 #include <cmath>
@@ -167,4 +174,199 @@ TEST_CASE("Barrier : payoff dependency on H") {
     double payoff2 = up_out_call2.compute_payoff(sim);
 
     REQUIRE(payoff1 != payoff2);
-}
\ No newline at end of file
+}
+static double norm_cdf(double x) {
+    return 0.5 * std::erfc(-x / std::sqrt(2.0));
+}
+
+// continuously monitored down-and-out call with H <= K and r = 0
+static double down_and_out_call(double S, double K, double H, double T, double sigma) {
+    double sq = sigma * std::sqrt(T);
+    double d1 = (std::log(S / K) + 0.5 * sigma * sigma * T) / sq;
+    double call = S * norm_cdf(d1) - K * norm_cdf(d1 - sq);
+    double y = std::log(H * H / (S * K)) / sq + 0.5 * sq;
+    double down_and_in = H * norm_cdf(y) - K * (S / H) * norm_cdf(y - sq);
+    return call - down_and_in;
+}
+
+TEST_CASE("Barrier : Brownian bridge correction"){
+
+    double S0 = 100, K = 100, H = 90, T = 1, sigma = 0.25;
+    OptionContract contract(K, T);
+    CallPayoff call_payoff;
+
+    auto discrete = std::make_shared<Instrument>(contract, std::make_shared<BarrierPayoff>(H, Down, Out, call_payoff));
+    auto continuous = std::make_shared<Instrument>(contract, std::make_shared<BarrierPayoff>(H, Down, Out, call_payoff, Continuous));
+    auto continuous_in = std::make_shared<Instrument>(contract, std::make_shared<BarrierPayoff>(H, Down, In, call_payoff, Continuous));
+    auto vanilla = std::make_shared<Instrument>(contract, std::make_shared<CallPayoff>());
+
+    MonteCarlo mc(EulerBlackScholes{BlackScholes(0.0, sigma)});
+    mc.configure(1, -1);
+    Pricer pricer(MarketState(S0, 0.0), 25, 200000, std::make_shared<MonteCarlo>(mc));
+
+    double exact = down_and_out_call(S0, K, H, T, sigma);
+    double price_discrete = pricer.compute_price(discrete);
+    double price_continuous = pricer.compute_price(continuous);
+
+    // 25 monitoring dates overprice the knock-out, the bridge removes the bias
+    REQUIRE(price_discrete > exact * 1.03);
+    REQUIRE(price_continuous == Catch::Approx(exact).epsilon(0.015));
+
+    // in + out parity holds path by path
+    std::vector<double> prices = pricer.batch_price({continuous, continuous_in, vanilla});
+    REQUIRE(prices[0] + prices[1] == Catch::Approx(prices[2]).epsilon(1e-12));
+
+    // the correction needs the volatility of the paths
+    mc.configure(std::nullopt, std::nullopt, false);
+    SimulationResult no_vol = mc.generate_spot(S0, 25, T, 10);
+    REQUIRE_THROWS_AS(continuous->compute_payoff(no_vol), std::invalid_argument);
+    REQUIRE_NOTHROW(discrete->compute_payoff(no_vol));
+}
+
+TEST_CASE("Barrier : early termination of knocked out paths"){
+
+    double S0 = 100, K = 100, H = 110, T = 1;
+    OptionContract contract(K, T);
+    CallPayoff call_payoff;
+
+    auto up_and_out = std::make_shared<Instrument>(contract, std::make_shared<BarrierPayoff>(H, Up, Out, call_payoff));
+    auto up_and_in = std::make_shared<Instrument>(contract, std::make_shared<BarrierPayoff>(H, Up, In, call_payoff));
+    REQUIRE(up_and_out->knock_out() == KnockCondition{H, Up});
+    REQUIRE_FALSE(up_and_in->knock_out().has_value());
+
+    BlackScholes bs(0.02, 0.3);
+    MonteCarlo mc(Euler(std::make_shared<BlackScholes>(bs)));
+    mc.configure(4, -1);
+
+    size_t n_paths = 2000;
+    TimeGrid grid = TimeGrid::uniform(T, 100);
+    SimulationResult full = mc.generate_spot(S0, grid, n_paths);
+    mc.reset_rng();
+    SimulationResult monitored = mc.generate_monitored(S0, grid, n_paths, KnockCondition{H, Up});
+
+    REQUIRE(monitored.get_path_size() == 1);
+    REQUIRE(monitored.get_paths().size() == n_paths);
+
+    // same paths : identical flags, terminal values and payoffs
+    const auto& knocked = monitored.get_knocked();
+    size_t n_knocked = 0;
+    for (size_t p = 0; p < n_paths; p++) {
+        std::span<const double> path(full.get_paths().data() + p * 101, 101);
+        bool touched = std::any_of(path.begin(), path.end(), [&](double s){return s >= H;});
+        REQUIRE(static_cast<bool>(knocked[p]) == touched);
+        if (!touched) REQUIRE(monitored.get_paths()[p] == path.back());
+        n_knocked += knocked[p];
+    }
+    REQUIRE(n_knocked > n_paths / 4);
+    REQUIRE(up_and_out->compute_payoff(monitored) == Catch::Approx(up_and_out->compute_payoff(full)).epsilon(1e-12));
+
+    // the flags belong to the monitored condition only
+    REQUIRE_THROWS_AS(up_and_in->compute_payoff(monitored), std::invalid_argument);
+
+    // the pricer stops knocked paths and returns the same price
+    MonteCarlo reference = mc;
+    reference.reset_rng();
+    Pricer pricer(MarketState(S0, 0.02), 100, n_paths, std::make_shared<MonteCarlo>(reference));
+    double price = pricer.compute_price(up_and_out);
+    REQUIRE(price == Catch::Approx(up_and_out->compute_payoff(full) * std::exp(-0.02 * T)).epsilon(1e-12));
+}
+
+TEST_CASE("Barrier : batch payoffs"){
+
+    BlackScholes bs(0.02, 0.3);
+    MonteCarlo mc(Euler(std::make_shared<BlackScholes>(bs)));
+    mc.configure(11, 1);
+    SimulationResult sim = mc.generate_spot(100, TimeGrid::uniform(1, 50), 500);
+
+    const size_t n_paths = sim.get_npaths();
+    const size_t m = sim.get_path_size();
+    PathsView paths{sim.get_paths(), sim.get_vol(), sim.get_times(), n_paths, m};
+
+    CallPayoff call;
+    PutPayoff put;
+    std::vector<BarrierPayoff> barriers = {BarrierPayoff(115, Up, Out, call), BarrierPayoff(115, Up, In, call),
+                                           BarrierPayoff(90, Down, Out, put), BarrierPayoff(90, Down, In, put),
+                                           BarrierPayoff(90, Down, Out, call, Continuous)};
+
+    std::vector<double> out(n_paths);
+    for (const auto& barrier : barriers) {
+        barrier.compute_batch(paths, 100, out);
+        for (size_t p = 0; p < n_paths; p++) {
+            REQUIRE(out[p] == barrier.compute_path(paths.path(p), 100));
+        }
+    }
+}
+
+TEST_CASE("Barrier : path features and barrier ladder"){
+
+    double S0 = 100, K = 100, T = 1, r = 0.02;
+    OptionContract contract(K, T);
+    CallPayoff call;
+    PutPayoff put;
+
+    MonteCarlo mc(Euler(std::make_shared<BlackScholes>(r, 0.25)));
+    mc.configure(5, -1);
+    TimeGrid grid = TimeGrid::uniform(T, 60);
+
+    SECTION("features of stored and streamed paths") {
+        SimulationResult sim = mc.generate_spot(S0, grid, 1000);
+        mc.reset_rng();
+        PathFeatures streamed = mc.generate_features(S0, grid, 1000);
+        PathFeatures stored = PathFeatures::extract(sim);
+
+        REQUIRE(streamed.size() == 1000);
+        for (size_t p = 0; p < 1000; p++) {
+            REQUIRE(streamed.terminal[p] == stored.terminal[p]);
+            REQUIRE(streamed.max[p] == stored.max[p]);
+            REQUIRE(streamed.min[p] == stored.min[p]);
+            REQUIRE(streamed.average[p] == Catch::Approx(stored.average[p]).epsilon(1e-12));
+        }
+
+        // barrier payoffs from features match the ones of the paths
+        for (const BarrierPayoff& barrier : {BarrierPayoff(115, Up, Out, call), BarrierPayoff(90, Down, In, put)}) {
+            std::vector<double> from_features(1000);
+            barrier.compute_features(stored, K, from_features);
+            for (size_t p = 0; p < 1000; p++) {
+                std::span<const double> path(sim.get_paths().data() + p * 61, 61);
+                REQUIRE(from_features[p] == barrier.compute(path, K));
+            }
+        }
+        REQUIRE_FALSE(BarrierPayoff(115, Up, Out, call, Continuous).uses_features());
+    }
+
+    SECTION("ladder matches the individual barrier prices") {
+        std::vector<double> levels = {105, 110, 115, 120, 130, 150};
+        size_t n_paths = 4000;
+
+        std::vector<std::shared_ptr<Instrument>> up_out;
+        for (double H : levels) up_out.push_back(std::make_shared<Instrument>(contract, std::make_shared<BarrierPayoff>(H, Up, Out, call)));
+
+        MonteCarlo ref = mc;
+        Pricer pricer(MarketState(S0, r), 60, n_paths, std::make_shared<MonteCarlo>(mc));
+        Pricer batch_pricer(MarketState(S0, r), 60, n_paths, std::make_shared<MonteCarlo>(ref));
+
+        std::vector<double> ladder = pricer.ladder_price(levels, Up, Out, call, contract);
+        std::vector<double> batch = batch_pricer.batch_price(up_out);
+        REQUIRE(ladder.size() == levels.size());
+        for (size_t j = 0; j < levels.size(); j++) {
+            REQUIRE(ladder[j] == Catch::Approx(batch[j]).epsilon(1e-10));
+            if (j > 0) REQUIRE(ladder[j] >= ladder[j-1]);
+        }
+
+        // in + out = vanilla for every level, down barriers included
+        std::vector<double> down = {70, 80, 90, 95};
+        auto engine = std::make_shared<MonteCarlo>(mc);
+        Pricer down_pricer(MarketState(S0, r), 60, n_paths, engine);
+        engine->reset_rng();
+        std::vector<double> d_in = down_pricer.ladder_price(down, Down, In, put, contract);
+        engine->reset_rng();
+        std::vector<double> d_out = down_pricer.ladder_price(down, Down, Out, put, contract);
+        engine->reset_rng();
+        double vanilla = down_pricer.batch_price({std::make_shared<Instrument>(contract, std::make_shared<PutPayoff>()),
+                                                  std::make_shared<Instrument>(contract, std::make_shared<CallPayoff>())})[0];
+        for (size_t j = 0; j < down.size(); j++) REQUIRE(d_in[j] + d_out[j] == Catch::Approx(vanilla).epsilon(1e-10));
+
+        REQUIRE_THROWS_AS(pricer.ladder_price({}, Up, Out, call, contract), std::invalid_argument);
+        REQUIRE_THROWS_AS(pricer.ladder_price(levels, Up, Out, BarrierPayoff(115, Up, Out, call, Continuous), contract), std::invalid_argument);
+    }
+}
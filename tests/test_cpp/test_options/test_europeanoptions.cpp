@@ -115,4 +115,28 @@ TEST_CASE("European option - basic pricing with volatility") {
     REQUIRE(payoff*std::exp(-r*T) == Catch::Approx(bs_price).epsilon(0.03));
 
 
-}
\ No newline at end of file
+}
+TEST_CASE("European option - batch payoffs") {
+
+    // 3 paths of 4 values, row-major
+    std::vector<double> spots = {100, 101, 99, 95,
+                                 100, 103, 108, 112,
+                                 100, 98, 100, 100};
+    PathsView paths{spots, {}, {}, 3, 4};
+    double K = 100;
+
+    std::vector<std::shared_ptr<Payoff>> payoffs = {std::make_shared<CallPayoff>(), std::make_shared<PutPayoff>(),
+                                                    std::make_shared<DigitalCallPayoff>(), std::make_shared<DigitalPutPayoff>()};
+    std::vector<double> out(3);
+
+    for (const auto& payoff : payoffs) {
+        payoff->compute_batch(paths, K, out);
+        for (size_t p = 0; p < 3; p++) {
+            REQUIRE(out[p] == payoff->compute(paths.path(p).spot, K));
+        }
+    }
+
+    std::vector<double> wrong(2);
+    REQUIRE_THROWS_AS(payoffs[0]->compute_batch(paths, K, wrong), std::invalid_argument);
+    REQUIRE_THROWS_AS(payoffs[0]->compute_batch(paths, -1, out), std::invalid_argument);
+}
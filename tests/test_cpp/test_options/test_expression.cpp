@@ -0,0 +1,113 @@
+#include "engine/montecarlo.hpp"
+#include "instruments/instrument.h"
+#include "models/black_scholes/black_scholes.hpp"
+#include "options/options.hpp"
+#include "payoff/expression.hpp"
+#include "payoff/payoff.h"
+#include "schemes/euler.h"
+#include "pricing/pricer.h"
+#include "types/marketstate.h"
+#include "types/pathfeatures.hpp"
+#include "types/simulationresult.hpp"
+#include "types/timegrid.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+
+TEST_CASE("Expression payoff : parsing"){
+
+    REQUIRE(ExpressionPayoff("max(S[T] - K, 0)").expression() == "max(S[T] - K, 0)");
+    REQUIRE_NOTHROW(ExpressionPayoff("min(max(S[T] - K, 0), 20) + 0.5 * (S[0.5] > K) - -1"));
+    REQUIRE_NOTHROW(ExpressionPayoff("sqrt(abs(log(S[T] / K))) * exp(-0.1) + sum(S) / 4"));
+
+    REQUIRE_THROWS_AS(ExpressionPayoff(""), std::invalid_argument);
+    REQUIRE_THROWS_AS(ExpressionPayoff("S"), std::invalid_argument);
+    REQUIRE_THROWS_AS(ExpressionPayoff("max(S, K)"), std::invalid_argument);
+    REQUIRE_THROWS_AS(ExpressionPayoff("max(S[T] - K, 0"), std::invalid_argument);
+    REQUIRE_THROWS_AS(ExpressionPayoff("payoff(S[T])"), std::invalid_argument);
+    REQUIRE_THROWS_AS(ExpressionPayoff("mean(S[T])"), std::invalid_argument);
+    REQUIRE_THROWS_AS(ExpressionPayoff("max(mean(S))"), std::invalid_argument);
+    REQUIRE_THROWS_AS(ExpressionPayoff("S[t]"), std::invalid_argument);
+    REQUIRE_THROWS_AS(ExpressionPayoff("S[T] K"), std::invalid_argument);
+
+    // only S[T] : priced like a vanilla
+    REQUIRE_FALSE(ExpressionPayoff("max(S[T] - K, 0)").path_dependent());
+    REQUIRE(ExpressionPayoff("max(S[T] - K, 0)").uses_features());
+    REQUIRE(ExpressionPayoff("max(max(S) - K, 0)").path_dependent());
+    REQUIRE(ExpressionPayoff("max(mean(S) - K, 0) * (min(S) > 80)").uses_features());
+    REQUIRE_FALSE(ExpressionPayoff("mean(S > 90)").uses_features());
+    REQUIRE_FALSE(ExpressionPayoff("S[0.5]").uses_features());
+}
+
+TEST_CASE("Expression payoff : values on a path"){
+
+    std::vector<double> spot{100, 110, 120, 130, 90};
+    std::vector<double> times{0, 0.25, 0.5, 0.75, 1};
+    PathView path{spot, {}, times};
+
+    REQUIRE(ExpressionPayoff("max(S[T] - K, 0)").compute(spot, 80) == Catch::Approx(10));
+    REQUIRE(ExpressionPayoff("min(max(S) - K, 20)").compute(spot, 100) == Catch::Approx(20));
+    REQUIRE(ExpressionPayoff("max(mean(S) - K, 0)").compute(spot, 100) == Catch::Approx(10));
+    REQUIRE(ExpressionPayoff("mean((S > 105) * (S < 125))").compute(spot, 0) == Catch::Approx(0.4));
+    REQUIRE(ExpressionPayoff("sum(S >= 120) + min(S)").compute(spot, 0) == Catch::Approx(92));
+    REQUIRE(ExpressionPayoff("2 * -(S[T] - K) / 4 + 1").compute(spot, 100) == Catch::Approx(6));
+
+    // a fixing reads the last state at or before its time
+    REQUIRE(ExpressionPayoff("S[0.5]").compute_path(path, 0) == Catch::Approx(120));
+    REQUIRE(ExpressionPayoff("S[0.6] - S[0]").compute_path(path, 0) == Catch::Approx(20));
+    REQUIRE_THROWS_AS(ExpressionPayoff("S[0.5]").compute(spot, 0), std::invalid_argument);
+
+    // the accumulator sees the same states
+    for (const char* e : {"min(max(S) - K, 20)", "mean((S > 105) * (S < 125))", "S[0.6] - S[0] + mean(S)"}) {
+        ExpressionPayoff payoff(e);
+        auto acc = payoff.accumulator(100);
+        acc->start(spot[0], 0.2, times[0]);
+        for (size_t k = 1; k < spot.size(); k++) acc->update(spot[k], 0.2, times[k]);
+        REQUIRE(acc->finalize() == Catch::Approx(payoff.compute_path(path, 100)));
+    }
+}
+
+TEST_CASE("Expression payoff : pricing"){
+
+    double S0 = 100.0;
+    double r = 0.02;
+    double T = 1.0;
+
+    auto engine = std::make_shared<MonteCarlo>(Euler(std::make_shared<BlackScholes>(r, 0.2)));
+    engine->configure(3, -1);
+    Pricer pricer(MarketState(S0, r), 50, 20000, engine);
+
+    CallPayoff call;
+    auto vanilla = std::make_shared<Instrument>(OptionContract(105, T), std::make_shared<CallPayoff>());
+    auto barrier = std::make_shared<Instrument>(OptionContract(105, T), std::make_shared<BarrierPayoff>(130, Up, Out, call));
+    auto expr_vanilla = std::make_shared<Instrument>(OptionContract(105, T), std::make_shared<ExpressionPayoff>("max(S[T] - K, 0)"));
+    auto expr_barrier = std::make_shared<Instrument>(OptionContract(105, T), std::make_shared<ExpressionPayoff>("max(S[T] - K, 0) * (max(S) < 130)"));
+    auto asian = std::make_shared<Instrument>(OptionContract(105, T), std::make_shared<ExpressionPayoff>("max(mean(S) - K, 0)"));
+    auto fixing = std::make_shared<Instrument>(OptionContract(105, T), std::make_shared<ExpressionPayoff>("max(S[0.5] - K, 0)"));
+
+    // single instruments use the accumulators, batches the features
+    engine->reset_rng();
+    std::vector<double> reference = pricer.batch_price({vanilla, barrier});
+    engine->reset_rng();
+    std::vector<double> features = pricer.batch_price({expr_vanilla, expr_barrier, asian});
+    engine->reset_rng();
+    REQUIRE(pricer.compute_price(expr_barrier) == Catch::Approx(reference[1]).epsilon(1e-10));
+    REQUIRE(features[0] == Catch::Approx(reference[0]).epsilon(1e-10));
+    REQUIRE(features[1] == Catch::Approx(reference[1]).epsilon(1e-10));
+
+    // stored paths, with the batch kernels
+    engine->reset_rng();
+    SimulationResult sim = engine->generate_spot(S0, TimeGrid::uniform(T, 50), 20000);
+    const double discount = std::exp(-r * T);
+    REQUIRE(asian->compute_payoff(sim) * discount == Catch::Approx(features[2]).epsilon(1e-10));
+    REQUIRE(features[2] < features[0]);
+
+    engine->reset_rng();
+    const double half = pricer.compute_price(fixing);
+    REQUIRE(fixing->compute_payoff(sim) * discount == Catch::Approx(half).epsilon(1e-10));
+    REQUIRE(half < features[0]);
+}
@@ -1,19 +1,28 @@
 
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/catch_approx.hpp>  
+#include <algorithm>
 #include <memory>
 #include <optional>
+#include <span>
 #include <stdexcept>
+#include <vector>
 #include <cmath>
 #include "pricing/pricer.h"
 #include "models/black_scholes/black_scholes.hpp"
 #include "options/options.hpp"
 #include "payoff/payoff.h"
 #include "instruments/instrument.h"
+#include "instruments/instrumenttable.hpp"
 #include "schemes/euler.h"
+#include "schemes/eulerblackscholes.hpp"
+#include "schemes/exactvasicek.hpp"
+#include "models/ir_models/vasicek.h"
+#include "engine/cancellation.hpp"
 #include "engine/montecarlo.hpp"
 #include "types/marketstate.h"
 #include "types/simulationresult.hpp"
+#include "types/timegrid.hpp"
 
 
 static double price_bs_call(float S, float K, float T, float sigma, float r) {
@@ -51,6 +60,20 @@ static double price_bs_put(float S, float K, float T, float sigma, float r) {
     return (-S * N_minus_d1 + K * std::exp(-r * T) * N_minus_d2);
 }
 
+// payoff defined outside of the library, reading the whole path
+class LookbackPayoff : public Payoff {
+
+public:
+    double compute(std::span<const double> path, double K) const override {
+        return std::max(*std::max_element(path.begin(), path.end()) - K, 0.0);
+    }
+
+    std::shared_ptr<Payoff> clone() const override {
+        return std::make_shared<LookbackPayoff>(*this);
+    }
+
+};
+
 TEST_CASE("Pricer : construction") {
 
     double S0 = 100;
@@ -318,4 +341,328 @@ TEST_CASE("Pricer : options with different maturities") {
                 std::make_shared<MonteCarlo>(engine));
 
     REQUIRE_THROWS_AS(pricer.batch_price(instruments), std::invalid_argument);
-}
\ No newline at end of file
+}
+TEST_CASE("Pricer : single step pricing with an exact scheme") {
+
+    double S0 = 100.0;
+    double r = 0.02;
+    double sigma = 0.2;
+    double T = 1.1;
+
+    auto call = std::make_shared<Instrument>(OptionContract(102, T), std::make_shared<CallPayoff>());
+    CallPayoff call_payoff;
+    auto barrier = std::make_shared<Instrument>(OptionContract(102, T),
+                                                std::make_shared<BarrierPayoff>(120, Up, Out, call_payoff));
+
+    REQUIRE_FALSE(call->path_dependent());
+    REQUIRE(barrier->path_dependent());
+
+    MonteCarlo engine(EulerBlackScholes{BlackScholes(r, sigma)});
+    engine.configure(1, -1);
+    MarketState mstate(S0, r);
+
+    Pricer pricer(mstate, 252, 100000, std::make_shared<MonteCarlo>(engine));
+    Pricer one_step(mstate, 1, 100000, std::make_shared<MonteCarlo>(engine));
+
+    // European payoffs ignore the configured number of steps
+    double price = pricer.compute_price(call);
+    REQUIRE(price == one_step.compute_price(call));
+    REQUIRE(price == Catch::Approx(price_bs_call(S0, 102, T, sigma, r)).epsilon(0.02));
+    REQUIRE(pricer.compute_delta_bar(call, 0.01) == one_step.compute_delta_bar(call, 0.01));
+
+    // path dependent payoffs keep the full grid
+    pricer.reconfigure(50, 5000, std::nullopt);
+    one_step.reconfigure(std::nullopt, 5000, std::nullopt);
+    REQUIRE(pricer.compute_price(barrier) != one_step.compute_price(barrier));
+    REQUIRE(pricer.batch_price({call, barrier})[0] != one_step.batch_price({call, barrier})[0]);
+}
+
+TEST_CASE("Pricer : instrument table") {
+
+    double S0 = 100.0;
+    double r = 0.02;
+    double sigma = 0.2;
+    double nan = std::nan("");
+
+    std::vector<double> K{95, 105, 100, 100, 100};
+    std::vector<double> T{1.0, 1.0, 0.5, 1.0, 1.0};
+    std::vector<int32_t> codes{CallCode, PutCode, CallCode, DigitalCallCode, CallCode};
+    std::vector<double> barrier{nan, nan, nan, nan, 120};
+    std::vector<int32_t> direction{0, 0, 0, 0, Up};
+    std::vector<int32_t> nature{0, 0, 0, 0, Out};
+    InstrumentTable table{K, T, codes, barrier, direction, nature};
+
+    BlackScholes bs(r, sigma);
+    auto engine = std::make_shared<MonteCarlo>(Euler(std::make_shared<BlackScholes>(bs)));
+    engine->configure(1, -1);
+    Pricer pricer(MarketState(S0, r), 50, 20000, engine);
+
+    TablePrices prices = pricer.price_table(table);
+    REQUIRE(prices.price.size() == 5);
+    REQUIRE(prices.price[0] == Catch::Approx(price_bs_call(S0, 95, 1.0, sigma, r)).epsilon(0.05));
+    REQUIRE(prices.price[2] == Catch::Approx(price_bs_call(S0, 100, 0.5, sigma, r)).epsilon(0.05));
+    REQUIRE(prices.price[4] < prices.price[2] + prices.price[0]);
+    for (double e : prices.std_error) REQUIRE(e > 0.0);
+    REQUIRE(std::abs(prices.price[0] - price_bs_call(S0, 95, 1.0, sigma, r)) < 4 * prices.std_error[0]);
+
+    // same paths as a batch of instruments of the same maturity
+    CallPayoff call;
+    std::vector<std::shared_ptr<Instrument>> instruments{
+        std::make_shared<Instrument>(OptionContract(95, 1.0), std::make_shared<CallPayoff>()),
+        std::make_shared<Instrument>(OptionContract(105, 1.0), std::make_shared<PutPayoff>()),
+        std::make_shared<Instrument>(OptionContract(100, 1.0), std::make_shared<DigitalCallPayoff>()),
+        std::make_shared<Instrument>(OptionContract(100, 1.0), std::make_shared<BarrierPayoff>(120, Up, Out, call))};
+    engine->reset_rng();
+    std::vector<double> batch = pricer.batch_price(instruments);
+
+    std::vector<double> K1{95, 105, 100, 100};
+    std::vector<double> T1{1.0, 1.0, 1.0, 1.0};
+    std::vector<int32_t> codes1{CallCode, PutCode, DigitalCallCode, CallCode};
+    std::vector<double> barrier1{nan, nan, nan, 120};
+    std::vector<int32_t> direction1{0, 0, 0, Up};
+    std::vector<int32_t> nature1{0, 0, 0, Out};
+    engine->reset_rng();
+    TablePrices same = pricer.price_table(InstrumentTable{K1, T1, codes1, barrier1, direction1, nature1});
+    for (size_t i = 0; i < 4; i++) REQUIRE(same.price[i] == Catch::Approx(batch[i]).epsilon(1e-12));
+
+    // vanilla only table
+    TablePrices vanilla = pricer.price_table(InstrumentTable{K1, T1, codes1});
+    REQUIRE(vanilla.price.size() == 4);
+
+    std::vector<int32_t> bad_codes{CallCode, 7, CallCode, CallCode};
+    std::vector<double> short_T{1.0};
+    REQUIRE_THROWS_AS(pricer.price_table(InstrumentTable{K1, T1, bad_codes}), std::invalid_argument);
+    REQUIRE_THROWS_AS(pricer.price_table(InstrumentTable{K1, short_T, codes1}), std::invalid_argument);
+    REQUIRE_THROWS_AS(pricer.price_table(InstrumentTable{}), std::invalid_argument);
+}
+
+TEST_CASE("Pricer : function payoffs evaluated by chunks") {
+
+    double S0 = 100.0;
+    double r = 0.02;
+    double sigma = 0.2;
+    double T = 1.0;
+
+    size_t calls = 0;
+    size_t largest = 0;
+    FunctionPayoff::Function call_function = [&](const PathsView& paths, double K, std::span<double> out){
+        calls++;
+        largest = std::max(largest, paths.n_paths);
+        for (size_t p = 0; p < paths.n_paths; p++) out[p] = std::max(paths.path(p).spot.back() - K, 0.0);
+    };
+    auto function_call = std::make_shared<Instrument>(OptionContract(102, T), std::make_shared<FunctionPayoff>(call_function, 3000));
+    auto call = std::make_shared<Instrument>(OptionContract(102, T), std::make_shared<CallPayoff>());
+    REQUIRE(function_call->chunk_paths() == 3000);
+    REQUIRE(function_call->path_dependent());
+
+    BlackScholes bs(r, sigma);
+    auto engine = std::make_shared<MonteCarlo>(Euler(std::make_shared<BlackScholes>(bs)));
+    engine->configure(1, -1);
+    Pricer pricer(MarketState(S0, r), 50, 10000, engine);
+
+    // same paths as the other routes, evaluated in 4 calls
+    double price = pricer.compute_price(function_call);
+    REQUIRE(calls == 4);
+    REQUIRE(largest == 3000);
+    engine->reset_rng();
+    REQUIRE(price == Catch::Approx(pricer.compute_price(call)).epsilon(1e-12));
+
+    // the engine generator advances as with any other run
+    double next = pricer.compute_price(function_call);
+    REQUIRE(next != price);
+    engine->reset_rng();
+    pricer.compute_price(function_call);
+    REQUIRE(pricer.compute_price(call) == Catch::Approx(next).epsilon(1e-12));
+
+    // mixed with built-in payoffs in a batch
+    engine->reset_rng();
+    std::vector<double> batch = pricer.batch_price({function_call, call});
+    REQUIRE(batch[0] == Catch::Approx(price).epsilon(1e-12));
+    REQUIRE(batch[1] == Catch::Approx(price).epsilon(1e-12));
+
+    // cancelled while the chunks are evaluated
+    CancellationToken token;
+    FunctionPayoff::Function cancelling = [&](const PathsView& paths, double K, std::span<double> out){
+        call_function(paths, K, out);
+        token.cancel();
+    };
+    auto cancelled_call = std::make_shared<Instrument>(OptionContract(102, T), std::make_shared<FunctionPayoff>(cancelling, 3000));
+    calls = 0;
+    {
+        CancellationToken::Scope scope(token);
+        REQUIRE_THROWS_AS(pricer.compute_price(cancelled_call), Cancelled);
+    }
+    REQUIRE(calls == 1);
+
+    REQUIRE_THROWS_AS(FunctionPayoff(call_function, 0), std::invalid_argument);
+    REQUIRE_THROWS_AS(FunctionPayoff(nullptr, 10), std::invalid_argument);
+}
+
+TEST_CASE("Pricer : scenario grid") {
+
+    double r = 0.02;
+    double sigma = 0.2;
+
+    auto call = std::make_shared<Instrument>(OptionContract(100, 1.0), std::make_shared<CallPayoff>());
+    auto put = std::make_shared<Instrument>(OptionContract(95, 1.0), std::make_shared<PutPayoff>());
+    auto short_call = std::make_shared<Instrument>(OptionContract(105, 0.5), std::make_shared<CallPayoff>());
+    CallPayoff call_payoff;
+    auto barrier = std::make_shared<Instrument>(OptionContract(100, 1.0), std::make_shared<BarrierPayoff>(85, Down, Out, call_payoff));
+    std::vector<std::shared_ptr<Instrument>> book{call, put, short_call, barrier};
+
+    std::vector<MarketState> scenarios;
+    for (double S0 : {90.0, 100.0, 110.0}) {
+        for (double rate : {0.0, 0.02, 0.05}) scenarios.emplace_back(S0, rate);
+    }
+
+    // each maturity matches a batch on the same random numbers after reconfigure
+    auto check = [&](std::shared_ptr<MonteCarlo> engine, const std::vector<std::shared_ptr<Instrument>>& instruments) {
+        Pricer pricer(MarketState(100, r), 20, 5000, engine);
+        std::vector<std::vector<double>> prices = pricer.scenario_prices(scenarios, instruments);
+        REQUIRE(prices.size() == scenarios.size());
+
+        Pricer reference(MarketState(100, r), 20, 5000, engine);
+        for (size_t k = 0; k < scenarios.size(); k++) {
+            REQUIRE(prices[k].size() == instruments.size());
+            reference.reconfigure(std::nullopt, std::nullopt, scenarios[k]);
+            for (double T : {0.5, 1.0}) {
+                std::vector<std::shared_ptr<Instrument>> batch;
+                std::vector<size_t> members;
+                for (size_t i = 0; i < instruments.size(); i++) {
+                    if (instruments[i]->get_maturity() == T) {
+                        batch.push_back(instruments[i]);
+                        members.push_back(i);
+                    }
+                }
+                if (batch.empty()) continue;
+                engine->reset_rng();
+                std::vector<double> expected = reference.batch_price(batch);
+                for (size_t m = 0; m < members.size(); m++) REQUIRE(prices[k][members[m]] == Catch::Approx(expected[m]).epsilon(1e-9));
+            }
+        }
+    };
+
+    SECTION("spot homogeneous scheme") {
+        auto engine = std::make_shared<MonteCarlo>(Euler(std::make_shared<BlackScholes>(r, sigma)));
+        engine->configure(1, -1);
+        REQUIRE(engine->get_scheme().spot_homogeneous());
+        check(engine, book);
+
+        // payoffs evaluated by chunks are priced spot by spot through their
+        // chunks, on the calling thread
+        size_t largest = 0;
+        auto function_call = std::make_shared<Instrument>(OptionContract(100, 1.0), std::make_shared<FunctionPayoff>(
+            [&](const PathsView& paths, double K, std::span<double> out){
+                largest = std::max(largest, paths.n_paths);
+                for (size_t p = 0; p < paths.n_paths; p++) out[p] = std::max(paths.path(p).spot.back() - K, 0.0);
+            }, 1000));
+        check(engine, {call, function_call});
+        REQUIRE(largest == 1000);
+
+        // the sweep leaves the generator of the engine untouched
+        engine->reset_rng();
+        Pricer pricer(MarketState(100, r), 20, 5000, engine);
+        double before = pricer.compute_price(call);
+        engine->reset_rng();
+        pricer.scenario_prices(scenarios, book);
+        REQUIRE(pricer.compute_price(call) == Catch::Approx(before).epsilon(1e-12));
+    }
+
+    SECTION("re-simulated scheme") {
+        auto engine = std::make_shared<MonteCarlo>(ExactVasicek{Vasicek(0.8, 0.04, 0.02)});
+        engine->configure(1, -1);
+        REQUIRE_FALSE(engine->get_scheme().spot_homogeneous());
+        std::vector<std::shared_ptr<Instrument>> rates{
+            std::make_shared<Instrument>(OptionContract(0.03, 1.0), std::make_shared<CallPayoff>()),
+            std::make_shared<Instrument>(OptionContract(0.03, 1.0), std::make_shared<PutPayoff>())};
+        scenarios = {MarketState(0.02, 0.0), MarketState(0.05, 0.01), MarketState(0.02, 0.03)};
+        check(engine, rates);
+    }
+
+    auto engine = std::make_shared<MonteCarlo>(Euler(std::make_shared<BlackScholes>(r, sigma)));
+    Pricer pricer(MarketState(100, r), 20, 5000, engine);
+    REQUIRE_THROWS_AS(pricer.scenario_prices({}, book), std::invalid_argument);
+    REQUIRE_THROWS_AS(pricer.scenario_prices(scenarios, {}), std::invalid_argument);
+    REQUIRE_THROWS_AS(pricer.scenario_prices({MarketState(0.0, r)}, book), std::invalid_argument);
+}
+
+TEST_CASE("Pricer : parameter batch") {
+
+    double S0 = 100.0;
+    double r = 0.02;
+
+    auto call = std::make_shared<Instrument>(OptionContract(100, 1.0), std::make_shared<CallPayoff>());
+    auto short_put = std::make_shared<Instrument>(OptionContract(95, 0.5), std::make_shared<PutPayoff>());
+    auto function_call = std::make_shared<Instrument>(OptionContract(100, 1.0), std::make_shared<FunctionPayoff>(
+        [](const PathsView& paths, double K, std::span<double> out){
+            for (size_t p = 0; p < paths.n_paths; p++) out[p] = std::max(paths.path(p).spot.back() - K, 0.0);
+        }, 1000));
+    std::vector<std::shared_ptr<Instrument>> book{call, short_put, function_call};
+
+    std::vector<std::shared_ptr<Scheme>> schemes;
+    for (double sigma : {0.15, 0.2, 0.25}) schemes.push_back(std::make_shared<Euler>(std::make_shared<BlackScholes>(r, sigma)));
+
+    auto engine = std::make_shared<MonteCarlo>(schemes[1]);
+    engine->configure(3, -1);
+    Pricer pricer(MarketState(S0, r), 20, 5000, engine);
+    std::vector<std::vector<double>> prices = pricer.parameter_prices(schemes, book);
+    REQUIRE(prices.size() == 3);
+
+    // each row is the pricing with the scheme alone, maturity after maturity
+    for (size_t k = 0; k < schemes.size(); k++) {
+        auto single = std::make_shared<MonteCarlo>(schemes[k]);
+        single->configure(3, -1);
+        Pricer reference(MarketState(S0, r), 20, 5000, single);
+        const double short_price = reference.compute_price(short_put);
+        std::vector<double> long_prices = reference.batch_price({call, function_call});
+        REQUIRE(prices[k][1] == Catch::Approx(short_price).epsilon(1e-12));
+        REQUIRE(prices[k][0] == Catch::Approx(long_prices[0]).epsilon(1e-12));
+        REQUIRE(prices[k][2] == Catch::Approx(long_prices[1]).epsilon(1e-12));
+    }
+
+    // shared random numbers : the vega from the bumped rows is close to Black-Scholes
+    const double vega = (prices[2][0] - prices[0][0]) / 0.1;
+    REQUIRE(vega == Catch::Approx(38.7).epsilon(0.05));
+
+    REQUIRE_THROWS_AS(pricer.parameter_prices({}, book), std::invalid_argument);
+    REQUIRE_THROWS_AS(pricer.parameter_prices(schemes, {}), std::invalid_argument);
+}
+
+TEST_CASE("Pricer : payoffs are path dependent unless they say otherwise") {
+
+    double S0 = 100.0;
+    double r = 0.02;
+    double T = 1.0;
+
+    auto lookback = std::make_shared<Instrument>(OptionContract(100, T), std::make_shared<LookbackPayoff>());
+    auto call = std::make_shared<Instrument>(OptionContract(100, T), std::make_shared<CallPayoff>());
+    REQUIRE(lookback->path_dependent());
+    REQUIRE_FALSE(call->path_dependent());
+    // nor streamed through the terminal spot accumulator
+    REQUIRE(lookback->accumulator() == nullptr);
+    REQUIRE(call->accumulator() != nullptr);
+    // nor computed from the terminal spot of the path features
+    REQUIRE_FALSE(lookback->uses_features());
+    REQUIRE(call->uses_features());
+
+    // an exact scheme still simulates every step for the custom payoff
+    auto engine = std::make_shared<MonteCarlo>(EulerBlackScholes(BlackScholes(r, 0.2)));
+    engine->configure(5, -1);
+    Pricer pricer(MarketState(S0, r), 50, 20000, engine);
+    const double price = pricer.compute_price(lookback);
+
+    engine->reset_rng();
+    SimulationResult paths = engine->generate_spot(S0, TimeGrid::uniform(T, 50), 20000);
+    REQUIRE(price == Catch::Approx(lookback->compute_payoff(paths) * std::exp(-r * T)).epsilon(1e-12));
+    REQUIRE(price > 1.5 * price_bs_call(S0, 100, T, 0.2, r));
+
+    // and in a batch with a vanilla
+    engine->reset_rng();
+    std::vector<double> batch = pricer.batch_price({lookback, call});
+    REQUIRE(batch[0] == Catch::Approx(price).epsilon(1e-12));
+
+    // and alone in a scenario sweep, whose paths are rescaled
+    std::vector<std::vector<double>> scenarios = pricer.scenario_prices({MarketState(S0, r), MarketState(110, r)}, {lookback});
+    REQUIRE(scenarios[0][0] == Catch::Approx(price).epsilon(1e-9));
+    REQUIRE(scenarios[1][0] > price);
+}
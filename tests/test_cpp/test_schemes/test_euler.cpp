@@ -11,9 +11,12 @@
 
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/catch_approx.hpp>  
+#include <atomic>
 #include <cmath>
 #include <memory>
 #include <optional>
+#include <random>
+#include <span>
 #include <stdexcept>
 #include <utility>
 #include <vector>
@@ -21,10 +24,12 @@
 #include "models/black_scholes/black_scholes.hpp"
 #include "models/dupire/dupire.hpp"
 #include "models/heston/heston.hpp"
+#include "models/ir_models/vasicek.h"
 #include "schemes/euler.h"
 #include "schemes/eulerheston.hpp"
 #include "surface/local_vol.hpp"
 #include "types/simulationresult.hpp"
+#include "types/timegrid.hpp"
 
 
 TEST_CASE("Scheme - Euler - BlackScholes") {
@@ -181,3 +186,104 @@ SECTION("Invalid dt") {
     REQUIRE_THROWS_AS(euler.step(init.first, init.second, 0, -0.1f, rng), std::invalid_argument);
 }
 }
+
+TEST_CASE("Scheme - Euler - Fused model coefficients") {
+
+    std::shared_ptr<LocalVolatilitySurface> surface = make_surface();
+    std::vector<std::shared_ptr<Model>> models{
+        std::make_shared<BlackScholes>(0.05, 0.2),
+        std::make_shared<Vasicek>(0.5, 0.04, 0.01),
+        std::make_shared<Dupire>(0.03, 0.01, surface)
+    };
+
+    std::vector<double> S{85.0, 99.5, 100.0, 112.3};
+    std::vector<double> drift(S.size()), diffusion(S.size()), vol(S.size());
+
+    for (const auto& model : models) {
+        for (double t : {0.0, 0.3, 0.75}) {
+
+            model->coefficients_batch(t, S, drift, diffusion, vol);
+
+            for (size_t i = 0; i < S.size(); i++) {
+                Coefficients c = model->coefficients(t, S[i]);
+                REQUIRE(c.drift == model->drift(t, S[i]));
+                REQUIRE(c.diffusion == model->diffusion(t, S[i]));
+                REQUIRE(c.volatility == model->volatility(t, S[i]));
+
+                REQUIRE(drift[i] == c.drift);
+                REQUIRE(diffusion[i] == c.diffusion);
+                REQUIRE(vol[i] == c.volatility);
+            }
+        }
+
+        std::vector<double> wrong_size(1);
+        REQUIRE_THROWS_AS(model->coefficients_batch(0.1, S, wrong_size, diffusion, vol), std::invalid_argument);
+    }
+
+    // the Euler step is unchanged by the fused evaluation
+    Dupire dupire(0.03, 0.01, surface);
+    Euler euler(std::make_shared<Dupire>(dupire));
+    std::mt19937 rng(7), rng_ref(7);
+    double t = 0.3;
+    double dt = 0.1;
+
+    std::pair<double, double> state = euler.step(100, 0.2, t, dt, rng);
+    std::normal_distribution<double> dist;
+    double Z = dist(rng_ref);
+    double expected = 100 + dupire.drift(t, 100) * dt + dupire.diffusion(t, 100) * Z * std::sqrt(dt);
+    REQUIRE(state.first == expected);
+    REQUIRE(state.second == dupire.volatility(t, 100));
+}
+
+// Black-Scholes model counting the evaluations of its coefficients
+struct CountingModel : BlackScholes {
+    CountingModel() : BlackScholes(0.03, 0.25) {}
+
+    Coefficients coefficients(double t, const double S) const override {
+        scalar++;
+        return BlackScholes::coefficients(t, S);
+    }
+    void coefficients_batch(double t, std::span<const double> S, std::span<double> drift,
+                            std::span<double> diffusion, std::span<double> vol) const override {
+        batches++;
+        BlackScholes::coefficients_batch(t, S, drift, diffusion, vol);
+    }
+
+    mutable std::atomic<size_t> scalar = 0;
+    mutable std::atomic<size_t> batches = 0;
+};
+
+TEST_CASE("Scheme - Euler - Block steps") {
+
+    auto model = std::make_shared<CountingModel>();
+    MonteCarlo mc{Euler(model)};
+    REQUIRE(mc.get_scheme().block_steps());
+
+    mc.configure(11, -1, true, PathMajor);
+    SimulationResult path_major = mc.generate_spot(100, TimeGrid::uniform(1, 10), 300);
+    REQUIRE(model->scalar > 0);
+    REQUIRE(model->batches == 0);
+
+    // time-major blocks are stepped together with the batched coefficients,
+    // on the same paths
+    model->scalar = 0;
+    mc.configure(11, -1, true, TimeMajor);
+    SimulationResult time_major = mc.generate_spot(100, TimeGrid::uniform(1, 10), 300);
+    REQUIRE(model->scalar == 0);
+    REQUIRE(model->batches == 10 * 5);
+    for (size_t p = 0; p < 300; p++) {
+        for (size_t j = 0; j <= 10; j++) {
+            REQUIRE(time_major.get_paths()[j * 300 + p] == path_major.get_paths()[p * 11 + j]);
+            REQUIRE(time_major.vols()[j * 300 + p] == path_major.vols()[p * 11 + j]);
+        }
+    }
+
+    // the default block step is step_from on each path
+    EulerHeston heston(Heston{0.02, 2, 0.05, 0.4, -0.5});
+    std::vector<double> S{100, 105}, v{0.2, 0.25}, z{0.1, -0.4, 1.2, 0.3};
+    std::pair<double, double> first = heston.step_from(100, 0.2, 0, 0.1, std::span<const double>(z).subspan(0, 2));
+    heston.step_block(S, v, 0, 0.1, z);
+    REQUIRE(S[0] == first.first);
+    REQUIRE(v[0] == first.second);
+    REQUIRE_THROWS_AS(heston.step_block(S, v, 0, 0.1, std::span<const double>(z).subspan(0, 3)), std::invalid_argument);
+}
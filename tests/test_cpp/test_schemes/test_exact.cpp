@@ -0,0 +1,119 @@
+/*
+ _            _                              _   
+| |_ ___  ___| |_ ___    _____  ____ _  ___| |_ 
+| __/ _ \/ __| __/ __|  / _ \ \/ / _` |/ __| __|
+| ||  __/\__ \ |_\__ \ |  __/>  < (_| | (__| |_ 
+ \__\___||___/\__|___/  \___/_/\_\__,_|\___|\__|
+
+*/
+
+
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>  
+#include <cmath>
+#include <memory>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "engine/montecarlo.hpp"
+#include "models/black_scholes/black_scholes.hpp"
+#include "models/ir_models/vasicek.h"
+#include "schemes/euler.h"
+#include "schemes/eulerblackscholes.hpp"
+#include "schemes/exactvasicek.hpp"
+#include "types/simulationresult.hpp"
+
+
+TEST_CASE("Scheme - EulerBlackScholes") {
+
+SECTION("Exact transition") {
+
+    BlackScholes bs{0.05, 0.2};
+    EulerBlackScholes scheme(bs);
+    REQUIRE(scheme.exact());
+    REQUIRE_FALSE(Euler(std::make_shared<BlackScholes>(bs)).exact());
+
+    std::mt19937 rng(3), rng_ref(3);
+    double dt = 0.7;
+    std::pair<double, double> state = scheme.step(100, 0.2, 1, dt, rng);
+
+    std::normal_distribution<double> dist;
+    double Z = dist(rng_ref);
+    double sigma = bs.sigma;
+    double expected = 100 * std::exp((bs.mu - 0.5*sigma*sigma)*dt + sigma*std::sqrt(dt)*Z);
+    REQUIRE(state.first == Catch::Approx(expected).epsilon(1e-12));
+    REQUIRE(state.second == Catch::Approx(0.2));
+}
+
+SECTION("Single step terminal moments") {
+
+    BlackScholes bs{0.05, 0.3};
+    MonteCarlo engine(EulerBlackScholes{bs});
+    engine.configure(1, -1);
+
+    double T = 2.0;
+    SimulationResult sim = engine.generate_spot(100, 1, T, 200000);
+
+    // E[S_T] = S0 e^{mu T} without any discretization bias
+    REQUIRE(sim.avg_terminal_value() == Catch::Approx(100 * std::exp(0.05 * T)).epsilon(0.01));
+}
+
+SECTION("Invalid dt") {
+    EulerBlackScholes scheme(BlackScholes{0.02, 0.2});
+    std::mt19937 rng;
+    REQUIRE_THROWS_AS(scheme.step(100, 0.2, 0, 0.0f, rng), std::invalid_argument);
+    REQUIRE_THROWS_AS(scheme.step(100, 0.2, 0, -0.1f, rng), std::invalid_argument);
+}
+
+}
+
+TEST_CASE("Scheme - ExactVasicek") {
+
+SECTION("Exact transition") {
+
+    Vasicek vasicek(0.8, 0.04, 0.02);
+    ExactVasicek scheme(vasicek);
+    REQUIRE(scheme.exact());
+
+    std::pair<double, double> init = scheme.init_state(0.01, std::nullopt);
+    REQUIRE(init.first == 0.01);
+    REQUIRE(init.second == 0.02);
+
+    std::mt19937 rng(5), rng_ref(5);
+    double dt = 1.5;
+    std::pair<double, double> state = scheme.step(0.01, 0.02, 1, dt, rng);
+
+    std::normal_distribution<double> dist;
+    double Z = dist(rng_ref);
+    double mean = 0.01 * std::exp(-0.8 * dt) + 0.04 * (1 - std::exp(-0.8 * dt));
+    double std_dev = 0.02 * std::sqrt((1 - std::exp(-1.6 * dt)) / 1.6);
+    REQUIRE(state.first == Catch::Approx(mean + std_dev * Z).epsilon(1e-12));
+}
+
+SECTION("Single step terminal distribution") {
+
+    double a = 0.5, b = 0.05, sigma = 0.03, r0 = 0.01, T = 3.0;
+    MonteCarlo engine(ExactVasicek{Vasicek(a, b, sigma)});
+    engine.configure(1, -1);
+
+    size_t n_paths = 200000;
+    SimulationResult sim = engine.generate_spot(r0, 1, T, n_paths);
+    const std::vector<double>& rates = sim.get_paths();
+
+    double mean = 0, sq = 0;
+    for (size_t p = 0; p < n_paths; p++) {
+        double r = rates[2*p + 1];
+        mean += r;
+        sq += r * r;
+    }
+    mean /= n_paths;
+    double var = sq / n_paths - mean * mean;
+
+    REQUIRE(mean == Catch::Approx(r0 * std::exp(-a*T) + b * (1 - std::exp(-a*T))).epsilon(0.01));
+    REQUIRE(var == Catch::Approx(sigma*sigma * (1 - std::exp(-2*a*T)) / (2*a)).epsilon(0.02));
+}
+
+}
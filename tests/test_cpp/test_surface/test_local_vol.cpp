@@ -1,7 +1,11 @@
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/catch_approx.hpp>  
+#include <algorithm>
+#include <cmath>
 #include <optional>
+#include <random>
 #include <stdexcept>
+#include <vector>
 
 #include "surface/local_vol.hpp"
 
@@ -82,3 +86,149 @@ TEST_CASE("Local Volatility Surface - Interpolation") {
     }
 
 }
+
+
+// reference implementation : binary search on both axes, as done before the
+// grid lookup was precompiled
+static double reference_sigma(const std::vector<double>& times, const std::vector<double>& spots,
+                              const std::vector<double>& vol, double t, double S) {
+
+    auto low_index = [](const std::vector<double>& vec, double val) -> size_t {
+        if (val <= vec.front()) return 0;
+        if (val >= vec.back()) return vec.size()-2;
+        auto it = std::lower_bound(vec.begin(), vec.end(), val);
+        return static_cast<size_t>(std::distance(vec.begin(), it)-1);
+    };
+
+    double S_c = std::clamp(S, spots.front(), spots.back());
+    double t_c = std::clamp(t, times.front(), times.back());
+    size_t i = low_index(times, t_c);
+    size_t j = low_index(spots, S_c);
+
+    double wt = (times[i+1] == times[i]) ? 0.0 : (t_c - times[i]) / (times[i+1] - times[i]);
+    double wS = (spots[j+1] == spots[j]) ? 0.0 : (S_c - spots[j]) / (spots[j+1] - spots[j]);
+    wt = std::clamp(wt, 0.0, 1.0);
+    wS = std::clamp(wS, 0.0, 1.0);
+
+    size_t nS = spots.size();
+    double v0 = (1.0 - wS) * vol[i*nS + j] + wS * vol[i*nS + j+1];
+    double v1 = (1.0 - wS) * vol[(i+1)*nS + j] + wS * vol[(i+1)*nS + j+1];
+    return (1.0 - wt) * v0 + wt * v1;
+}
+
+static std::vector<double> make_vols(size_t nt, size_t nS) {
+    std::vector<double> vol(nt*nS);
+    for (size_t k = 0; k < vol.size(); k++) vol[k] = 0.15 + 0.01 * std::sin(0.7 * static_cast<double>(k));
+    return vol;
+}
+
+TEST_CASE("Local Volatility Surface - Grid detection") {
+
+    REQUIRE(GridAxis({0.1, 0.2, 0.3, 0.4}).spacing() == GridAxis::Spacing::Uniform);
+    REQUIRE(GridAxis({50, 100, 200, 400}).spacing() == GridAxis::Spacing::LogUniform);
+    REQUIRE(GridAxis({0.1, 0.25, 0.3, 1.0}).spacing() == GridAxis::Spacing::Irregular);
+    REQUIRE(GridAxis({-1.0, 0.5, 4.0}).spacing() == GridAxis::Spacing::Irregular);
+}
+
+TEST_CASE("Local Volatility Surface - O(1) lookup matches binary search") {
+
+    std::vector<double> uniform_t, uniform_s, log_s;
+    for (int i = 0; i < 25; i++) uniform_t.push_back(0.04 * i);
+    for (int i = 0; i < 41; i++) uniform_s.push_back(50.0 + 2.5 * i);
+    for (int i = 0; i < 41; i++) log_s.push_back(50.0 * std::exp(0.02 * i));
+    std::vector<double> irregular_s{60, 70, 85, 90, 92, 100, 101, 115, 140};
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> U_t(-0.1, 1.1);
+    std::uniform_real_distribution<double> U_S(40.0, 160.0);
+
+    for (const auto& s : {uniform_s, log_s, irregular_s}) {
+
+        std::vector<double> vol = make_vols(uniform_t.size(), s.size());
+        LocalVolatilitySurface surface(uniform_t, s, vol);
+
+        for (int k = 0; k < 20000; k++) {
+            double t = U_t(rng);
+            double S = U_S(rng);
+            REQUIRE(surface.sigma(t, S) == reference_sigma(uniform_t, s, vol, t, S));
+        }
+
+        // grid nodes and cell boundaries are the sensitive points of the lookup
+        for (double t : uniform_t) {
+            for (double S : s) {
+                REQUIRE(surface.sigma(t, S) == reference_sigma(uniform_t, s, vol, t, S));
+            }
+        }
+    }
+}
+
+TEST_CASE("Local Volatility Surface - Batched interpolation") {
+
+    std::vector<double> spot{90, 100, 110};
+    std::vector<double> time{0.2, 0.5, 0.8};
+    std::vector<double> vol{0.20, 0.19, 0.21,
+                            0.22, 0.20, 0.23,
+                            0.25, 0.24, 0.26};
+
+    LocalVolatilitySurface surface(time, spot, vol);
+
+    std::vector<double> S{80, 90, 95.5, 100, 104.2, 110, 130};
+    std::vector<double> out(S.size());
+
+    for (double t : {0.1, 0.2, 0.35, 0.8, 1.2}) {
+        surface.sigma_batch(t, S, out);
+        for (size_t i = 0; i < S.size(); i++) {
+            REQUIRE(out[i] == surface.sigma(t, S[i]));
+        }
+    }
+
+    std::vector<double> wrong_size(2);
+    REQUIRE_THROWS_AS(surface.sigma_batch(0.5, S, wrong_size), std::invalid_argument);
+}
+
+TEST_CASE("Local Volatility Surface - Time slices") {
+
+    std::vector<double> spot{90, 100, 110};
+    std::vector<double> time{0.2, 0.5, 0.8};
+    std::vector<double> vol{0.20, 0.19, 0.21,
+                            0.22, 0.20, 0.23,
+                            0.25, 0.24, 0.26};
+
+    LocalVolatilitySurface surface(time, spot, vol);
+
+    std::vector<double> S{80, 90, 95.5, 100, 104.2, 110, 130};
+    for (double t : {0.1, 0.2, 0.35, 0.8, 1.2}) {
+        LocalVolatilitySlice slice = surface.slice(t);
+        for (double s : S) {
+            REQUIRE(slice.sigma(s) == Catch::Approx(surface.sigma(t, s)).margin(1e-12));
+        }
+    }
+
+    std::vector<double> grid{0.0, 0.25, 0.5, 0.75, 1.0};
+    LocalVolatilityTimeSlices slices = surface.slices(grid);
+    REQUIRE(slices.size() == grid.size());
+
+    for (double t : grid) {
+        const LocalVolatilitySlice* slice = slices.find(t);
+        REQUIRE(slice != nullptr);
+        REQUIRE(slice->sigma(104.2) == Catch::Approx(surface.sigma(t, 104.2)).margin(1e-12));
+    }
+    REQUIRE(slices.find(0.3) == nullptr);
+    REQUIRE(slices.find(2.0) == nullptr);
+
+    // the matching tolerance follows the grid step, not the magnitude of t
+    std::vector<double> short_grid{0.0, 1e-7, 2e-7, 3e-7};
+    LocalVolatilityTimeSlices short_slices = surface.slices(short_grid);
+    REQUIRE(short_slices.find(2e-7) != nullptr);
+    REQUIRE(short_slices.find(2e-7) != short_slices.find(1e-7));
+    REQUIRE(short_slices.find(1.5e-7) == nullptr);
+
+    std::vector<double> long_grid{0.0, 500.0, 1000.0};
+    LocalVolatilityTimeSlices long_slices = surface.slices(long_grid);
+    REQUIRE(long_slices.find(1000.0 + 1e-3) != nullptr);
+    REQUIRE(long_slices.find(static_cast<float>(500.0 / 3.0) * 3.0f) != nullptr);
+    REQUIRE(long_slices.find(501.0) == nullptr);
+
+    REQUIRE_THROWS_AS(surface.slices({0.5}), std::invalid_argument);
+    REQUIRE_THROWS_AS(surface.slices({0.5, 0.1}), std::invalid_argument);
+}
@@ -0,0 +1,121 @@
+/*
+ _            _        _             _     _
+| |_ ___  ___| |_     / \   _ __ ___| |__ (_)_   _____
+| __/ _ \/ __| __|   / _ \ | '__/ __| '_ \| \ \ / / _ \
+| ||  __/\__ \ |_   / ___ \| | | (__| | | | |\ V /  __/
+ \__\___||___/\__| /_/   \_\_|  \___|_| |_|_| \_/ \___|
+*/
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "engine/montecarlo.hpp"
+#include "instruments/instrument.h"
+#include "models/black_scholes/black_scholes.hpp"
+#include "models/heston/heston.hpp"
+#include "options/options.hpp"
+#include "payoff/payoff.h"
+#include "schemes/euler.h"
+#include "schemes/qe.hpp"
+#include "types/archive.hpp"
+#include "types/simulationresult.hpp"
+#include "types/timegrid.hpp"
+
+
+// fresh archive directory in the temporary directory
+static std::string archive_dir(const std::string& name){
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / ("volmc_test_" + name);
+    std::filesystem::remove_all(dir);
+    return dir.string();
+}
+
+static void require_same(const SimulationResult& a, const SimulationResult& b){
+    REQUIRE(a.get_npaths() == b.get_npaths());
+    REQUIRE(a.get_nsteps() == b.get_nsteps());
+    REQUIRE(a.get_seed() == b.get_seed());
+    REQUIRE(a.get_layout() == b.get_layout());
+    REQUIRE(a.get_observed_steps() == b.get_observed_steps());
+    REQUIRE(a.get_times() == b.get_times());
+    REQUIRE(std::equal(a.spots().begin(), a.spots().end(), b.spots().begin(), b.spots().end()));
+    REQUIRE(a.has_vol() == b.has_vol());
+    if (a.has_vol()) REQUIRE(std::equal(a.vols().begin(), a.vols().end(), b.vols().begin(), b.vols().end()));
+}
+
+
+TEST_CASE("Archive - Save and load") {
+
+    Heston heston(0.02, 1.5, 0.04, 0.3, -0.7);
+    MonteCarlo mc(QE{heston});
+
+    for (Layout layout : {PathMajor, TimeMajor}) {
+        mc.configure(7, -1, std::nullopt, layout);
+        SimulationResult sim = mc.generate_spot(100, TimeGrid::uniform(1, 24), 1001, 0.04, std::vector<size_t>{6, 12});
+
+        const std::string dir = archive_dir(layout == PathMajor ? "save_path" : "save_time");
+        SimulationArchive::save(sim, dir, mc.get_scheme().describe());
+        SimulationResult loaded = SimulationArchive::load(dir);
+
+        require_same(sim, loaded);
+        // the values are mapped, not copied into vectors
+        REQUIRE_THROWS_AS(loaded.get_paths(), std::invalid_argument);
+
+        std::map<std::string, std::string> head = SimulationArchive::header(dir);
+        REQUIRE(head["n_paths"] == "1001");
+        REQUIRE(head["n_cols"] == "3");
+        REQUIRE(head["layout"] == (layout == PathMajor ? "path" : "time"));
+        REQUIRE(head["description"].find("QE(psi_c=1.5)[Heston(") == 0);
+
+        std::filesystem::remove_all(dir);
+    }
+}
+
+TEST_CASE("Archive - Generation to file") {
+
+    MonteCarlo mc(Euler(std::make_shared<BlackScholes>(0.02, 0.2)));
+    const TimeGrid grid = TimeGrid::uniform(1, 50);
+
+    for (Layout layout : {PathMajor, TimeMajor}) {
+        mc.configure(3, -1, std::nullopt, layout);
+        SimulationResult in_memory = mc.generate_spot(100, grid, 4000);
+
+        const std::string dir = archive_dir(layout == PathMajor ? "file_path" : "file_time");
+        mc.reset_rng();
+        SimulationResult on_disk = mc.generate_to_file(dir, 100, grid, 4000);
+        require_same(in_memory, on_disk);
+        REQUIRE(SimulationArchive::header(dir)["description"] == "Euler[BlackScholes(mu=0.02, sigma=0.2)]");
+
+        // payoffs read the mapped values like the ones held in memory
+        Instrument call(OptionContract(100, 1), std::make_shared<CallPayoff>());
+        REQUIRE(call.compute_payoff(on_disk) == Catch::Approx(call.compute_payoff(in_memory)).epsilon(1e-12));
+
+        std::filesystem::remove_all(dir);
+    }
+}
+
+TEST_CASE("Archive - Knock-out flags and errors") {
+
+    MonteCarlo mc(Euler(std::make_shared<BlackScholes>(0.02, 0.2)));
+    mc.configure(11, -1);
+    const KnockCondition knock{120, Up};
+    SimulationResult sim = mc.generate_monitored(100, TimeGrid::uniform(1, 50), 2000, knock);
+
+    const std::string dir = archive_dir("knock");
+    SimulationArchive::save(sim, dir);
+    SimulationResult loaded = SimulationArchive::load(dir);
+    REQUIRE(loaded.get_knock_out() == sim.get_knock_out());
+    REQUIRE(loaded.get_knocked() == sim.get_knocked());
+
+    // an archive without header is incomplete
+    std::filesystem::remove(std::filesystem::path(dir) / "header.txt");
+    REQUIRE_THROWS_AS(SimulationArchive::load(dir), std::invalid_argument);
+    REQUIRE_THROWS_AS(SimulationArchive::load(archive_dir("missing")), std::invalid_argument);
+
+    std::filesystem::remove_all(dir);
+}
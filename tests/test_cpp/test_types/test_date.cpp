@@ -34,4 +34,13 @@ TEST_CASE("Date - Constructor errors") {
     REQUIRE_THROWS_AS(Date(0, 6, 2026), std::invalid_argument);
     REQUIRE_THROWS_AS(Date(1, 0, 2026), std::invalid_argument);
 
-}
\ No newline at end of file
+}
+TEST_CASE("Date - Year fraction") {
+
+    REQUIRE(year_fraction(Date(1, 1, 2025), Date(1, 1, 2026)) == Catch::Approx(1.0));
+    REQUIRE(year_fraction(Date(1, 1, 2024), Date(1, 1, 2025)) == Catch::Approx(366.0 / 365.0));
+    REQUIRE(year_fraction(Date(28, 2, 2024), Date(1, 3, 2024)) == Catch::Approx(2.0 / 365.0));
+    REQUIRE(year_fraction(Date(1, 6, 2026), Date(1, 6, 2026, 12)) == Catch::Approx(0.5 / 365.0));
+    REQUIRE(year_fraction(Date(1, 6, 2026), Date(1, 5, 2026)) == Catch::Approx(-31.0 / 365.0));
+
+}
@@ -7,6 +7,7 @@
 #include <optional>
 #include <stdexcept>
 
+#include <types/lrucache.hpp>
 #include <types/simulationresult.hpp>
 
 
@@ -56,3 +57,59 @@ TEST_CASE("SimulationResult - Error accessing vol") {
     REQUIRE_THROWS_AS(res.get_vol(), std::invalid_argument);
 
 }
+
+
+TEST_CASE("SimulationResult - Observed steps") {
+
+    std::vector<double> my_path{100, 102, 103,
+                                100, 98, 97};
+
+    SimulationResult res(std::make_shared<std::vector<double>>(my_path), 1, 10, 2, std::nullopt, nullptr,
+                         std::vector<size_t>{0, 5, 10});
+
+    REQUIRE(res.get_nsteps() == 10);
+    REQUIRE(res.get_path_size() == 3);
+    REQUIRE(res.avg_terminal_value() == 100.0);
+
+    auto paths = std::make_shared<std::vector<double>>(my_path);
+    REQUIRE_THROWS_AS(SimulationResult(paths, 1, 10, 2, std::nullopt, nullptr, std::vector<size_t>{0, 5}), std::invalid_argument);
+    REQUIRE_THROWS_AS(SimulationResult(paths, 1, 10, 2, std::nullopt, nullptr, std::vector<size_t>{0, 5, 11}), std::invalid_argument);
+    REQUIRE_THROWS_AS(SimulationResult(paths, 1, 10, 2, std::nullopt, nullptr, std::vector<size_t>{5, 5, 10}), std::invalid_argument);
+
+}
+
+TEST_CASE("LruCache - Eviction order") {
+
+    LruCache<size_t, int> cache(2);
+    cache.put(1, std::make_shared<const int>(10));
+    cache.put(2, std::make_shared<const int>(20));
+    REQUIRE(*cache.get(1) == 10);
+
+    // 2 is now the least recently used value
+    cache.put(3, std::make_shared<const int>(30));
+    REQUIRE(cache.size() == 2);
+    REQUIRE(cache.get(2) == nullptr);
+    REQUIRE(*cache.get(1) == 10);
+    REQUIRE(*cache.get(3) == 30);
+    REQUIRE(cache.hits() == 3);
+    REQUIRE(cache.misses() == 1);
+
+    LruCache<size_t, int> none(0);
+    none.put(1, std::make_shared<const int>(10));
+    REQUIRE(none.get(1) == nullptr);
+
+    // a capacity in cost : the least recently used values make room
+    LruCache<size_t, int> weighted(100);
+    weighted.put(1, std::make_shared<const int>(10), 60);
+    weighted.put(2, std::make_shared<const int>(20), 30);
+    REQUIRE(weighted.cost() == 90);
+    weighted.put(3, std::make_shared<const int>(30), 50);
+    REQUIRE(weighted.get(1) == nullptr);
+    REQUIRE(weighted.cost() == 80);
+    weighted.put(2, std::make_shared<const int>(21), 10);
+    REQUIRE(*weighted.get(2) == 21);
+    REQUIRE(weighted.cost() == 60);
+    weighted.put(4, std::make_shared<const int>(40), 101);
+    REQUIRE(weighted.get(4) == nullptr);
+    REQUIRE(weighted.size() == 2);
+}
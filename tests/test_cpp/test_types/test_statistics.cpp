@@ -0,0 +1,122 @@
+/*
+ _            _     ____  _        _   _     _   _          
+| |_ ___  ___| |_  / ___|| |_ __ _| |_(_)___| |_(_) ___ ___ 
+| __/ _ \/ __| __| \___ \| __/ _` | __| / __| __| |/ __/ __|
+| ||  __/\__ \ |_   ___) | || (_| | |_| \__ \ |_| | (__\__ \
+ \__\___||___/\__| |____/ \__\__,_|\__|_|___/\__|_|\___|___/
+*/
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>  
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include "engine/montecarlo.hpp"
+#include "models/black_scholes/black_scholes.hpp"
+#include "schemes/euler.h"
+#include "types/simulationresult.hpp"
+#include "types/statistics.hpp"
+#include "types/timegrid.hpp"
+
+
+// values of a stored column, read one by one
+static std::vector<double> column_of(const SimulationResult& sim, size_t j, bool vol = false){
+    const std::vector<double>& values = vol ? sim.get_vol() : sim.get_paths();
+    std::vector<double> x(sim.get_npaths());
+    for (size_t p = 0; p < x.size(); p++) x[p] = values[sim.index(p, j)];
+    return x;
+}
+
+
+TEST_CASE("Statistics - Moments") {
+
+    MonteCarlo mc(Euler(std::make_shared<BlackScholes>(0.02, 0.2)));
+    mc.configure(1, -1);
+    SimulationResult rows = mc.generate_spot(100, TimeGrid::uniform(1, 12), 5001);
+    mc.configure(1, std::nullopt, std::nullopt, TimeMajor);
+    SimulationResult cols = mc.generate_spot(100, TimeGrid::uniform(1, 12), 5001);
+
+    StepMoments m_rows = Statistics::moments(rows);
+    StepMoments m_cols = Statistics::moments(cols);
+    REQUIRE(m_rows.mean.size() == 13);
+
+    for (size_t j = 0; j < 13; j++) {
+        std::vector<double> x = column_of(rows, j);
+        const double mean = std::accumulate(x.begin(), x.end(), 0.0) / x.size();
+        double var = 0;
+        for (double v : x) var += (v - mean) * (v - mean);
+        var /= (x.size() - 1);
+
+        REQUIRE(m_rows.mean[j] == Catch::Approx(mean).epsilon(1e-12));
+        REQUIRE(m_rows.variance[j] == Catch::Approx(var).epsilon(1e-9).margin(1e-12));
+        REQUIRE(m_cols.mean[j] == Catch::Approx(mean).epsilon(1e-12));
+        REQUIRE(m_cols.variance[j] == Catch::Approx(var).epsilon(1e-9).margin(1e-12));
+    }
+    // all the paths start at S0
+    REQUIRE(m_rows.mean[0] == Catch::Approx(100));
+    REQUIRE(m_rows.variance[0] == Catch::Approx(0).margin(1e-12));
+
+    // volatility is constant in Black-Scholes
+    StepMoments m_vol = Statistics::moments(rows, true);
+    REQUIRE(m_vol.mean[5] == Catch::Approx(0.2));
+}
+
+TEST_CASE("Statistics - Quantiles") {
+
+    MonteCarlo mc(Euler(std::make_shared<BlackScholes>(0.02, 0.2)));
+    mc.configure(2, -1);
+    SimulationResult sim = mc.generate_spot(100, TimeGrid::uniform(1, 4), 40001);
+
+    std::vector<double> probs = {0.5, 0.0, 1.0, 0.01, 0.99, 0.25, 0.123};
+    std::vector<double> q = Statistics::quantiles(sim, 4, probs);
+
+    std::vector<double> x = column_of(sim, 4);
+    std::sort(x.begin(), x.end());
+    for (size_t i = 0; i < probs.size(); i++) {
+        const double h = probs[i] * (x.size() - 1);
+        const size_t lo = static_cast<size_t>(std::floor(h));
+        const size_t hi = std::min(lo + 1, x.size() - 1);
+        REQUIRE(q[i] == Catch::Approx(x[lo] + (h - lo) * (x[hi] - x[lo])).epsilon(1e-14));
+    }
+    REQUIRE(q[1] == x.front());
+    REQUIRE(q[2] == x.back());
+
+    REQUIRE_THROWS_AS(Statistics::quantiles(sim, 5, probs), std::invalid_argument);
+    REQUIRE_THROWS_AS(Statistics::quantiles(sim, 4, {1.5}), std::invalid_argument);
+}
+
+TEST_CASE("Statistics - Histogram") {
+
+    MonteCarlo mc(Euler(std::make_shared<BlackScholes>(0.02, 0.2)));
+    mc.configure(3, -1);
+    SimulationResult sim = mc.generate_spot(100, TimeGrid::uniform(1, 4), 10000);
+
+    Histogram h = Statistics::histogram(sim, 4, 20);
+    REQUIRE(h.edges.size() == 21);
+    REQUIRE(h.counts.size() == 20);
+    REQUIRE(std::accumulate(h.counts.begin(), h.counts.end(), size_t(0)) == 10000);
+
+    std::vector<double> x = column_of(sim, 4);
+    REQUIRE(h.edges.front() == *std::min_element(x.begin(), x.end()));
+    REQUIRE(h.edges.back() == *std::max_element(x.begin(), x.end()));
+
+    Histogram fixed = Statistics::histogram(sim, 4, 4, std::make_pair(90.0, 110.0));
+    std::vector<size_t> expected(4, 0);
+    for (double v : x) {
+        if (v < 90 || v > 110) continue;
+        expected[std::min(static_cast<size_t>((v - 90) / 5), size_t(3))]++;
+    }
+    REQUIRE(fixed.counts == expected);
+    REQUIRE(fixed.edges == std::vector<double>{90, 95, 100, 105, 110});
+
+    // constant column
+    Histogram start = Statistics::histogram(sim, 0, 2);
+    REQUIRE(start.counts == std::vector<size_t>{0, 10000});
+
+    REQUIRE_THROWS_AS(Statistics::histogram(sim, 4, 0), std::invalid_argument);
+    REQUIRE_THROWS_AS(Statistics::histogram(sim, 4, 4, std::make_pair(110.0, 90.0)), std::invalid_argument);
+}
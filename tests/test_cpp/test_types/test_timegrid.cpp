@@ -0,0 +1,71 @@
+/*
+ _            _     _____ _                 ____      _     _ 
+| |_ ___  ___| |_  |_   _(_)_ __ ___   ___ / ___|_ __(_) __| |
+| __/ _ \/ __| __|   | | | | '_ ` _ \ / _ \ |  _| '__| |/ _` |
+| ||  __/\__ \ |_    | | | | | | | | |  __/ |_| | |  | | (_| |
+ \__\___||___/\__|   |_| |_|_| |_| |_|\___|\____|_|  |_|\__,_|
+*/
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>  
+#include <stdexcept>
+#include <vector>
+
+#include "types/date.hpp"
+#include "types/timegrid.hpp"
+
+
+TEST_CASE("TimeGrid - Construction") {
+
+    TimeGrid grid({0.0, 0.1, 0.5, 1.0});
+    REQUIRE(grid.size() == 4);
+    REQUIRE(grid.n_steps() == 3);
+    REQUIRE(grid.maturity() == 1.0);
+    REQUIRE(grid.dt(2) == Catch::Approx(0.4));
+
+    TimeGrid uniform = TimeGrid::uniform(2.0, 8);
+    REQUIRE(uniform.n_steps() == 8);
+    REQUIRE(uniform[3] == Catch::Approx(0.75));
+    REQUIRE(uniform.maturity() == 2.0);
+
+    REQUIRE_THROWS_AS(TimeGrid({0.0}), std::invalid_argument);
+    REQUIRE_THROWS_AS(TimeGrid({0.1, 0.5}), std::invalid_argument);
+    REQUIRE_THROWS_AS(TimeGrid({0.0, 0.5, 0.5}), std::invalid_argument);
+    REQUIRE_THROWS_AS(TimeGrid::uniform(1.0, 0), std::invalid_argument);
+    REQUIRE_THROWS_AS(TimeGrid::uniform(-1.0, 10), std::invalid_argument);
+}
+
+TEST_CASE("TimeGrid - Date schedule") {
+
+    Date start(1, 1, 2025);
+    std::vector<Date> schedule{Date(1, 4, 2025), Date(1, 7, 2025), Date(1, 1, 2026)};
+
+    TimeGrid grid = TimeGrid::from_dates(start, schedule);
+    REQUIRE(grid.size() == 4);
+    REQUIRE(grid[0] == 0.0);
+    REQUIRE(grid[1] == Catch::Approx(90.0 / 365.0));
+    REQUIRE(grid[2] == Catch::Approx(181.0 / 365.0));
+    REQUIRE(grid[3] == Catch::Approx(1.0));
+
+    REQUIRE_THROWS_AS(TimeGrid::from_dates(start, {}), std::invalid_argument);
+    REQUIRE_THROWS_AS(TimeGrid::from_dates(start, {Date(1, 4, 2025), Date(1, 2, 2025)}), std::invalid_argument);
+}
+
+TEST_CASE("TimeGrid - Refinement") {
+
+    TimeGrid grid({0.0, 0.1, 0.5, 1.0});
+    TimeGrid fine = grid.refine(0.15);
+
+    // 0.1 is kept as is, 0.4 is split in 3 and 0.5 in 4
+    REQUIRE(fine.n_steps() == 1 + 3 + 4);
+    for (size_t k = 1; k < fine.size(); k++) {
+        REQUIRE(fine.dt(k) <= 0.15 + 1e-12);
+    }
+
+    for (double t : grid.times()) {
+        REQUIRE(fine[fine.index(t)] == t);
+    }
+    REQUIRE(fine.index(0.5) == 4);
+    REQUIRE_THROWS_AS(fine.index(0.42), std::invalid_argument);
+    REQUIRE_THROWS_AS(grid.refine(0.0), std::invalid_argument);
+}
@@ -4,7 +4,7 @@ import numpy as np
 from volmc.types import *
 from volmc.models import Heston, BlackScholes, Dupire
 from volmc.schemes import Euler, EulerHeston, QE
-from volmc.pricing import MonteCarlo
+from volmc.pricing import MonteCarlo, RandomStore
 
 def test_basic_monte_carlo_euler_bs():
 
@@ -228,3 +228,218 @@ def test_mc_dupire():
     S = sim.spot_values()
     assert np.all(S > 0)
 
+
+
+def test_monte_carlo_time_grid():
+
+    bs = BlackScholes(0.05, 0.0)
+    montecarlo = MonteCarlo(Euler(bs))
+    montecarlo.configure(seed=1)
+
+    sim = montecarlo.generate_on_grid(100, [0.0, 0.1, 0.5, 1.0], 4)
+    assert(sim.spot_values().shape == (4, 4))
+    assert(np.allclose(sim.times(), [0.0, 0.1, 0.5, 1.0]))
+    assert(sim.mean_terminal_spot() == pytest.approx(100 * 1.005 * 1.02 * 1.025))
+
+    refined = montecarlo.generate_on_grid(100, [0.0, 0.1, 0.5, 1.0], 4, max_dt=0.15)
+    assert(refined.spot_values().shape == (4, 9))
+    assert(np.all(np.diff(refined.times()) <= 0.15 + 1e-12))
+
+    with pytest.raises(ValueError):
+        montecarlo.generate_on_grid(100, [0.0, 0.5, 0.2], 4)
+
+
+def test_monte_carlo_observation_schedule():
+
+    bs = BlackScholes(0.02, 0.15)
+    montecarlo = MonteCarlo(Euler(bs))
+
+    montecarlo.configure(seed=1)
+    full = montecarlo.generate(100, 252, 1, 10)
+    montecarlo.configure(seed=1)
+    obs = montecarlo.generate(100, 252, 1, 10, observe=[21 * k for k in range(1, 12)])
+
+    assert(obs.spot_values().shape == (10, 12))
+    assert(obs.observed_steps()[-1] == 252)
+    assert(np.array_equal(obs.spot_values(), full.spot_values()[:, obs.observed_steps()]))
+
+    grid = montecarlo.generate_on_grid(100, [0.0, 0.5, 1.0], 10, max_dt=0.1, observe_times=[0.5])
+    assert(grid.spot_values().shape == (10, 2))
+    assert(np.allclose(grid.times(), [0.5, 1.0]))
+
+
+def test_monte_carlo_time_major_layout():
+
+    montecarlo = MonteCarlo(Euler(BlackScholes(0.02, 0.15)))
+
+    montecarlo.configure(seed=1)
+    rows = montecarlo.generate(100, 50, 1, 100)
+    montecarlo.configure(seed=1, layout="time")
+    cols = montecarlo.generate(100, 50, 1, 100)
+
+    S = cols.spot_values()
+    assert(np.array_equal(S, rows.spot_values()))
+    # views on the simulation : the dates are contiguous and nothing is copied
+    assert(S.strides == (8, 8 * 100))
+    assert(S[:, -1].flags["C_CONTIGUOUS"])
+    assert(not S.flags["WRITEABLE"])
+
+    with pytest.raises(ValueError):
+        montecarlo.configure(layout="diagonal")
+
+
+def test_simulation_statistics():
+
+    montecarlo = MonteCarlo(Euler(BlackScholes(0.02, 0.15)))
+    montecarlo.configure(seed=1)
+    sim = montecarlo.generate(100, 10, 1, 2001)
+    S = sim.spot_values()
+
+    mean, var = sim.moments()
+    assert(np.allclose(mean, S.mean(axis=0)))
+    assert(np.allclose(var, S.var(axis=0, ddof=1)))
+
+    q = [0.01, 0.5, 0.99]
+    assert(np.allclose(sim.quantiles(q), np.quantile(S[:, -1], q)))
+    assert(sim.quantiles(0.5, step=5) == pytest.approx(np.quantile(S[:, 5], 0.5)))
+
+    counts, edges = sim.histogram(bins=20, range=(80, 120))
+    ref_counts, ref_edges = np.histogram(S[:, -1], bins=20, range=(80, 120))
+    assert(np.array_equal(counts, ref_counts))
+    assert(np.allclose(edges, ref_edges))
+
+    with pytest.raises(IndexError):
+        sim.quantiles(0.5, step=11)
+
+
+def test_simulation_archive(tmp_path):
+
+    montecarlo = MonteCarlo(Euler(BlackScholes(0.02, 0.15)))
+    montecarlo.configure(seed=3, layout="time")
+    times = np.linspace(0, 1, 21)
+    sim = montecarlo.generate_on_grid(100, times, 500)
+    montecarlo.configure(seed=3, layout="time")
+    disk = montecarlo.generate_to_file(tmp_path / "archive", 100, times, 500)
+
+    assert(np.array_equal(disk.spot_values(), sim.spot_values()))
+    assert(np.allclose(disk.times(), times))
+    # plain npy files, readable without volmc
+    mapped = np.load(tmp_path / "archive" / "spot.npy", mmap_mode="r")
+    assert(np.array_equal(mapped, sim.spot_values()))
+
+    header = SimulationResult.archive_header(tmp_path / "archive")
+    assert(header["n_paths"] == "500")
+    assert(header["description"].startswith("Euler[BlackScholes("))
+
+    sim.save(tmp_path / "copy")
+    loaded = SimulationResult.load(tmp_path / "copy")
+    assert(np.array_equal(loaded.spot_values(), sim.spot_values()))
+    assert(np.array_equal(loaded.vol_values(), sim.vol_values()))
+
+
+def test_lazy_simulation():
+
+    montecarlo = MonteCarlo(Euler(BlackScholes(0.02, 0.15)))
+    times = np.linspace(0, 1, 13)
+    montecarlo.configure(seed=4)
+    sim = montecarlo.generate_on_grid(100, times, 3000)
+    montecarlo.configure(seed=4)
+    lazy = montecarlo.generate_lazy(100, times, 3000, cache_blocks=1)
+
+    assert(lazy.lazy and not sim.lazy)
+    assert(lazy.n_path == 3000 and lazy.n_steps == 13)
+    assert(np.array_equal(lazy.spot_values(), sim.spot_values()))
+
+
+def test_monte_carlo_workspace():
+
+    montecarlo = MonteCarlo(Euler(BlackScholes(0.02, 0.15)))
+    montecarlo.configure(seed=6)
+    reference = montecarlo.generate(100, 20, 1, 1000).spot_values().copy()
+
+    montecarlo.use_workspace(max_buffers=2)
+    montecarlo.configure(seed=6)
+    sim = montecarlo.generate(100, 20, 1, 1000)
+    assert(np.array_equal(sim.spot_values(), reference))
+    assert(montecarlo.workspace_bytes() > 0)
+
+    # a live result is never overwritten by the next run
+    S = sim.spot_values()
+    montecarlo.generate(100, 20, 1, 1000)
+    assert(np.array_equal(S, reference))
+
+    montecarlo.use_workspace(False)
+    assert(montecarlo.workspace_bytes() == 0)
+
+
+def test_iter_chunks():
+
+    montecarlo = MonteCarlo(Euler(BlackScholes(0.02, 0.15)))
+    montecarlo.configure(seed=8)
+    reference = montecarlo.generate(100, 20, 1, 2500)
+    montecarlo.configure(seed=8)
+
+    blocks = [S.copy() for S in montecarlo.iter_chunks(100, None, 20, 1, 2500, 1000)]
+    assert([len(S) for S in blocks] == [1000, 1000, 500])
+    assert(np.array_equal(np.vstack(blocks), reference.spot_values()))
+
+    # running statistics over the blocks, with the volatility
+    total = 0.0
+    for S, V in montecarlo.iter_chunks(100, None, 20, 1, 2500, 700, volatility=True):
+        assert(S.shape == V.shape)
+        total += S[:, -1].sum()
+    assert(total / 2500 == pytest.approx(reference.spot_values()[:, -1].mean()))
+
+def test_monte_carlo_cache():
+
+    montecarlo = MonteCarlo(Euler(BlackScholes(0.02, 0.15)))
+    montecarlo.configure(seed=6)
+    reference = montecarlo.generate(100, 20, 1, 1000)
+
+    montecarlo.use_cache(max_bytes=1 << 24)
+    montecarlo.configure(seed=6)
+    first = montecarlo.generate(100, 20, 1, 1000)
+    montecarlo.configure(seed=6)
+    second = montecarlo.generate(100, 20, 1, 1000)
+    assert(np.array_equal(second.spot_values(), reference.spot_values()))
+    assert(np.array_equal(first.spot_values(), second.spot_values()))
+
+    stats = montecarlo.cache_stats()
+    assert(stats["hits"] == 1 and stats["entries"] == 1)
+    assert(0 < stats["bytes"] <= stats["max_bytes"])
+
+    montecarlo.clear_cache()
+    assert(montecarlo.cache_stats()["entries"] == 0)
+    montecarlo.use_cache(False)
+    assert(montecarlo.cache_stats()["max_bytes"] == 0)
+
+def test_random_store(tmp_path):
+
+    montecarlo = MonteCarlo(Euler(BlackScholes(0.02, 0.15)))
+    montecarlo.configure(seed=3)
+    reference = montecarlo.generate(100, 20, 1, 500)
+
+    store = RandomStore(800, 20, dims=2, seed=3)
+    assert(store.shape == (800, 20, 2))
+    assert(store.values().shape == (800, 20, 2))
+    assert(not store.values().flags.writeable)
+
+    montecarlo.use_random_store(RandomStore(500, 20, seed=3))
+    assert(np.array_equal(montecarlo.generate(100, 20, 1, 500).spot_values(), reference.spot_values()))
+
+    # two Heston schemes on the same normals
+    heston = Heston(0.02, 2, 0.05, 0.4, -0.5)
+    euler = MonteCarlo(EulerHeston(heston))
+    qe = MonteCarlo(QE(heston))
+    euler.use_random_store(store)
+    qe.use_random_store(store)
+    diff = euler.generate(100, 20, 1, 800, v0=0.2).spot_values()[:, -1] - qe.generate(100, 20, 1, 800, v0=0.2).spot_values()[:, -1]
+    assert(np.sqrt((diff ** 2).mean()) < 5)
+
+    store.save(tmp_path / "normals")
+    loaded = RandomStore.load(tmp_path / "normals")
+    assert(np.array_equal(loaded.values(), store.values()))
+
+    with pytest.raises(ValueError):
+        montecarlo.generate(100, 10, 1, 500)
+    montecarlo.use_random_store(None)
@@ -93,6 +93,10 @@ def test_barrier_error():
     with pytest.raises(ValueError):
         BarrierPayoff(101, "in", 'out', CallPayoff())
 
+    BarrierPayoff(101, "up", "out", CallPayoff(), monitoring="Continuous")
+    with pytest.raises(ValueError):
+        BarrierPayoff(101, "up", "out", CallPayoff(), monitoring="daily")
+
 def test_barrier_payoff_dep_on_H():
     K = 120
     H1 = 105
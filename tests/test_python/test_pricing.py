@@ -1,6 +1,6 @@
 from volmc.models import BlackScholes, Heston, Dupire, Vasicek
-from volmc.schemes import Euler, QE
-from volmc.pricing import MonteCarlo, Pricer, BlackScholesEngine, HestonEngine
+from volmc.schemes import Euler, EulerHeston, QE
+from volmc.pricing import MonteCarlo, Pricer, BlackScholesEngine, HestonEngine, BlackScholesBatch, HestonBatch
 from volmc.types import *
 from volmc.options import *
 
@@ -226,4 +226,215 @@ def test_gamma():
     bs_gamma = gamma(S, K , sigma, T, r)
 
     assert(mc_gamma == pytest.approx(bs_gamma, rel = 0.05))
-    
\ No newline at end of file
+    
+def test_ladder_price():
+
+    S0, K, T, r = 100, 100, 1, 0.02
+    levels = [110, 120, 130]
+
+    mc = BlackScholesEngine(r, 0.2)
+    mc.configure(1, -1)
+    ladder = Pricer(MarketState(S0, r), 50, 20_000, mc).ladder_price(levels, "up", "out", CallPayoff(), OptionContract(K, T))
+
+    mc.configure(1, -1)
+    instruments = [Instrument(OptionContract(K, T), BarrierPayoff(H, "up", "out", CallPayoff())) for H in levels]
+    batch = Pricer(MarketState(S0, r), 50, 20_000, mc).batch_price(instruments)
+
+    assert(ladder == pytest.approx(batch, rel = 1e-10))
+    assert(ladder[0] < ladder[1] < ladder[2])
+
+    with pytest.raises(ValueError):
+        Pricer(MarketState(S0, r), 50, 1000, mc).ladder_price(levels, "left", "out", CallPayoff(), OptionContract(K, T))
+
+
+def test_price_table():
+
+    S0, r, sigma = 100, 0.02, 0.2
+    K = np.linspace(80, 120, 41)
+    T = np.where(np.arange(41) % 2 == 0, 0.5, 1.0)
+
+    mc = BlackScholesEngine(r, sigma)
+    mc.configure(1, -1)
+    pricer = Pricer(MarketState(S0, r), 50, 50_000, mc)
+
+    prices, errors = pricer.price_table(K, T, "call")
+    assert(prices.shape == (41,) and errors.shape == (41,))
+    assert(np.all(np.abs(prices - bs_call_price(S0, K, sigma, T, r)) < 5 * errors))
+
+    codes = np.array([Pricer.PAYOFF_CODES["put"]] * 41, dtype = np.int32)
+    puts, _ = pricer.price_table(K, T, codes)
+    assert(puts == pytest.approx(bs_put_price(S0, K, sigma, T, r), rel = 0.05, abs = 0.05))
+
+    # rows with a NaN barrier are vanillas
+    barrier = np.full(41, np.nan)
+    barrier[::3] = 130
+    ko, _ = pricer.price_table(K, T, "call", barrier, "up", "out")
+    assert(np.all(ko[::3] < prices[::3]))
+
+    mc.configure(1, -1)
+    same, _ = pricer.price_table(np.array([95.0, 105.0]), np.array([1.0, 1.0]), "call")
+    mc.configure(1, -1)
+    batch = pricer.batch_price([Instrument(OptionContract(95, 1), CallPayoff()), Instrument(OptionContract(105, 1), CallPayoff())])
+    assert(same == pytest.approx(batch, rel = 1e-10))
+
+    with pytest.raises(ValueError):
+        pricer.price_table(K, T, "straddle")
+    with pytest.raises(ValueError):
+        pricer.price_table(K, T[:3], "call")
+
+
+def test_scenario_prices():
+
+    r, sigma = 0.02, 0.2
+    spots, rates = [90, 100, 110], [0.0, 0.05]
+    book = [Instrument(OptionContract(100, 1), CallPayoff()), Instrument(OptionContract(100, 0.5), PutPayoff())]
+
+    mc = BlackScholesEngine(r, sigma)
+    mc.configure(1, -1)
+    pricer = Pricer(MarketState(100, r), 20, 20_000, mc)
+    grid = pricer.scenario_prices(book, spots, rates)
+    assert(grid.shape == (3, 2, 2))
+
+    # the same random numbers as a pricing in each scenario
+    for i, S0 in enumerate(spots):
+        for j, rate in enumerate(rates):
+            for k, instrument in enumerate(book):
+                mc.configure(1, -1)
+                price = Pricer(MarketState(S0, rate), 20, 20_000, mc).price(instrument)
+                assert(grid[i, j, k] == pytest.approx(price, rel = 1e-9))
+
+    assert(np.all(np.diff(grid[:, 0, 0]) > 0) and np.all(np.diff(grid[:, 0, 1]) < 0))
+    assert(pricer.scenario_prices(book, spots, rates, vols = [0.04]).shape == (3, 1, 2, 2))
+
+    with pytest.raises(ValueError):
+        pricer.scenario_prices(book, [], rates)
+
+
+def test_parameter_prices():
+
+    r = 0.02
+    book = [Instrument(OptionContract(100, 1), CallPayoff()), Instrument(OptionContract(95, 0.5), PutPayoff())]
+
+    params = [(r, sigma) for sigma in (0.15, 0.2, 0.25)]
+    mc = BlackScholesEngine(r, 0.2)
+    mc.configure(3, -1)
+    prices = Pricer(MarketState(100, r), 20, 20_000, mc).parameter_prices(book, BlackScholesBatch(params))
+    assert(prices.shape == (3, 2))
+
+    # each row prices with its parameters alone, on the same random numbers
+    for k, (mu, sigma) in enumerate(params):
+        single = BlackScholesEngine(mu, sigma)
+        single.configure(3, -1)
+        pricer = Pricer(MarketState(100, r), 20, 20_000, single)
+        assert(prices[k, 1] == pytest.approx(pricer.price(book[1]), rel = 1e-10))
+        assert(prices[k, 0] == pytest.approx(pricer.price(book[0]), rel = 1e-10))
+    assert(np.all(np.diff(prices, axis = 0) > 0))
+
+    # Heston sensitivities from bumped parameter sets
+    heston = HestonBatch([(r, kappa, 0.05, 0.4, -0.5) for kappa in (1.9, 2.0, 2.1)])
+    mc.configure(3, -1)
+    results = mc.generate_batch(heston, 100, 20, 1, 1000, v0 = 0.04)
+    assert(len(results) == 3)
+    kappa_prices = Pricer(MarketState(100, r, 0.04), 20, 20_000, mc).parameter_prices(book[:1], heston)
+    assert(abs(kappa_prices[2, 0] - kappa_prices[0, 0]) < 0.1)
+
+    # the Euler scheme of the same parameter sets
+    euler = HestonBatch([(r, kappa, 0.05, 0.4, -0.5) for kappa in (1.9, 2.0, 2.1)], scheme = "euler")
+    assert(all(isinstance(s, EulerHeston) for s in euler))
+    mc.configure(3, -1)
+    euler_results = mc.generate_batch(euler, 100, 20, 1, 1000, v0 = 0.04)
+    assert(len(euler_results) == 3)
+    euler_prices = Pricer(MarketState(100, r, 0.04), 20, 20_000, mc).parameter_prices(book[:1], euler)
+    assert(euler_prices.shape == kappa_prices.shape)
+    assert(abs(euler_prices[1, 0] - kappa_prices[1, 0]) < 0.5)
+
+    with pytest.raises(ValueError):
+        HestonBatch([(r, 2.0, 0.05, 0.4, -0.5)], scheme = "exact")
+
+
+def test_price_async():
+
+    import asyncio
+    import concurrent.futures
+
+    model = BlackScholes(0.02, 0.2)
+    engine = MonteCarlo(Euler(model))
+    call = Call(95, 1)
+    state = MarketState(S = 100, r = 0.02)
+
+    engine.configure(1, -1)
+    pricer = Pricer(state, 50, 10_000, engine)
+    expected = pricer.price(call)
+
+    engine.configure(1, -1)
+    future = pricer.price_async(call)
+    assert(future.result() == expected)
+
+    # several pricings awaited together
+    async def gather():
+        return await asyncio.gather(pricer.price_async(call), pricer.batch_price_async([call, call]))
+    price, batch = asyncio.run(gather())
+    assert(price > 0 and len(batch) == 2)
+
+    # a cancelled pricing stops and raises CancelledError
+    slow = Pricer(state, 500, 2_000_000, engine)
+    future = slow.price_async(call)
+    future.cancel()
+    with pytest.raises(concurrent.futures.CancelledError):
+        future.result()
+
+
+def test_function_payoff():
+
+    S0, K, T, r = 100, 100, 1, 0.02
+
+    mc = BlackScholesEngine(r, 0.2)
+    mc.configure(1, -1)
+    pricer = Pricer(MarketState(S0, r), 50, 20_000, mc)
+    call = pricer.price(Instrument(OptionContract(K, T), CallPayoff()))
+
+    shapes = []
+    strikes = []
+    def function_call(S, strike):
+        shapes.append(S.shape)
+        strikes.append(strike)
+        assert(not S.flags.writeable)
+        return np.maximum(S[:, -1] - strike, 0)
+
+    mc.configure(1, -1)
+    price = pricer.price(Instrument(OptionContract(K, T), FunctionPayoff(function_call, chunk_paths=8000)))
+    assert(price == pytest.approx(call, rel = 1e-10))
+    assert(shapes == [(8000, 51), (8000, 51), (4000, 51)])
+    assert(strikes == [K, K, K])
+
+    # an arithmetic Asian call, from a plain function
+    asian = pricer.price(Instrument(OptionContract(K, T), lambda S, K: np.maximum(S.mean(axis=1) - K, 0)))
+    assert(0 < asian < call)
+
+    with pytest.raises(ValueError):
+        pricer.price(Instrument(OptionContract(K, T), lambda S, K: S))
+    with pytest.raises(ZeroDivisionError):
+        pricer.price(Instrument(OptionContract(K, T), lambda S, K: 1 / 0))
+
+
+def test_expression_payoff():
+
+    S0, K, T, r = 100, 100, 1, 0.02
+
+    mc = BlackScholesEngine(r, 0.2)
+    pricer = Pricer(MarketState(S0, r), 50, 20_000, mc)
+
+    mc.configure(1, -1)
+    call = pricer.price(Instrument(OptionContract(K, T), CallPayoff()))
+    mc.configure(1, -1)
+    expr = pricer.price(Instrument(OptionContract(K, T), ExpressionPayoff("max(S[T] - K, 0)")))
+    assert(expr == pytest.approx(call, rel = 1e-10))
+
+    mc.configure(1, -1)
+    capped, asian, accrual = pricer.batch_price([Instrument(OptionContract(K, T), "min(max(S[T] - K, 0), 10)"),
+                                                 Instrument(OptionContract(K, T), "max(mean(S) - K, 0)"),
+                                                 Instrument(OptionContract(K, T), "mean((S > 90) * (S < 110))")])
+    assert(0 < capped < call and 0 < asian < call and 0 < accrual < 1)
+
+    with pytest.raises(ValueError):
+        ExpressionPayoff("max(S - K, 0)")
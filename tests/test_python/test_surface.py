@@ -60,3 +60,17 @@ def test_local_vol_surface_error_wrong_dim_v():
     with pytest.raises(ValueError):
         loc_vol = LocalVolatilitySurface(t,s,v)
 
+
+def test_local_vol_surface_sigma_batch():
+
+    import numpy as np
+    t,s,v = make_inputs()
+
+    loc_vol = LocalVolatilitySurface(t,s,v)
+    spots = np.array([75, 80, 95, 104.5, 120, 130])
+
+    batch = loc_vol.sigma_batch(0.5, spots)
+
+    assert(len(batch) == len(spots))
+    for S, sigma in zip(spots, batch):
+        assert(sigma == loc_vol.sigma(0.5, S))
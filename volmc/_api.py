@@ -2,12 +2,16 @@ from __future__ import annotations
 from ._volmc import _State
 from ._volmc import _Path
 from ._volmc import _Model, _BlackScholes, _Heston, _Dupire, _Vasicek
-from ._volmc import _EulerHeston, _QE, _Scheme, _Euler
-from ._volmc import _MonteCarlo
+from ._volmc import _EulerHeston, _QE, _Scheme, _Euler, _EulerBlackScholes, _ExactVasicek
+from ._volmc import _MonteCarlo, _Layout, _CancellationToken, _Cancelled, _RandomStore, _load_random_store
 from ._volmc import _LocalVolatilitySurface
-from ._volmc import _OptionContract, _Payoff, _PutPayoff, _CallPayoff, _DigitalCallPayoff,_DigitalPutPayoff, _Instrument, _BarrierPayoff, _Direction, _Nature
+from ._volmc import _OptionContract, _Payoff, _PutPayoff, _CallPayoff, _DigitalCallPayoff,_DigitalPutPayoff, _FunctionPayoff, _ExpressionPayoff, _Instrument, _BarrierPayoff, _Direction, _Nature, _Monitoring
 from ._volmc import _Pricer, _MarketState
+from ._volmc import _load_archive, _archive_header
 
+import asyncio
+import concurrent.futures
+import threading
 from dataclasses import dataclass
 from typing import TYPE_CHECKING
 
@@ -91,23 +95,47 @@ class SimulationResult:
         Result of a MonteCarlo simulation
         """
         self.res = cpp_simres
-        self.n_path = len(self.res.spot)
-        self.n_steps = len(self.res.spot[0])
+        self.n_path = self.res.n_paths
+        self.n_steps = self.res.n_cols
 
     def __repr__(self):
-        return f"SimulationResult of {len(self.res.spot)} paths and {len(self.res.spot[0])} steps"
+        return f"SimulationResult of {self.n_path} paths and {self.n_steps} steps"
+
+    @property
+    def lazy(self):
+        """
+        Whether the paths are regenerated from their seeds when read, see
+        MonteCarlo.generate_lazy
+        """
+        return self.res.lazy
     
     def spot_values(self):
         """
-        Returns a numpy matrix of the spot processes (one row = one process)
+        Returns a numpy matrix of the spot processes (one row = one process).
+        The matrix is a read-only view on the simulation, its strides follow
+        the layout of the engine. A lazy result computes and keeps all its
+        paths on the first call.
         """
         return self.res.spot
     
     def vol_values(self):
         """
-        Returns a numpy matrix of the variance processes (one row = one process)
+        Returns a numpy matrix of the variance processes (one row = one process).
+        The matrix is a read-only view on the simulation.
         """
         return self.res.vol
+
+    def times(self):
+        """
+        Returns the simulation times in years of the columns of the paths
+        """
+        return self.res.times
+
+    def observed_steps(self):
+        """
+        Returns the step index of each column of the paths
+        """
+        return self.res.observed_steps
     
     def mean_terminal_spot(self):
         """
@@ -115,6 +143,113 @@ class SimulationResult:
         """
         return (self.res.spot[:,-1]).sum()/self.n_path
 
+    def save(self, path : str, description : str = ""):
+        """
+        Writes the simulation to an archive directory. The paths are stored
+        as .npy files (spot.npy, vol.npy, times.npy, observed.npy) next to a
+        text header, numpy.load(..., mmap_mode="r") reads them directly.
+
+        Parameters
+        ----------
+        path : str
+            The archive directory, created if needed
+        description : str
+            Free text stored in the header
+        """
+        self.res._save(str(path), description)
+
+    @staticmethod
+    def load(path : str):
+        """
+        Opens an archive written by save or MonteCarlo.generate_to_file. The
+        paths are memory mapped : they are read from the disk when accessed,
+        so the archive may be larger than the memory.
+
+        Parameters
+        ----------
+        path : str
+            The archive directory
+
+        Returns
+        -------
+        SimulationResult
+        """
+        return SimulationResult(_load_archive(str(path)))
+
+    @staticmethod
+    def archive_header(path : str):
+        """
+        Returns the header of an archive as a dict of strings : seed,
+        n_steps, n_paths, layout, description of the scheme...
+        """
+        return dict(_archive_header(str(path)))
+
+    def _column(self, step : int):
+        column = step + self.n_steps if step < 0 else step
+        if column < 0 or column >= self.n_steps:
+            raise IndexError(f"SimulationResult : column {step} out of range for {self.n_steps} stored columns")
+        return column
+
+    def moments(self, vol : bool = False):
+        """
+        Returns the mean and the variance across paths of every stored column,
+        computed in parallel without copying the paths.
+
+        Parameters
+        ----------
+        vol : bool
+            Reads the variance processes instead of the spot processes
+
+        Returns
+        -------
+        (numpy.ndarray, numpy.ndarray)
+            The means and the unbiased variances, one value per column
+        """
+        return self.res._moments(vol)
+
+    def quantiles(self, q, step : int = -1, vol : bool = False):
+        """
+        Returns quantiles across paths of a stored column, interpolated like
+        numpy.quantile. Uses a parallel selection instead of a full sort.
+
+        Parameters
+        ----------
+        q : float or list of float
+            The probabilities, in [0, 1]
+        step : int
+            The stored column, the last one by default. Negative values count
+            from the end
+        vol : bool
+            Reads the variance processes instead of the spot processes
+        """
+        probs = [q] if isinstance(q, (int, float)) else list(q)
+        out = self.res._quantiles(self._column(step), probs, vol)
+        return out[0] if isinstance(q, (int, float)) else out
+
+    def histogram(self, bins : int = 50, range : tuple | None = None, step : int = -1, vol : bool = False):
+        """
+        Counts the values of a stored column in fixed-width bins, like
+        numpy.histogram.
+
+        Parameters
+        ----------
+        bins : int
+            The number of bins
+        range : tuple
+            The lower and upper edges, the minimum and maximum of the column
+            by default. Values outside are not counted
+        step : int
+            The stored column, the last one by default
+        vol : bool
+            Reads the variance processes instead of the spot processes
+
+        Returns
+        -------
+        (numpy.ndarray, numpy.ndarray)
+            The counts and the bins + 1 edges
+        """
+        return self.res._histogram(self._column(step), bins, range, vol)
+
 #--------------------------------MODELS
 
 class Model(_Model):
@@ -293,8 +428,128 @@ class Euler(_Euler):
         super().__init__(model)
 
 
+class EulerBlackScholes(_EulerBlackScholes):
+    def __init__(self, model):
+        """
+        Log-Euler discretization for Black Scholes. The log-spot has constant
+        coefficients, so the scheme is exact for any time step.
+
+        Parameters
+        ----------
+        model : BlackScholes
+            a Black Scholes model
+        """
+        if (isinstance(model, BlackScholes) == False):
+            raise ValueError("EulerBlackScholes : model must be a BlackScholes model.")
+        super().__init__(model)
+
+
+class ExactVasicek(_ExactVasicek):
+    def __init__(self, model):
+        """
+        Exact simulation of the Vasicek short rate from its Gaussian
+        transition law, unbiased for any time step.
+
+        Parameters
+        ----------
+        model : Vasicek
+            a Vasicek model
+        """
+        if (isinstance(model, Vasicek) == False):
+            raise ValueError("ExactVasicek : model must be a Vasicek model.")
+        super().__init__(model)
+
+
 #--------------------------------Engine
 
+class RandomStore:
+    """
+    Standard normals of a simulation, generated once in parallel and read
+    by the runs of any engine, see MonteCarlo.use_random_store.
+
+    Runs reading the same store share their random numbers : bumped spots
+    or parameters, and other schemes of the same model (EulerHeston and QE),
+    are compared on the same paths without drawing any random number. A
+    store built with the seed of an engine holds the normals that the
+    engine draws for its first run with the Euler and EulerHeston schemes.
+
+    Parameters
+    ----------
+    n_paths : int
+        The number of paths
+    n_steps : int
+        The number of steps of each path, the number of steps of the runs
+    dims : int
+        The number of normals of each step : 1 for Black Scholes and local
+        volatility schemes, 2 for Heston schemes
+    seed : int
+        The seed of the generation
+    n_jobs : int
+        The number of threads of the generation, -1 for all
+    """
+    def __init__(self, n_paths: int, n_steps: int, dims: int = 1, seed: int = 0, n_jobs: int = -1):
+        self.store = _RandomStore(n_paths, n_steps, dims, seed, n_jobs)
+
+    @classmethod
+    def _wrap(cls, cpp_store):
+        store = cls.__new__(cls)
+        store.store = cpp_store
+        return store
+
+    def __repr__(self):
+        return f"RandomStore of {self.store.n_paths} paths, {self.store.n_steps} steps and {self.store.dims} normals per step"
+
+    @property
+    def shape(self):
+        """
+        (n_paths, n_steps, dims)
+        """
+        return (self.store.n_paths, self.store.n_steps, self.store.dims)
+
+    @property
+    def nbytes(self):
+        """
+        The memory of the normals, in bytes
+        """
+        return self.store.nbytes
+
+    def values(self):
+        """
+        Returns a read-only numpy view of shape (n_paths, n_steps, dims) on
+        the normals
+        """
+        return self.store.values
+
+    def save(self, path: str):
+        """
+        Writes the store to an archive directory, see SimulationResult.save
+
+        Parameters
+        ----------
+        path : str
+            The archive directory, created if needed
+        """
+        self.store._save(str(path))
+
+    @staticmethod
+    def load(path: str):
+        """
+        Opens a store written by save. The normals are memory mapped : they
+        are read from the disk by the runs, so the store may be larger than
+        the memory.
+
+        Parameters
+        ----------
+        path : str
+            The archive directory
+
+        Returns
+        -------
+        RandomStore
+        """
+        return RandomStore._wrap(_load_random_store(str(path)))
+
+
 class MonteCarlo(_MonteCarlo):
     """
     Creates a Monte Carlo generator.
@@ -329,7 +584,7 @@ class MonteCarlo(_MonteCarlo):
         cpp_path = super()._simulate_path(S0, n, T, v0)
         return Path(cpp_path)
 
-    def generate(self, S0: float, n: int, T: float, n_paths: int, v0: float | None = None):
+    def generate(self, S0: float, n: int, T: float, n_paths: int, v0: float | None = None, observe = None):
         """
         Returns a MonteCarlo simulation
 
@@ -345,18 +600,276 @@ class MonteCarlo(_MonteCarlo):
             Number of paths to simulate
         v0 : float | None
             Initial volatility 
+        observe : Sequence[int] | None
+            Step indices to store. All the steps are simulated but only these
+            columns are kept, the terminal step always is.
 
         Returns
         -------
         SimulationResult
         """
-        if (v0 is not None):
-            sim_res = super()._generate(S0, n, T, n_paths, v0)
-        else:
-            sim_res = super()._generate(S0, n, T, n_paths)
+        observe = None if observe is None else [int(i) for i in observe]
+        sim_res = super()._generate(S0, n, T, n_paths, v0, observe)
+        return SimulationResult(sim_res)
+
+    def generate_batch(self, schemes, S0: float, n: int, T: float, n_paths: int, v0: float | None = None):
+        """
+        Simulates the same paths with each scheme of a batch, for instance
+        one model under many parameter sets, see HestonBatch. The normals of
+        each path are drawn once and every scheme steps on them.
+
+        Parameters
+        ----------
+        schemes : Sequence[Scheme]
+            The schemes to simulate, in place of the scheme of the engine
+        S0 : float
+            Initial spot 
+        n : int
+            Number of steps of each path
+        T : float
+            Time interval
+        n_paths : int
+            Number of paths of each scheme
+        v0 : float | None
+            Initial volatility 
+
+        Returns
+        -------
+        List[SimulationResult]
+            The simulation of each scheme
+
+        Notes
+        -----
+        The paths of a scheme are the ones of an engine reading a RandomStore
+        generated with the seed of this one. The generator advances as for a
+        single run of n_paths paths.
+        """
+        return [SimulationResult(res) for res in super()._generate_batch(list(schemes), S0, n, T, n_paths, v0)]
+
+    def iter_chunks(self, S0: float, v0: float | None, n: int, T: float, n_paths: int, chunk_paths: int,
+                    observe = None, volatility: bool = False):
+        """
+        Iterates over a simulation by blocks of paths, so that any number of
+        paths can be processed with a fixed memory. The next block is
+        simulated on background threads while the current one is processed.
+
+        Parameters
+        ----------
+        S0 : float
+            Initial spot 
+        v0 : float | None
+            Initial volatility 
+        n : int
+            Number of steps of each path
+        T : float
+            Time interval
+        n_paths : int
+            Total number of paths
+        chunk_paths : int
+            Number of paths of each block, the last one holds the remaining
+            paths
+        observe : Sequence[int] | None
+            Step indices to store, see generate
+        volatility : bool
+            Whether to also yield the volatility of the paths, which requires
+            the engine to return it
+
+        Yields
+        ------
+        numpy.ndarray | (numpy.ndarray, numpy.ndarray)
+            Read-only views of the spot paths of each block (one row = one
+            path), with the volatility paths if requested
+
+        Notes
+        -----
+        The blocks put end to end are the paths of generate with the same
+        seed, and iterating does not advance the generator of the engine. A
+        block is recycled once its views are deleted : keep a copy to retain
+        it.
+        """
+        observe = None if observe is None else [int(i) for i in observe]
+        for block in super()._iter_chunks(S0, n, T, n_paths, chunk_paths, v0, observe):
+            res = SimulationResult(block)
+            yield (res.spot_values(), res.vol_values()) if volatility else res.spot_values()
+
+    def generate_on_grid(self, S0: float, times, n_paths: int, v0: float | None = None, max_dt: float | None = None, observe_times = None):
+        """
+        Returns a MonteCarlo simulation on an explicit time grid. Each step
+        uses its own time interval, so simulating only the event dates of a
+        product is enough for non path-dependent payoffs.
+
+        Parameters
+        ----------
+        S0 : float
+            Initial spot 
+        times : Sequence[float]
+            Strictly increasing simulation times in years, starting at 0
+        n_paths : int
+            Number of paths to simulate
+        v0 : float | None
+            Initial volatility 
+        max_dt : float | None
+            If set, steps longer than max_dt are split into equal sub-steps
+        observe_times : Sequence[float] | None
+            Times of the grid to store. The terminal time is always stored.
+
+        Returns
+        -------
+        SimulationResult
+        """
+        observe_times = None if observe_times is None else list(observe_times)
+        sim_res = super()._generate_on_grid(S0, list(times), n_paths, v0, max_dt, observe_times)
+        return SimulationResult(sim_res)
+    
+    def generate_lazy(self, S0: float, times, n_paths: int, v0: float | None = None, max_dt: float | None = None, observe_times = None, cache_blocks: int = 0):
+        """
+        Same as generate_on_grid, but only the seeds of the paths are kept.
+        The paths are regenerated by blocks of 1024 each time they are read,
+        so pricing instruments on the result needs little memory.
+
+        Parameters
+        ----------
+        S0 : float
+            Initial spot 
+        times : Sequence[float]
+            Strictly increasing simulation times in years, starting at 0
+        n_paths : int
+            Number of paths to simulate
+        v0 : float | None
+            Initial volatility 
+        max_dt : float | None
+            If set, steps longer than max_dt are split into equal sub-steps
+        observe_times : Sequence[float] | None
+            Times of the grid to store. The terminal time is always stored.
+        cache_blocks : int
+            Number of regenerated blocks kept in memory, the least recently
+            used are dropped first. 0 keeps none
+
+        Returns
+        -------
+        SimulationResult
+            A lazy result, with the same paths as generate_on_grid with the
+            same seed
+        """
+        observe_times = None if observe_times is None else list(observe_times)
+        sim_res = super()._generate_lazy(S0, list(times), n_paths, v0, max_dt, observe_times, cache_blocks)
+        return SimulationResult(sim_res)
+
+    def generate_to_file(self, path: str, S0: float, times, n_paths: int, v0: float | None = None, max_dt: float | None = None, observe_times = None):
+        """
+        Same as generate_on_grid, but the paths are written to an archive
+        directory instead of the memory. The number of paths is only
+        limited by the disk. The header of the archive records the seed and
+        the scheme.
+
+        Parameters
+        ----------
+        path : str
+            The archive directory, created if needed
+        S0 : float
+            Initial spot 
+        times : Sequence[float]
+            Strictly increasing simulation times in years, starting at 0
+        n_paths : int
+            Number of paths to simulate
+        v0 : float | None
+            Initial volatility 
+        max_dt : float | None
+            If set, steps longer than max_dt are split into equal sub-steps
+        observe_times : Sequence[float] | None
+            Times of the grid to store. The terminal time is always stored.
+
+        Returns
+        -------
+        SimulationResult
+            The archive, memory mapped read-only. See SimulationResult.load
+        """
+        observe_times = None if observe_times is None else list(observe_times)
+        sim_res = super()._generate_to_file(str(path), S0, list(times), n_paths, v0, max_dt, observe_times)
         return SimulationResult(sim_res)
     
-    def configure(self, seed: int | None = None, n_jobs: int | None = None):
+    def use_workspace(self, enabled: bool = True, max_buffers: int = 4):
+        """
+        Keeps the path and seed buffers of the engine alive across runs, so
+        that repeated simulations of the same size (such as repricing a book
+        with a Pricer) do not allocate their memory again.
+
+        A buffer is only reused once every SimulationResult and NumPy matrix
+        using it has been deleted : results are never overwritten. Buffers
+        only grow, and are freed with use_workspace(False).
+
+        Parameters
+        ----------
+        enabled : bool
+            Whether the engine reuses its buffers
+        max_buffers : int
+            Number of buffers of each kind kept by the engine
+        """
+        self._set_workspace(max_buffers if enabled else None)
+
+    def workspace_bytes(self):
+        """
+        Returns the memory held by the workspace of the engine, in bytes
+        """
+        return self._workspace_bytes()
+
+    def use_cache(self, enabled: bool = True, max_bytes: int = 1 << 30):
+        """
+        Keeps the paths of the recent simulations of the engine, and of the
+        Pricers using it, so that a repeated simulation returns the stored
+        paths instead of simulating them again.
+
+        Only seeded, reset runs are cached : a simulation is stored when it
+        starts right after configure with a seed or reset_rng. Any later
+        identical simulation (same seed, spot, grid, settings and model
+        parameters) returns these paths, so repeated pricings give the same
+        price without reset_rng. The generator advances as if the paths were
+        simulated. Without a seed nothing is cached. The least recently used
+        runs are dropped beyond max_bytes.
+
+        Parameters
+        ----------
+        enabled : bool
+            Whether the engine caches its runs
+        max_bytes : int
+            Memory the cached paths may hold, in bytes
+        """
+        self._set_cache(max_bytes if enabled else None)
+
+    def use_random_store(self, store: RandomStore | None):
+        """
+        Makes the runs of the engine, and of the Pricers using it, read
+        their normals from a RandomStore instead of drawing them : every run
+        reads the first n_paths paths of the store and the generator does
+        not advance.
+
+        Parameters
+        ----------
+        store : RandomStore or None
+            The store, whose number of steps must match the runs. None draws
+            the normals from the generator again
+        """
+        self._set_random_store(None if store is None else store.store)
+
+    def clear_cache(self):
+        """
+        Drops the runs cached by the engine
+        """
+        self._clear_cache()
+
+    def cache_stats(self):
+        """
+        Returns the state of the cache of the engine
+
+        Returns
+        -------
+        dict
+            entries, bytes and max_bytes of the cache, and its number of
+            hits and misses. All zero without cache
+        """
+        return self._cache_stats()
+
+    def configure(self, seed: int | None = None, n_jobs: int | None = None, layout: str | None = None):
         """
         Add configurations to the MonteCarlo engine.
 
@@ -366,8 +879,22 @@ class MonteCarlo(_MonteCarlo):
             The seed to be used for randomness
         n_jobs : int
             The number of CPU core to use. -1 uses all the cores available
-        """
-        self._configure(seed, n_jobs, None)
+        layout : str
+            The memory order of the generated paths. "path" (default) stores
+            each path contiguously. "time" stores the values of all the paths
+            at a date contiguously, which speeds up cross-sectional reads such
+            as sim.spot_values()[:, k]. The returned matrices are the same,
+            only their strides change.
+        """
+        if layout is None:
+            _layout = None
+        elif layout.lower() == "path":
+            _layout = _Layout.PathMajor
+        elif layout.lower() == "time":
+            _layout = _Layout.TimeMajor
+        else:
+            raise ValueError(f"MonteCarlo : the layout must be 'path' or 'time', received {layout}.")
+        self._configure(seed, n_jobs, None, _layout)
 
 
 class LocalVolatilitySurface(_LocalVolatilitySurface):
@@ -406,6 +933,24 @@ class LocalVolatilitySurface(_LocalVolatilitySurface):
             The interpolated local volatility
         """
         return self._sigma(t, S)
+
+    def sigma_batch(self, t : float, S : numpy.ndarray):
+        """
+        Computes the interpolated local volatility at time t for an array of spots.
+
+        Parameters
+        ----------
+        t : float
+            Time in years.
+        S : numpy.ndarray
+            1D array of spot prices.
+
+        Returns
+        -------
+        numpy.ndarray
+            The interpolated local volatilities, one per spot
+        """
+        return self._sigma_batch(t, S)
     
 #-------------------------------- Options
 
@@ -478,8 +1023,57 @@ class DigitalCallPayoff(_DigitalCallPayoff):
         """
         super().__init__()
 
+class FunctionPayoff(_FunctionPayoff):
+    def __init__(self, function, chunk_paths : int = 16384):
+        """
+        Payoff computed by a Python function on blocks of paths, typically
+        with NumPy. The pricer simulates the paths by chunks and calls the
+        function on each chunk while the next one is simulated, so that the
+        whole simulation is never stored.
+
+        Parameters
+        ----------
+        function : Callable[[numpy.ndarray, float], numpy.ndarray]
+            Maps a read-only (n_paths, n_steps + 1) block of spot paths (one
+            row = one path) and the strike of the contract to the 1-D array
+            of their payoffs. The block is only valid during the call : copy
+            it to keep it
+        chunk_paths : int
+            The number of paths per call
+        """
+        super().__init__(function, chunk_paths)
+
+class ExpressionPayoff(_ExpressionPayoff):
+    def __init__(self, expression : str):
+        """
+        Payoff written as an expression of the path, compiled once in C++
+        and evaluated on blocks of paths.
+
+        Parameters
+        ----------
+        expression : str
+            The payoff, which can read :
+            - S[T] the terminal spot, S[t] the fixing at time t in years (the
+              last simulated spot at or before t)
+            - max(e), min(e), mean(e), sum(e) over the states of the path of
+              an expression e of the spot S
+            - K the strike, numbers, + - * /, comparisons < <= > >= worth 1
+              when true and 0 otherwise, max(a, b, ...), min(a, b, ...), abs,
+              exp, log, sqrt
+
+        Examples
+        --------
+        >>> capped_call = ExpressionPayoff("min(max(S[T] - K, 0), 20)")
+        >>> asian_call = ExpressionPayoff("max(mean(S) - K, 0)")
+        >>> range_accrual = ExpressionPayoff("mean((S > 90) * (S < 110))")
+        """
+        super().__init__(expression)
+
+    def __repr__(self):
+        return f"ExpressionPayoff({self.expression!r})"
+
 class BarrierPayoff(_BarrierPayoff):
-    def __init__(self, H : float, direction : str, nature : str, payoff : Payoff):
+    def __init__(self, H : float, direction : str, nature : str, payoff : Payoff, monitoring : str = "discrete"):
         """
         Payoff for a barrier option
 
@@ -493,6 +1087,11 @@ class BarrierPayoff(_BarrierPayoff):
             The nature of the barrier. Must be "in" or "out"
         payoff : Payoff
             The payoff to be activated or deactivated if the barrier is hit 
+        monitoring : str
+            "discrete" checks the barrier on the simulated spots only.
+            "continuous" also accounts for crossings between two steps with a
+            Brownian bridge, which needs the volatility paths (default engine
+            setting) and converges with a few dozen steps.
         """
         if (direction.lower() == "up"):
             _dir = _Direction.Up
@@ -507,8 +1106,15 @@ class BarrierPayoff(_BarrierPayoff):
             _nat = _Nature.Out
         else:
             raise ValueError(f"Barrier : the nature must be 'in' or 'out', received {nature}.")
+
+        if (monitoring.lower() == "discrete"):
+            _mon = _Monitoring.Discrete
+        elif (monitoring.lower() == "continuous"):
+            _mon = _Monitoring.Continuous
+        else:
+            raise ValueError(f"Barrier : the monitoring must be 'discrete' or 'continuous', received {monitoring}.")
         
-        super().__init__(H, _dir, _nat, payoff)
+        super().__init__(H, _dir, _nat, payoff, _mon)
 
 class Instrument(_Instrument):
     def __init__(self, contract : OptionContract, payoff : Payoff):
@@ -519,9 +1125,15 @@ class Instrument(_Instrument):
         ----------
         contract : OptionContract
             The term sheet
-        payoff : Payoff
-            The payoff of the instrument
+        payoff : Payoff | str | Callable[[numpy.ndarray, float], numpy.ndarray]
+            The payoff of the instrument. A string is compiled into an
+            ExpressionPayoff, a function of a block of paths and the strike is
+            wrapped in a FunctionPayoff
         """
+        if isinstance(payoff, str):
+            payoff = ExpressionPayoff(payoff)
+        elif callable(payoff) and not isinstance(payoff, _Payoff):
+            payoff = FunctionPayoff(payoff)
 
         super().__init__(contract, payoff)
 
@@ -587,9 +1199,9 @@ def DigitalPut(K : float, T : float):
     """
     return Instrument(OptionContract(K, T), DigitalPutPayoff())
 
-def BlackScholesEngine(mu : float, sigma : float):
+def BlackScholesEngine(mu : float, sigma : float, scheme : str = "exact"):
     """
-    Returns a Monte Carlo engine with a Euler discretization of BlackScholes model
+    Returns a Monte Carlo engine configured with a BlackScholes model
 
     Parameters
     ----------
@@ -597,10 +1209,18 @@ def BlackScholesEngine(mu : float, sigma : float):
         The drift rate for the Black Scholes model
     sigma : float
         The volatility for the Black Scholes model
+    scheme : str
+        The scheme to use in ["exact", "euler"]. The exact scheme lets the
+        Pricer simulate European payoffs in a single step.
     """
+    if scheme.strip().lower() not in ["exact", "euler"]:
+        raise ValueError(f"BlackScholesEngine : the scheme for a BlackScholes model must be in ['exact', 'euler']. Received {scheme}")
+
     model = BlackScholes(mu, sigma)
-    scheme = Euler(model)
-    return MonteCarlo(scheme)
+
+    if scheme.strip().lower() == "exact":
+        return MonteCarlo(EulerBlackScholes(model))
+    return MonteCarlo(Euler(model))
 
 def HestonEngine(mu : float, kappa : float, theta : float, epsilon : float, rho : float, scheme : str = "qe"):
     """
@@ -635,6 +1255,44 @@ def HestonEngine(mu : float, kappa : float, theta : float, epsilon : float, rho
 
 
 
+def BlackScholesBatch(params, scheme : str = "exact"):
+    """
+    Returns the schemes of a BlackScholes model under each parameter set,
+    see MonteCarlo.generate_batch and Pricer.parameter_prices
+
+    Parameters
+    ----------
+    params : Sequence[Sequence[float]]
+        One (mu, sigma) row per parameter set
+    scheme : str
+        The scheme to use in ["exact", "euler"]
+    """
+    if scheme.strip().lower() not in ["exact", "euler"]:
+        raise ValueError(f"BlackScholesBatch : the scheme for a BlackScholes model must be in ['exact', 'euler']. Received {scheme}")
+
+    if scheme.strip().lower() == "exact":
+        return [EulerBlackScholes(BlackScholes(*row)) for row in params]
+    return [Euler(BlackScholes(*row)) for row in params]
+
+def HestonBatch(params, scheme : str = "qe"):
+    """
+    Returns the schemes of a Heston model under each parameter set, see
+    MonteCarlo.generate_batch and Pricer.parameter_prices
+
+    Parameters
+    ----------
+    params : Sequence[Sequence[float]]
+        One (mu, kappa, theta, epsilon, rho) row per parameter set
+    scheme : str
+        The scheme to use in ["qe", "euler"]
+    """
+    if scheme.strip().lower() not in ["qe", "euler"]:
+        raise ValueError(f"HestonBatch : the scheme for a Heston model must be in ['qe', 'euler']. Received {scheme}")
+
+    if scheme.strip().lower() == "qe":
+        return [QE(Heston(*row)) for row in params]
+    return [EulerHeston(Heston(*row)) for row in params]
+
 class MarketState(_MarketState):
     def __init__(self, S: float, r: float, v0 : float | None = None):
         """
@@ -651,6 +1309,42 @@ class MarketState(_MarketState):
         """
         super().__init__(S, r, v0)
 
+class PricingFuture(concurrent.futures.Future):
+    """
+    Result of an asynchronous pricing, see Pricer.price_async.
+
+    A concurrent.futures.Future that can also be awaited from asyncio.
+    cancel() stops a pricing that is already running : the simulation
+    threads skip their remaining paths, and result() raises
+    concurrent.futures.CancelledError.
+    """
+    def __init__(self):
+        super().__init__()
+        self._token = _CancellationToken()
+
+    def cancel(self):
+        self._token.cancel()
+        if super().cancel():
+            return True
+        return not self.done()
+
+    def __await__(self):
+        return asyncio.wrap_future(self).__await__()
+
+
+_executor = None
+_executor_lock = threading.Lock()
+
+def _async_executor():
+    # pricings run their simulation on the OpenMP threads of the engine,
+    # the executor threads only wait for them without holding the GIL
+    global _executor
+    with _executor_lock:
+        if _executor is None:
+            _executor = concurrent.futures.ThreadPoolExecutor(max_workers=4, thread_name_prefix="volmc")
+        return _executor
+
+
 class Pricer(_Pricer):
     def __init__(self, marketstate : MarketState, n_steps : int, n_paths : int, engine : MonteCarlo):
         """
@@ -661,7 +1355,8 @@ class Pricer(_Pricer):
         marketstate : MarketState
             The state of the market at time of pricing
         n_steps : int
-            The number of steps in each path
+            The number of steps in each path. With an exact scheme, instruments
+            that only depend on the terminal spot are priced in a single step.
         n_paths : int
             The number of paths to generate
         engine : MonteCarlo
@@ -671,7 +1366,8 @@ class Pricer(_Pricer):
 
     def price(self, instrument : Instrument):
         """
-        Returns the Monte Carlo simulation price
+        Returns the Monte Carlo simulation price. The GIL is released during
+        the simulation, see price_async to run it in the background
 
         Parameters
         ----------
@@ -691,6 +1387,152 @@ class Pricer(_Pricer):
         """
         return self._batch_price(instrument_list)
 
+    def ladder_price(self, barriers : List[float], direction : str, nature : str, payoff : Payoff, contract : OptionContract):
+        """
+        Prices a ladder of discretely monitored barrier options that only
+        differ by their barrier level, with a single simulation. The paths are
+        sorted once by their extreme spot, so adding levels is almost free.
+
+        Parameters
+        ----------
+        barriers : List[float]
+            The barrier levels
+        direction : str
+            The direction from which the barriers are hit. Must be "up" or "down"
+        nature : str
+            The nature of the barriers. Must be "in" or "out"
+        payoff : Payoff
+            The payoff activated or deactivated by the barriers, it must only
+            depend on the terminal spot
+        contract : OptionContract
+            The strike and maturity shared by the options
+        """
+        if (direction.lower() == "up"):
+            _dir = _Direction.Up
+        elif (direction.lower() == "down"):
+            _dir = _Direction.Down
+        else:
+            raise ValueError(f"Pricer : the direction must be 'up' or 'down', received {direction}.")
+
+        if (nature.lower() == "in"):
+            _nat = _Nature.In
+        elif (nature.lower() == "out"):
+            _nat = _Nature.Out
+        else:
+            raise ValueError(f"Pricer : the nature must be 'in' or 'out', received {nature}.")
+
+        return self._ladder_price(barriers, _dir, _nat, payoff, contract)
+
+    def scenario_prices(self, instrument_list : List[Instrument], spots : List[float], rates : List[float],
+                        vols : List[float] | None = None):
+        """
+        Prices a book of instruments on a grid of market scenarios in one
+        sweep. The instruments of a maturity are simulated once per initial
+        volatility : with a scheme whose paths scale with the spot, such as
+        Black-Scholes or Heston, the paths are rescaled to every spot of the
+        grid, otherwise each spot is simulated on the same random numbers.
+        Rates only discount the payoffs, the drift being a model parameter.
+
+        Parameters
+        ----------
+        instrument_list : List[Instrument]
+            The instruments to price, of any maturities
+        spots : List[float]
+            The initial spots of the grid
+        rates : List[float]
+            The discount rates of the grid
+        vols : List[float] | None
+            The initial volatilities of the grid, for the models that
+            require one
+
+        Returns
+        -------
+        numpy.ndarray
+            The prices, of shape (len(spots), len(vols), len(rates),
+            len(instrument_list)), or (len(spots), len(rates),
+            len(instrument_list)) without vols
+        """
+        axis = [None] if vols is None else list(vols)
+        scenarios = [MarketState(S, r, v0) for S in spots for v0 in axis for r in rates]
+        prices = self._scenario_prices(scenarios, instrument_list)
+        if vols is None:
+            return prices.reshape(len(spots), len(rates), len(instrument_list))
+        return prices.reshape(len(spots), len(axis), len(rates), len(instrument_list))
+
+    def parameter_prices(self, instrument_list : List[Instrument], schemes):
+        """
+        Prices a book of instruments under each scheme of a batch in one
+        simulation per maturity, for instance a model under many parameter
+        sets, see HestonBatch. The schemes step on the same random numbers :
+        the differences between the prices of bumped parameter sets are
+        sensitivities to the parameters.
+
+        Parameters
+        ----------
+        instrument_list : List[Instrument]
+            The instruments to price, of any maturities
+        schemes : Sequence[Scheme]
+            The schemes to price with, in place of the scheme of the engine
+
+        Returns
+        -------
+        numpy.ndarray
+            The prices, of shape (len(schemes), len(instrument_list))
+        """
+        return self._parameter_prices(list(schemes), instrument_list)
+
+    # codes of the payoff column of price_table
+    PAYOFF_CODES = {"call" : 0, "put" : 1, "digital_call" : 2, "digital_put" : 3}
+
+    def price_table(self, K, T, payoff = "call", barrier = None, direction = None, nature = None):
+        """
+        Prices a table of options given by columns, without building an
+        Instrument per option. The options of a same maturity share one
+        simulation, and the prices are computed in C++.
+
+        Parameters
+        ----------
+        K : array_like
+            The strikes
+        T : array_like
+            The maturities
+        payoff : str | array_like
+            The payoff of every row ("call", "put", "digital_call" or
+            "digital_put"), or an integer array of codes, see PAYOFF_CODES
+        barrier : array_like | None
+            The discretely monitored barrier of each row, NaN for a row
+            without barrier
+        direction : str | array_like | None
+            The direction of the barriers, "up" or "down" for every row, or an
+            integer array (0 = up, 1 = down). Required with barrier
+        nature : str | array_like | None
+            The nature of the barriers, "in" or "out" for every row, or an
+            integer array (0 = in, 1 = out). Required with barrier
+
+        Returns
+        -------
+        (numpy.ndarray, numpy.ndarray)
+            The price and the standard error of the Monte Carlo estimate of
+            each row
+        """
+        def codes(value, names, column):
+            if not isinstance(value, str):
+                return value
+            if value.lower() not in names:
+                raise ValueError(f"Pricer : the {column} must be one of {list(names)}, received {value}.")
+            return [names[value.lower()]] * len(K)
+
+        payoff = codes(payoff, self.PAYOFF_CODES, "payoff")
+        if barrier is not None:
+            if direction is None or nature is None:
+                raise ValueError("Pricer : barriers require a direction and a nature.")
+            direction = codes(direction, {"up" : 0, "down" : 1}, "direction")
+            nature = codes(nature, {"in" : 0, "out" : 1}, "nature")
+        else:
+            direction = nature = None
+
+        return self._price_table(K, T, payoff, barrier, direction, nature)
+
     def delta(self, instrument : Instrument, h : float):
         """
         Computes the delta using bump-and-revalue.
@@ -717,6 +1559,62 @@ class Pricer(_Pricer):
         """
         return self._gamma(instrument, h)
 
+    def _submit(self, method, args, executor):
+        future = PricingFuture()
+
+        def run():
+            if not future.set_running_or_notify_cancel():
+                return
+            try:
+                future.set_result(method(*args, token=future._token))
+            except _Cancelled:
+                future.set_exception(concurrent.futures.CancelledError())
+            except BaseException as e:
+                future.set_exception(e)
+
+        (executor or _async_executor()).submit(run)
+        return future
+
+    def price_async(self, instrument : Instrument, executor = None):
+        """
+        Starts the pricing of an instrument and returns immediately. The
+        simulation runs without the GIL, so that other Python threads and
+        coroutines keep running, and several pricings may overlap.
+
+        Parameters
+        ----------
+        instrument : Instrument
+            The instrument to price
+        executor : concurrent.futures.Executor | None
+            The executor that waits for the pricing. Defaults to a pool of
+            4 threads shared by all the pricers
+
+        Returns
+        -------
+        PricingFuture
+            future.result() returns the price, `await future` also works in
+            a coroutine. future.cancel() stops the simulation.
+        """
+        return self._submit(self._compute_price, (instrument,), executor)
+
+    def batch_price_async(self, instrument_list : List[Instrument], executor = None):
+        """
+        Asynchronous version of batch_price, see price_async
+        """
+        return self._submit(self._batch_price, (instrument_list,), executor)
+
+    def delta_async(self, instrument : Instrument, h : float, executor = None):
+        """
+        Asynchronous version of delta, see price_async
+        """
+        return self._submit(self._delta, (instrument, h), executor)
+
+    def gamma_async(self, instrument : Instrument, h : float, executor = None):
+        """
+        Asynchronous version of gamma, see price_async
+        """
+        return self._submit(self._gamma, (instrument, h), executor)
+
     def reconfigure(self, n_steps : int = None, n_paths : int = None, marketstate : MarketState = None):
         """
         Change the parameters of the pricing engine.
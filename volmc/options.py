@@ -1,4 +1,4 @@
-from ._api import Call, Put, DigitalCall, DigitalPut, BarrierPayoff, CallPayoff, PutPayoff, DigitalCallPayoff, DigitalPutPayoff, Instrument, OptionContract
+from ._api import Call, Put, DigitalCall, DigitalPut, BarrierPayoff, CallPayoff, PutPayoff, DigitalCallPayoff, DigitalPutPayoff, FunctionPayoff, ExpressionPayoff, Instrument, OptionContract
 
-__all__ = ["Call", "Put", "OptionContract", "PutPayoff", "CallPayoff", "DigitalCallPayoff", "DigitalPutPayoff", "BarrierPayoff", "Instrument", "DigitalCall", "DigitalPut"]
+__all__ = ["Call", "Put", "OptionContract", "PutPayoff", "CallPayoff", "DigitalCallPayoff", "DigitalPutPayoff", "BarrierPayoff", "FunctionPayoff", "ExpressionPayoff", "Instrument", "DigitalCall", "DigitalPut"]
            
\ No newline at end of file
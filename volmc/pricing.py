@@ -1,3 +1,3 @@
-from ._api import Pricer, MonteCarlo, BlackScholesEngine, HestonEngine
+from ._api import Pricer, PricingFuture, MonteCarlo, RandomStore, BlackScholesEngine, HestonEngine, BlackScholesBatch, HestonBatch
 
-__all__ = ["Pricer", "MonteCarlo", "BlackScholesEngine", "HestonEngine"]
\ No newline at end of file
+__all__ = ["Pricer", "PricingFuture", "MonteCarlo", "RandomStore", "BlackScholesEngine", "HestonEngine", "BlackScholesBatch", "HestonBatch"]
\ No newline at end of file
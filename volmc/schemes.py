@@ -1,3 +1,3 @@
-from ._api import Euler, EulerHeston, QE
+from ._api import Euler, EulerHeston, QE, EulerBlackScholes, ExactVasicek
 
-__all__ = ["EulerHeston", "QE", "Euler"]
\ No newline at end of file
+__all__ = ["EulerHeston", "QE", "Euler", "EulerBlackScholes", "ExactVasicek"]
\ No newline at end of file